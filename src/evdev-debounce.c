@@ -475,21 +475,15 @@ fallback_debounce_handle_state(struct fallback_dispatch *dispatch,
 			       uint64_t time)
 {
 	unsigned int changed[16] = {0}; /* event codes of changed buttons */
-	size_t nchanged = 0;
+	size_t nchanged;
 	bool flushed = false;
 
-	for (unsigned int code = 0; code <= KEY_MAX; code++) {
-		if (get_key_type(code) != KEY_TYPE_BUTTON)
-			continue;
-
-		if (hw_key_has_changed(dispatch, code))
-			changed[nchanged++] = code;
-
-		/* If you manage to press more than 16 buttons in the same
-		 * frame, we just quietly ignore the rest of them */
-		if (nchanged == ARRAY_LENGTH(changed))
-			break;
-	}
+	/* If you manage to press more than 16 buttons in the same
+	 * frame, we just quietly ignore the rest of them */
+	nchanged = hw_key_get_changed(dispatch,
+				      KEY_TYPE_BUTTON,
+				      changed,
+				      ARRAY_LENGTH(changed));
 
 	/* If we have more than one button this frame or a different button,
 	 * flush the state machine with otherbutton */
@@ -572,6 +572,7 @@ fallback_process_key(struct fallback_dispatch *dispatch,
 			return;
 
 		dispatch->pending_event |= EVDEV_KEY;
+		hw_key_mark_changed(dispatch, e->code);
 		break;
 	}
 
@@ -1019,18 +1020,9 @@ fallback_handle_state(struct fallback_dispatch *dispatch,
 
 	/* Buttons and keys */
 	if (dispatch->pending_event & EVDEV_KEY) {
-		bool want_debounce = false;
-		for (unsigned int code = 0; code <= KEY_MAX; code++) {
-			if (!hw_key_has_changed(dispatch, code))
-				continue;
+		unsigned int button;
 
-			if (get_key_type(code) == KEY_TYPE_BUTTON) {
-				want_debounce = true;
-				break;
-			}
-		}
-
-		if (want_debounce)
+		if (hw_key_get_changed(dispatch, KEY_TYPE_BUTTON, &button, 1))
 			fallback_debounce_handle_state(dispatch, time);
 
 		hw_key_update_last_state(dispatch);
@@ -1161,7 +1153,8 @@ fallback_return_to_neutral_state(struct fallback_dispatch *dispatch,
 	cancel_touches(dispatch, device, NULL, time);
 	release_pressed_keys(dispatch, device, time);
 	memset(dispatch->hw_key_mask, 0, sizeof(dispatch->hw_key_mask));
-	memset(dispatch->hw_key_mask, 0, sizeof(dispatch->last_hw_key_mask));
+	memset(dispatch->last_hw_key_mask, 0, sizeof(dispatch->last_hw_key_mask));
+	hw_key_reset_changed(dispatch);
 }
 
 static void
@@ -1730,6 +1723,13 @@ fallback_dispatch_create(struct libinput_device *libinput_device)
 
 	fallback_dispatch_init_switch(dispatch, device);
 
+	/* lid switches pair with keyboards, keyboards and trackpoints with
+	 * tablet mode switches */
+	if (device->tags & EVDEV_TAG_LID_SWITCH)
+		device->pairing.subscriptions |= bit(EVDEV_ROLE_KEYBOARD);
+	if (device->tags & (EVDEV_TAG_KEYBOARD|EVDEV_TAG_TRACKPOINT))
+		device->pairing.subscriptions |= bit(EVDEV_ROLE_TABLET_MODE_SWITCH);
+
 	if (device->left_handed.want_enabled)
 		evdev_init_left_handed(device,
 				       fallback_change_to_left_handed);
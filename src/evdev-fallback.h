@@ -120,6 +120,15 @@ struct fallback_dispatch {
 	unsigned long hw_key_mask[NLONGS(KEY_CNT)];
 	unsigned long last_hw_key_mask[NLONGS(KEY_CNT)];
 
+	/* Key and button codes that changed state in the current frame,
+	 * sorted in ascending order. If more keys change in one frame than
+	 * fit here, overflow is set and we scan the whole mask instead. */
+	struct {
+		unsigned int codes[32];
+		size_t count;
+		bool overflow;
+	} changed_keys;
+
 	enum evdev_event_type pending_event;
 
 	struct {
@@ -218,6 +227,81 @@ hw_key_has_changed(struct fallback_dispatch *dispatch, int code)
 		long_bit_is_set(dispatch->last_hw_key_mask, code);
 }
 
+static inline void
+hw_key_mark_changed(struct fallback_dispatch *dispatch, unsigned int code)
+{
+	unsigned int *codes = dispatch->changed_keys.codes;
+	size_t count = dispatch->changed_keys.count;
+	size_t idx = count;
+
+	if (dispatch->changed_keys.overflow)
+		return;
+
+	while (idx > 0 && codes[idx - 1] >= code) {
+		if (codes[idx - 1] == code)
+			return;
+		idx--;
+	}
+
+	if (count == ARRAY_LENGTH(dispatch->changed_keys.codes)) {
+		dispatch->changed_keys.overflow = true;
+		return;
+	}
+
+	memmove(&codes[idx + 1], &codes[idx], (count - idx) * sizeof(*codes));
+	codes[idx] = code;
+	dispatch->changed_keys.count++;
+}
+
+static inline void
+hw_key_reset_changed(struct fallback_dispatch *dispatch)
+{
+	dispatch->changed_keys.count = 0;
+	dispatch->changed_keys.overflow = false;
+}
+
+/**
+ * Fill codes with up to ncodes key codes of the given type whose state
+ * differs from the last frame, in ascending order.
+ *
+ * @return the number of codes filled in
+ */
+static inline size_t
+hw_key_get_changed(struct fallback_dispatch *dispatch,
+		   enum key_type type,
+		   unsigned int *codes,
+		   size_t ncodes)
+{
+	size_t nchanged = 0;
+
+	if (!dispatch->changed_keys.overflow) {
+		for (size_t i = 0;
+		     i < dispatch->changed_keys.count && nchanged < ncodes;
+		     i++) {
+			unsigned int code = dispatch->changed_keys.codes[i];
+
+			/* pressed and released within the same frame */
+			if (!hw_key_has_changed(dispatch, code))
+				continue;
+
+			if (get_key_type(code) == type)
+				codes[nchanged++] = code;
+		}
+
+		return nchanged;
+	}
+
+	for (unsigned int code = 0;
+	     code <= KEY_MAX && nchanged < ncodes;
+	     code++) {
+		if (get_key_type(code) == type &&
+		    hw_key_has_changed(dispatch, code))
+			codes[nchanged++] = code;
+	}
+
+	return nchanged;
+}
+
 static inline void
 hw_key_update_last_state(struct fallback_dispatch *dispatch)
 {
@@ -228,6 +312,7 @@ hw_key_update_last_state(struct fallback_dispatch *dispatch)
 	memcpy(dispatch->last_hw_key_mask,
 	       dispatch->hw_key_mask,
 	       sizeof(dispatch->hw_key_mask));
+	hw_key_reset_changed(dispatch);
 }
 
 static inline bool
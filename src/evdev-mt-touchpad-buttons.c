@@ -147,7 +147,7 @@ tp_button_set_enter_timer(struct tp_dispatch *tp,
 			  struct tp_touch *t,
 			  uint64_t time)
 {
-	libinput_timer_set(&t->button.timer,
+	libinput_timer_set(&tp_touch_timers(t)->button,
 			   time + DEFAULT_BUTTON_ENTER_TIMEOUT);
 }
 
@@ -156,7 +156,7 @@ tp_button_set_leave_timer(struct tp_dispatch *tp,
 			  struct tp_touch *t,
 			  uint64_t time)
 {
-	libinput_timer_set(&t->button.timer,
+	libinput_timer_set(&tp_touch_timers(t)->button,
 			   time + DEFAULT_BUTTON_LEAVE_TIMEOUT);
 }
 
@@ -171,7 +171,7 @@ tp_button_set_state(struct tp_dispatch *tp,
 		    enum button_event event,
 		    uint64_t time)
 {
-	libinput_timer_cancel(&t->button.timer);
+	libinput_timer_cancel(&tp_touch_timers(t)->button);
 
 	t->button.state = new_state;
 
@@ -1011,7 +1011,7 @@ tp_init_buttons(struct tp_dispatch *tp,
 			 evdev_device_get_sysname(device),
 			 i);
 		t->button.state = BUTTON_STATE_NONE;
-		libinput_timer_init(&t->button.timer,
+		libinput_timer_init(&tp_touch_timers(t)->button,
 				    tp_libinput_context(tp),
 				    timer_name,
 				    tp_button_handle_timeout, t);
@@ -1024,8 +1024,8 @@ tp_remove_buttons(struct tp_dispatch *tp)
 	struct tp_touch *t;
 
 	tp_for_each_touch(tp, t) {
-		libinput_timer_cancel(&t->button.timer);
-		libinput_timer_destroy(&t->button.timer);
+		libinput_timer_cancel(&tp_touch_timers(t)->button);
+		libinput_timer_destroy(&tp_touch_timers(t)->button);
 	}
 }
 
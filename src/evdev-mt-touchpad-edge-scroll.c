@@ -100,7 +100,7 @@ tp_edge_scroll_set_timer(struct tp_dispatch *tp,
 	    LIBINPUT_CONFIG_CLICK_METHOD_BUTTON_AREAS)
 		return;
 
-	libinput_timer_set(&t->scroll.timer,
+	libinput_timer_set(&tp_touch_timers(t)->scroll,
 			   time + DEFAULT_SCROLL_LOCK_TIMEOUT);
 }
 
@@ -110,7 +110,7 @@ tp_edge_scroll_set_state(struct tp_dispatch *tp,
 			 enum tp_edge_scroll_touch_state state,
 			 uint64_t time)
 {
-	libinput_timer_cancel(&t->scroll.timer);
+	libinput_timer_cancel(&tp_touch_timers(t)->scroll);
 
 	t->scroll.edge_state = state;
 
@@ -342,7 +342,7 @@ tp_edge_scroll_init(struct tp_dispatch *tp, struct evdev_device *device)
 			 evdev_device_get_sysname(device),
 			 i);
 		t->scroll.direction = -1;
-		libinput_timer_init(&t->scroll.timer,
+		libinput_timer_init(&tp_touch_timers(t)->scroll,
 				    tp_libinput_context(tp),
 				    timer_name,
 				    tp_edge_scroll_handle_timeout, t);
@@ -355,8 +355,8 @@ tp_remove_edge_scroll(struct tp_dispatch *tp)
 	struct tp_touch *t;
 
 	tp_for_each_touch(tp, t) {
-		libinput_timer_cancel(&t->scroll.timer);
-		libinput_timer_destroy(&t->scroll.timer);
+		libinput_timer_cancel(&tp_touch_timers(t)->scroll);
+		libinput_timer_destroy(&tp_touch_timers(t)->scroll);
 	}
 }
 
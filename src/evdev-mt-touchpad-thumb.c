@@ -388,7 +388,6 @@ tp_init_thumb(struct tp_dispatch *tp)
 	struct device_coords edges;
 	struct phys_coords mm = { 0.0, 0.0 };
 	uint32_t threshold;
-	struct quirks_context *quirks;
 	struct quirks *q;
 
 	tp->thumb.detect_thumbs = false;
@@ -417,8 +416,7 @@ tp_init_thumb(struct tp_dispatch *tp)
 	edges = evdev_device_mm_to_units(device, &mm);
 	tp->thumb.lower_thumb_line = edges.y;
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 
 	if (libevdev_has_event_code(device->evdev, EV_ABS, ABS_MT_PRESSURE)) {
 		if (quirks_get_uint32(q,
@@ -2015,6 +2015,7 @@ tp_interface_destroy(struct evdev_dispatch *dispatch)
 	libinput_timer_destroy(&tp->tap.timer);
 	libinput_timer_destroy(&tp->gesture.finger_count_switch_timer);
 	free(tp->touches);
+	free(tp->touch_timers);
 	free(tp);
 }
 
@@ -2649,13 +2650,14 @@ tp_interface_device_removed(struct evdev_device *device,
 
 	if (tp->sendevents.current_mode ==
 		    LIBINPUT_CONFIG_SEND_EVENTS_DISABLED_ON_EXTERNAL_MOUSE) {
-		struct libinput_device *dev;
+		struct libinput_seat *seat = device->base.seat;
+		struct evdev_role_link *l;
 		bool found = false;
 
-		list_for_each(dev, &device->base.seat->devices_list, link) {
-			struct evdev_device *d = evdev_device(dev);
-			if (d != removed_device &&
-			    (d->tags & EVDEV_TAG_EXTERNAL_MOUSE)) {
+		list_for_each(l,
+			      &seat->role_devices[EVDEV_ROLE_EXTERNAL_MOUSE],
+			      link) {
+			if (l->device != removed_device) {
 				found = true;
 				break;
 			}
@@ -2691,14 +2693,13 @@ evdev_tag_touchpad_external(struct evdev_device *device)
 }
 
 static void
-evdev_tag_touchpad(struct evdev_device *device,
-		   struct udev_device *udev_device)
+evdev_tag_touchpad(struct evdev_device *device)
 {
 	int bustype, vendor;
 	const char *prop;
 
-	prop = udev_device_get_property_value(udev_device,
-					      "ID_INPUT_TOUCHPAD_INTEGRATION");
+	prop = evdev_device_get_property(device,
+					 "ID_INPUT_TOUCHPAD_INTEGRATION");
 	if (prop) {
 		if (streq(prop, "internal")) {
 			evdev_tag_touchpad_internal(device);
@@ -2933,6 +2934,7 @@ tp_init_slots(struct tp_dispatch *tp,
 
 	tp->ntouches = max(tp->num_slots, n_btn_tool_touches);
 	tp->touches = zalloc(tp->ntouches * sizeof(struct tp_touch));
+	tp->touch_timers = zalloc(tp->ntouches * sizeof(*tp->touch_timers));
 
 	for (i = 0; i < tp->ntouches; i++)
 		tp_init_touch(tp, &tp->touches[i], i);
@@ -3198,14 +3200,12 @@ tp_dwt_config_get_default(struct libinput_device *device)
 static inline bool
 tp_is_tpkb_combo_below(struct evdev_device *device)
 {
-	struct quirks_context *quirks;
 	struct quirks *q;
 	char *prop;
 	enum tpkbcombo_layout layout = TPKBCOMBO_LAYOUT_UNKNOWN;
 	int rc = false;
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (!q)
 		return false;
 
@@ -3283,11 +3283,9 @@ tp_read_palm_pressure_prop(struct tp_dispatch *tp,
 {
 	const int default_palm_threshold = 130;
 	uint32_t threshold = default_palm_threshold;
-	struct quirks_context *quirks;
 	struct quirks *q;
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (!q)
 		return threshold;
 
@@ -3318,12 +3316,10 @@ static inline void
 tp_init_palmdetect_size(struct tp_dispatch *tp,
 			struct evdev_device *device)
 {
-	struct quirks_context *quirks;
 	struct quirks *q;
 	uint32_t threshold;
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (!q)
 		return;
 
@@ -3502,7 +3498,6 @@ tp_init_pressure(struct tp_dispatch *tp,
 {
 	const struct input_absinfo *abs;
 	unsigned int code;
-	struct quirks_context *quirks;
 	struct quirks *q;
 	struct quirk_range r;
 	int hi, lo;
@@ -3516,8 +3511,7 @@ tp_init_pressure(struct tp_dispatch *tp,
 	abs = libevdev_get_abs_info(device->evdev, code);
 	assert(abs);
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (q && quirks_get_range(q, QUIRK_ATTR_PRESSURE_RANGE, &r)) {
 		hi = r.upper;
 		lo = r.lower;
@@ -3560,7 +3554,6 @@ static bool
 tp_init_touch_size(struct tp_dispatch *tp,
 		   struct evdev_device *device)
 {
-	struct quirks_context *quirks;
 	struct quirks *q;
 	struct quirk_range r;
 	int lo, hi;
@@ -3572,8 +3565,7 @@ tp_init_touch_size(struct tp_dispatch *tp,
 		return false;
 	}
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (q && quirks_get_range(q, QUIRK_ATTR_TOUCH_SIZE_RANGE, &r)) {
 		hi = r.upper;
 		lo = r.lower;
@@ -3707,15 +3699,10 @@ static void
 tp_suspend_conditional(struct tp_dispatch *tp,
 		       struct evdev_device *device)
 {
-	struct libinput_device *dev;
+	struct libinput_seat *seat = device->base.seat;
 
-	list_for_each(dev, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(dev);
-		if (d->tags & EVDEV_TAG_EXTERNAL_MOUSE) {
-			tp_suspend(tp, device, SUSPEND_EXTERNAL_MOUSE);
-			break;
-		}
-	}
+	if (!list_empty(&seat->role_devices[EVDEV_ROLE_EXTERNAL_MOUSE]))
+		tp_suspend(tp, device, SUSPEND_EXTERNAL_MOUSE);
 }
 
 static enum libinput_config_status
@@ -3867,7 +3854,7 @@ evdev_mt_touchpad_create(struct evdev_device *device)
 {
 	struct tp_dispatch *tp;
 
-	evdev_tag_touchpad(device, device->udev_device);
+	evdev_tag_touchpad(device);
 
 	tp = zalloc(sizeof *tp);
 
@@ -3886,5 +3873,12 @@ evdev_mt_touchpad_create(struct evdev_device *device)
 
 	tp_init_left_handed(tp, device);
 
+	device->pairing.subscriptions = bit(EVDEV_ROLE_KEYBOARD) |
+					bit(EVDEV_ROLE_TRACKPOINT) |
+					bit(EVDEV_ROLE_EXTERNAL_MOUSE) |
+					bit(EVDEV_ROLE_LID_SWITCH) |
+					bit(EVDEV_ROLE_TABLET_MODE_SWITCH) |
+					bit(EVDEV_ROLE_TABLET);
+
 	return &tp->base;
 }
@@ -178,63 +178,36 @@ enum tp_jump_state {
 	JUMP_STATE_EXPECT_DELAY,
 };
 
+/* The fields of struct tp_touch are grouped by use: the ones read for
+ * every touch on every frame first, the ones only used on transitions
+ * last. The per-touch timers are only used on arm and cancel and live in
+ * tp_dispatch->touch_timers, see tp_touch_timers().
+ */
 struct tp_touch {
-	struct tp_dispatch *tp;
-	unsigned int index;
+	/* read for every touch on every frame */
 	enum touch_state state;
 	bool has_ended;				/* TRACKING_ID == -1 */
 	bool dirty;
+	bool was_down; /* if distance == 0, false for pure hovering
+			  touches */
+	bool is_tool_palm; /* MT_TOOL_PALM */
 	struct device_coords point;
-	uint64_t initial_time;
 	int pressure;
-	bool is_tool_palm; /* MT_TOOL_PALM */
 	int major, minor;
 
-	bool was_down; /* if distance == 0, false for pure hovering
-			  touches */
-
-	struct {
-		/* A quirk mostly used on Synaptics touchpads. In a
-		   transition to/from fake touches > num_slots, the current
-		   event data is likely garbage and the subsequent event
-		   is likely too. This marker tells us to reset the motion
-		   history again -> this effectively swallows any motion */
-		bool reset_motion_history;
-	} quirks;
-
 	struct {
+		unsigned int index;
+		unsigned int count;
 		struct tp_history_point {
 			uint64_t time;
 			struct device_coords point;
 		} samples[TOUCHPAD_HISTORY_LENGTH];
-		unsigned int index;
-		unsigned int count;
 	} history;
 
-	struct {
-		double last_delta_mm;
-	} jumps;
-
-	struct {
-		struct device_coords center;
-		uint8_t x_motion_history;
-	} hysteresis;
-
-	/* A pinned touchpoint is the one that pressed the physical button
-	 * on a clickpad. After the release, it won't move until the center
-	 * moves more than a threshold away from the original coordinates
-	 */
-	struct {
-		bool is_pinned;
-		struct device_coords center;
-	} pinned;
-
-	/* Software-button state and timeout if applicable */
 	struct {
 		enum button_state state;
 		/* We use button_event here so we can use == on events */
 		enum button_event current;
-		struct libinput_timer timer;
 		struct device_coords initial;
 		bool has_moved; /* has moved more than threshold */
 		uint64_t initial_time;
@@ -251,7 +224,6 @@ struct tp_touch {
 		enum tp_edge_scroll_touch_state edge_state;
 		uint32_t edge;
 		int direction;
-		struct libinput_timer timer;
 		struct device_coords initial;
 	} scroll;
 
@@ -261,14 +233,53 @@ struct tp_touch {
 		uint64_t time; /* first timestamp if is_palm == true */
 	} palm;
 
-	struct {
-		struct device_coords initial;
-	} gesture;
-
 	struct {
 		double last_speed; /* speed in mm/s at last sample */
 		unsigned int exceeded_count;
 	} speed;
+
+	struct {
+		double last_delta_mm;
+	} jumps;
+
+	struct {
+		struct device_coords center;
+		uint8_t x_motion_history;
+	} hysteresis;
+
+	/* only used when a touch begins or ends, or on specific
+	 * state transitions */
+	struct tp_dispatch *tp;
+	unsigned int index;
+	uint64_t initial_time;
+
+	struct {
+		/* A quirk mostly used on Synaptics touchpads. In a
+		   transition to/from fake touches > num_slots, the current
+		   event data is likely garbage and the subsequent event
+		   is likely too. This marker tells us to reset the motion
+		   history again -> this effectively swallows any motion */
+		bool reset_motion_history;
+	} quirks;
+
+	/* A pinned touchpoint is the one that pressed the physical button
+	 * on a clickpad. After the release, it won't move until the center
+	 * moves more than a threshold away from the original coordinates
+	 */
+	struct {
+		bool is_pinned;
+		struct device_coords center;
+	} pinned;
+
+	struct {
+		struct device_coords initial;
+	} gesture;
+};
+
+/* Software-button and edge scroll timeouts, indexed like tp->touches */
+struct tp_touch_timers {
+	struct libinput_timer button;
+	struct libinput_timer scroll;
 };
 
 enum suspend_trigger {
@@ -300,6 +311,7 @@ struct tp_dispatch {
 	unsigned int num_slots;			/* number of slots */
 	unsigned int ntouches;			/* no slots inc. fakes */
 	struct tp_touch *touches;		/* len == ntouches */
+	struct tp_touch_timers *touch_timers;	/* len == ntouches */
 	/* bit 0: BTN_TOUCH
 	 * bit 1: BTN_TOOL_FINGER
 	 * bit 2: BTN_TOOL_DOUBLETAP
@@ -539,6 +551,12 @@ tp_dispatch(struct evdev_dispatch *dispatch)
 #define tp_for_each_touch(_tp, _t) \
 	for (unsigned int _i = 0; _i < (_tp)->ntouches && (_t = &(_tp)->touches[_i]); _i++)
 
+static inline struct tp_touch_timers *
+tp_touch_timers(const struct tp_touch *t)
+{
+	return &t->tp->touch_timers[t->index];
+}
+
 static inline struct libinput*
 tp_libinput_context(const struct tp_dispatch *tp)
 {
@@ -70,29 +70,45 @@ pad_mode_toggle_button_destroy(struct pad_mode_toggle_button* button)
 	free(button);
 }
 
+/**
+ * @return 1 if the LED is lit, 0 if it is off, or a negative errno on
+ * failure
+ */
 static inline int
-pad_led_group_get_mode(struct pad_led_group *group)
+pad_led_is_lit(struct pad_mode_led *led)
 {
 	char buf[4] = {0};
 	int rc;
 	unsigned int brightness;
-	struct pad_mode_led *led;
 
-	list_for_each(led, &group->led_list, link) {
-		rc = lseek(led->brightness_fd, 0, SEEK_SET);
-		if (rc == -1)
-			return -errno;
+	rc = lseek(led->brightness_fd, 0, SEEK_SET);
+	if (rc == -1)
+		return -errno;
+
+	rc = read(led->brightness_fd, buf, sizeof(buf) - 1);
+	if (rc == -1)
+		return -errno;
+
+	rc = sscanf(buf, "%u\n", &brightness);
+	if (rc != 1)
+		return -EINVAL;
+
+	return brightness != 0;
+}
 
-		rc = read(led->brightness_fd, buf, sizeof(buf) - 1);
-		if (rc == -1)
-			return -errno;
+static inline int
+pad_led_group_get_mode(struct pad_led_group *group)
+{
+	int rc;
+	struct pad_mode_led *led;
 
-		rc = sscanf(buf, "%u\n", &brightness);
-		if (rc != 1)
-			return -EINVAL;
+	list_for_each(led, &group->led_list, link) {
+		rc = pad_led_is_lit(led);
+		if (rc < 0)
+			return rc;
 
 		/* Assumption: only one LED lit up at any time */
-		if (brightness != 0)
+		if (rc)
 			return led->mode_idx;
 	}
 
@@ -186,8 +202,7 @@ pad_group_new_basic(struct pad_dispatch *pad,
 static inline bool
 is_litest_device(struct evdev_device *device)
 {
-	return !!udev_device_get_property_value(device->udev_device,
-						"LIBINPUT_TEST_DEVICE");
+	return !!evdev_device_get_property(device, "LIBINPUT_TEST_DEVICE");
 }
 
 static inline struct pad_led_group *
@@ -244,6 +259,8 @@ pad_led_get_sysfs_base_path(struct evdev_device *device,
 	int rc;
 
 	udev_device = device->udev_device;
+	if (!udev_device)
+		return false;
 
 	/* For testing purposes only allow for a base path set through a
 	 * udev rule. We still expect the normal directory hierarchy inside */
@@ -493,6 +510,9 @@ pad_init_leds_from_libwacom(struct pad_dispatch *pad,
 	WacomDevice *wacom = NULL;
 	int rc = 1;
 
+	if (evdev_device_is_virtual(device))
+		return rc;
+
 	db = libinput_libwacom_ref(li);
 	if (!db)
 		goto out;
@@ -583,12 +603,27 @@ pad_destroy_leds(struct pad_dispatch *pad)
 		libinput_tablet_pad_mode_group_unref(group);
 }
 
+static struct pad_mode_led *
+pad_led_group_get_led(struct pad_led_group *group, unsigned int mode)
+{
+	struct pad_mode_led *led;
+
+	list_for_each(led, &group->led_list, link) {
+		if ((unsigned int)led->mode_idx == mode)
+			return led;
+	}
+
+	return NULL;
+}
+
 void
 pad_button_update_mode(struct libinput_tablet_pad_mode_group *g,
 		       unsigned int button_index,
 		       enum libinput_button_state state)
 {
 	struct pad_led_group *group = (struct pad_led_group*)g;
+	struct pad_mode_led *led;
+	unsigned int next_mode;
 	int rc;
 
 	if (state != LIBINPUT_BUTTON_STATE_PRESSED)
@@ -597,6 +632,28 @@ pad_button_update_mode(struct libinput_tablet_pad_mode_group *g,
 	if (!libinput_tablet_pad_mode_group_button_is_toggle(g, button_index))
 		return;
 
+	if (list_empty(&group->led_list))
+		return;
+
+	/* With a single toggle button, the kernel cycles through the
+	 * modes and has already lit up the next LED by the time we see
+	 * the press. Check that one LED only instead of reading all of
+	 * them, we only need the full read if something else changed
+	 * the mode behind our back.
+	 *
+	 * Pads with one button per mode (e.g. the Cintiq 24HD) switch
+	 * to the button's mode, the order of which we don't know here,
+	 * so these always read all LEDs.
+	 */
+	if (__builtin_popcount(g->toggle_button_mask) == 1) {
+		next_mode = (g->current_mode + 1) % g->num_modes;
+		led = pad_led_group_get_led(group, next_mode);
+		if (led && pad_led_is_lit(led) == 1) {
+			g->current_mode = next_mode;
+			return;
+		}
+	}
+
 	rc = pad_led_group_get_mode(group);
 	if (rc >= 0)
 		group->base.current_mode = rc;
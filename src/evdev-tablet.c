@@ -25,6 +25,7 @@
 #include "evdev-tablet.h"
 
 #include <assert.h>
+#include <math.h>
 #include <stdbool.h>
 #include <string.h>
 
@@ -96,6 +97,7 @@ static inline void
 tablet_history_reset(struct tablet_dispatch *tablet)
 {
 	tablet->history.count = 0;
+	tablet->adaptive.primed = false;
 }
 
 static inline void
@@ -669,8 +671,8 @@ tablet_update_wheel(struct tablet_dispatch *tablet,
 }
 
 static void
-tablet_smoothen_axes(const struct tablet_dispatch *tablet,
-		     struct tablet_axes *axes)
+tablet_smoothen_axes_average(const struct tablet_dispatch *tablet,
+			     struct tablet_axes *axes)
 {
 	size_t i;
 	size_t count = tablet_history_size(tablet);
@@ -693,6 +695,123 @@ tablet_smoothen_axes(const struct tablet_dispatch *tablet,
 	axes->tilt.y = smooth.tilt.y/count;
 }
 
+/* Parameters of the adaptive filter. The cutoff frequency in Hz is
+ * MIN_CUTOFF at rest and goes up by BETA for every mm/s (or deg/s for
+ * tilt) of speed, so a slow pen is smoothed heavily and a fast one
+ * barely at all. */
+#define TABLET_ADAPTIVE_MIN_CUTOFF 1.0 /* Hz */
+#define TABLET_ADAPTIVE_BETA_MM 1.0
+#define TABLET_ADAPTIVE_BETA_DEGREES 0.1
+#define TABLET_ADAPTIVE_DERIVATIVE_CUTOFF 1.0 /* Hz */
+
+static inline double
+tablet_lowpass_alpha(double cutoff, double dt)
+{
+	double tau = 1.0/(2 * M_PI * cutoff);
+
+	return 1.0/(1.0 + tau/dt);
+}
+
+static inline void
+tablet_lowpass_reset(struct tablet_lowpass *lp, double value)
+{
+	lp->value = value;
+	lp->raw = value;
+	lp->derivative = 0.0;
+}
+
+/**
+ * A single step of the speed-adaptive low-pass filter (the "1€ filter",
+ * Casiez et al. 2012). The speed is the low-passed derivative of the
+ * raw samples, the cutoff frequency for the value scales linearly
+ * with that speed.
+ *
+ * @param dt Time since the previous step in seconds
+ */
+static inline double
+tablet_lowpass_filter(struct tablet_lowpass *lp,
+		      double value,
+		      double dt,
+		      double beta)
+{
+	double derivative = (value - lp->raw)/dt;
+	double cutoff;
+
+	lp->raw = value;
+
+	lp->derivative += tablet_lowpass_alpha(TABLET_ADAPTIVE_DERIVATIVE_CUTOFF, dt) *
+			  (derivative - lp->derivative);
+	cutoff = TABLET_ADAPTIVE_MIN_CUTOFF + beta * fabs(lp->derivative);
+	lp->value += tablet_lowpass_alpha(cutoff, dt) * (value - lp->value);
+
+	return lp->value;
+}
+
+static void
+tablet_smoothen_axes_adaptive(struct tablet_dispatch *tablet,
+			      struct tablet_axes *axes,
+			      uint64_t time)
+{
+	const struct input_absinfo *absx = tablet->device->abs.absinfo_x,
+				   *absy = tablet->device->abs.absinfo_y;
+	const struct tablet_axes *raw = &tablet->axes;
+	/* filter in mm so the parameters don't depend on the resolution */
+	double x = 1.0 * raw->point.x/absx->resolution,
+	       y = 1.0 * raw->point.y/absy->resolution;
+	uint64_t elapsed;
+	double dt;
+
+	if (!tablet->adaptive.primed) {
+		tablet_lowpass_reset(&tablet->adaptive.x, x);
+		tablet_lowpass_reset(&tablet->adaptive.y, y);
+		tablet_lowpass_reset(&tablet->adaptive.tilt_x, raw->tilt.x);
+		tablet_lowpass_reset(&tablet->adaptive.tilt_y, raw->tilt.y);
+		tablet->adaptive.primed = true;
+		tablet->adaptive.time = time;
+		axes->point = raw->point;
+		axes->tilt = raw->tilt;
+		return;
+	}
+
+	/* Some devices send several frames with the same timestamp, don't
+	 * let those blow up the derivative */
+	elapsed = time > tablet->adaptive.time ? time - tablet->adaptive.time : 0;
+	dt = max(elapsed, ms2us(1))/1000000.0;
+	tablet->adaptive.time = max(time, tablet->adaptive.time);
+
+	x = tablet_lowpass_filter(&tablet->adaptive.x, x, dt,
+				  TABLET_ADAPTIVE_BETA_MM);
+	y = tablet_lowpass_filter(&tablet->adaptive.y, y, dt,
+				  TABLET_ADAPTIVE_BETA_MM);
+	axes->point.x = round(x * absx->resolution);
+	axes->point.y = round(y * absy->resolution);
+
+	axes->tilt.x = tablet_lowpass_filter(&tablet->adaptive.tilt_x,
+					     raw->tilt.x, dt,
+					     TABLET_ADAPTIVE_BETA_DEGREES);
+	axes->tilt.y = tablet_lowpass_filter(&tablet->adaptive.tilt_y,
+					     raw->tilt.y, dt,
+					     TABLET_ADAPTIVE_BETA_DEGREES);
+}
+
+static void
+tablet_smoothen_axes(struct tablet_dispatch *tablet,
+		     struct tablet_axes *axes,
+		     uint64_t time)
+{
+	switch (tablet->smoothing) {
+	case TABLET_SMOOTHING_NONE:
+		break;
+	case TABLET_SMOOTHING_AVERAGE:
+		tablet_history_push(tablet, &tablet->axes);
+		tablet_smoothen_axes_average(tablet, axes);
+		break;
+	case TABLET_SMOOTHING_ADAPTIVE:
+		tablet_smoothen_axes_adaptive(tablet, axes, time);
+		break;
+	}
+}
+
 static bool
 tablet_check_notify_axes(struct tablet_dispatch *tablet,
 			 struct evdev_device *device,
@@ -739,8 +858,7 @@ out:
 		tablet_history_reset(tablet);
 	}
 
-	tablet_history_push(tablet, &tablet->axes);
-	tablet_smoothen_axes(tablet, &axes);
+	tablet_smoothen_axes(tablet, &axes, time);
 
 	/* The delta relies on the last *smooth* point, so we do it last */
 	axes.delta = tablet_tool_process_delta(tablet, tool, device, &axes, time);
@@ -1076,7 +1194,6 @@ tool_set_pressure_thresholds(struct tablet_dispatch *tablet,
 {
 	struct evdev_device *device = tablet->device;
 	const struct input_absinfo *pressure;
-	struct quirks_context *quirks = NULL;
 	struct quirks *q = NULL;
 	struct quirk_range r;
 	int lo = 0, hi = 1;
@@ -1088,8 +1205,7 @@ tool_set_pressure_thresholds(struct tablet_dispatch *tablet,
 	if (!pressure)
 		goto out;
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 
 	tool->pressure.offset = pressure->minimum;
 
@@ -1121,18 +1237,10 @@ tablet_get_tool(struct tablet_dispatch *tablet,
 {
 	struct libinput *libinput = tablet_libinput_context(tablet);
 	struct libinput_tablet_tool *tool = NULL, *t;
-	struct list *tool_list;
 
-	if (serial) {
-		tool_list = &libinput->tool_list;
-		/* Check if we already have the tool in our list of tools */
-		list_for_each(t, tool_list, link) {
-			if (type == t->type && serial == t->serial) {
-				tool = t;
-				break;
-			}
-		}
-	}
+	/* Check if we already have the tool in the context's registry */
+	if (serial)
+		tool = libinput_tool_registry_lookup(libinput, type, serial);
 
 	/* If we get a tool with a delayed serial number, we already created
 	 * a 0-serial number tool for it earlier. Re-use that, even though
@@ -1140,24 +1248,18 @@ tablet_get_tool(struct tablet_dispatch *tablet,
 	 * https://bugs.freedesktop.org/show_bug.cgi?id=97526
 	 */
 	if (!tool) {
-		tool_list = &tablet->tool_list;
 		/* We can't guarantee that tools without serial numbers are
 		 * unique, so we keep them local to the tablet that they come
-		 * into proximity of instead of storing them in the global tool
-		 * list
+		 * into proximity of instead of storing them in the global
+		 * registry.
 		 * Same as above, but don't bother checking the serial number
 		 */
-		list_for_each(t, tool_list, link) {
+		list_for_each(t, &tablet->tool_list, link) {
 			if (type == t->type) {
 				tool = t;
 				break;
 			}
 		}
-
-		/* Didn't find the tool but we have a serial. Switch
-		 * tool_list back so we create in the correct list */
-		if (!tool && serial)
-			tool_list = &libinput->tool_list;
 	}
 
 	/* If we didn't already have the new_tool in our list of tools,
@@ -1175,7 +1277,10 @@ tablet_get_tool(struct tablet_dispatch *tablet,
 		tool_set_pressure_thresholds(tablet, tool);
 		tool_set_bits(tablet, tool);
 
-		list_insert(tool_list, &tool->link);
+		if (serial)
+			libinput_tool_registry_insert(libinput, tool);
+		else
+			list_insert(&tablet->tool_list, &tool->link);
 	}
 
 	return tool;
@@ -2349,6 +2454,8 @@ tablet_init_smoothing(struct evdev_device *device,
 		      struct tablet_dispatch *tablet)
 {
 	size_t history_size = ARRAY_LENGTH(tablet->history.samples);
+	struct quirks *q;
+	char *prop;
 #if HAVE_LIBWACOM
 	const char *devnode;
 	WacomDeviceDatabase *db;
@@ -2364,7 +2471,7 @@ tablet_init_smoothing(struct evdev_device *device,
 	 * lenovo pens so we use that as the flag of whether the tablet
 	 * is an AES tablet
 	 */
-	if (vid != VENDOR_ID_WACOM)
+	if (vid != VENDOR_ID_WACOM || evdev_device_is_virtual(device))
 		goto out;
 
 	db = tablet_libinput_context(tablet)->libwacom.db;
@@ -2391,6 +2498,24 @@ tablet_init_smoothing(struct evdev_device *device,
 out:
 #endif
 	tablet->history.size = history_size;
+	tablet->smoothing = TABLET_SMOOTHING_AVERAGE;
+
+	q = evdev_device_fetch_quirks(device);
+	if (q && quirks_get_string(q, QUIRK_ATTR_TABLET_SMOOTHING, &prop)) {
+		if (streq(prop, "none")) {
+			tablet->smoothing = TABLET_SMOOTHING_NONE;
+		} else if (streq(prop, "average")) {
+			tablet->smoothing = TABLET_SMOOTHING_AVERAGE;
+		} else if (streq(prop, "adaptive")) {
+			tablet->smoothing = TABLET_SMOOTHING_ADAPTIVE;
+		} else {
+			evdev_log_info(device,
+				       "tagged with unknown smoothing %s\n",
+				       prop);
+		}
+	}
+
+	quirks_unref(q);
 }
 
 static bool
@@ -2500,5 +2625,7 @@ evdev_tablet_create(struct evdev_device *device)
 		return NULL;
 	}
 
+	device->pairing.subscriptions = bit(EVDEV_ROLE_TOUCH);
+
 	return &tablet->base;
 }
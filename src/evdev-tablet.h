@@ -53,6 +53,19 @@ struct button_state {
 	unsigned char bits[NCHARS(KEY_CNT)];
 };
 
+enum tablet_smoothing {
+	TABLET_SMOOTHING_NONE,
+	TABLET_SMOOTHING_AVERAGE,
+	TABLET_SMOOTHING_ADAPTIVE,
+};
+
+/* State of one axis in the adaptive low-pass filter, in mm or degrees */
+struct tablet_lowpass {
+	double value;
+	double raw; /* previous unfiltered sample */
+	double derivative;
+};
+
 struct tablet_dispatch {
 	struct evdev_dispatch base;
 	struct evdev_device *device;
@@ -67,6 +80,14 @@ struct tablet_dispatch {
 		size_t size;
 	} history;
 
+	enum tablet_smoothing smoothing;
+	struct {
+		bool primed;
+		uint64_t time;
+		struct tablet_lowpass x, y;
+		struct tablet_lowpass tilt_x, tilt_y;
+	} adaptive;
+
 	unsigned char axis_caps[NCHARS(LIBINPUT_TABLET_TOOL_AXIS_MAX + 1)];
 	int current_value[LIBINPUT_TABLET_TOOL_AXIS_MAX + 1];
 	int prev_value[LIBINPUT_TABLET_TOOL_AXIS_MAX + 1];
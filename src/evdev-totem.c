@@ -828,6 +828,9 @@ evdev_totem_create(struct evdev_device *device)
 	evdev_init_sendevents(device, &totem->base);
 	totem_init_accel(totem, device);
 
+	/* The touch device is matched on VID/PID, not on a role */
+	device->pairing.subscriptions = bit(EVDEV_ROLE_ANY);
+
 	return &totem->base;
 error:
 	totem_interface_destroy(&totem->base);
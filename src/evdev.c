@@ -44,6 +44,7 @@
 #include "libinput-private.h"
 #include "quirks.h"
 #include "util-input-event.h"
+#include "input-thread.h"
 
 #if HAVE_LIBWACOM
 #include <libwacom/libwacom.h>
@@ -95,7 +96,10 @@ parse_udev_flag(struct evdev_device *device,
 {
 	const char *val;
 
-	val = udev_device_get_property_value(udev_device, property);
+	if (udev_device)
+		val = udev_device_get_property_value(udev_device, property);
+	else
+		val = evdev_device_get_property(device, property);
 	if (!val)
 		return false;
 
@@ -420,7 +424,6 @@ static void
 evdev_tag_trackpoint(struct evdev_device *device,
 		     struct udev_device *udev_device)
 {
-	struct quirks_context *quirks;
 	struct quirks *q;
 	char *prop;
 
@@ -431,8 +434,7 @@ evdev_tag_trackpoint(struct evdev_device *device,
 
 	device->tags |= EVDEV_TAG_TRACKPOINT;
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (q && quirks_get_string(q, QUIRK_ATTR_TRACKPOINT_INTEGRATION, &prop)) {
 		if (streq(prop, "internal")) {
 			/* noop, this is the default anyway */
@@ -468,7 +470,6 @@ static void
 evdev_tag_keyboard(struct evdev_device *device,
 		   struct udev_device *udev_device)
 {
-	struct quirks_context *quirks;
 	struct quirks *q;
 	char *prop;
 	int code;
@@ -483,8 +484,7 @@ evdev_tag_keyboard(struct evdev_device *device,
 			return;
 	}
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (q && quirks_get_string(q, QUIRK_ATTR_KEYBOARD_INTEGRATION, &prop)) {
 		if (streq(prop, "internal")) {
 			evdev_tag_keyboard_internal(device);
@@ -911,12 +911,10 @@ enum switch_reliability
 evdev_read_switch_reliability_prop(struct evdev_device *device)
 {
 	enum switch_reliability r;
-	struct quirks_context *quirks;
 	struct quirks *q;
 	char *prop;
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (!q || !quirks_get_string(q, QUIRK_ATTR_LID_SWITCH_RELIABILITY, &prop)) {
 		r = RELIABILITY_UNKNOWN;
 	} else if (!parse_switch_reliability_property(prop, &r)) {
@@ -1001,6 +999,55 @@ evdev_device_dispatch_one(struct evdev_device *device,
 	}
 }
 
+/* The kernel fills a single frame with at most a few events per
+ * touch/axis, larger frames are split across several batches */
+#define EVDEV_FRAME_BATCH_SIZE 64
+
+/**
+ * Process a batch of events, usually a whole frame up to and including
+ * the SYN_REPORT. Events within a frame share the same timestamp, so we
+ * only need to flush the timers when the timestamp changes rather than
+ * once per event.
+ */
+static inline void
+evdev_device_dispatch_frame(struct evdev_device *device,
+			    struct input_event *frame,
+			    size_t nevents)
+{
+	struct evdev_dispatch *dispatch = device->dispatch;
+	struct libinput *libinput = evdev_libinput_context(device);
+	uint64_t time = 0;
+
+	if (device->mtdev) {
+		for (size_t i = 0; i < nevents; i++)
+			evdev_device_dispatch_one(device, &frame[i]);
+		return;
+	}
+
+	for (size_t i = 0; i < nevents; i++) {
+		struct input_event *e = &frame[i];
+		uint64_t etime = input_event_time(e);
+
+		if (i == 0 || etime != time) {
+			time = etime;
+			libinput_timer_flush(libinput, time);
+		}
+
+		dispatch->interface->process(dispatch, device, e, time);
+	}
+}
+
+/* With a virtual clock, the kernel's timestamps have nothing to do with
+ * the time the dispatchers see, events happen whenever they're read */
+static inline void
+evdev_stamp_event(struct evdev_device *device, struct input_event *ev)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+
+	if (libinput->clock.is_virtual)
+		input_event_set_time(ev, libinput->clock.now);
+}
+
 static int
 evdev_sync_device(struct evdev_device *device)
 {
@@ -1012,6 +1059,7 @@ evdev_sync_device(struct evdev_device *device)
 					 LIBEVDEV_READ_FLAG_SYNC, &ev);
 		if (rc < 0)
 			break;
+		evdev_stamp_event(device, &ev);
 		evdev_device_dispatch_one(device, &ev);
 	} while (rc == LIBEVDEV_READ_STATUS_SYNC);
 
@@ -1045,22 +1093,50 @@ evdev_note_time_delay(struct evdev_device *device,
 	}
 }
 
+static inline void
+evdev_note_read_latency(struct evdev_device *device,
+			const struct input_event *ev,
+			uint64_t now)
+{
+	uint64_t eventtime = input_event_time(ev);
+
+	if (now < eventtime)
+		return;
+
+	libinput_device_note_latency(&device->base,
+				     LIBINPUT_LATENCY_STAGE_READ,
+				     LIBINPUT_EVENT_NONE,
+				     now - eventtime);
+}
+
 static void
 evdev_device_dispatch(void *data)
 {
 	struct evdev_device *device = data;
 	struct libinput *libinput = evdev_libinput_context(device);
-	struct input_event ev;
+	struct input_event frame[EVDEV_FRAME_BATCH_SIZE];
+	size_t nevents = 0;
+	uint64_t now = 0;
 	int rc;
 	bool once = false;
 
 	/* If the compositor is repainting, this function is called only once
 	 * per frame and we have to process all the events available on the
-	 * fd, otherwise there will be input lag. */
+	 * fd, otherwise there will be input lag.
+	 *
+	 * libevdev already reads the fd in bulk, we collect the events up
+	 * to the SYN_REPORT and hand the whole frame to the dispatch.
+	 */
 	do {
+		struct input_event *ev = &frame[nevents];
+
 		rc = libevdev_next_event(device->evdev,
-					 LIBEVDEV_READ_FLAG_NORMAL, &ev);
+					 LIBEVDEV_READ_FLAG_NORMAL, ev);
+		if (rc >= 0)
+			evdev_stamp_event(device, ev);
+
 		if (rc == LIBEVDEV_READ_STATUS_SYNC) {
+			libinput_device_note_syn_dropped(&device->base);
 			evdev_log_info_ratelimit(device,
 						 &device->syn_drop_limit,
 						 "SYN_DROPPED event - some input events have been lost.\n");
@@ -1068,27 +1144,326 @@ evdev_device_dispatch(void *data)
 			/* send one more sync event so we handle all
 			   currently pending events before we sync up
 			   to the current state */
-			ev.code = SYN_REPORT;
-			evdev_device_dispatch_one(device, &ev);
+			ev->code = SYN_REPORT;
+			evdev_device_dispatch_frame(device, frame, nevents + 1);
+			nevents = 0;
 
 			rc = evdev_sync_device(device);
 			if (rc == 0)
 				rc = LIBEVDEV_READ_STATUS_SUCCESS;
 		} else if (rc == LIBEVDEV_READ_STATUS_SUCCESS) {
 			if (!once) {
-				evdev_note_time_delay(device, &ev);
+				evdev_note_time_delay(device, ev);
 				once = true;
 			}
-			evdev_device_dispatch_one(device, &ev);
+
+			/* libevdev reads in bulk, so one timestamp is
+			 * good enough for all frames in this dispatch */
+			if (libevdev_event_is_code(ev, EV_SYN, SYN_REPORT)) {
+				if (now == 0)
+					now = libinput_now(libinput);
+				evdev_note_read_latency(device, ev, now);
+			}
+
+			nevents++;
+			if (libevdev_event_is_code(ev, EV_SYN, SYN_REPORT) ||
+			    nevents == ARRAY_LENGTH(frame)) {
+				evdev_device_dispatch_frame(device,
+							    frame,
+							    nevents);
+				nevents = 0;
+			}
 		}
 	} while (rc == LIBEVDEV_READ_STATUS_SUCCESS);
 
+	/* Incomplete frame, the rest follows with the next dispatch */
+	if (nevents > 0)
+		evdev_device_dispatch_frame(device, frame, nevents);
+
 	if (rc != -EAGAIN && rc != -EINTR) {
 		libinput_remove_source(libinput, device->source);
 		device->source = NULL;
 	}
 }
 
+/* libevdev only updates its state from events it reads itself, some of
+ * the dispatchers look at that state */
+static inline void
+evdev_update_libevdev_state(struct evdev_device *device,
+			    const struct input_event *e)
+{
+	switch (e->type) {
+	case EV_ABS:
+	case EV_KEY:
+	case EV_SW:
+	case EV_LED:
+		libevdev_set_event_value(device->evdev,
+					 e->type,
+					 e->code,
+					 e->value);
+		break;
+	default:
+		break;
+	}
+}
+
+struct evdev_resync {
+	struct evdev_device *device;
+	uint64_t time;
+	struct input_event frame[EVDEV_FRAME_BATCH_SIZE];
+	size_t nevents;
+};
+
+static void
+evdev_resync_queue(struct evdev_resync *r,
+		   unsigned int type,
+		   unsigned int code,
+		   int value)
+{
+	struct input_event *ev = &r->frame[r->nevents++];
+
+	*ev = (struct input_event) {
+		.type = type,
+		.code = code,
+		.value = value,
+	};
+	input_event_set_time(ev, r->time);
+	evdev_update_libevdev_state(r->device, ev);
+
+	if (r->nevents == ARRAY_LENGTH(r->frame) ||
+	    libevdev_event_is_code(ev, EV_SYN, SYN_REPORT)) {
+		evdev_device_dispatch_frame(r->device, r->frame, r->nevents);
+		r->nevents = 0;
+	}
+}
+
+static inline void
+evdev_resync_codes(struct evdev_resync *r,
+		   struct libevdev *kernel,
+		   unsigned int type,
+		   unsigned int max)
+{
+	struct libevdev *evdev = r->device->evdev;
+
+	for (unsigned int code = 0; code <= max; code++) {
+		int value;
+
+		if (type == EV_ABS && code >= ABS_MT_SLOT && code <= ABS_MT_TOOL_Y)
+			continue;
+
+		if (!libevdev_has_event_code(evdev, type, code))
+			continue;
+
+		value = libevdev_get_event_value(kernel, type, code);
+		if (value != libevdev_get_event_value(evdev, type, code))
+			evdev_resync_queue(r, type, code, value);
+	}
+}
+
+static inline void
+evdev_drain_fd(int fd)
+{
+	struct input_event ev[24];
+	size_t sz = sizeof ev;
+
+	while (read(fd, &ev, sz) == (int)sz) {
+		/* discard all pending events */
+	}
+}
+
+/**
+ * Events were lost between the input thread and us. libevdev cannot
+ * sync the device because it doesn't read the fd, so we take the
+ * kernel's state with a second libevdev context and send the difference
+ * as events, the same way libevdev would after a SYN_DROPPED.
+ */
+static void
+evdev_device_resync(struct evdev_device *device)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+	struct evdev_resync r = {
+		.device = device,
+		.time = libinput_now(libinput),
+	};
+	struct libevdev *evdev = device->evdev,
+			*kernel;
+	struct input_event ev;
+	bool ended = false;
+	int nslots, rc;
+
+	/* Pause the input thread so the events left in the ring are
+	 * older than the state we read. The events the input thread
+	 * hasn't read yet are older too, the kernel's state already
+	 * includes them. */
+	input_reader_lock(device->reader);
+	while (input_reader_pop(device->reader, &ev))
+		;
+	evdev_drain_fd(device->fd);
+	rc = libevdev_new_from_fd(device->fd, &kernel);
+	input_reader_unlock(device->reader);
+
+	if (rc != 0)
+		return;
+
+	/* Touches that ended or were replaced end in a frame of their
+	 * own */
+	nslots = libevdev_get_num_slots(evdev);
+	for (int slot = 0; slot < nslots; slot++) {
+		int old = libevdev_get_slot_value(evdev, slot, ABS_MT_TRACKING_ID),
+		    new = libevdev_get_slot_value(kernel, slot, ABS_MT_TRACKING_ID);
+
+		if (old == -1 || old == new)
+			continue;
+
+		evdev_resync_queue(&r, EV_ABS, ABS_MT_SLOT, slot);
+		evdev_resync_queue(&r, EV_ABS, ABS_MT_TRACKING_ID, -1);
+		ended = true;
+	}
+	if (ended)
+		evdev_resync_queue(&r, EV_SYN, SYN_REPORT, 0);
+
+	evdev_resync_codes(&r, kernel, EV_KEY, KEY_MAX);
+	evdev_resync_codes(&r, kernel, EV_SW, SW_MAX);
+	evdev_resync_codes(&r, kernel, EV_ABS, ABS_MAX);
+
+	for (int slot = 0; slot < nslots; slot++) {
+		bool slot_sent = false;
+
+		for (unsigned int code = ABS_MT_SLOT + 1;
+		     code <= ABS_MT_TOOL_Y;
+		     code++) {
+			int value;
+
+			if (!libevdev_has_event_code(evdev, EV_ABS, code))
+				continue;
+
+			value = libevdev_get_slot_value(kernel, slot, code);
+			if (value == libevdev_get_slot_value(evdev, slot, code))
+				continue;
+
+			if (!slot_sent) {
+				evdev_resync_queue(&r, EV_ABS, ABS_MT_SLOT, slot);
+				slot_sent = true;
+			}
+			evdev_resync_queue(&r, EV_ABS, code, value);
+		}
+	}
+
+	if (nslots > 0 &&
+	    libevdev_get_current_slot(kernel) != libevdev_get_current_slot(evdev))
+		evdev_resync_queue(&r,
+				   EV_ABS,
+				   ABS_MT_SLOT,
+				   libevdev_get_current_slot(kernel));
+
+	evdev_resync_queue(&r, EV_SYN, SYN_REPORT, 0);
+
+	libevdev_free(kernel);
+}
+
+/**
+ * The dispatch with the input thread, see evdev_device_dispatch() for
+ * the dispatch that reads the fd.
+ */
+static void
+evdev_device_dispatch_reader(void *data)
+{
+	struct evdev_device *device = data;
+	struct libinput *libinput = evdev_libinput_context(device);
+	struct input_event frame[EVDEV_FRAME_BATCH_SIZE];
+	size_t nevents = 0;
+	uint64_t now = 0;
+	bool once = false;
+
+	while (input_reader_pop(device->reader, &frame[nevents])) {
+		struct input_event *ev = &frame[nevents];
+
+		evdev_stamp_event(device, ev);
+
+		if (libevdev_event_is_code(ev, EV_SYN, SYN_DROPPED)) {
+			libinput_device_note_syn_dropped(&device->base);
+			evdev_log_info_ratelimit(device,
+						 &device->syn_drop_limit,
+						 "SYN_DROPPED event - some input events have been lost.\n");
+
+			/* Finish the current frame, then catch up with
+			 * the kernel's state */
+			ev->code = SYN_REPORT;
+			evdev_device_dispatch_frame(device, frame, nevents + 1);
+			nevents = 0;
+
+			evdev_device_resync(device);
+			continue;
+		}
+
+		if (!once) {
+			evdev_note_time_delay(device, ev);
+			once = true;
+		}
+
+		if (libevdev_event_is_code(ev, EV_SYN, SYN_REPORT)) {
+			if (now == 0)
+				now = libinput_now(libinput);
+			evdev_note_read_latency(device, ev, now);
+		}
+
+		evdev_update_libevdev_state(device, ev);
+
+		nevents++;
+		if (libevdev_event_is_code(ev, EV_SYN, SYN_REPORT) ||
+		    nevents == ARRAY_LENGTH(frame)) {
+			evdev_device_dispatch_frame(device, frame, nevents);
+			nevents = 0;
+		}
+	}
+
+	/* Incomplete frame, the rest follows with the next dispatch */
+	if (nevents > 0)
+		evdev_device_dispatch_frame(device, frame, nevents);
+
+	/* The input thread stopped reading, e.g. the device was
+	 * unplugged. Same as above, the device is removed through udev
+	 * or the caller */
+	if (input_reader_get_error(device->reader) != 0) {
+		input_thread_remove_fd(libinput, device->reader);
+		device->reader = NULL;
+	}
+}
+
+static bool
+evdev_device_start_reading(struct evdev_device *device, int fd)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+
+	if (libinput->input_thread) {
+		device->reader = input_thread_add_fd(libinput,
+						     fd,
+						     evdev_device_dispatch_reader,
+						     device);
+		return device->reader != NULL;
+	}
+
+	device->source =
+		libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
+	return device->source != NULL;
+}
+
+static void
+evdev_device_stop_reading(struct evdev_device *device)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
+
+	if (device->source) {
+		libinput_remove_source(libinput, device->source);
+		device->source = NULL;
+	}
+
+	if (device->reader) {
+		input_thread_remove_fd(libinput, device->reader);
+		device->reader = NULL;
+	}
+}
+
 static inline bool
 evdev_init_accel(struct evdev_device *device,
 		 enum libinput_config_accel_profile which)
@@ -1238,7 +1613,7 @@ evdev_read_wheel_click_prop(struct evdev_device *device,
 	int val;
 
 	*angle = DEFAULT_WHEEL_CLICK_ANGLE;
-	prop = udev_device_get_property_value(device->udev_device, prop);
+	prop = evdev_device_get_property(device, prop);
 	if (!prop)
 		return false;
 
@@ -1263,7 +1638,7 @@ evdev_read_wheel_click_count_prop(struct evdev_device *device,
 {
 	int val;
 
-	prop = udev_device_get_property_value(device->udev_device, prop);
+	prop = evdev_device_get_property(device, prop);
 	if (!prop)
 		return false;
 
@@ -1311,15 +1686,13 @@ evdev_read_wheel_click_props(struct evdev_device *device)
 static inline double
 evdev_get_trackpoint_multiplier(struct evdev_device *device)
 {
-	struct quirks_context *quirks;
 	struct quirks *q;
 	double multiplier = 1.0;
 
 	if (!(device->tags & EVDEV_TAG_TRACKPOINT))
 		return 1.0;
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (q) {
 		quirks_get_double(q, QUIRK_ATTR_TRACKPOINT_MULTIPLIER, &multiplier);
 		quirks_unref(q);
@@ -1343,12 +1716,10 @@ evdev_get_trackpoint_multiplier(struct evdev_device *device)
 static inline bool
 evdev_need_velocity_averaging(struct evdev_device *device)
 {
-	struct quirks_context *quirks;
 	struct quirks *q;
 	bool use_velocity_averaging = false; /* default off unless we have quirk */
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (q) {
 		quirks_get_bool(q,
 				QUIRK_ATTR_USE_VELOCITY_AVERAGING,
@@ -1372,8 +1743,7 @@ evdev_read_dpi_prop(struct evdev_device *device)
 	if (device->tags & EVDEV_TAG_TRACKPOINT)
 		return DEFAULT_MOUSE_DPI;
 
-	mouse_dpi = udev_device_get_property_value(device->udev_device,
-						   "MOUSE_DPI");
+	mouse_dpi = evdev_device_get_property(device, "MOUSE_DPI");
 	if (mouse_dpi) {
 		dpi = parse_mouse_dpi_property(mouse_dpi);
 		if (!dpi) {
@@ -1412,11 +1782,9 @@ evdev_read_model_flags(struct evdev_device *device)
 	const struct model_map *m = model_map;
 	uint32_t model_flags = 0;
 	uint32_t all_model_flags = 0;
-	struct quirks_context *quirks;
 	struct quirks *q;
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 
 	while (q && m->quirk) {
 		bool is_set;
@@ -1477,13 +1845,11 @@ evdev_read_attr_res_prop(struct evdev_device *device,
 			 size_t *xres,
 			 size_t *yres)
 {
-	struct quirks_context *quirks;
 	struct quirks *q;
 	struct quirk_dimensions dim;
 	bool rc = false;
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (!q)
 		return false;
 
@@ -1503,13 +1869,11 @@ evdev_read_attr_size_prop(struct evdev_device *device,
 			  size_t *size_x,
 			  size_t *size_y)
 {
-	struct quirks_context *quirks;
 	struct quirks *q;
 	struct quirk_dimensions dim;
 	bool rc = false;
 
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (!q)
 		return false;
 
@@ -1577,7 +1941,7 @@ evdev_device_get_udev_tags(struct evdev_device *device,
 	enum evdev_device_udev_tags tags = 0;
 	int i;
 
-	for (i = 0; i < 2 && udev_device; i++) {
+	for (i = 0; i < 2; i++) {
 		unsigned j;
 		for (j = 0; j < ARRAY_LENGTH(evdev_udev_tag_matches); j++) {
 			const struct evdev_udev_tag_match match = evdev_udev_tag_matches[j];
@@ -1586,7 +1950,14 @@ evdev_device_get_udev_tags(struct evdev_device *device,
 					    match.name))
 				tags |= match.tag;
 		}
+
+		/* virtual devices only have their own properties */
+		if (!udev_device)
+			break;
+
 		udev_device = udev_device_get_parent(udev_device);
+		if (!udev_device)
+			break;
 	}
 
 	return tags;
@@ -1959,35 +2330,178 @@ evdev_configure_device(struct evdev_device *device)
 	return fallback_dispatch_create(&device->base);
 }
 
+static_assert(EVDEV_ROLE_COUNT == LIBINPUT_SEAT_NUM_ROLES,
+	      "seat role lists out of sync with enum evdev_device_role");
+
+static uint32_t
+evdev_device_get_roles(struct evdev_device *device)
+{
+	uint32_t roles = bit(EVDEV_ROLE_ANY);
+
+	if (device->tags & EVDEV_TAG_KEYBOARD)
+		roles |= bit(EVDEV_ROLE_KEYBOARD);
+	if (device->tags & EVDEV_TAG_TRACKPOINT)
+		roles |= bit(EVDEV_ROLE_TRACKPOINT);
+	if (device->tags & EVDEV_TAG_EXTERNAL_MOUSE)
+		roles |= bit(EVDEV_ROLE_EXTERNAL_MOUSE);
+	if (device->tags & EVDEV_TAG_LID_SWITCH)
+		roles |= bit(EVDEV_ROLE_LID_SWITCH);
+	if (device->tags & EVDEV_TAG_TABLET_MODE_SWITCH)
+		roles |= bit(EVDEV_ROLE_TABLET_MODE_SWITCH);
+	if (device->seat_caps & EVDEV_DEVICE_TABLET)
+		roles |= bit(EVDEV_ROLE_TABLET);
+	if ((device->seat_caps & EVDEV_DEVICE_TOUCH) ||
+	    ((device->seat_caps & EVDEV_DEVICE_POINTER) &&
+	     (device->tags & EVDEV_TAG_EXTERNAL_TOUCHPAD)))
+		roles |= bit(EVDEV_ROLE_TOUCH);
+
+	return roles;
+}
+
+static void
+evdev_pairing_register(struct evdev_device *device)
+{
+	struct libinput_seat *seat = device->base.seat;
+	enum evdev_device_role role;
+
+	device->pairing.roles = evdev_device_get_roles(device);
+
+	for (role = 0; role < EVDEV_ROLE_COUNT; role++) {
+		struct evdev_role_link *l;
+
+		if (device->pairing.roles & bit(role)) {
+			l = &device->pairing.role_links[role];
+			l->device = device;
+			list_append(&seat->role_devices[role], &l->link);
+		}
+
+		if (device->pairing.subscriptions & bit(role)) {
+			l = &device->pairing.subscriber_links[role];
+			l->device = device;
+			list_append(&seat->role_subscribers[role], &l->link);
+		}
+	}
+}
+
+static void
+evdev_pairing_unregister(struct evdev_device *device)
+{
+	enum evdev_device_role role;
+
+	/* Not yet added to the seat */
+	if (device->pairing.roles == 0)
+		return;
+
+	for (role = 0; role < EVDEV_ROLE_COUNT; role++) {
+		if (device->pairing.roles & bit(role))
+			list_remove(&device->pairing.role_links[role].link);
+		if (device->pairing.subscriptions & bit(role))
+			list_remove(&device->pairing.subscriber_links[role].link);
+	}
+
+	device->pairing.roles = 0;
+}
+
+enum pairing_notification {
+	PAIRING_ADDED,
+	PAIRING_REMOVED,
+	PAIRING_SUSPENDED,
+	PAIRING_RESUMED,
+};
+
+/* Notify every device subscribed to any of the roles of device. Each
+ * subscriber is notified once, even if it subscribed to several of the
+ * roles. Within a role, subscribers are notified in the order they were
+ * added. */
+static void
+evdev_pairing_notify_subscribers(struct evdev_device *device,
+				 enum pairing_notification which)
+{
+	struct libinput_seat *seat = device->base.seat;
+	uint32_t generation = ++seat->role_generation;
+	enum evdev_device_role role;
+
+	for (role = 0; role < EVDEV_ROLE_COUNT; role++) {
+		struct evdev_role_link *l;
+
+		if ((device->pairing.roles & bit(role)) == 0)
+			continue;
+
+		list_for_each(l, &seat->role_subscribers[role], link) {
+			struct evdev_device *d = l->device;
+			const struct evdev_dispatch_interface *interface;
+
+			if (d == device || d->pairing.generation == generation)
+				continue;
+
+			d->pairing.generation = generation;
+			interface = d->dispatch->interface;
+
+			switch (which) {
+			case PAIRING_ADDED:
+				if (interface->device_added)
+					interface->device_added(d, device);
+				break;
+			case PAIRING_REMOVED:
+				if (interface->device_removed)
+					interface->device_removed(d, device);
+				break;
+			case PAIRING_SUSPENDED:
+				if (interface->device_suspended)
+					interface->device_suspended(d, device);
+				break;
+			case PAIRING_RESUMED:
+				if (interface->device_resumed)
+					interface->device_resumed(d, device);
+				break;
+			}
+		}
+	}
+}
+
 static void
 evdev_notify_added_device(struct evdev_device *device)
 {
-	struct libinput_device *dev;
+	struct libinput_seat *seat = device->base.seat;
+	const struct evdev_dispatch_interface *interface =
+		device->dispatch->interface;
+	uint32_t generation;
+	enum evdev_device_role role;
+
+	evdev_pairing_register(device);
+
+	/* Notify existing devices about addition of device */
+	evdev_pairing_notify_subscribers(device, PAIRING_ADDED);
+
+	/* Notify new device about the existing devices it subscribed to */
+	generation = ++seat->role_generation;
+	for (role = 0; role < EVDEV_ROLE_COUNT; role++) {
+		struct evdev_role_link *l;
 
-	list_for_each(dev, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(dev);
-		if (dev == &device->base)
+		if ((device->pairing.subscriptions & bit(role)) == 0)
 			continue;
 
-		/* Notify existing device d about addition of device */
-		if (d->dispatch->interface->device_added)
-			d->dispatch->interface->device_added(d, device);
+		list_for_each(l, &seat->role_devices[role], link) {
+			struct evdev_device *d = l->device;
 
-		/* Notify new device about existing device d */
-		if (device->dispatch->interface->device_added)
-			device->dispatch->interface->device_added(device, d);
+			if (d == device || d->pairing.generation == generation)
+				continue;
 
-		/* Notify new device if existing device d is suspended */
-		if (d->is_suspended &&
-		    device->dispatch->interface->device_suspended)
-			device->dispatch->interface->device_suspended(device, d);
+			d->pairing.generation = generation;
+
+			if (interface->device_added)
+				interface->device_added(device, d);
+
+			/* Notify new device if existing device d is suspended */
+			if (d->is_suspended && interface->device_suspended)
+				interface->device_suspended(device, d);
+		}
 	}
 
 	notify_added_device(&device->base);
 
-	if (device->dispatch->interface->post_added)
-		device->dispatch->interface->post_added(device,
-							device->dispatch);
+	if (interface->post_added)
+		interface->post_added(device, device->dispatch);
 }
 
 static bool
@@ -2014,15 +2528,14 @@ out:
 }
 
 static bool
-evdev_set_device_group(struct evdev_device *device,
-		       struct udev_device *udev_device)
+evdev_set_device_group(struct evdev_device *device)
 {
 	struct libinput *libinput = evdev_libinput_context(device);
 	struct libinput_device_group *group = NULL;
 	const char *udev_group;
 
-	udev_group = udev_device_get_property_value(udev_device,
-						    "LIBINPUT_DEVICE_GROUP");
+	udev_group = evdev_device_get_property(device,
+					       "LIBINPUT_DEVICE_GROUP");
 	if (udev_group)
 		group = libinput_device_group_find_group(libinput, udev_group);
 
@@ -2039,21 +2552,9 @@ evdev_set_device_group(struct evdev_device *device,
 	return true;
 }
 
-static inline void
-evdev_drain_fd(int fd)
-{
-	struct input_event ev[24];
-	size_t sz = sizeof ev;
-
-	while (read(fd, &ev, sz) == (int)sz) {
-		/* discard all pending events */
-	}
-}
-
 static inline void
 evdev_pre_configure_model_quirks(struct evdev_device *device)
 {
-	struct quirks_context *quirks;
 	struct quirks *q;
 	const struct quirk_tuples *t;
 	const uint32_t *props = NULL;
@@ -2068,8 +2569,7 @@ evdev_pre_configure_model_quirks(struct evdev_device *device)
 	/* Generally we don't care about MSC_TIMESTAMP and it can cause
 	 * unnecessary wakeups but on some devices we need to watch it for
 	 * pointer jumps */
-	quirks = evdev_libinput_context(device)->quirks;
-	q = quirks_fetch_for_device(quirks, device->udev_device);
+	q = evdev_device_fetch_quirks(device);
 	if (!q ||
 	    !quirks_get_string(q, QUIRK_ATTR_MSC_TIMESTAMP, &prop) ||
 	    !streq(prop, "watch")) {
@@ -2202,57 +2702,98 @@ udev_device_should_be_ignored(struct udev_device *udev_device)
 	return value && !streq(value, "0");
 }
 
-struct evdev_device *
-evdev_device_create(struct libinput_seat *seat,
-		    struct udev_device *udev_device)
+/**
+ * Check whether we want to open this device at all and set up the
+ * probe. Returns false if the device is to be skipped.
+ */
+bool
+evdev_device_probe_init(struct libinput *libinput,
+			struct evdev_probe *probe,
+			struct udev_device *udev_device)
 {
-	struct libinput *libinput = seat->libinput;
-	struct evdev_device *device = NULL;
-	int rc;
-	int fd;
-	int unhandled_device = 0;
 	const char *devnode = udev_device_get_devnode(udev_device);
 	const char *sysname = udev_device_get_sysname(udev_device);
 
+	memset(probe, 0, sizeof(*probe));
+	probe->fd = -ENODEV;
+
 	if (!devnode) {
 		log_info(libinput, "%s: no device node associated\n", sysname);
-		return NULL;
+		return false;
 	}
 
 	if (udev_device_should_be_ignored(udev_device)) {
 		log_debug(libinput, "%s: device is ignored\n", sysname);
-		return NULL;
+		return false;
 	}
 
+	probe->udev_device = udev_device_ref(udev_device);
+	probe->devnode = devnode;
+
+	return true;
+}
+
+/* libinput_now() without the context, see evdev_device_probe() */
+static inline uint64_t
+evdev_probe_now(void)
+{
+	struct timespec ts = { 0, 0 };
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
+}
+
+/**
+ * Open the device and read its description. This must not log or
+ * otherwise touch the libinput context, it may be called from a
+ * worker thread.
+ */
+void
+evdev_device_probe(struct libinput *libinput,
+		   struct evdev_probe *probe)
+{
+	uint64_t start = evdev_probe_now();
+
 	/* Use non-blocking mode so that we can loop on read on
 	 * evdev_device_data() until all events on the fd are
 	 * read.  mtdev_get() also expects this. */
-	fd = open_restricted(libinput, devnode,
-			     O_RDWR | O_NONBLOCK | O_CLOEXEC);
-	if (fd < 0) {
-		log_info(libinput,
-			 "%s: opening input device '%s' failed (%s).\n",
-			 sysname,
-			 devnode,
-			 strerror(-fd));
-		return NULL;
-	}
+	probe->fd = open_restricted(libinput, probe->devnode,
+				    O_RDWR | O_NONBLOCK | O_CLOEXEC);
+	if (probe->fd >= 0) {
+		evdev_drain_fd(probe->fd);
 
-	if (!evdev_device_have_same_syspath(udev_device, fd))
-		goto err;
+		probe->rc = libevdev_new_from_fd(probe->fd, &probe->evdev);
+		if (probe->rc == 0)
+			libevdev_set_clock_id(probe->evdev, CLOCK_MONOTONIC);
+	}
 
-	device = zalloc(sizeof *device);
+	probe->duration = evdev_probe_now() - start;
+}
 
-	libinput_device_init(&device->base, seat);
-	libinput_seat_ref(seat);
+void
+evdev_device_probe_release(struct libinput *libinput,
+			   struct evdev_probe *probe)
+{
+	if (probe->evdev)
+		libevdev_free(probe->evdev);
+	if (probe->fd >= 0)
+		close_restricted(libinput, probe->fd);
+	if (probe->udev_device)
+		udev_device_unref(probe->udev_device);
 
-	evdev_drain_fd(fd);
+	memset(probe, 0, sizeof(*probe));
+	probe->fd = -ENODEV;
+}
 
-	rc = libevdev_new_from_fd(fd, &device->evdev);
-	if (rc != 0)
-		goto err;
+/**
+ * Initialize the device from its libevdev description and set up the
+ * dispatch. device->evdev and device->fd must be set by the caller.
+ */
+static bool
+evdev_device_setup(struct evdev_device *device)
+{
+	struct libinput *libinput = evdev_libinput_context(device);
 
-	libevdev_set_clock_id(device->evdev, CLOCK_MONOTONIC);
 	libevdev_set_device_log_function(device->evdev,
 					 libevdev_log_func,
 					 LIBEVDEV_LOG_ERROR,
@@ -2260,9 +2801,7 @@ evdev_device_create(struct libinput_seat *seat,
 	device->seat_caps = 0;
 	device->is_mt = 0;
 	device->mtdev = NULL;
-	device->udev_device = udev_device_ref(udev_device);
 	device->dispatch = NULL;
-	device->fd = fd;
 	device->devname = libevdev_get_name(device->evdev);
 	device->scroll.threshold = 5.0; /* Default may be overridden */
 	device->scroll.direction_lock_threshold = 5.0; /* Default may be overridden */
@@ -2287,16 +2826,60 @@ evdev_device_create(struct libinput_seat *seat,
 
 	device->dispatch = evdev_configure_device(device);
 	if (device->dispatch == NULL || device->seat_caps == 0)
+		return false;
+
+	return evdev_set_device_group(device);
+}
+
+struct evdev_device *
+evdev_device_create_probed(struct libinput_seat *seat,
+			   struct evdev_probe *probe)
+{
+	struct libinput *libinput = seat->libinput;
+	struct udev_device *udev_device = probe->udev_device;
+	struct evdev_device *device = NULL;
+	int fd = probe->fd;
+	int unhandled_device = 0;
+	const char *sysname = udev_device_get_sysname(udev_device);
+
+	if (fd < 0) {
+		log_info(libinput,
+			 "%s: opening input device '%s' failed (%s).\n",
+			 sysname,
+			 probe->devnode,
+			 strerror(-fd));
+		return NULL;
+	}
+
+	/* The fd is ours now, the libevdev device is taken below */
+	probe->fd = -EBADF;
+
+	if (!evdev_device_have_same_syspath(udev_device, fd))
 		goto err;
 
-	device->source =
-		libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
-	if (!device->source)
+	device = zalloc(sizeof *device);
+
+	libinput_device_init(&device->base, seat);
+	libinput_seat_ref(seat);
+
+	if (probe->rc != 0)
 		goto err;
 
-	if (!evdev_set_device_group(device, udev_device))
+	device->evdev = probe->evdev;
+	probe->evdev = NULL;
+	device->udev_device = udev_device_ref(udev_device);
+	device->fd = fd;
+
+	if (!evdev_device_setup(device))
 		goto err;
 
+	if (!evdev_device_start_reading(device, fd))
+		goto err;
+
+	evdev_log_debug(device,
+			"opened in %.1fms\n",
+			probe->duration / 1000.0);
+
 	list_insert(seat->devices_list.prev, &device->base.link);
 
 	evdev_notify_added_device(device);
@@ -2313,6 +2896,105 @@ err:
 	return unhandled_device ? EVDEV_UNHANDLED_DEVICE :  NULL;
 }
 
+struct evdev_device *
+evdev_device_create_virtual(struct libinput_seat *seat,
+			    struct libevdev *evdev,
+			    const char *sysname,
+			    char **properties)
+{
+	struct evdev_device *device;
+	size_t nprops = 0;
+	int unhandled_device;
+
+	device = zalloc(sizeof *device);
+
+	libinput_device_init(&device->base, seat);
+	libinput_seat_ref(seat);
+
+	while (properties && properties[nprops])
+		nprops++;
+
+	device->virtual.sysname = safe_strdup(sysname);
+	device->virtual.properties = zalloc((nprops + 1) *
+					    sizeof(*device->virtual.properties));
+	for (size_t i = 0; i < nprops; i++)
+		device->virtual.properties[i] = safe_strdup(properties[i]);
+
+	device->evdev = evdev;
+	device->udev_device = NULL;
+	device->fd = -1;
+
+	if (!evdev_device_setup(device)) {
+		unhandled_device = device->seat_caps == 0;
+		evdev_device_destroy(device);
+		return unhandled_device ? EVDEV_UNHANDLED_DEVICE : NULL;
+	}
+
+	list_insert(seat->devices_list.prev, &device->base.link);
+
+	evdev_notify_added_device(device);
+
+	return device;
+}
+
+void
+evdev_device_inject_frame(struct evdev_device *device,
+			  struct input_event *frame,
+			  size_t nevents)
+{
+	assert(evdev_device_is_virtual(device));
+
+	if (device->was_removed || device->is_suspended)
+		return;
+
+	for (size_t i = 0; i < nevents; i++)
+		evdev_update_libevdev_state(device, &frame[i]);
+
+	evdev_device_dispatch_frame(device, frame, nevents);
+}
+
+const char *
+evdev_device_get_property(struct evdev_device *device,
+			  const char *property)
+{
+	if (!evdev_device_is_virtual(device))
+		return udev_device_get_property_value(device->udev_device,
+						      property);
+
+	return strv_find_value(device->virtual.properties, property);
+}
+
+struct quirks *
+evdev_device_fetch_quirks(const struct evdev_device *device)
+{
+	struct quirks_context *quirks = evdev_libinput_context(device)->quirks;
+
+	if (evdev_device_is_virtual(device))
+		return quirks_fetch_for_properties(quirks,
+						   device->virtual.sysname,
+						   device->virtual.properties);
+
+	return quirks_fetch_for_device(quirks, device->udev_device);
+}
+
+struct evdev_device *
+evdev_device_create(struct libinput_seat *seat,
+		    struct udev_device *udev_device)
+{
+	struct libinput *libinput = seat->libinput;
+	struct evdev_device *device;
+	struct evdev_probe probe;
+
+	if (!evdev_device_probe_init(libinput, &probe, udev_device))
+		return NULL;
+
+	evdev_device_probe(libinput, &probe);
+	device = evdev_device_create_probed(seat, &probe);
+	evdev_device_probe_release(libinput, &probe);
+
+	return device;
+}
+
 const char *
 evdev_device_get_output(struct evdev_device *device)
 {
@@ -2322,6 +3004,9 @@ evdev_device_get_output(struct evdev_device *device)
 const char *
 evdev_device_get_sysname(struct evdev_device *device)
 {
+	if (evdev_device_is_virtual(device))
+		return device->virtual.sysname;
+
 	return udev_device_get_sysname(device->udev_device);
 }
 
@@ -2427,8 +3112,8 @@ evdev_read_calibration_prop(struct evdev_device *device)
 	const char *prop;
 	float calibration[6];
 
-	prop = udev_device_get_property_value(device->udev_device,
-					      "LIBINPUT_CALIBRATION_MATRIX");
+	prop = evdev_device_get_property(device,
+					 "LIBINPUT_CALIBRATION_MATRIX");
 
 	if (prop == NULL)
 		return;
@@ -2463,7 +3148,7 @@ evdev_read_fuzz_prop(struct evdev_device *device, unsigned int code)
 	if (rc == -1)
 		return 0;
 
-	prop = udev_device_get_property_value(device->udev_device, name);
+	prop = evdev_device_get_property(device, name);
 	if (prop && (safe_atoi(prop, &fuzz) == false || fuzz < 0)) {
 		evdev_log_bug_libinput(device,
 				       "invalid LIBINPUT_FUZZ property value: %s\n",
@@ -2724,19 +3409,10 @@ evdev_stop_scroll(struct evdev_device *device,
 void
 evdev_notify_suspended_device(struct evdev_device *device)
 {
-	struct libinput_device *it;
-
 	if (device->is_suspended)
 		return;
 
-	list_for_each(it, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(it);
-		if (it == &device->base)
-			continue;
-
-		if (d->dispatch->interface->device_suspended)
-			d->dispatch->interface->device_suspended(d, device);
-	}
+	evdev_pairing_notify_subscribers(device, PAIRING_SUSPENDED);
 
 	device->is_suspended = true;
 }
@@ -2744,19 +3420,10 @@ evdev_notify_suspended_device(struct evdev_device *device)
 void
 evdev_notify_resumed_device(struct evdev_device *device)
 {
-	struct libinput_device *it;
-
 	if (!device->is_suspended)
 		return;
 
-	list_for_each(it, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(it);
-		if (it == &device->base)
-			continue;
-
-		if (d->dispatch->interface->device_resumed)
-			d->dispatch->interface->device_resumed(d, device);
-	}
+	evdev_pairing_notify_subscribers(device, PAIRING_RESUMED);
 
 	device->is_suspended = false;
 }
@@ -2772,10 +3439,7 @@ evdev_device_suspend(struct evdev_device *device)
 		device->dispatch->interface->suspend(device->dispatch,
 						     device);
 
-	if (device->source) {
-		libinput_remove_source(libinput, device->source);
-		device->source = NULL;
-	}
+	evdev_device_stop_reading(device);
 
 	if (device->mtdev) {
 		mtdev_close_delete(device->mtdev);
@@ -2796,6 +3460,7 @@ evdev_device_resume(struct evdev_device *device)
 	const char *devnode;
 	struct input_event ev;
 	enum libevdev_read_status status;
+	uint64_t start;
 
 	if (device->fd != -1)
 		return 0;
@@ -2803,10 +3468,18 @@ evdev_device_resume(struct evdev_device *device)
 	if (device->was_removed)
 		return -ENODEV;
 
+	/* Nothing to reopen, evdev_device_inject_frame() drops events
+	 * while the device is suspended */
+	if (evdev_device_is_virtual(device)) {
+		evdev_notify_resumed_device(device);
+		return 0;
+	}
+
 	devnode = udev_device_get_devnode(device->udev_device);
 	if (!devnode)
 		return -ENODEV;
 
+	start = libinput_now(libinput);
 	fd = open_restricted(libinput, devnode,
 			     O_RDWR | O_NONBLOCK | O_CLOEXEC);
 
@@ -2842,13 +3515,15 @@ evdev_device_resume(struct evdev_device *device)
 					     &ev);
 	} while (status == LIBEVDEV_READ_STATUS_SYNC);
 
-	device->source =
-		libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
-	if (!device->source) {
+	if (!evdev_device_start_reading(device, fd)) {
 		mtdev_close_delete(device->mtdev);
 		return -ENOMEM;
 	}
 
+	evdev_log_debug(device,
+			"resumed in %.1fms\n",
+			(libinput_now(libinput) - start) / 1000.0);
+
 	evdev_notify_resumed_device(device);
 
 	return 0;
@@ -2857,21 +3532,12 @@ evdev_device_resume(struct evdev_device *device)
 void
 evdev_device_remove(struct evdev_device *device)
 {
-	struct libinput_device *dev;
-
 	evdev_log_info(device, "device removed\n");
 
 	libinput_timer_cancel(&device->scroll.timer);
 	libinput_timer_cancel(&device->middlebutton.timer);
 
-	list_for_each(dev, &device->base.seat->devices_list, link) {
-		struct evdev_device *d = evdev_device(dev);
-		if (dev == &device->base)
-			continue;
-
-		if (d->dispatch->interface->device_removed)
-			d->dispatch->interface->device_removed(d, device);
-	}
+	evdev_pairing_notify_subscribers(device, PAIRING_REMOVED);
 
 	evdev_device_suspend(device);
 
@@ -2882,6 +3548,7 @@ evdev_device_remove(struct evdev_device *device)
 	 * skip re-opening a different device with the same node */
 	device->was_removed = true;
 
+	evdev_pairing_unregister(device);
 	list_remove(&device->base.link);
 
 	notify_removed_device(&device->base);
@@ -2907,6 +3574,8 @@ evdev_device_destroy(struct evdev_device *device)
 	libinput_seat_unref(device->base.seat);
 	libevdev_free(device->evdev);
 	udev_device_unref(device->udev_device);
+	free(device->virtual.sysname);
+	strv_free(device->virtual.properties);
 	free(device);
 }
 
@@ -2921,6 +3590,10 @@ evdev_tablet_has_left_handed(struct evdev_device *device)
 	WacomError *error;
 	const char *devnode;
 
+	/* virtual devices have no node for libwacom to look at */
+	if (evdev_device_is_virtual(device))
+		goto out;
+
 	db = libinput_libwacom_ref(li);
 	if (!db)
 		goto out;
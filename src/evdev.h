@@ -76,6 +76,28 @@ enum evdev_device_tags {
 	EVDEV_TAG_TABLET_TOUCHPAD	= bit(9),
 };
 
+/* The roles a device can take when pairing with other devices on the
+ * same seat. A dispatch subscribes to the roles it pairs with and only
+ * gets device_added/removed/suspended/resumed for devices with at least
+ * one of those roles. Must match LIBINPUT_SEAT_NUM_ROLES. */
+enum evdev_device_role {
+	EVDEV_ROLE_KEYBOARD,
+	EVDEV_ROLE_TRACKPOINT,
+	EVDEV_ROLE_EXTERNAL_MOUSE,
+	EVDEV_ROLE_LID_SWITCH,
+	EVDEV_ROLE_TABLET_MODE_SWITCH,
+	EVDEV_ROLE_TABLET,
+	EVDEV_ROLE_TOUCH, /* touchscreen or external touchpad */
+	EVDEV_ROLE_ANY, /* every device has this role */
+
+	EVDEV_ROLE_COUNT,
+};
+
+struct evdev_role_link {
+	struct list link;
+	struct evdev_device *device;
+};
+
 enum evdev_middlebutton_state {
 	MIDDLEBUTTON_IDLE,
 	MIDDLEBUTTON_LEFT_DOWN,
@@ -163,6 +185,7 @@ struct evdev_device {
 	struct libinput_device base;
 
 	struct libinput_source *source;
+	struct input_reader *reader; /* instead of source with the input thread */
 
 	struct evdev_dispatch *dispatch;
 	struct libevdev *evdev;
@@ -173,6 +196,13 @@ struct evdev_device {
 	int fd;
 	enum evdev_device_seat_capability seat_caps;
 	enum evdev_device_tags tags;
+	struct {
+		uint32_t roles; /* bitmask of enum evdev_device_role */
+		uint32_t subscriptions; /* set by the dispatch */
+		struct evdev_role_link role_links[EVDEV_ROLE_COUNT];
+		struct evdev_role_link subscriber_links[EVDEV_ROLE_COUNT];
+		uint32_t generation;
+	} pairing;
 	bool is_mt;
 	bool is_suspended;
 	int dpi; /* HW resolution */
@@ -184,6 +214,13 @@ struct evdev_device {
 	uint32_t model_flags;
 	struct mtdev *mtdev;
 
+	/* Only set for devices without a kernel device node, see
+	 * evdev_device_create_virtual() */
+	struct {
+		char *sysname;
+		char **properties; /* NULL-terminated, "NAME=value" */
+	} virtual;
+
 	struct {
 		const struct input_absinfo *absinfo_x, *absinfo_y;
 		bool is_fake_resolution;
@@ -377,6 +414,75 @@ struct evdev_device *
 evdev_device_create(struct libinput_seat *seat,
 		    struct udev_device *device);
 
+/**
+ * The result of opening an event node, the first half of
+ * evdev_device_create(). evdev_device_probe() does not touch any
+ * libinput state other than calling open_restricted, so it may run on a
+ * different thread. The device is then created from the probe with
+ * evdev_device_create_probed() on the libinput thread.
+ */
+struct evdev_probe {
+	struct udev_device *udev_device;
+	const char *devnode;
+	int fd;			/* negative errno on failure */
+	struct libevdev *evdev;
+	int rc;			/* libevdev_new_from_fd() result */
+	uint64_t duration;	/* time spent in evdev_device_probe() in us */
+};
+
+bool
+evdev_device_probe_init(struct libinput *libinput,
+			struct evdev_probe *probe,
+			struct udev_device *udev_device);
+
+void
+evdev_device_probe(struct libinput *libinput,
+		   struct evdev_probe *probe);
+
+void
+evdev_device_probe_release(struct libinput *libinput,
+			   struct evdev_probe *probe);
+
+struct evdev_device *
+evdev_device_create_probed(struct libinput_seat *seat,
+			   struct evdev_probe *probe);
+
+/**
+ * Create a device that is not backed by a kernel device node. The device
+ * takes ownership of the libevdev device, its description is all
+ * libinput ever sees of the device. The properties stand in for the udev
+ * properties and are copied.
+ *
+ * Events are fed into the device with evdev_device_inject_frame().
+ */
+struct evdev_device *
+evdev_device_create_virtual(struct libinput_seat *seat,
+			    struct libevdev *evdev,
+			    const char *sysname,
+			    char **properties);
+
+void
+evdev_device_inject_frame(struct evdev_device *device,
+			  struct input_event *frame,
+			  size_t nevents);
+
+static inline bool
+evdev_device_is_virtual(const struct evdev_device *device)
+{
+	return device->udev_device == NULL;
+}
+
+const char *
+evdev_device_get_property(struct evdev_device *device,
+			  const char *property);
+
+/**
+ * The quirks for this device, matched on the udev device or for virtual
+ * devices on their properties. Use quirks_unref() to release.
+ */
+struct quirks *
+evdev_device_fetch_quirks(const struct evdev_device *device);
+
 static inline struct libinput *
 evdev_libinput_context(const struct evdev_device *device)
 {
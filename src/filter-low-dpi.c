@@ -196,6 +196,23 @@ accelerator_destroy(struct motion_filter *filter)
 	free(accel);
 }
 
+static void
+accelerator_update_lut(struct pointer_accelerator_low_dpi *accel)
+{
+	/* The velocity where the profile hits max_accel, see
+	 * pointer_accel_profile_linear_low_dpi() */
+	double dpi_factor = accel->dpi/(double)DEFAULT_MOUSE_DPI;
+	double max_velocity = accel->threshold * dpi_factor +
+			      v_ms2us((accel->accel/dpi_factor - 1)/accel->incline);
+
+	max_velocity = max(max_velocity, v_ms2us(0.07));
+
+	filter_build_profile_lut(&accel->base,
+				 accel->profile,
+				 max_velocity,
+				 true);
+}
+
 static bool
 accelerator_set_speed(struct motion_filter *filter,
 		      double speed_adjustment)
@@ -221,6 +238,8 @@ accelerator_set_speed(struct motion_filter *filter,
 	accel_filter->incline = DEFAULT_INCLINE + speed_adjustment * 0.75;
 
 	filter->speed_adjustment = speed_adjustment;
+	accelerator_update_lut(accel_filter);
+
 	return true;
 }
 
@@ -262,6 +281,7 @@ create_pointer_accelerator_filter_linear_low_dpi(int dpi, bool use_velocity_aver
 
 	filter->base.interface = &accelerator_interface_low_dpi;
 	filter->profile = pointer_accel_profile_linear_low_dpi;
+	accelerator_update_lut(filter);
 
 	return &filter->base;
 }
@@ -194,6 +194,23 @@ accelerator_destroy(struct motion_filter *filter)
 	free(accel);
 }
 
+static void
+accelerator_update_lut(struct pointer_accelerator *accel)
+{
+	/* The velocity where the profile hits max_accel, in the units the
+	 * profile gets, see pointer_accel_profile_linear() */
+	double max_velocity = accel->threshold +
+			      v_ms2us((accel->accel - 1)/accel->incline);
+
+	max_velocity = max(max_velocity, v_ms2us(0.07));
+	max_velocity = max_velocity * accel->dpi/DEFAULT_MOUSE_DPI;
+
+	filter_build_profile_lut(&accel->base,
+				 accel->profile,
+				 max_velocity,
+				 true);
+}
+
 static bool
 accelerator_set_speed(struct motion_filter *filter,
 		      double speed_adjustment)
@@ -219,6 +236,8 @@ accelerator_set_speed(struct motion_filter *filter,
 	accel_filter->incline = DEFAULT_INCLINE + speed_adjustment * 0.75;
 
 	filter->speed_adjustment = speed_adjustment;
+	accelerator_update_lut(accel_filter);
+
 	return true;
 }
 
@@ -336,6 +355,7 @@ create_pointer_accelerator_filter_linear(int dpi, bool use_velocity_averaging)
 
 	filter->base.interface = &accelerator_interface;
 	filter->profile = pointer_accel_profile_linear;
+	accelerator_update_lut(filter);
 
 	return &filter->base;
 }
@@ -27,6 +27,7 @@
 #include "config.h"
 
 #include "filter.h"
+#include "util-bits.h"
 
 struct motion_filter_interface {
 	enum libinput_config_accel_profile type;
@@ -46,9 +47,29 @@ struct motion_filter_interface {
 			  double speed_adjustment);
 };
 
+/* Number of intervals in a profile lookup table */
+#define ACCEL_LUT_SIZE 2048
+/* Max deviation of an interpolated factor from the profile before an
+ * interval is marked as exact */
+#define ACCEL_LUT_TOLERANCE 0.001
+
+/* The acceleration profile sampled at regular velocity intervals, see
+ * filter_build_profile_lut() */
+struct accel_lut {
+	accel_profile_func_t profile;
+	double max_velocity;	/* units/us */
+	double scale;		/* table entries per units/us */
+	bool constant_above;	/* profile is constant above max_velocity */
+	double factors[ACCEL_LUT_SIZE + 1];
+	/* intervals containing a step or sharp bend in the profile, these
+	 * call the profile instead of interpolating */
+	unsigned char exact[NCHARS(ACCEL_LUT_SIZE)];
+};
+
 struct motion_filter {
 	double speed_adjustment; /* normalized [-1, 1] */
 	struct motion_filter_interface *interface;
+	struct accel_lut *lut; /* may be NULL */
 };
 
 struct pointer_tracker {
@@ -88,6 +109,19 @@ trackers_by_offset(struct pointer_trackers *trackers, unsigned int offset);
 double
 trackers_velocity(struct pointer_trackers *trackers, uint64_t time);
 
+void
+filter_build_profile_lut(struct motion_filter *filter,
+			 accel_profile_func_t profile,
+			 double max_velocity,
+			 bool constant_above);
+
+double
+filter_profile_factor(struct motion_filter *filter,
+		      accel_profile_func_t profile,
+		      void *data,
+		      double velocity,
+		      uint64_t time);
+
 double
 calculate_acceleration_simpsons(struct motion_filter *filter,
 				accel_profile_func_t profile,
@@ -88,7 +88,11 @@ static double
 acceleration_profile(struct pointer_accelerator_x230 *accel,
 		     void *data, double velocity, uint64_t time)
 {
-	return accel->profile(&accel->base, data, velocity, time);
+	return filter_profile_factor(&accel->base,
+				     accel->profile,
+				     data,
+				     velocity,
+				     time);
 }
 
 /**
@@ -216,6 +220,26 @@ accelerator_destroy_x230(struct motion_filter *filter)
 	free(accel);
 }
 
+static void
+accelerator_update_lut_x230(struct pointer_accelerator_x230 *accel)
+{
+	/* The velocity where the profile hits max_accel, see
+	 * touchpad_lenovo_x230_accel_profile() */
+	const double slowdown = X230_MAGIC_SLOWDOWN / X230_TP_MAGIC_LOW_RES_FACTOR;
+	const double max_accel = accel->accel * X230_TP_MAGIC_LOW_RES_FACTOR;
+	const double threshold = accel->threshold / X230_TP_MAGIC_LOW_RES_FACTOR;
+	const double incline = accel->incline * X230_TP_MAGIC_LOW_RES_FACTOR;
+	double max_velocity;
+
+	max_velocity = threshold + v_ms2us((max_accel - 1)/incline);
+	max_velocity = max(max_velocity, v_ms2us(0.2));
+
+	filter_build_profile_lut(&accel->base,
+				 accel->profile,
+				 max_velocity/slowdown,
+				 true);
+}
+
 static bool
 accelerator_set_speed_x230(struct motion_filter *filter,
 			   double speed_adjustment)
@@ -241,6 +265,8 @@ accelerator_set_speed_x230(struct motion_filter *filter,
 	accel_filter->incline = DEFAULT_INCLINE + speed_adjustment * 0.75;
 
 	filter->speed_adjustment = speed_adjustment;
+	accelerator_update_lut_x230(accel_filter);
+
 	return true;
 }
 
@@ -312,6 +338,7 @@ create_pointer_accelerator_filter_lenovo_x230(int dpi, bool use_velocity_averagi
 	filter->accel = X230_ACCELERATION; /* unitless factor */
 	filter->incline = X230_INCLINE; /* incline of the acceleration function */
 	filter->dpi = dpi;
+	accelerator_update_lut_x230(filter);
 
 	return &filter->base;
 }
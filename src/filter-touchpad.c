@@ -164,6 +164,20 @@ speed_factor(double s)
 							   2.377168));
 }
 
+static void
+touchpad_accelerator_update_lut(struct touchpad_accelerator *accel)
+{
+	/* The profile is constant above four times the threshold, see
+	 * touchpad_accel_profile_linear(). Convert from mm/s back to
+	 * device units/us */
+	double max_velocity = 4.0 * accel->threshold * accel->dpi/25.4;
+
+	filter_build_profile_lut(&accel->base,
+				 accel->profile,
+				 max_velocity/1000000.0,
+				 true);
+}
+
 static bool
 touchpad_accelerator_set_speed(struct motion_filter *filter,
 		      double speed_adjustment)
@@ -175,6 +189,7 @@ touchpad_accelerator_set_speed(struct motion_filter *filter,
 
 	filter->speed_adjustment = speed_adjustment;
 	accel_filter->speed_factor = speed_factor(speed_adjustment);
+	touchpad_accelerator_update_lut(accel_filter);
 
 	return true;
 }
@@ -341,6 +356,7 @@ create_pointer_accelerator_filter_touchpad(int dpi,
 
 	filter->base.interface = &accelerator_interface_touchpad;
 	filter->profile = touchpad_accel_profile_linear;
+	touchpad_accelerator_update_lut(filter);
 
 	smoothener = zalloc(sizeof(*smoothener));
 	smoothener->threshold = event_delta_smooth_threshold,
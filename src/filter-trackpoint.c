@@ -88,7 +88,11 @@ trackpoint_accelerator_filter(struct motion_filter *filter,
 	trackers_feed(&accel_filter->trackers, &multiplied, time);
 	velocity = trackers_velocity(&accel_filter->trackers, time);
 
-	f = trackpoint_accel_profile(filter, data, velocity, time);
+	f = filter_profile_factor(filter,
+				  trackpoint_accel_profile,
+				  data,
+				  velocity,
+				  time);
 	coords.x = multiplied.x * f;
 	coords.y = multiplied.y * f;
 
@@ -134,6 +138,17 @@ speed_factor(double s)
 							   2.377168));
 }
 
+static void
+trackpoint_accelerator_update_lut(struct trackpoint_accelerator *accel)
+{
+	/* The curve keeps rising, faster movements use the profile
+	 * directly */
+	filter_build_profile_lut(&accel->base,
+				 trackpoint_accel_profile,
+				 v_ms2us(5.0),
+				 false);
+}
+
 static bool
 trackpoint_accelerator_set_speed(struct motion_filter *filter,
 				 double speed_adjustment)
@@ -145,7 +160,7 @@ trackpoint_accelerator_set_speed(struct motion_filter *filter,
 
 	filter->speed_adjustment = speed_adjustment;
 	accel_filter->speed_factor = speed_factor(speed_adjustment);
-
+	trackpoint_accelerator_update_lut(accel_filter);
 
 	return true;
 }
@@ -209,6 +224,7 @@ create_pointer_accelerator_filter_trackpoint(double multiplier, bool use_velocit
 	trackers_init(&filter->trackers, use_velocity_averaging ? 16 : 2);
 
 	filter->base.interface = &accelerator_interface_trackpoint;
+	trackpoint_accelerator_update_lut(filter);
 
 	smoothener = zalloc(sizeof(*smoothener));
 	smoothener->threshold = ms2us(10);
@@ -29,6 +29,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdint.h>
+#include <string.h>
 #include <math.h>
 
 #include "filter.h"
@@ -67,6 +68,7 @@ filter_destroy(struct motion_filter *filter)
 	if (!filter || !filter->interface->destroy)
 		return;
 
+	free(filter->lut);
 	filter->interface->destroy(filter);
 }
 
@@ -263,6 +265,106 @@ trackers_velocity(struct pointer_trackers *trackers, uint64_t time)
 	return result; /* units/us */
 }
 
+/**
+ * Sample the filter's acceleration profile into a lookup table, replacing
+ * any previous table. The profile must not depend on the data or time
+ * arguments, and this must be called again whenever the filter's
+ * parameters change, usually in set_speed.
+ *
+ * @param filter The acceleration filter
+ * @param profile The profile to sample
+ * @param max_velocity Upper end of the table in the profile's units/us
+ * @param constant_above True if the profile is constant for any velocity
+ * above max_velocity
+ */
+void
+filter_build_profile_lut(struct motion_filter *filter,
+			 accel_profile_func_t profile,
+			 double max_velocity,
+			 bool constant_above)
+{
+	struct accel_lut *lut = filter->lut;
+
+	assert(max_velocity > 0.0);
+
+	if (!lut) {
+		lut = zalloc(sizeof *lut);
+		filter->lut = lut;
+	}
+
+	lut->profile = profile;
+	lut->max_velocity = max_velocity;
+	lut->scale = ACCEL_LUT_SIZE/max_velocity;
+	lut->constant_above = constant_above;
+
+	for (size_t i = 0; i <= ACCEL_LUT_SIZE; i++) {
+		double velocity = i * max_velocity/ACCEL_LUT_SIZE;
+
+		lut->factors[i] = profile(filter, NULL, velocity, 0);
+	}
+
+	/* Linear interpolation is only accurate where the profile is
+	 * smooth, so check each interval at its quarter points and mark
+	 * the ones that straddle a step or kink in the profile. */
+	memset(lut->exact, 0, sizeof(lut->exact));
+	for (size_t i = 0; i < ACCEL_LUT_SIZE; i++) {
+		double f0 = lut->factors[i],
+		       f1 = lut->factors[i + 1];
+
+		for (int q = 1; q < 4; q++) {
+			double velocity = (i + q/4.0) * max_velocity/ACCEL_LUT_SIZE;
+			double expected = profile(filter, NULL, velocity, 0);
+			double interpolated = f0 + (f1 - f0) * q/4.0;
+
+			if (fabs(expected - interpolated) > ACCEL_LUT_TOLERANCE) {
+				set_bit(lut->exact, i);
+				break;
+			}
+		}
+	}
+}
+
+/**
+ * Look up the acceleration factor for the given velocity in the filter's
+ * lookup table, linearly interpolating between the two closest entries.
+ * Falls back to calling the profile if the filter has no table for this
+ * profile, the velocity is outside the table or the interval is marked
+ * as exact.
+ *
+ * @return A unitless acceleration factor
+ */
+double
+filter_profile_factor(struct motion_filter *filter,
+		      accel_profile_func_t profile,
+		      void *data,
+		      double velocity,
+		      uint64_t time)
+{
+	const struct accel_lut *lut = filter->lut;
+	double pos, frac;
+	size_t idx;
+
+	if (!lut || lut->profile != profile || velocity < 0.0)
+		return profile(filter, data, velocity, time);
+
+	if (velocity >= lut->max_velocity) {
+		if (lut->constant_above)
+			return lut->factors[ACCEL_LUT_SIZE];
+		return profile(filter, data, velocity, time);
+	}
+
+	pos = velocity * lut->scale;
+	idx = (size_t)pos;
+	if (idx >= ACCEL_LUT_SIZE)
+		return lut->factors[ACCEL_LUT_SIZE];
+	if (bit_is_set(lut->exact, idx))
+		return profile(filter, data, velocity, time);
+	frac = pos - idx;
+
+	return lut->factors[idx] +
+		(lut->factors[idx + 1] - lut->factors[idx]) * frac;
+}
+
 /**
  * Calculate the acceleration factor for our current velocity, averaging
  * between our current and the most recent velocity to smoothen out changes.
@@ -287,11 +389,12 @@ calculate_acceleration_simpsons(struct motion_filter *filter,
 
 	/* Use Simpson's rule to calculate the average acceleration between
 	 * the previous motion and the most recent. */
-	factor = profile(filter, data, velocity, time);
-	factor += profile(filter, data, last_velocity, time);
-	factor += 4.0 * profile(filter, data,
-				(last_velocity + velocity) / 2,
-				time);
+	factor = filter_profile_factor(filter, profile, data, velocity, time);
+	factor += filter_profile_factor(filter, profile, data,
+					last_velocity, time);
+	factor += 4.0 * filter_profile_factor(filter, profile, data,
+					      (last_velocity + velocity) / 2,
+					      time);
 
 	factor = factor / 6.0;
 
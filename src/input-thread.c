@@ -0,0 +1,430 @@
+/*
+ * Copyright © 2021 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "input-thread.h"
+#include "libinput-private.h"
+
+/* Events per device that fit between the input thread and the caller,
+ * a power of two. At 24 bytes per event that's 48kB per device, more
+ * than a second of a touchpad with three fingers down. */
+#define INPUT_READER_RING_SIZE 2048
+
+struct input_reader {
+	struct input_thread *thread;
+	struct list link; /* input_thread.readers */
+	int fd; /* -1 once removed */
+	void (*dispatch)(void *data);
+	void *user_data;
+
+	/* head is only written by the input thread, tail only by the
+	 * caller. Both only ever grow, the index into the ring is
+	 * masked */
+	size_t head;
+	size_t tail;
+	int error; /* written by the input thread */
+
+	/* Only accessed by the input thread: the ring was full and
+	 * events are discarded until the next SYN_REPORT */
+	bool overflow;
+
+	struct input_event ring[INPUT_READER_RING_SIZE];
+};
+
+struct input_thread {
+	pthread_t thread;
+	int epoll_fd; /* the device fds, polled by the input thread */
+	int stop_fd; /* eventfd, written by the caller on shutdown */
+	int wakeup_fd; /* eventfd, written by the input thread */
+	struct libinput_source *source; /* wakeup_fd */
+
+	/* Held by the input thread while it reads. The caller takes it
+	 * to add or remove readers, i.e. the input thread never sees a
+	 * reader that is being freed */
+	pthread_mutex_t lock;
+	struct list readers;
+
+	bool in_dispatch;
+};
+
+static inline void
+input_reader_push(struct input_reader *reader,
+		  const struct input_event *ev)
+{
+	size_t head = reader->head;
+	size_t tail = __atomic_load_n(&reader->tail, __ATOMIC_ACQUIRE);
+	size_t space = INPUT_READER_RING_SIZE - (head - tail);
+
+	/* Like the kernel's evdev buffer: the last free slot is for a
+	 * SYN_DROPPED. Once the caller made room again, everything up to
+	 * the next SYN_REPORT is dropped as well, the caller resyncs from
+	 * the kernel's state */
+	if (reader->overflow) {
+		if (space > 1 &&
+		    ev->type == EV_SYN && ev->code == SYN_REPORT)
+			reader->overflow = false;
+		return;
+	}
+
+	reader->ring[head % INPUT_READER_RING_SIZE] = *ev;
+	if (space == 1) {
+		struct input_event *dropped;
+
+		dropped = &reader->ring[head % INPUT_READER_RING_SIZE];
+		dropped->type = EV_SYN;
+		dropped->code = SYN_DROPPED;
+		dropped->value = 0;
+		reader->overflow = true;
+	}
+
+	__atomic_store_n(&reader->head, head + 1, __ATOMIC_RELEASE);
+}
+
+static bool
+input_reader_fill(struct input_thread *thread,
+		  struct input_reader *reader)
+{
+	struct input_event buf[64];
+	size_t head = reader->head;
+	ssize_t len;
+
+	while ((len = read(reader->fd, buf, sizeof(buf))) > 0) {
+		for (size_t i = 0; i < len / sizeof(buf[0]); i++)
+			input_reader_push(reader, &buf[i]);
+	}
+
+	if (len == 0 || (len < 0 && errno != EAGAIN && errno != EINTR)) {
+		/* Stop polling the fd, the caller removes the device */
+		epoll_ctl(thread->epoll_fd, EPOLL_CTL_DEL, reader->fd, NULL);
+		__atomic_store_n(&reader->error,
+				 len == 0 ? -ENODEV : -errno,
+				 __ATOMIC_RELEASE);
+		return true;
+	}
+
+	return reader->head != head;
+}
+
+static inline bool
+input_thread_has_reader(struct input_thread *thread,
+			struct input_reader *reader)
+{
+	struct input_reader *r;
+
+	list_for_each(r, &thread->readers, link) {
+		if (r == reader)
+			return r->fd != -1;
+	}
+
+	return false;
+}
+
+static void *
+input_thread_func(void *data)
+{
+	struct input_thread *thread = data;
+	struct epoll_event ep[32];
+	bool stop = false;
+
+	while (!stop) {
+		bool queued = false;
+		int count;
+
+		count = epoll_wait(thread->epoll_fd, ep, ARRAY_LENGTH(ep), -1);
+		if (count < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		pthread_mutex_lock(&thread->lock);
+		for (int i = 0; i < count; i++) {
+			struct input_reader *reader = ep[i].data.ptr;
+
+			if (reader == NULL) {
+				stop = true;
+				continue;
+			}
+
+			/* A reader removed after epoll_wait() returned */
+			if (!input_thread_has_reader(thread, reader))
+				continue;
+
+			if (input_reader_fill(thread, reader))
+				queued = true;
+		}
+		pthread_mutex_unlock(&thread->lock);
+
+		if (queued) {
+			uint64_t one = 1;
+
+			if (write(thread->wakeup_fd, &one, sizeof(one)) < 0 &&
+			    errno != EAGAIN)
+				break;
+		}
+	}
+
+	return NULL;
+}
+
+static inline bool
+input_reader_is_pending(struct input_reader *reader)
+{
+	return __atomic_load_n(&reader->head, __ATOMIC_ACQUIRE) != reader->tail ||
+	       __atomic_load_n(&reader->error, __ATOMIC_ACQUIRE) != 0;
+}
+
+static void
+input_thread_drop_removed_readers(struct input_thread *thread)
+{
+	struct input_reader *reader;
+
+	pthread_mutex_lock(&thread->lock);
+	list_for_each_safe(reader, &thread->readers, link) {
+		if (reader->fd != -1)
+			continue;
+
+		list_remove(&reader->link);
+		free(reader);
+	}
+	pthread_mutex_unlock(&thread->lock);
+}
+
+static void
+input_thread_dispatch(void *data)
+{
+	struct input_thread *thread = data;
+	struct input_reader *reader;
+	uint64_t count;
+
+	/* Clear the eventfd first, anything queued after this wakes us
+	 * up again */
+	if (read(thread->wakeup_fd, &count, sizeof(count)) < 0 &&
+	    errno != EAGAIN)
+		return;
+
+	/* Removed readers stay in the list until we're done walking it,
+	 * the dispatch may remove any device */
+	thread->in_dispatch = true;
+	list_for_each(reader, &thread->readers, link) {
+		if (reader->fd != -1 && input_reader_is_pending(reader))
+			reader->dispatch(reader->user_data);
+	}
+	thread->in_dispatch = false;
+
+	input_thread_drop_removed_readers(thread);
+}
+
+bool
+input_reader_pop(struct input_reader *reader, struct input_event *ev)
+{
+	size_t tail = reader->tail;
+
+	if (__atomic_load_n(&reader->head, __ATOMIC_ACQUIRE) == tail)
+		return false;
+
+	*ev = reader->ring[tail % INPUT_READER_RING_SIZE];
+	__atomic_store_n(&reader->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+int
+input_reader_get_error(struct input_reader *reader)
+{
+	return __atomic_load_n(&reader->error, __ATOMIC_ACQUIRE);
+}
+
+void
+input_reader_lock(struct input_reader *reader)
+{
+	pthread_mutex_lock(&reader->thread->lock);
+}
+
+void
+input_reader_unlock(struct input_reader *reader)
+{
+	pthread_mutex_unlock(&reader->thread->lock);
+}
+
+struct input_reader *
+input_thread_add_fd(struct libinput *libinput,
+		    int fd,
+		    void (*dispatch)(void *data),
+		    void *user_data)
+{
+	struct input_thread *thread = libinput->input_thread;
+	struct input_reader *reader;
+	struct epoll_event ep;
+
+	reader = zalloc(sizeof *reader);
+	reader->thread = thread;
+	reader->fd = fd;
+	reader->dispatch = dispatch;
+	reader->user_data = user_data;
+
+	memset(&ep, 0, sizeof ep);
+	ep.events = EPOLLIN;
+	ep.data.ptr = reader;
+
+	pthread_mutex_lock(&thread->lock);
+	list_append(&thread->readers, &reader->link);
+	pthread_mutex_unlock(&thread->lock);
+
+	if (epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, fd, &ep) < 0) {
+		reader->fd = -1;
+		if (!thread->in_dispatch)
+			input_thread_drop_removed_readers(thread);
+		return NULL;
+	}
+
+	return reader;
+}
+
+void
+input_thread_remove_fd(struct libinput *libinput,
+		       struct input_reader *reader)
+{
+	struct input_thread *thread = libinput->input_thread;
+
+	epoll_ctl(thread->epoll_fd, EPOLL_CTL_DEL, reader->fd, NULL);
+
+	/* The input thread may be reading the fd right now, once we have
+	 * the lock it is done and skips this reader from now on */
+	pthread_mutex_lock(&thread->lock);
+	reader->fd = -1;
+	pthread_mutex_unlock(&thread->lock);
+
+	if (!thread->in_dispatch)
+		input_thread_drop_removed_readers(thread);
+}
+
+int
+input_thread_start(struct libinput *libinput)
+{
+	struct input_thread *thread;
+	struct epoll_event ep;
+	sigset_t all, old;
+	int rc;
+
+	thread = zalloc(sizeof *thread);
+	list_init(&thread->readers);
+	thread->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	thread->stop_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+	thread->wakeup_fd = eventfd(0, EFD_CLOEXEC|EFD_NONBLOCK);
+	if (thread->epoll_fd < 0 ||
+	    thread->stop_fd < 0 ||
+	    thread->wakeup_fd < 0)
+		goto err;
+
+	memset(&ep, 0, sizeof ep);
+	ep.events = EPOLLIN;
+	ep.data.ptr = NULL;
+	if (epoll_ctl(thread->epoll_fd, EPOLL_CTL_ADD, thread->stop_fd, &ep) < 0)
+		goto err;
+
+	thread->source = libinput_add_fd(libinput,
+					 thread->wakeup_fd,
+					 input_thread_dispatch,
+					 thread);
+	if (!thread->source)
+		goto err;
+
+	pthread_mutex_init(&thread->lock, NULL);
+
+	/* Signals are for the caller's thread, the new thread inherits
+	 * our mask */
+	sigfillset(&all);
+	pthread_sigmask(SIG_SETMASK, &all, &old);
+	rc = pthread_create(&thread->thread, NULL, input_thread_func, thread);
+	pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+	if (rc != 0) {
+		log_error(libinput,
+			  "Failed to create the input thread: %s\n",
+			  strerror(rc));
+		pthread_mutex_destroy(&thread->lock);
+		libinput_remove_source(libinput, thread->source);
+		goto err;
+	}
+
+	libinput->input_thread = thread;
+
+	return 0;
+
+err:
+	if (thread->epoll_fd >= 0)
+		close(thread->epoll_fd);
+	if (thread->stop_fd >= 0)
+		close(thread->stop_fd);
+	if (thread->wakeup_fd >= 0)
+		close(thread->wakeup_fd);
+	free(thread);
+
+	return -1;
+}
+
+void
+input_thread_stop(struct libinput *libinput)
+{
+	struct input_thread *thread = libinput->input_thread;
+	struct input_reader *reader;
+	uint64_t one = 1;
+
+	if (!thread)
+		return;
+
+	if (write(thread->stop_fd, &one, sizeof(one)) < 0)
+		log_bug_libinput(libinput,
+				 "Failed to stop the input thread: %s\n",
+				 strerror(errno));
+	pthread_join(thread->thread, NULL);
+
+	list_for_each_safe(reader, &thread->readers, link) {
+		if (reader->fd != -1)
+			log_bug_libinput(libinput,
+					 "Input thread still reading fd %d\n",
+					 reader->fd);
+		list_remove(&reader->link);
+		free(reader);
+	}
+
+	libinput_remove_source(libinput, thread->source);
+	pthread_mutex_destroy(&thread->lock);
+	close(thread->epoll_fd);
+	close(thread->stop_fd);
+	close(thread->wakeup_fd);
+	free(thread);
+
+	libinput->input_thread = NULL;
+}
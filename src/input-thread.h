@@ -0,0 +1,89 @@
+/*
+ * Copyright © 2021 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef INPUT_THREAD_H
+#define INPUT_THREAD_H
+
+#include <stdbool.h>
+
+#include "linux/input.h"
+
+struct libinput;
+struct input_reader;
+
+/* The input thread drains the device fds into one single-producer
+ * single-consumer ring per device, so the kernel's buffers never fill
+ * up while the caller is busy. Everything else, i.e. the libevdev state,
+ * the dispatch and the timers, stays on the caller's thread and reads
+ * from those rings in libinput_dispatch().
+ */
+
+int
+input_thread_start(struct libinput *libinput);
+
+void
+input_thread_stop(struct libinput *libinput);
+
+/**
+ * Have the input thread read from fd. dispatch is called from
+ * libinput_dispatch() when events are available, it must call
+ * input_reader_pop() until it returns false.
+ */
+struct input_reader *
+input_thread_add_fd(struct libinput *libinput,
+		    int fd,
+		    void (*dispatch)(void *data),
+		    void *user_data);
+
+/**
+ * Stop reading from the fd, events that were not popped yet are
+ * discarded. Once this returns, the input thread no longer touches the
+ * fd and the caller may close it.
+ */
+void
+input_thread_remove_fd(struct libinput *libinput,
+		       struct input_reader *reader);
+
+bool
+input_reader_pop(struct input_reader *reader, struct input_event *ev);
+
+/**
+ * @return 0 or the negative errno the input thread failed to read the
+ * fd with, no more events will be queued after the ones already in the
+ * ring
+ */
+int
+input_reader_get_error(struct input_reader *reader);
+
+/**
+ * Stop the input thread from reading any fd until
+ * input_reader_unlock(), e.g. to take a snapshot of the device state
+ * that is consistent with the events in the ring
+ */
+void
+input_reader_lock(struct input_reader *reader);
+
+void
+input_reader_unlock(struct input_reader *reader);
+
+#endif
@@ -42,6 +42,9 @@
 #include "libinput-version.h"
 
 struct libinput_source;
+struct libinput_event_pool_entry;
+struct input_thread;
+struct motion_prediction;
 
 /* A coordinate pair in device coordinates */
 struct device_coords {
@@ -119,6 +122,21 @@ struct libinput_interface_backend {
 				  const char *seat_name);
 };
 
+/* One event pool per event struct, the pool for an event is derived from
+ * its event type */
+enum event_pool_type {
+	EVENT_POOL_DEVICE_NOTIFY,
+	EVENT_POOL_KEYBOARD,
+	EVENT_POOL_POINTER,
+	EVENT_POOL_TOUCH,
+	EVENT_POOL_GESTURE,
+	EVENT_POOL_TABLET_TOOL,
+	EVENT_POOL_TABLET_PAD,
+	EVENT_POOL_SWITCH,
+
+	EVENT_POOL_COUNT,
+};
+
 struct libinput {
 	int epoll_fd;
 	struct list source_destroy_list;
@@ -126,20 +144,58 @@ struct libinput {
 	struct list seat_list;
 
 	struct {
-		struct list list;
+		/* binary min-heap of armed timers, ordered by expiry */
+		struct libinput_timer **heap;
+		size_t heap_count;
+		size_t heap_size;
 		struct libinput_source *source;
 		int fd;
-		uint64_t next_expiry;
+		uint64_t next_expiry; /* the expiry the timerfd is armed for */
+		bool in_handler;
 	} timer;
 
+	/* A clock that only moves when told to, for the test suite and
+	 * offline replays. See libinput_clock_enable_virtual() */
+	struct {
+		bool is_virtual;
+		uint64_t now;
+	} clock;
+
 	struct libinput_event **events;
 	size_t events_count;
 	size_t events_len;
 	size_t events_in;
 	size_t events_out;
+	/* merge pointer events into the queue's tail once this many are
+	 * queued, 0 to disable. See libinput_set_event_coalescing() */
+	size_t events_coalesce_threshold;
+
+	struct {
+		struct libinput_event_pool_entry *free_list[EVENT_POOL_COUNT];
+		size_t nfree[EVENT_POOL_COUNT];
+		size_t nlive;
+
+		uint64_t hits;
+		uint64_t misses;
+		size_t high_water_mark;
+	} event_pool;
 
 	struct list tool_list;
 
+	/* Tablet tools with a serial number, hashed by type and serial.
+	 * The registry holds one reference to each tool, tools without
+	 * any other reference are evicted in least-recently-used order */
+	struct {
+		struct list *buckets;
+		size_t nbuckets; /* 0 or a power of two */
+		struct list lru; /* most recently used first */
+		size_t ntools;
+
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t evictions;
+	} tool_registry;
+
 	const struct libinput_interface *interface;
 	const struct libinput_interface_backend *interface_backend;
 
@@ -152,6 +208,28 @@ struct libinput {
 
 	uint64_t last_event_time;
 	uint64_t dispatch_time;
+	/* Taken on the first event queued by libinput_dispatch() and
+	 * again on the first delivery after it, shared by the latency of
+	 * all events queued or delivered until then */
+	uint64_t delivery_time;
+	bool dispatching;
+
+	/* NULL unless enabled with libinput_enable_input_thread() */
+	struct input_thread *input_thread;
+
+	/* See libinput_get_dispatch_stat() */
+	struct {
+		uint64_t dispatches;
+		uint64_t wakeups;
+		uint64_t dispatch_time; /* µs, cumulative */
+		uint64_t timer_expiries;
+		uint64_t events_queued;
+		uint64_t events_coalesced;
+		uint64_t events_consumed;
+		size_t queue_high_water_mark;
+		uint64_t queue_reallocations;
+		uint64_t syn_dropped;
+	} dispatch_stats;
 
 	bool quirks_initialized;
 	struct quirks_context *quirks;
@@ -166,6 +244,9 @@ struct libinput {
 
 typedef void (*libinput_seat_destroy_func) (struct libinput_seat *seat);
 
+/* see enum evdev_device_role */
+#define LIBINPUT_SEAT_NUM_ROLES 8
+
 struct libinput_seat {
 	struct libinput *libinput;
 	struct list link;
@@ -180,6 +261,12 @@ struct libinput_seat {
 	uint32_t slot_map;
 
 	uint32_t button_count[KEY_CNT];
+
+	/* Device pairing registry, see enum evdev_device_role. Lists of
+	 * struct evdev_role_link, indexed by role */
+	struct list role_devices[LIBINPUT_SEAT_NUM_ROLES];
+	struct list role_subscribers[LIBINPUT_SEAT_NUM_ROLES];
+	uint32_t role_generation;
 };
 
 struct libinput_device_config_tap {
@@ -329,6 +416,18 @@ struct libinput_device_group {
 	struct list link;
 };
 
+/* Bucket 0 is [0, 2us), bucket n is [2^n, 2^(n+1))us, the last bucket
+ * takes everything above */
+#define LATENCY_HISTOGRAM_BUCKETS 24
+
+/* Input event types are grouped by hundreds with at most 6 types per
+ * group, see latency_type_index() */
+#define LATENCY_EVENT_TYPES (7 * 6)
+
+struct latency_histogram {
+	uint64_t counts[LATENCY_HISTOGRAM_BUCKETS];
+};
+
 struct libinput_device {
 	struct libinput_seat *seat;
 	struct libinput_device_group *group;
@@ -337,6 +436,19 @@ struct libinput_device {
 	void *user_data;
 	int refcount;
 	struct libinput_device_config config;
+
+	/* Time from the kernel timestamp to each stage. The per-type
+	 * histograms are allocated on first use. */
+	struct {
+		struct latency_histogram read;
+		struct latency_histogram *queued[LATENCY_EVENT_TYPES];
+		struct latency_histogram *delivered[LATENCY_EVENT_TYPES];
+	} latency;
+
+	uint64_t syn_dropped; /* number of SYN_DROPPED seen */
+
+	/* NULL unless the caller enabled motion prediction */
+	struct motion_prediction *prediction;
 };
 
 enum libinput_tablet_tool_axis {
@@ -370,6 +482,7 @@ struct tablet_axes {
 
 struct libinput_tablet_tool {
 	struct list link;
+	struct list lru_link; /* libinput->tool_registry.lru */
 	uint32_t serial;
 	uint32_t tool_id;
 	enum libinput_tablet_tool_type type;
@@ -409,6 +522,7 @@ struct libinput_tablet_pad_mode_group {
 struct libinput_event {
 	enum libinput_event_type type;
 	struct libinput_device *device;
+	uint64_t time; /* 0 for device notifications */
 };
 
 struct libinput_event_listener {
@@ -502,6 +616,24 @@ void
 libinput_device_init(struct libinput_device *device,
 		     struct libinput_seat *seat);
 
+void
+libinput_device_note_syn_dropped(struct libinput_device *device);
+
+void
+libinput_device_note_latency(struct libinput_device *device,
+			     enum libinput_latency_stage stage,
+			     enum libinput_event_type type,
+			     uint64_t latency);
+
+struct libinput_tablet_tool *
+libinput_tool_registry_lookup(struct libinput *libinput,
+			      enum libinput_tablet_tool_type type,
+			      uint32_t serial);
+
+void
+libinput_tool_registry_insert(struct libinput *libinput,
+			      struct libinput_tablet_tool *tool);
+
 struct libinput_device_group *
 libinput_device_group_create(struct libinput *libinput,
 			     const char *identifier);
@@ -696,6 +828,9 @@ libinput_now(struct libinput *libinput)
 {
 	struct timespec ts = { 0, 0 };
 
+	if (libinput->clock.is_virtual)
+		return libinput->clock.now;
+
 	if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0) {
 		log_error(libinput, "clock_gettime failed: %s\n", strerror(errno));
 		return 0;
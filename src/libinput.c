@@ -38,6 +38,8 @@
 #include "libinput-private.h"
 #include "evdev.h"
 #include "timer.h"
+#include "input-thread.h"
+#include "prediction.h"
 #include "quirks.h"
 
 #define require_event_type(li_, type_, retval_, ...)	\
@@ -75,6 +77,8 @@ ASSERT_INT_SIZE(enum libinput_config_click_method);
 ASSERT_INT_SIZE(enum libinput_config_middle_emulation_state);
 ASSERT_INT_SIZE(enum libinput_config_scroll_method);
 ASSERT_INT_SIZE(enum libinput_config_dwt_state);
+ASSERT_INT_SIZE(enum libinput_event_pool_stat);
+ASSERT_INT_SIZE(enum libinput_latency_stage);
 
 static inline const char *
 event_type_to_str(enum libinput_event_type type)
@@ -171,6 +175,7 @@ struct libinput_event_pointer {
 	uint64_t time;
 	struct normalized_coords delta;
 	struct device_float_coords delta_raw;
+	struct normalized_coords delta_predicted;
 	struct device_coords absolute;
 	struct discrete_coords discrete;
 	uint32_t button;
@@ -186,6 +191,7 @@ struct libinput_event_touch {
 	int32_t slot;
 	int32_t seat_slot;
 	struct device_coords point;
+	struct device_float_coords point_predicted;
 };
 
 struct libinput_event_gesture {
@@ -206,6 +212,7 @@ struct libinput_event_tablet_tool {
 	uint32_t seat_button_count;
 	uint64_t time;
 	struct tablet_axes axes;
+	struct device_float_coords point_predicted;
 	unsigned char changed_axes[NCHARS(LIBINPUT_TABLET_TOOL_AXIS_MAX + 1)];
 	struct libinput_tablet_tool *tool;
 	enum libinput_tablet_tool_proximity_state proximity_state;
@@ -244,6 +251,32 @@ struct libinput_event_switch {
 	enum libinput_switch_state state;
 };
 
+/* Maximum number of unused events kept around per pool, anything beyond
+ * that is handed back to the allocator. This is enough to cover a few
+ * frames worth of high-frequency events for a client that dispatches once
+ * per repaint. */
+#define EVENT_POOL_MAX_FREE 256
+
+/* A free event, re-using the memory of the event itself */
+struct libinput_event_pool_entry {
+	struct libinput_event_pool_entry *next;
+};
+
+static const size_t event_pool_sizes[EVENT_POOL_COUNT] = {
+	[EVENT_POOL_DEVICE_NOTIFY] = sizeof(struct libinput_event_device_notify),
+	[EVENT_POOL_KEYBOARD] = sizeof(struct libinput_event_keyboard),
+	[EVENT_POOL_POINTER] = sizeof(struct libinput_event_pointer),
+	[EVENT_POOL_TOUCH] = sizeof(struct libinput_event_touch),
+	[EVENT_POOL_GESTURE] = sizeof(struct libinput_event_gesture),
+	[EVENT_POOL_TABLET_TOOL] = sizeof(struct libinput_event_tablet_tool),
+	[EVENT_POOL_TABLET_PAD] = sizeof(struct libinput_event_tablet_pad),
+	[EVENT_POOL_SWITCH] = sizeof(struct libinput_event_switch),
+};
+
+static_assert(sizeof(struct libinput_event_device_notify) >=
+	      sizeof(struct libinput_event_pool_entry),
+	      "event too small for the pool free list");
+
 LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
 static void
 libinput_default_log_func(struct libinput *libinput,
@@ -567,6 +600,28 @@ libinput_event_pointer_get_dy(struct libinput_event_pointer *event)
 	return event->delta.y;
 }
 
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_dx_predicted(struct libinput_event_pointer *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_MOTION);
+
+	return event->delta_predicted.x;
+}
+
+LIBINPUT_EXPORT double
+libinput_event_pointer_get_dy_predicted(struct libinput_event_pointer *event)
+{
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_POINTER_MOTION);
+
+	return event->delta_predicted.y;
+}
+
 LIBINPUT_EXPORT double
 libinput_event_pointer_get_dx_unaccelerated(
 	struct libinput_event_pointer *event)
@@ -867,6 +922,70 @@ libinput_event_touch_get_y_transformed(struct libinput_event_touch *event,
 	return evdev_device_transform_y(device, event->point.y, height);
 }
 
+LIBINPUT_EXPORT double
+libinput_event_touch_get_x_predicted(struct libinput_event_touch *event)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_MOTION);
+
+	return evdev_convert_to_mm(device->abs.absinfo_x,
+				   event->point_predicted.x);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_touch_get_y_predicted(struct libinput_event_touch *event)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_MOTION);
+
+	return evdev_convert_to_mm(device->abs.absinfo_y,
+				   event->point_predicted.y);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_touch_get_x_predicted_transformed(struct libinput_event_touch *event,
+						 uint32_t width)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_MOTION);
+
+	return evdev_device_transform_x(device,
+					event->point_predicted.x,
+					width);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_touch_get_y_predicted_transformed(struct libinput_event_touch *event,
+						 uint32_t height)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TOUCH_DOWN,
+			   LIBINPUT_EVENT_TOUCH_MOTION);
+
+	return evdev_device_transform_y(device,
+					event->point_predicted.y,
+					height);
+}
+
 LIBINPUT_EXPORT double
 libinput_event_touch_get_y(struct libinput_event_touch *event)
 {
@@ -1450,6 +1569,74 @@ libinput_event_tablet_tool_get_y_transformed(struct libinput_event_tablet_tool *
 					height);
 }
 
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_x_predicted(struct libinput_event_tablet_tool *event)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return evdev_convert_to_mm(device->abs.absinfo_x,
+				   event->point_predicted.x);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_y_predicted(struct libinput_event_tablet_tool *event)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return evdev_convert_to_mm(device->abs.absinfo_y,
+				   event->point_predicted.y);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_x_predicted_transformed(struct libinput_event_tablet_tool *event,
+						       uint32_t width)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return evdev_device_transform_x(device,
+					event->point_predicted.x,
+					width);
+}
+
+LIBINPUT_EXPORT double
+libinput_event_tablet_tool_get_y_predicted_transformed(struct libinput_event_tablet_tool *event,
+						       uint32_t height)
+{
+	struct evdev_device *device = evdev_device(event->base.device);
+
+	require_event_type(libinput_event_get_context(&event->base),
+			   event->base.type,
+			   0,
+			   LIBINPUT_EVENT_TABLET_TOOL_AXIS,
+			   LIBINPUT_EVENT_TABLET_TOOL_TIP,
+			   LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+
+	return evdev_device_transform_y(device,
+					event->point_predicted.y,
+					height);
+}
+
 LIBINPUT_EXPORT struct libinput_tablet_tool *
 libinput_event_tablet_tool_get_tool(struct libinput_event_tablet_tool *event)
 {
@@ -1670,6 +1857,166 @@ libinput_tablet_tool_unref(struct libinput_tablet_tool *tool)
 	return NULL;
 }
 
+/* Max number of tools kept in the registry, only tools without a
+ * reference from the caller count towards this */
+#define TOOL_REGISTRY_MAX_TOOLS 64
+
+static inline struct list *
+tool_registry_bucket(struct libinput *libinput,
+		     enum libinput_tablet_tool_type type,
+		     uint32_t serial)
+{
+	uint32_t hash = serial ^ ((uint32_t)type << 24);
+
+	/* Serials are often sequential, mix all bits into the index */
+	hash ^= hash >> 16;
+	hash *= 0x7feb352d;
+	hash ^= hash >> 15;
+	hash *= 0x846ca68b;
+	hash ^= hash >> 16;
+
+	return &libinput->tool_registry.buckets[hash &
+						(libinput->tool_registry.nbuckets - 1)];
+}
+
+static void
+tool_registry_grow(struct libinput *libinput)
+{
+	struct list *old_buckets = libinput->tool_registry.buckets;
+	size_t nbuckets = libinput->tool_registry.nbuckets;
+	struct libinput_tablet_tool *tool;
+
+	nbuckets = nbuckets ? nbuckets * 2 : 16;
+
+	libinput->tool_registry.buckets = zalloc(nbuckets * sizeof(struct list));
+	libinput->tool_registry.nbuckets = nbuckets;
+	for (size_t i = 0; i < nbuckets; i++)
+		list_init(&libinput->tool_registry.buckets[i]);
+
+	list_for_each(tool, &libinput->tool_registry.lru, lru_link) {
+		list_remove(&tool->link);
+		list_insert(tool_registry_bucket(libinput,
+						 tool->type,
+						 tool->serial),
+			    &tool->link);
+	}
+
+	free(old_buckets);
+}
+
+static void
+tool_registry_evict(struct libinput *libinput, size_t max_tools)
+{
+	struct list *elm = libinput->tool_registry.lru.prev;
+
+	while (libinput->tool_registry.ntools > max_tools &&
+	       elm != &libinput->tool_registry.lru) {
+		struct libinput_tablet_tool *tool;
+
+		tool = container_of(elm, struct libinput_tablet_tool, lru_link);
+		elm = elm->prev;
+
+		/* The caller still uses this tool */
+		if (tool->refcount > 1)
+			continue;
+
+		list_remove(&tool->lru_link);
+		libinput->tool_registry.ntools--;
+		libinput->tool_registry.evictions++;
+		libinput_tablet_tool_unref(tool);
+	}
+}
+
+static void
+tool_registry_destroy(struct libinput *libinput)
+{
+	struct libinput_tablet_tool *tool;
+
+	list_for_each_safe(tool, &libinput->tool_registry.lru, lru_link) {
+		list_remove(&tool->lru_link);
+		/* The bucket goes away, a tool still referenced by the
+		 * caller must not point into it */
+		list_remove(&tool->link);
+		list_init(&tool->link);
+		libinput_tablet_tool_unref(tool);
+	}
+
+	free(libinput->tool_registry.buckets);
+	libinput->tool_registry.buckets = NULL;
+	libinput->tool_registry.nbuckets = 0;
+	libinput->tool_registry.ntools = 0;
+}
+
+struct libinput_tablet_tool *
+libinput_tool_registry_lookup(struct libinput *libinput,
+			      enum libinput_tablet_tool_type type,
+			      uint32_t serial)
+{
+	struct libinput_tablet_tool *tool;
+
+	if (libinput->tool_registry.nbuckets == 0)
+		goto out;
+
+	list_for_each(tool,
+		      tool_registry_bucket(libinput, type, serial),
+		      link) {
+		if (tool->type != type || tool->serial != serial)
+			continue;
+
+		list_remove(&tool->lru_link);
+		list_insert(&libinput->tool_registry.lru, &tool->lru_link);
+		libinput->tool_registry.hits++;
+		return tool;
+	}
+
+out:
+	libinput->tool_registry.misses++;
+	return NULL;
+}
+
+/**
+ * Add a tool to the registry, the registry takes over the caller's
+ * reference. If the registry is full, the least recently used tools
+ * that have no other reference are destroyed.
+ */
+void
+libinput_tool_registry_insert(struct libinput *libinput,
+			      struct libinput_tablet_tool *tool)
+{
+	assert(tool->serial != 0);
+
+	tool_registry_evict(libinput, TOOL_REGISTRY_MAX_TOOLS - 1);
+
+	if (libinput->tool_registry.ntools >= libinput->tool_registry.nbuckets)
+		tool_registry_grow(libinput);
+
+	list_insert(tool_registry_bucket(libinput, tool->type, tool->serial),
+		    &tool->link);
+	list_insert(&libinput->tool_registry.lru, &tool->lru_link);
+	libinput->tool_registry.ntools++;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_tablet_tool_registry_get_stat(struct libinput *libinput,
+				       enum libinput_tablet_tool_registry_stat stat)
+{
+	switch (stat) {
+	case LIBINPUT_TABLET_TOOL_REGISTRY_STAT_TOOLS:
+		return libinput->tool_registry.ntools;
+	case LIBINPUT_TABLET_TOOL_REGISTRY_STAT_HITS:
+		return libinput->tool_registry.hits;
+	case LIBINPUT_TABLET_TOOL_REGISTRY_STAT_MISSES:
+		return libinput->tool_registry.misses;
+	case LIBINPUT_TABLET_TOOL_REGISTRY_STAT_EVICTIONS:
+		return libinput->tool_registry.evictions;
+	}
+
+	log_bug_client(libinput,
+		       "Invalid tool registry stat %d\n",
+		       stat);
+	return 0;
+}
+
 LIBINPUT_EXPORT struct libinput_event *
 libinput_event_switch_get_base_event(struct libinput_event_switch *event)
 {
@@ -1785,6 +2132,7 @@ libinput_init(struct libinput *libinput,
 	list_init(&libinput->seat_list);
 	list_init(&libinput->device_group_list);
 	list_init(&libinput->tool_list);
+	list_init(&libinput->tool_registry.lru);
 
 	if (libinput_timer_subsys_init(libinput) != 0) {
 		free(libinput->events);
@@ -1799,7 +2147,8 @@ void
 libinput_init_quirks(struct libinput *libinput)
 {
 	const char *data_path,
-	           *override_file = NULL;
+	           *override_file = NULL,
+	           *cache_file;
 	struct quirks_context *quirks;
 
 	if (libinput->quirks_initialized)
@@ -1808,17 +2157,23 @@ libinput_init_quirks(struct libinput *libinput)
 	/* If we fail, we'll fail next time too */
 	libinput->quirks_initialized = true;
 
+	/* The cache is ignored if it doesn't match the data files, so a
+	 * custom data dir only gets a cache if one is explicitly given */
+	cache_file = getenv("LIBINPUT_QUIRKS_CACHE_FILE");
 	data_path = getenv("LIBINPUT_QUIRKS_DIR");
 	if (!data_path) {
 		data_path = LIBINPUT_QUIRKS_DIR;
 		override_file = LIBINPUT_QUIRKS_OVERRIDE_FILE;
+		if (!cache_file)
+			cache_file = LIBINPUT_QUIRKS_CACHE_FILE;
 	}
 
-	quirks = quirks_init_subsystem(data_path,
-				       override_file,
-				       log_msg_va,
-				       libinput,
-				       QLOG_LIBINPUT_LOGGING);
+	quirks = quirks_init_subsystem_with_cache(data_path,
+						  override_file,
+						  cache_file,
+						  log_msg_va,
+						  libinput,
+						  QLOG_LIBINPUT_LOGGING);
 	if (!quirks) {
 		log_error(libinput,
 			  "Failed to load the device quirks from %s%s%s. "
@@ -1841,6 +2196,11 @@ libinput_device_destroy(struct libinput_device *device);
 static void
 libinput_seat_destroy(struct libinput_seat *seat);
 
+static void
+libinput_note_queued_latency(struct libinput *libinput,
+			     size_t count,
+			     uint64_t now);
+
 static void
 libinput_drop_destroyed_sources(struct libinput *libinput)
 {
@@ -1851,6 +2211,170 @@ libinput_drop_destroyed_sources(struct libinput *libinput)
 	list_init(&libinput->source_destroy_list);
 }
 
+static enum event_pool_type
+event_pool_type_from_event_type(enum libinput_event_type type)
+{
+	switch (type) {
+	case LIBINPUT_EVENT_NONE:
+		abort();
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return EVENT_POOL_DEVICE_NOTIFY;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return EVENT_POOL_KEYBOARD;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		return EVENT_POOL_POINTER;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return EVENT_POOL_TOUCH;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		return EVENT_POOL_TABLET_TOOL;
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+	case LIBINPUT_EVENT_TABLET_PAD_KEY:
+		return EVENT_POOL_TABLET_PAD;
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:
+		return EVENT_POOL_GESTURE;
+	case LIBINPUT_EVENT_SWITCH_TOGGLE:
+		return EVENT_POOL_SWITCH;
+	}
+
+	abort();
+}
+
+/**
+ * Allocate a zeroed event from the context's event pool for the given
+ * event struct. Memory is only requested from the allocator if the pool
+ * has no free events left.
+ */
+static void *
+event_pool_zalloc(struct libinput_device *device,
+		  enum event_pool_type type)
+{
+	struct libinput *libinput = device->seat->libinput;
+	struct libinput_event_pool_entry *entry;
+	size_t size = event_pool_sizes[type];
+
+	entry = libinput->event_pool.free_list[type];
+	if (entry) {
+		libinput->event_pool.free_list[type] = entry->next;
+		libinput->event_pool.nfree[type]--;
+		libinput->event_pool.hits++;
+		memset(entry, 0, size);
+	} else {
+		entry = zalloc(size);
+		libinput->event_pool.misses++;
+	}
+
+	libinput->event_pool.nlive++;
+	libinput->event_pool.high_water_mark =
+		max(libinput->event_pool.high_water_mark,
+		    libinput->event_pool.nlive);
+
+	return entry;
+}
+
+static void
+event_pool_release(struct libinput *libinput,
+		   struct libinput_event *event)
+{
+	struct libinput_event_pool_entry *entry;
+	enum event_pool_type type;
+
+	assert(libinput->event_pool.nlive > 0);
+	libinput->event_pool.nlive--;
+
+	type = event_pool_type_from_event_type(event->type);
+	if (libinput->event_pool.nfree[type] >= EVENT_POOL_MAX_FREE) {
+		free(event);
+		return;
+	}
+
+	entry = (struct libinput_event_pool_entry *)event;
+	entry->next = libinput->event_pool.free_list[type];
+	libinput->event_pool.free_list[type] = entry;
+	libinput->event_pool.nfree[type]++;
+}
+
+static void
+event_pool_destroy(struct libinput *libinput)
+{
+	struct libinput_event_pool_entry *entry, *next;
+
+	for (size_t i = 0; i < EVENT_POOL_COUNT; i++) {
+		entry = libinput->event_pool.free_list[i];
+		while (entry) {
+			next = entry->next;
+			free(entry);
+			entry = next;
+		}
+		libinput->event_pool.free_list[i] = NULL;
+		libinput->event_pool.nfree[i] = 0;
+	}
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_event_pool_get_stat(struct libinput *libinput,
+			     enum libinput_event_pool_stat stat)
+{
+	switch (stat) {
+	case LIBINPUT_EVENT_POOL_STAT_HITS:
+		return libinput->event_pool.hits;
+	case LIBINPUT_EVENT_POOL_STAT_MISSES:
+		return libinput->event_pool.misses;
+	case LIBINPUT_EVENT_POOL_STAT_HIGH_WATER_MARK:
+		return libinput->event_pool.high_water_mark;
+	}
+
+	log_bug_client(libinput,
+		       "Invalid event pool stat %d\n",
+		       stat);
+	return 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_enable_input_thread(struct libinput *libinput)
+{
+	struct libinput_seat *seat;
+
+	if (libinput->input_thread)
+		return 0;
+
+	list_for_each(seat, &libinput->seat_list, link) {
+		if (!list_empty(&seat->devices_list)) {
+			log_bug_client(libinput,
+				       "The input thread must be enabled before devices are added\n");
+			return -1;
+		}
+	}
+
+	return input_thread_start(libinput);
+}
+
+LIBINPUT_EXPORT int
+libinput_set_event_coalescing(struct libinput *libinput,
+			      unsigned int threshold)
+{
+	libinput->events_coalesce_threshold = threshold;
+
+	return 0;
+}
+
 LIBINPUT_EXPORT struct libinput *
 libinput_ref(struct libinput *libinput)
 {
@@ -1903,8 +2427,12 @@ libinput_unref(struct libinput *libinput)
 		libinput_tablet_tool_unref(tool);
 	}
 
+	tool_registry_destroy(libinput);
+
+	input_thread_stop(libinput);
 	libinput_timer_subsys_destroy(libinput);
 	libinput_drop_destroyed_sources(libinput);
+	event_pool_destroy(libinput);
 	quirks_context_unref(libinput->quirks);
 	close(libinput->epoll_fd);
 	free(libinput);
@@ -1928,6 +2456,8 @@ libinput_event_tablet_pad_destroy(struct libinput_event_tablet_pad *event)
 LIBINPUT_EXPORT void
 libinput_event_destroy(struct libinput_event *event)
 {
+	struct libinput *libinput;
+
 	if (event == NULL)
 		return;
 
@@ -1950,10 +2480,17 @@ libinput_event_destroy(struct libinput_event *event)
 		break;
 	}
 
-	if (event->device)
-		libinput_device_unref(event->device);
+	/* Pooled events always have a device, see event_pool_zalloc() */
+	if (event->device == NULL) {
+		free(event);
+		return;
+	}
+
+	/* The device may go away with the unref below */
+	libinput = event->device->seat->libinput;
+	libinput_device_unref(event->device);
 
-	free(event);
+	event_pool_release(libinput, event);
 }
 
 int
@@ -1994,6 +2531,10 @@ libinput_seat_init(struct libinput_seat *seat,
 	seat->logical_name = safe_strdup(logical_name);
 	seat->destroy = destroy;
 	list_init(&seat->devices_list);
+	for (size_t i = 0; i < ARRAY_LENGTH(seat->role_devices); i++) {
+		list_init(&seat->role_devices[i]);
+		list_init(&seat->role_subscribers[i]);
+	}
 	list_insert(&libinput->seat_list, &seat->link);
 }
 
@@ -2076,9 +2617,147 @@ static void
 libinput_device_destroy(struct libinput_device *device)
 {
 	assert(list_empty(&device->event_listeners));
+
+	for (size_t i = 0; i < LATENCY_EVENT_TYPES; i++) {
+		free(device->latency.queued[i]);
+		free(device->latency.delivered[i]);
+	}
+
+	free(device->prediction);
+
 	evdev_device_destroy(evdev_device(device));
 }
 
+static inline int
+latency_type_index(enum libinput_event_type type)
+{
+	unsigned int group = type / 100,
+		     offset = type % 100;
+
+	if (group < 3 || group > 9 || offset >= 6)
+		return -1;
+
+	return (group - 3) * 6 + offset;
+}
+
+static inline unsigned int
+latency_bucket(uint64_t latency)
+{
+	unsigned int bucket;
+
+	if (latency < 2)
+		return 0;
+
+	bucket = 63 - __builtin_clzll(latency);
+
+	return min(bucket, LATENCY_HISTOGRAM_BUCKETS - 1);
+}
+
+void
+libinput_device_note_latency(struct libinput_device *device,
+			     enum libinput_latency_stage stage,
+			     enum libinput_event_type type,
+			     uint64_t latency)
+{
+	struct latency_histogram **histograms;
+	struct latency_histogram *h;
+	int idx;
+
+	switch (stage) {
+	case LIBINPUT_LATENCY_STAGE_READ:
+		h = &device->latency.read;
+		h->counts[latency_bucket(latency)]++;
+		return;
+	case LIBINPUT_LATENCY_STAGE_QUEUED:
+		histograms = device->latency.queued;
+		break;
+	case LIBINPUT_LATENCY_STAGE_DELIVERED:
+		histograms = device->latency.delivered;
+		break;
+	default:
+		abort();
+	}
+
+	idx = latency_type_index(type);
+	if (idx < 0)
+		return;
+
+	h = histograms[idx];
+	if (!h) {
+		h = zalloc(sizeof(*h));
+		histograms[idx] = h;
+	}
+
+	h->counts[latency_bucket(latency)]++;
+}
+
+LIBINPUT_EXPORT size_t
+libinput_device_get_latency_histogram(struct libinput_device *device,
+				      enum libinput_latency_stage stage,
+				      enum libinput_event_type type,
+				      uint64_t *counts,
+				      size_t ncounts)
+{
+	struct latency_histogram sum = {0};
+	struct latency_histogram **histograms;
+	int idx;
+
+	ncounts = min(ncounts, LATENCY_HISTOGRAM_BUCKETS);
+
+	switch (stage) {
+	case LIBINPUT_LATENCY_STAGE_READ:
+		if (type == LIBINPUT_EVENT_NONE)
+			sum = device->latency.read;
+		histograms = NULL;
+		break;
+	case LIBINPUT_LATENCY_STAGE_QUEUED:
+		histograms = device->latency.queued;
+		break;
+	case LIBINPUT_LATENCY_STAGE_DELIVERED:
+		histograms = device->latency.delivered;
+		break;
+	default:
+		log_bug_client(libinput_device_get_context(device),
+			       "Invalid latency stage %d\n",
+			       stage);
+		return 0;
+	}
+
+	if (histograms && type == LIBINPUT_EVENT_NONE) {
+		for (size_t i = 0; i < LATENCY_EVENT_TYPES; i++) {
+			if (!histograms[i])
+				continue;
+
+			for (size_t b = 0; b < LATENCY_HISTOGRAM_BUCKETS; b++)
+				sum.counts[b] += histograms[i]->counts[b];
+		}
+	} else if (histograms) {
+		idx = latency_type_index(type);
+		if (idx >= 0 && histograms[idx])
+			sum = *histograms[idx];
+	}
+
+	if (ncounts > 0)
+		memcpy(counts, sum.counts, ncounts * sizeof(*counts));
+
+	return LATENCY_HISTOGRAM_BUCKETS;
+}
+
+LIBINPUT_EXPORT void
+libinput_device_reset_latency_histograms(struct libinput_device *device)
+{
+	memset(&device->latency.read, 0, sizeof(device->latency.read));
+
+	for (size_t i = 0; i < LATENCY_EVENT_TYPES; i++) {
+		if (device->latency.queued[i])
+			memset(device->latency.queued[i], 0,
+			       sizeof(*device->latency.queued[i]));
+		if (device->latency.delivered[i])
+			memset(device->latency.delivered[i], 0,
+			       sizeof(*device->latency.delivered[i]));
+	}
+}
+
 LIBINPUT_EXPORT struct libinput_device *
 libinput_device_unref(struct libinput_device *device)
 {
@@ -2101,16 +2780,19 @@ libinput_get_fd(struct libinput *libinput)
 LIBINPUT_EXPORT int
 libinput_dispatch(struct libinput *libinput)
 {
-	static uint8_t take_time_snapshot;
 	struct libinput_source *source;
 	struct epoll_event ep[32];
+	uint64_t start, end;
 	int i, count;
 
-	/* Every 10 calls to libinput_dispatch() we take the current time so
-	 * we can check the delay between our current time and the event
+	start = libinput_now(libinput);
+	libinput->delivery_time = 0;
+
+	/* Every 10 calls to libinput_dispatch() we use the current time to
+	 * check the delay between our current time and the event
 	 * timestamps */
-	if ((++take_time_snapshot % 10) == 0)
-		libinput->dispatch_time = libinput_now(libinput);
+	if ((++libinput->dispatch_stats.dispatches % 10) == 0)
+		libinput->dispatch_time = start;
 	else if (libinput->dispatch_time)
 		libinput->dispatch_time = 0;
 
@@ -2118,6 +2800,9 @@ libinput_dispatch(struct libinput *libinput)
 	if (count < 0)
 		return -errno;
 
+	libinput->dispatch_stats.wakeups += count;
+
+	libinput->dispatching = true;
 	for (i = 0; i < count; ++i) {
 		source = ep[i].data.ptr;
 		if (source->fd == -1)
@@ -2125,12 +2810,145 @@ libinput_dispatch(struct libinput *libinput)
 
 		source->dispatch(source->user_data);
 	}
+	libinput->dispatching = false;
 
 	libinput_drop_destroyed_sources(libinput);
 
+	/* the events queued above have used it, retrieving them takes a
+	 * new one */
+	libinput->delivery_time = 0;
+
+	end = libinput_now(libinput);
+	if (start != 0 && end > start)
+		libinput->dispatch_stats.dispatch_time += end - start;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_get_dispatch_stat(struct libinput *libinput,
+			   enum libinput_dispatch_stat stat)
+{
+	switch (stat) {
+	case LIBINPUT_DISPATCH_STAT_DISPATCHES:
+		return libinput->dispatch_stats.dispatches;
+	case LIBINPUT_DISPATCH_STAT_WAKEUPS:
+		return libinput->dispatch_stats.wakeups;
+	case LIBINPUT_DISPATCH_STAT_DISPATCH_TIME:
+		return libinput->dispatch_stats.dispatch_time;
+	case LIBINPUT_DISPATCH_STAT_TIMER_EXPIRIES:
+		return libinput->dispatch_stats.timer_expiries;
+	case LIBINPUT_DISPATCH_STAT_EVENTS_QUEUED:
+		return libinput->dispatch_stats.events_queued;
+	case LIBINPUT_DISPATCH_STAT_EVENTS_COALESCED:
+		return libinput->dispatch_stats.events_coalesced;
+	case LIBINPUT_DISPATCH_STAT_EVENTS_CONSUMED:
+		return libinput->dispatch_stats.events_consumed;
+	case LIBINPUT_DISPATCH_STAT_QUEUE_HIGH_WATER_MARK:
+		return libinput->dispatch_stats.queue_high_water_mark;
+	case LIBINPUT_DISPATCH_STAT_QUEUE_REALLOCATIONS:
+		return libinput->dispatch_stats.queue_reallocations;
+	case LIBINPUT_DISPATCH_STAT_SYN_DROPPED:
+		return libinput->dispatch_stats.syn_dropped;
+	}
+
+	log_bug_client(libinput,
+		       "Invalid dispatch stat %d\n",
+		       stat);
 	return 0;
 }
 
+void
+libinput_device_note_syn_dropped(struct libinput_device *device)
+{
+	device->syn_dropped++;
+	device->seat->libinput->dispatch_stats.syn_dropped++;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_syn_dropped_count(struct libinput_device *device)
+{
+	return device->syn_dropped;
+}
+
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_device_set_motion_prediction(struct libinput_device *device,
+				      unsigned int horizon_ms)
+{
+	struct evdev_device *evdev = evdev_device(device);
+	struct motion_prediction *prediction = device->prediction;
+	double resx = 1.0, resy = 1.0;
+
+	if (horizon_ms > PREDICTION_MAX_HORIZON_MS)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	if (horizon_ms == 0) {
+		free(device->prediction);
+		device->prediction = NULL;
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+	}
+
+	if (prediction && prediction->horizon == ms2us(horizon_ms))
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	if (!prediction) {
+		prediction = zalloc(sizeof(*prediction));
+		device->prediction = prediction;
+	}
+
+	/* The touch and tablet errors are in mm, pointer motion and
+	 * devices without a resolution don't have a physical unit */
+	if (evdev->abs.absinfo_x && evdev->abs.absinfo_y &&
+	    !evdev->abs.is_fake_resolution) {
+		resx = evdev->abs.absinfo_x->resolution;
+		resy = evdev->abs.absinfo_y->resolution;
+	}
+
+	motion_predictor_init(&prediction->pointer, 1.0, 1.0);
+	motion_predictor_init(&prediction->tablet, resx, resy);
+	for (size_t i = 0; i < ARRAY_LENGTH(prediction->touches); i++)
+		motion_predictor_init(&prediction->touches[i], resx, resy);
+	prediction->horizon = ms2us(horizon_ms);
+	prediction->error = (struct prediction_error) { 0 };
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
+LIBINPUT_EXPORT unsigned int
+libinput_device_get_motion_prediction(struct libinput_device *device)
+{
+	if (!device->prediction)
+		return 0;
+
+	return us2ms(device->prediction->horizon);
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_motion_prediction_error(struct libinput_device *device,
+					    double *mean_error,
+					    double *max_error)
+{
+	const struct prediction_error *error;
+	double mean = 0.0, largest = 0.0;
+	uint64_t count = 0;
+
+	if (device->prediction) {
+		error = &device->prediction->error;
+		count = error->count;
+		if (count > 0) {
+			mean = error->sum/count;
+			largest = error->max;
+		}
+	}
+
+	if (mean_error)
+		*mean_error = mean;
+	if (max_error)
+		*max_error = largest;
+
+	return count;
+}
+
 void
 libinput_device_init_event_listener(struct libinput_event_listener *listener)
 {
@@ -2208,6 +3026,43 @@ init_event_base(struct libinput_event *event,
 	event->device = device;
 }
 
+static inline void
+libinput_event_note_latency(struct libinput_event *event,
+			    enum libinput_latency_stage stage,
+			    uint64_t now)
+{
+	/* Device notifications have no timestamp and we can't measure
+	 * anything useful if the clock failed */
+	if (event->time == 0 || now < event->time)
+		return;
+
+	libinput_device_note_latency(event->device,
+				     stage,
+				     event->type,
+				     now - event->time);
+}
+
+static inline uint64_t
+libinput_delivery_time(struct libinput *libinput)
+{
+	if (libinput->delivery_time == 0)
+		libinput->delivery_time = libinput_now(libinput);
+
+	return libinput->delivery_time;
+}
+
+/* All events queued by one libinput_dispatch() share one timestamp.
+ * Events queued outside of it, e.g. the key releases when a device is
+ * suspended by a config change, are rare and take their own. */
+static inline uint64_t
+libinput_queue_time(struct libinput *libinput)
+{
+	if (!libinput->dispatching)
+		return libinput_now(libinput);
+
+	return libinput_delivery_time(libinput);
+}
+
 static void
 post_base_event(struct libinput_device *device,
 		enum libinput_event_type type,
@@ -2218,6 +3073,77 @@ post_base_event(struct libinput_device *device,
 	libinput_post_event(libinput, event);
 }
 
+static inline bool
+pointer_axis_event_is_stop(const struct libinput_event_pointer *event)
+{
+	if ((event->axes & bit(LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL)) &&
+	    event->delta.y == 0.0)
+		return true;
+
+	if ((event->axes & bit(LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL)) &&
+	    event->delta.x == 0.0)
+		return true;
+
+	return false;
+}
+
+/**
+ * Merge a relative motion or axis event into the last event in the
+ * queue if coalescing is enabled, the queue is backed up and the last
+ * event is the same type of event from the same device. Any other event
+ * in between, e.g. a button or key event, stops the merge.
+ *
+ * @return true if the event was merged and can be released
+ */
+static bool
+libinput_coalesce_event(struct libinput *libinput,
+			struct libinput_event *event)
+{
+	struct libinput_event *tail;
+	struct libinput_event_pointer *prev, *next;
+
+	if (libinput->events_coalesce_threshold == 0 ||
+	    libinput->events_count < libinput->events_coalesce_threshold)
+		return false;
+
+	if (event->type != LIBINPUT_EVENT_POINTER_MOTION &&
+	    event->type != LIBINPUT_EVENT_POINTER_AXIS)
+		return false;
+
+	tail = libinput->events[(libinput->events_in + libinput->events_len - 1) %
+				libinput->events_len];
+	if (tail->type != event->type || tail->device != event->device)
+		return false;
+
+	prev = (struct libinput_event_pointer *)tail;
+	next = (struct libinput_event_pointer *)event;
+
+	if (event->type == LIBINPUT_EVENT_POINTER_AXIS) {
+		/* An axis value of zero terminates a scroll sequence, the
+		 * caller must see it */
+		if (prev->source != next->source ||
+		    prev->axes != next->axes ||
+		    pointer_axis_event_is_stop(prev) ||
+		    pointer_axis_event_is_stop(next))
+			return false;
+
+		prev->discrete.x += next->discrete.x;
+		prev->discrete.y += next->discrete.y;
+	} else {
+		prev->delta_raw.x += next->delta_raw.x;
+		prev->delta_raw.y += next->delta_raw.y;
+		/* the prediction is from the end of the motion */
+		prev->delta_predicted = next->delta_predicted;
+	}
+
+	prev->delta.x += next->delta.x;
+	prev->delta.y += next->delta.y;
+	prev->time = next->time;
+	tail->time = event->time;
+
+	return true;
+}
+
 static void
 post_device_event(struct libinput_device *device,
 		  uint64_t time,
@@ -2238,10 +3164,17 @@ post_device_event(struct libinput_device *device,
 #endif
 
 	init_event_base(event, device, type);
+	event->time = time;
 
 	list_for_each_safe(listener, &device->event_listeners, link)
 		listener->notify_func(time, event, listener->notify_func_data);
 
+	if (libinput_coalesce_event(device->seat->libinput, event)) {
+		device->seat->libinput->dispatch_stats.events_coalesced++;
+		event_pool_release(device->seat->libinput, event);
+		return;
+	}
+
 	libinput_post_event(device->seat->libinput, event);
 }
 
@@ -2250,7 +3183,8 @@ notify_added_device(struct libinput_device *device)
 {
 	struct libinput_event_device_notify *added_device_event;
 
-	added_device_event = zalloc(sizeof *added_device_event);
+	added_device_event = event_pool_zalloc(device,
+					       EVENT_POOL_DEVICE_NOTIFY);
 
 	post_base_event(device,
 			LIBINPUT_EVENT_DEVICE_ADDED,
@@ -2268,7 +3202,8 @@ notify_removed_device(struct libinput_device *device)
 {
 	struct libinput_event_device_notify *removed_device_event;
 
-	removed_device_event = zalloc(sizeof *removed_device_event);
+	removed_device_event = event_pool_zalloc(device,
+						 EVENT_POOL_DEVICE_NOTIFY);
 
 	post_base_event(device,
 			LIBINPUT_EVENT_DEVICE_REMOVED,
@@ -2334,7 +3269,7 @@ keyboard_notify_key(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_KEYBOARD))
 		return;
 
-	key_event = zalloc(sizeof *key_event);
+	key_event = event_pool_zalloc(device, EVENT_POOL_KEYBOARD);
 
 	seat_key_count = update_seat_key_count(device->seat, key, state);
 
@@ -2350,6 +3285,112 @@ keyboard_notify_key(struct libinput_device *device,
 			  &key_event->base);
 }
 
+static void
+predict_pointer_motion(struct libinput_device *device,
+		       uint64_t time,
+		       const struct normalized_coords *delta,
+		       struct normalized_coords *predicted)
+{
+	struct motion_prediction *prediction = device->prediction;
+	struct device_float_coords *position;
+	struct device_float_coords p;
+
+	*predicted = (struct normalized_coords) { 0.0, 0.0 };
+
+	if (!prediction)
+		return;
+
+	position = &prediction->pointer_position;
+	position->x += delta->x;
+	position->y += delta->y;
+	motion_predictor_push(&prediction->pointer,
+			      &prediction->error,
+			      prediction->horizon,
+			      time,
+			      position,
+			      &p);
+	predicted->x = p.x - position->x;
+	predicted->y = p.y - position->y;
+}
+
+static void
+predict_touch(struct libinput_device *device,
+	      uint64_t time,
+	      int32_t slot,
+	      const struct device_coords *point,
+	      bool down,
+	      struct device_float_coords *predicted)
+{
+	struct motion_prediction *prediction = device->prediction;
+	struct device_float_coords p = { point->x, point->y };
+	struct motion_predictor *predictor;
+
+	*predicted = p;
+
+	/* single-touch devices use slot -1 */
+	slot = max(slot, 0);
+	if (!prediction || slot >= PREDICTION_MAX_TOUCHES)
+		return;
+
+	predictor = &prediction->touches[slot];
+	if (down)
+		motion_predictor_reset(predictor, &prediction->error);
+	motion_predictor_push(predictor,
+			      &prediction->error,
+			      prediction->horizon,
+			      time,
+			      &p,
+			      predicted);
+}
+
+static void
+predict_tablet_tool(struct libinput_device *device,
+		    uint64_t time,
+		    const struct tablet_axes *axes,
+		    bool proximity_in,
+		    struct device_float_coords *predicted)
+{
+	struct motion_prediction *prediction = device->prediction;
+	struct device_float_coords p = { axes->point.x, axes->point.y };
+
+	*predicted = p;
+
+	if (!prediction)
+		return;
+
+	if (proximity_in)
+		motion_predictor_reset(&prediction->tablet, &prediction->error);
+	motion_predictor_push(&prediction->tablet,
+			      &prediction->error,
+			      prediction->horizon,
+			      time,
+			      &p,
+			      predicted);
+}
+
+static void
+predict_touch_end(struct libinput_device *device, int32_t slot)
+{
+	struct motion_prediction *prediction = device->prediction;
+
+	slot = max(slot, 0);
+	if (!prediction || slot >= PREDICTION_MAX_TOUCHES)
+		return;
+
+	motion_predictor_reset(&prediction->touches[slot], &prediction->error);
+}
+
+static void
+predict_tablet_tool_end(struct libinput_device *device)
+{
+	struct motion_prediction *prediction = device->prediction;
+
+	if (!prediction)
+		return;
+
+	motion_predictor_reset(&prediction->tablet, &prediction->error);
+}
+
 void
 pointer_notify_motion(struct libinput_device *device,
 		      uint64_t time,
@@ -2361,13 +3402,15 @@ pointer_notify_motion(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	motion_event = zalloc(sizeof *motion_event);
+	motion_event = event_pool_zalloc(device, EVENT_POOL_POINTER);
 
 	*motion_event = (struct libinput_event_pointer) {
 		.time = time,
 		.delta = *delta,
 		.delta_raw = *raw,
 	};
+	predict_pointer_motion(device, time, delta,
+			       &motion_event->delta_predicted);
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_POINTER_MOTION,
@@ -2384,7 +3427,7 @@ pointer_notify_motion_absolute(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	motion_absolute_event = zalloc(sizeof *motion_absolute_event);
+	motion_absolute_event = event_pool_zalloc(device, EVENT_POOL_POINTER);
 
 	*motion_absolute_event = (struct libinput_event_pointer) {
 		.time = time,
@@ -2408,7 +3451,7 @@ pointer_notify_button(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	button_event = zalloc(sizeof *button_event);
+	button_event = event_pool_zalloc(device, EVENT_POOL_POINTER);
 
 	seat_button_count = update_seat_button_count(device->seat,
 						     button,
@@ -2439,7 +3482,7 @@ pointer_notify_axis(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	axis_event = zalloc(sizeof *axis_event);
+	axis_event = event_pool_zalloc(device, EVENT_POOL_POINTER);
 
 	*axis_event = (struct libinput_event_pointer) {
 		.time = time,
@@ -2466,7 +3509,7 @@ touch_notify_touch_down(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	touch_event = event_pool_zalloc(device, EVENT_POOL_TOUCH);
 
 	*touch_event = (struct libinput_event_touch) {
 		.time = time,
@@ -2474,6 +3517,8 @@ touch_notify_touch_down(struct libinput_device *device,
 		.seat_slot = seat_slot,
 		.point = *point,
 	};
+	predict_touch(device, time, slot, point, true,
+		      &touch_event->point_predicted);
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_TOUCH_DOWN,
@@ -2492,7 +3537,7 @@ touch_notify_touch_motion(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	touch_event = event_pool_zalloc(device, EVENT_POOL_TOUCH);
 
 	*touch_event = (struct libinput_event_touch) {
 		.time = time,
@@ -2500,6 +3545,8 @@ touch_notify_touch_motion(struct libinput_device *device,
 		.seat_slot = seat_slot,
 		.point = *point,
 	};
+	predict_touch(device, time, slot, point, false,
+		      &touch_event->point_predicted);
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_TOUCH_MOTION,
@@ -2517,13 +3564,14 @@ touch_notify_touch_up(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	touch_event = event_pool_zalloc(device, EVENT_POOL_TOUCH);
 
 	*touch_event = (struct libinput_event_touch) {
 		.time = time,
 		.slot = slot,
 		.seat_slot = seat_slot,
 	};
+	predict_touch_end(device, slot);
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_TOUCH_UP,
@@ -2541,13 +3589,14 @@ touch_notify_touch_cancel(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	touch_event = event_pool_zalloc(device, EVENT_POOL_TOUCH);
 
 	*touch_event = (struct libinput_event_touch) {
 		.time = time,
 		.slot = slot,
 		.seat_slot = seat_slot,
 	};
+	predict_touch_end(device, slot);
 
 	post_device_event(device, time,
 			  LIBINPUT_EVENT_TOUCH_CANCEL,
@@ -2563,7 +3612,7 @@ touch_notify_frame(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	touch_event = event_pool_zalloc(device, EVENT_POOL_TOUCH);
 
 	*touch_event = (struct libinput_event_touch) {
 		.time = time,
@@ -2584,7 +3633,7 @@ tablet_notify_axis(struct libinput_device *device,
 {
 	struct libinput_event_tablet_tool *axis_event;
 
-	axis_event = zalloc(sizeof *axis_event);
+	axis_event = event_pool_zalloc(device, EVENT_POOL_TABLET_TOOL);
 
 	*axis_event = (struct libinput_event_tablet_tool) {
 		.time = time,
@@ -2593,6 +3642,8 @@ tablet_notify_axis(struct libinput_device *device,
 		.tip_state = tip_state,
 		.axes = *axes,
 	};
+	predict_tablet_tool(device, time, axes, false,
+			    &axis_event->point_predicted);
 
 	memcpy(axis_event->changed_axes,
 	       changed_axes,
@@ -2614,7 +3665,7 @@ tablet_notify_proximity(struct libinput_device *device,
 {
 	struct libinput_event_tablet_tool *proximity_event;
 
-	proximity_event = zalloc(sizeof *proximity_event);
+	proximity_event = event_pool_zalloc(device, EVENT_POOL_TABLET_TOOL);
 
 	*proximity_event = (struct libinput_event_tablet_tool) {
 		.time = time,
@@ -2622,7 +3673,13 @@ tablet_notify_proximity(struct libinput_device *device,
 		.tip_state = LIBINPUT_TABLET_TOOL_TIP_UP,
 		.proximity_state = proximity_state,
 		.axes = *axes,
+		.point_predicted = { axes->point.x, axes->point.y },
 	};
+	if (proximity_state == LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN)
+		predict_tablet_tool(device, time, axes, true,
+				    &proximity_event->point_predicted);
+	else
+		predict_tablet_tool_end(device);
 	memcpy(proximity_event->changed_axes,
 	       changed_axes,
 	       sizeof(proximity_event->changed_axes));
@@ -2643,7 +3700,7 @@ tablet_notify_tip(struct libinput_device *device,
 {
 	struct libinput_event_tablet_tool *tip_event;
 
-	tip_event = zalloc(sizeof *tip_event);
+	tip_event = event_pool_zalloc(device, EVENT_POOL_TABLET_TOOL);
 
 	*tip_event = (struct libinput_event_tablet_tool) {
 		.time = time,
@@ -2652,6 +3709,8 @@ tablet_notify_tip(struct libinput_device *device,
 		.proximity_state = LIBINPUT_TABLET_TOOL_PROXIMITY_STATE_IN,
 		.axes = *axes,
 	};
+	predict_tablet_tool(device, time, axes, false,
+			    &tip_event->point_predicted);
 	memcpy(tip_event->changed_axes,
 	       changed_axes,
 	       sizeof(tip_event->changed_axes));
@@ -2674,7 +3733,7 @@ tablet_notify_button(struct libinput_device *device,
 	struct libinput_event_tablet_tool *button_event;
 	int32_t seat_button_count;
 
-	button_event = zalloc(sizeof *button_event);
+	button_event = event_pool_zalloc(device, EVENT_POOL_TABLET_TOOL);
 
 	seat_button_count = update_seat_button_count(device->seat,
 						     button,
@@ -2707,7 +3766,7 @@ tablet_pad_notify_button(struct libinput_device *device,
 	struct libinput_event_tablet_pad *button_event;
 	unsigned int mode;
 
-	button_event = zalloc(sizeof *button_event);
+	button_event = event_pool_zalloc(device, EVENT_POOL_TABLET_PAD);
 
 	mode = libinput_tablet_pad_mode_group_get_mode(group);
 
@@ -2736,7 +3795,7 @@ tablet_pad_notify_ring(struct libinput_device *device,
 	struct libinput_event_tablet_pad *ring_event;
 	unsigned int mode;
 
-	ring_event = zalloc(sizeof *ring_event);
+	ring_event = event_pool_zalloc(device, EVENT_POOL_TABLET_PAD);
 
 	mode = libinput_tablet_pad_mode_group_get_mode(group);
 
@@ -2766,7 +3825,7 @@ tablet_pad_notify_strip(struct libinput_device *device,
 	struct libinput_event_tablet_pad *strip_event;
 	unsigned int mode;
 
-	strip_event = zalloc(sizeof *strip_event);
+	strip_event = event_pool_zalloc(device, EVENT_POOL_TABLET_PAD);
 
 	mode = libinput_tablet_pad_mode_group_get_mode(group);
 
@@ -2793,7 +3852,7 @@ tablet_pad_notify_key(struct libinput_device *device,
 {
 	struct libinput_event_tablet_pad *key_event;
 
-	key_event = zalloc(sizeof *key_event);
+	key_event = event_pool_zalloc(device, EVENT_POOL_TABLET_PAD);
 
 	*key_event = (struct libinput_event_tablet_pad) {
 		.time = time,
@@ -2823,7 +3882,7 @@ gesture_notify(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_GESTURE))
 		return;
 
-	gesture_event = zalloc(sizeof *gesture_event);
+	gesture_event = event_pool_zalloc(device, EVENT_POOL_GESTURE);
 
 	*gesture_event = (struct libinput_event_gesture) {
 		.time = time,
@@ -2901,7 +3960,7 @@ switch_notify_toggle(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_SWITCH))
 		return;
 
-	switch_event = zalloc(sizeof *switch_event);
+	switch_event = event_pool_zalloc(device, EVENT_POOL_SWITCH);
 
 	*switch_event = (struct libinput_event_switch) {
 		.time = time,
@@ -2948,6 +4007,7 @@ libinput_post_event(struct libinput *libinput,
 		}
 
 		events = tmp;
+		libinput->dispatch_stats.queue_reallocations++;
 
 		if (libinput->events_count > 0 && libinput->events_in == 0) {
 			libinput->events_in = libinput->events_len;
@@ -2969,8 +4029,17 @@ libinput_post_event(struct libinput *libinput,
 		libinput_device_ref(event->device);
 
 	libinput->events_count = events_count;
+	libinput->dispatch_stats.events_queued++;
+	libinput->dispatch_stats.queue_high_water_mark =
+		max(libinput->dispatch_stats.queue_high_water_mark,
+		    events_count);
 	events[libinput->events_in] = event;
 	libinput->events_in = (libinput->events_in + 1) % libinput->events_len;
+
+	if (event->time != 0)
+		libinput_event_note_latency(event,
+					    LIBINPUT_LATENCY_STAGE_QUEUED,
+					    libinput_queue_time(libinput));
 }
 
 LIBINPUT_EXPORT struct libinput_event *
@@ -2985,10 +4054,60 @@ libinput_get_event(struct libinput *libinput)
 	libinput->events_out =
 		(libinput->events_out + 1) % libinput->events_len;
 	libinput->events_count--;
+	libinput->dispatch_stats.events_consumed++;
+
+	libinput_event_note_latency(event,
+				    LIBINPUT_LATENCY_STAGE_DELIVERED,
+				    libinput_delivery_time(libinput));
 
 	return event;
 }
 
+LIBINPUT_EXPORT size_t
+libinput_get_events(struct libinput *libinput,
+		    struct libinput_event **events,
+		    size_t max_events)
+{
+	size_t count, chunk;
+	uint64_t now;
+
+	count = min(libinput->events_count, max_events);
+	if (count == 0)
+		return 0;
+
+	/* The ring buffer wraps at most once, so this is at most two
+	 * contiguous copies */
+	chunk = min(count, libinput->events_len - libinput->events_out);
+	memcpy(events,
+	       libinput->events + libinput->events_out,
+	       chunk * sizeof *events);
+	if (chunk < count)
+		memcpy(events + chunk,
+		       libinput->events,
+		       (count - chunk) * sizeof *events);
+
+	libinput->events_out =
+		(libinput->events_out + count) % libinput->events_len;
+	libinput->events_count -= count;
+	libinput->dispatch_stats.events_consumed += count;
+
+	now = libinput_delivery_time(libinput);
+	for (size_t i = 0; i < count; i++)
+		libinput_event_note_latency(events[i],
+					    LIBINPUT_LATENCY_STAGE_DELIVERED,
+					    now);
+
+	return count;
+}
+
+LIBINPUT_EXPORT void
+libinput_events_destroy(struct libinput_event **events,
+			size_t nevents)
+{
+	for (size_t i = 0; i < nevents; i++)
+		libinput_event_destroy(events[i]);
+}
+
 LIBINPUT_EXPORT enum libinput_event_type
 libinput_next_event_type(struct libinput *libinput)
 {
@@ -1273,6 +1273,48 @@ double
 libinput_event_pointer_get_dy_unaccelerated(
 	struct libinput_event_pointer *event);
 
+/**
+ * @ingroup event_pointer
+ *
+ * Return the predicted relative x movement after this event, i.e. how
+ * much further the pointer is expected to move within the prediction
+ * horizon of the device, see libinput_device_set_motion_prediction().
+ * The value is in the same units as libinput_event_pointer_get_dx().
+ *
+ * If motion prediction is disabled or there is not enough recent motion
+ * to predict from, this function returns 0.
+ *
+ * @note It is an application bug to call this function for events other than
+ * @ref LIBINPUT_EVENT_POINTER_MOTION.
+ *
+ * @return The predicted relative x movement after this event
+ *
+ * @since 1.18
+ */
+double
+libinput_event_pointer_get_dx_predicted(struct libinput_event_pointer *event);
+
+/**
+ * @ingroup event_pointer
+ *
+ * Return the predicted relative y movement after this event, i.e. how
+ * much further the pointer is expected to move within the prediction
+ * horizon of the device, see libinput_device_set_motion_prediction().
+ * The value is in the same units as libinput_event_pointer_get_dy().
+ *
+ * If motion prediction is disabled or there is not enough recent motion
+ * to predict from, this function returns 0.
+ *
+ * @note It is an application bug to call this function for events other than
+ * @ref LIBINPUT_EVENT_POINTER_MOTION.
+ *
+ * @return The predicted relative y movement after this event
+ *
+ * @since 1.18
+ */
+double
+libinput_event_pointer_get_dy_predicted(struct libinput_event_pointer *event);
+
 /**
  * @ingroup event_pointer
  *
@@ -1672,6 +1714,96 @@ double
 libinput_event_touch_get_y_transformed(struct libinput_event_touch *event,
 				       uint32_t height);
 
+/**
+ * @ingroup event_touch
+ *
+ * Return the predicted absolute x coordinate of the touch point at the
+ * prediction horizon of the device after this event, in mm from the top
+ * left corner of the device, see libinput_device_set_motion_prediction().
+ *
+ * If motion prediction is disabled or there is not enough recent motion
+ * to predict from, this function returns the same value as
+ * libinput_event_touch_get_x().
+ *
+ * @note It is an application bug to call this function for events of type
+ * other than @ref LIBINPUT_EVENT_TOUCH_DOWN or @ref
+ * LIBINPUT_EVENT_TOUCH_MOTION.
+ *
+ * @param event The libinput touch event
+ * @return The predicted absolute x coordinate in mm
+ *
+ * @since 1.18
+ */
+double
+libinput_event_touch_get_x_predicted(struct libinput_event_touch *event);
+
+/**
+ * @ingroup event_touch
+ *
+ * Return the predicted absolute y coordinate of the touch point at the
+ * prediction horizon of the device after this event, in mm from the top
+ * left corner of the device, see libinput_device_set_motion_prediction().
+ *
+ * If motion prediction is disabled or there is not enough recent motion
+ * to predict from, this function returns the same value as
+ * libinput_event_touch_get_y().
+ *
+ * @note It is an application bug to call this function for events of type
+ * other than @ref LIBINPUT_EVENT_TOUCH_DOWN or @ref
+ * LIBINPUT_EVENT_TOUCH_MOTION.
+ *
+ * @param event The libinput touch event
+ * @return The predicted absolute y coordinate in mm
+ *
+ * @since 1.18
+ */
+double
+libinput_event_touch_get_y_predicted(struct libinput_event_touch *event);
+
+/**
+ * @ingroup event_touch
+ *
+ * Return the predicted absolute x coordinate of the touch point,
+ * transformed to screen coordinates. See
+ * libinput_event_touch_get_x_predicted() for details.
+ *
+ * @note It is an application bug to call this function for events of type
+ * other than @ref LIBINPUT_EVENT_TOUCH_DOWN or @ref
+ * LIBINPUT_EVENT_TOUCH_MOTION.
+ *
+ * @param event The libinput touch event
+ * @param width The current output screen width
+ * @return The predicted absolute x coordinate transformed to a screen
+ * coordinate
+ *
+ * @since 1.18
+ */
+double
+libinput_event_touch_get_x_predicted_transformed(struct libinput_event_touch *event,
+						 uint32_t width);
+
+/**
+ * @ingroup event_touch
+ *
+ * Return the predicted absolute y coordinate of the touch point,
+ * transformed to screen coordinates. See
+ * libinput_event_touch_get_y_predicted() for details.
+ *
+ * @note It is an application bug to call this function for events of type
+ * other than @ref LIBINPUT_EVENT_TOUCH_DOWN or @ref
+ * LIBINPUT_EVENT_TOUCH_MOTION.
+ *
+ * @param event The libinput touch event
+ * @param height The current output screen height
+ * @return The predicted absolute y coordinate transformed to a screen
+ * coordinate
+ *
+ * @since 1.18
+ */
+double
+libinput_event_touch_get_y_predicted_transformed(struct libinput_event_touch *event,
+						 uint32_t height);
+
 /**
  * @ingroup event_touch
  *
@@ -2468,6 +2600,94 @@ double
 libinput_event_tablet_tool_get_y_transformed(struct libinput_event_tablet_tool *event,
 					     uint32_t height);
 
+/**
+ * @ingroup event_tablet
+ *
+ * Return the predicted absolute x coordinate of the tool at the
+ * prediction horizon of the device after this event, in mm from the top
+ * left corner of the tablet in its current logical orientation, see
+ * libinput_device_set_motion_prediction(). The prediction starts afresh
+ * whenever the tool comes into proximity.
+ *
+ * If motion prediction is disabled or there is not enough recent motion
+ * to predict from, this function returns the same value as
+ * libinput_event_tablet_tool_get_x().
+ *
+ * @note It is an application bug to call this function for events of type
+ * other than @ref LIBINPUT_EVENT_TABLET_TOOL_AXIS, @ref
+ * LIBINPUT_EVENT_TABLET_TOOL_TIP or @ref
+ * LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY.
+ *
+ * @param event The libinput tablet tool event
+ * @return The predicted absolute x coordinate in mm
+ *
+ * @since 1.18
+ */
+double
+libinput_event_tablet_tool_get_x_predicted(struct libinput_event_tablet_tool *event);
+
+/**
+ * @ingroup event_tablet
+ *
+ * Return the predicted absolute y coordinate of the tool at the
+ * prediction horizon of the device after this event, in mm from the top
+ * left corner of the tablet in its current logical orientation, see
+ * libinput_device_set_motion_prediction(). The prediction starts afresh
+ * whenever the tool comes into proximity.
+ *
+ * If motion prediction is disabled or there is not enough recent motion
+ * to predict from, this function returns the same value as
+ * libinput_event_tablet_tool_get_y().
+ *
+ * @note It is an application bug to call this function for events of type
+ * other than @ref LIBINPUT_EVENT_TABLET_TOOL_AXIS, @ref
+ * LIBINPUT_EVENT_TABLET_TOOL_TIP or @ref
+ * LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY.
+ *
+ * @param event The libinput tablet tool event
+ * @return The predicted absolute y coordinate in mm
+ *
+ * @since 1.18
+ */
+double
+libinput_event_tablet_tool_get_y_predicted(struct libinput_event_tablet_tool *event);
+
+/**
+ * @ingroup event_tablet
+ *
+ * Return the predicted absolute x coordinate of the tool, transformed to
+ * screen coordinates. See libinput_event_tablet_tool_get_x_predicted()
+ * for details.
+ *
+ * @param event The libinput tablet tool event
+ * @param width The current output screen width
+ * @return the predicted absolute x coordinate transformed to a screen
+ * coordinate
+ *
+ * @since 1.18
+ */
+double
+libinput_event_tablet_tool_get_x_predicted_transformed(struct libinput_event_tablet_tool *event,
+						       uint32_t width);
+
+/**
+ * @ingroup event_tablet
+ *
+ * Return the predicted absolute y coordinate of the tool, transformed to
+ * screen coordinates. See libinput_event_tablet_tool_get_y_predicted()
+ * for details.
+ *
+ * @param event The libinput tablet tool event
+ * @param height The current output screen height
+ * @return the predicted absolute y coordinate transformed to a screen
+ * coordinate
+ *
+ * @since 1.18
+ */
+double
+libinput_event_tablet_tool_get_y_predicted_transformed(struct libinput_event_tablet_tool *event,
+						       uint32_t height);
+
 /**
  * @ingroup event_tablet
  *
@@ -2698,6 +2918,56 @@ libinput_tablet_tool_ref(struct libinput_tablet_tool *tool);
 struct libinput_tablet_tool *
 libinput_tablet_tool_unref(struct libinput_tablet_tool *tool);
 
+/**
+ * @ingroup event_tablet
+ *
+ * Statistics of the context's registry of tablet tools with serial
+ * numbers, see libinput_tablet_tool_registry_get_stat().
+ *
+ * @since 1.18
+ */
+enum libinput_tablet_tool_registry_stat {
+	/**
+	 * The number of tools currently in the registry.
+	 */
+	LIBINPUT_TABLET_TOOL_REGISTRY_STAT_TOOLS = 1,
+	/**
+	 * The number of lookups that found an existing tool.
+	 */
+	LIBINPUT_TABLET_TOOL_REGISTRY_STAT_HITS,
+	/**
+	 * The number of lookups that did not find a tool.
+	 */
+	LIBINPUT_TABLET_TOOL_REGISTRY_STAT_MISSES,
+	/**
+	 * The number of tools destroyed to make room for new tools.
+	 */
+	LIBINPUT_TABLET_TOOL_REGISTRY_STAT_EVICTIONS,
+};
+
+/**
+ * @ingroup event_tablet
+ *
+ * Return a statistic of the context's tool registry. libinput keeps each
+ * tool with a unique serial number (see libinput_tablet_tool_get_serial())
+ * in a registry so the same struct @ref libinput_tablet_tool is used
+ * whenever that tool comes into proximity again. The registry is limited
+ * in size, tools that are not referenced by the caller (see
+ * libinput_tablet_tool_ref()) are destroyed when the limit is reached,
+ * least recently used first.
+ *
+ * The values are counted since the context was created.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param stat The statistic to return
+ * @return The value of the statistic
+ *
+ * @since 1.18
+ */
+uint64_t
+libinput_tablet_tool_registry_get_stat(struct libinput *libinput,
+				       enum libinput_tablet_tool_registry_stat stat);
+
 /**
  * @ingroup event_tablet
  *
@@ -3342,6 +3612,41 @@ libinput_udev_create_context(const struct libinput_interface *interface,
 			     void *user_data,
 			     struct udev *udev);
 
+/**
+ * @ingroup base
+ *
+ * Open the devices on up to nthreads threads when a seat is assigned with
+ * libinput_udev_assign_seat() or when the context is resumed with
+ * libinput_resume(). The devices are still added to the seat on the
+ * caller's thread and in the same order as they would be without
+ * threads, and the same events are queued. Each device is added as soon
+ * as it and the devices before it are open, while the remaining devices
+ * are still being opened.
+ *
+ * This only speeds up adding the devices that are present when the seat
+ * is assigned. Devices added later are always opened on the caller's
+ * thread.
+ *
+ * @warning If nthreads is greater than 1, @ref
+ * libinput_interface::open_restricted and @ref
+ * libinput_interface::close_restricted may be called from a thread other
+ * than the caller's and concurrently, and must be thread-safe.
+ *
+ * By default, devices are opened on the caller's thread. A value of 0 or
+ * 1 restores this behavior. libinput may use fewer than nthreads threads.
+ *
+ * @param libinput A libinput context initialized with
+ * libinput_udev_create_context()
+ * @param nthreads The maximum number of threads to open devices on
+ *
+ * @return 0 on success or -1 on failure.
+ *
+ * @since 1.18
+ */
+int
+libinput_udev_set_probe_threads(struct libinput *libinput,
+				unsigned int nthreads);
+
 /**
  * @ingroup base
  *
@@ -3466,6 +3771,85 @@ libinput_get_fd(struct libinput *libinput);
 int
 libinput_dispatch(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Statistics of the context's event processing, see
+ * libinput_get_dispatch_stat().
+ *
+ * @since 1.18
+ */
+enum libinput_dispatch_stat {
+	/**
+	 * The number of calls to libinput_dispatch().
+	 */
+	LIBINPUT_DISPATCH_STAT_DISPATCHES = 1,
+	/**
+	 * The number of file descriptors that were ready when
+	 * libinput_dispatch() was called, i.e. devices with events to read
+	 * and expired timers.
+	 */
+	LIBINPUT_DISPATCH_STAT_WAKEUPS,
+	/**
+	 * The time spent in libinput_dispatch() in microseconds.
+	 */
+	LIBINPUT_DISPATCH_STAT_DISPATCH_TIME,
+	/**
+	 * The number of internal timers that expired, e.g. tapping or
+	 * button debouncing timeouts.
+	 */
+	LIBINPUT_DISPATCH_STAT_TIMER_EXPIRIES,
+	/**
+	 * The number of events added to the event queue.
+	 */
+	LIBINPUT_DISPATCH_STAT_EVENTS_QUEUED,
+	/**
+	 * The number of events merged into a queued event instead of being
+	 * queued, see libinput_set_event_coalescing().
+	 */
+	LIBINPUT_DISPATCH_STAT_EVENTS_COALESCED,
+	/**
+	 * The number of events retrieved with libinput_get_event() or
+	 * libinput_get_events().
+	 */
+	LIBINPUT_DISPATCH_STAT_EVENTS_CONSUMED,
+	/**
+	 * The maximum number of events in the event queue at the same time.
+	 */
+	LIBINPUT_DISPATCH_STAT_QUEUE_HIGH_WATER_MARK,
+	/**
+	 * The number of times the event queue had to grow.
+	 */
+	LIBINPUT_DISPATCH_STAT_QUEUE_REALLOCATIONS,
+	/**
+	 * The number of times the kernel dropped events because they were
+	 * not read fast enough, summed over all devices, including devices
+	 * that were removed since. See
+	 * libinput_device_get_syn_dropped_count() for the per-device count.
+	 */
+	LIBINPUT_DISPATCH_STAT_SYN_DROPPED,
+};
+
+/**
+ * @ingroup base
+ *
+ * Return a statistic of the context's event processing since the context
+ * was created. The statistics are cheap to maintain and intended for
+ * monitoring the health of the input stack, e.g. a growing queue
+ * high-water mark or SYN_DROPPED count indicate that the caller does not
+ * call libinput_dispatch() and libinput_get_event() often enough.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param stat The statistic to return
+ * @return The current value of the given statistic, or 0 if the
+ * statistic is invalid
+ *
+ * @since 1.18
+ */
+uint64_t
+libinput_get_dispatch_stat(struct libinput *libinput,
+			   enum libinput_dispatch_stat stat);
+
 /**
  * @ingroup base
  *
@@ -3480,6 +3864,48 @@ libinput_dispatch(struct libinput *libinput);
 struct libinput_event *
 libinput_get_event(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Retrieve up to max_events events from libinput's internal event queue
+ * in one call. The events are written to the caller-allocated array in the
+ * order they would have been returned by repeated calls to
+ * libinput_get_event().
+ *
+ * After handling the retrieved events, the caller must destroy each event
+ * using libinput_event_destroy() or all of them at once with
+ * libinput_events_destroy().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param events An array with space for at least max_events events
+ * @param max_events The maximum number of events to retrieve
+ * @return The number of events written to events, or 0 if no event is
+ * available.
+ *
+ * @see libinput_get_event
+ * @since 1.18
+ */
+size_t
+libinput_get_events(struct libinput *libinput,
+		    struct libinput_event **events,
+		    size_t max_events);
+
+/**
+ * @ingroup event
+ *
+ * Destroy an array of events, e.g. as returned by libinput_get_events().
+ * This is equivalent to calling libinput_event_destroy() on each event in
+ * order. The array itself is owned by the caller and not freed.
+ *
+ * @param events An array of events
+ * @param nevents The number of events in the array
+ *
+ * @since 1.18
+ */
+void
+libinput_events_destroy(struct libinput_event **events,
+			size_t nevents);
+
 /**
  * @ingroup base
  *
@@ -3494,6 +3920,114 @@ libinput_get_event(struct libinput *libinput);
 enum libinput_event_type
 libinput_next_event_type(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Statistics of the context's event pool, see
+ * libinput_event_pool_get_stat().
+ *
+ * @since 1.18
+ */
+enum libinput_event_pool_stat {
+	/**
+	 * The number of events that re-used the memory of a previously
+	 * destroyed event.
+	 */
+	LIBINPUT_EVENT_POOL_STAT_HITS = 1,
+	/**
+	 * The number of events that required a new memory allocation.
+	 */
+	LIBINPUT_EVENT_POOL_STAT_MISSES,
+	/**
+	 * The maximum number of events that were allocated at the same
+	 * time, i.e. queued in libinput or not yet destroyed by the caller
+	 * with libinput_event_destroy().
+	 */
+	LIBINPUT_EVENT_POOL_STAT_HIGH_WATER_MARK,
+};
+
+/**
+ * @ingroup base
+ *
+ * libinput recycles the memory of events destroyed with
+ * libinput_event_destroy() for subsequent events. This function returns
+ * the statistics of this event pool since the context was created. These
+ * statistics are for debugging and tuning purposes only, they do not
+ * affect the behavior of the context.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param stat The statistic to return
+ * @return The current value of the given statistic, or 0 if the
+ * statistic is invalid
+ *
+ * @since 1.18
+ */
+uint64_t
+libinput_event_pool_get_stat(struct libinput *libinput,
+			     enum libinput_event_pool_stat stat);
+
+/**
+ * @ingroup base
+ *
+ * Merge relative pointer events while the caller falls behind. Once
+ * threshold or more events are queued, a @ref
+ * LIBINPUT_EVENT_POINTER_MOTION event is merged into the last queued
+ * event if that is a @ref LIBINPUT_EVENT_POINTER_MOTION event from the
+ * same device. The accelerated and unaccelerated deltas are summed and
+ * the merged event has the timestamp of the most recent event.
+ *
+ * @ref LIBINPUT_EVENT_POINTER_AXIS events are merged the same way if
+ * they have the same axis source and axes. The values and discrete
+ * values are summed. Events that terminate a scroll sequence, see
+ * libinput_event_pointer_get_axis_value(), are never merged.
+ *
+ * Any other event, e.g. a button or key event, ends the merge: events
+ * are never reordered and the events after it start a new event.
+ *
+ * Coalescing is disabled by default. A threshold of 0 disables it.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param threshold The number of queued events at which coalescing
+ * starts, or 0 to disable coalescing
+ *
+ * @return 0 on success or -1 on failure.
+ *
+ * @since 1.18
+ */
+int
+libinput_set_event_coalescing(struct libinput *libinput,
+			      unsigned int threshold);
+
+/**
+ * @ingroup base
+ *
+ * Read the devices' events on an internal thread. The kernel only
+ * buffers a limited number of events per device, if the caller does
+ * not call libinput_dispatch() in time the kernel discards events. With
+ * the input thread enabled, libinput reads the events as they arrive
+ * and keeps them until the next call to libinput_dispatch(), so a
+ * caller that is busy for a while does not lose events.
+ *
+ * Only reading the devices moves to the input thread. The events are
+ * still processed and the timers still run in libinput_dispatch(), so
+ * the caller's thread remains the only thread that may call into
+ * libinput and no other locking is required. The fd returned by
+ * libinput_get_fd() becomes readable when the input thread has read
+ * events.
+ *
+ * The input thread must be enabled before any device is added, i.e.
+ * before libinput_udev_assign_seat() or libinput_path_add_device(). It
+ * cannot be disabled and is stopped when the context is destroyed.
+ *
+ * @param libinput A previously initialized libinput context
+ *
+ * @return 0 on success or -1 on failure.
+ *
+ * @since 1.18
+ */
+int
+libinput_enable_input_thread(struct libinput *libinput);
+
 /**
  * @ingroup base
  *
@@ -4054,6 +4588,106 @@ libinput_device_set_seat_logical_name(struct libinput_device *device,
 struct udev_device *
 libinput_device_get_udev_device(struct libinput_device *device);
 
+/**
+ * @ingroup device
+ *
+ * The stages of event processing that libinput measures the latency of,
+ * see libinput_device_get_latency_histogram(). Each latency is measured
+ * from the kernel timestamp of the event.
+ *
+ * @since 1.18
+ */
+enum libinput_latency_stage {
+	/**
+	 * The kernel event frame was read from the device. This stage is
+	 * measured once per frame and not by libinput event type.
+	 */
+	LIBINPUT_LATENCY_STAGE_READ = 1,
+	/**
+	 * The libinput event was added to the event queue. All events
+	 * queued by one libinput_dispatch() call share the timestamp taken
+	 * when it queues the first one.
+	 */
+	LIBINPUT_LATENCY_STAGE_QUEUED,
+	/**
+	 * The libinput event was retrieved by the caller with
+	 * libinput_get_event() or libinput_get_events(). This stage is
+	 * measured at the first retrieval after a libinput_dispatch() call,
+	 * all events retrieved before the next libinput_dispatch() call
+	 * share that timestamp.
+	 */
+	LIBINPUT_LATENCY_STAGE_DELIVERED,
+};
+
+/**
+ * @ingroup device
+ *
+ * Get the latency histogram of the given stage for this device. libinput
+ * keeps a histogram for each stage and each event type for each device
+ * from the time the device is added.
+ *
+ * The histogram has a fixed number of buckets with exponentially
+ * growing sizes: bucket 0 counts latencies below 2us, bucket n counts
+ * latencies of at least 2^n us and less than 2^(n+1) us. The last bucket
+ * counts all latencies above its lower bound.
+ *
+ * If type is @ref LIBINPUT_EVENT_NONE, the sum across all event types is
+ * returned. The @ref LIBINPUT_LATENCY_STAGE_READ stage is not measured
+ * per event type and is only available with @ref LIBINPUT_EVENT_NONE.
+ * Device notification events do not have a kernel timestamp and are
+ * never counted.
+ *
+ * @param device A previously obtained device
+ * @param stage The stage to get the latency histogram for
+ * @param type The event type to get the latency histogram for
+ * @param counts Filled in with the count for each bucket, up to ncounts
+ * buckets. May be NULL if ncounts is 0.
+ * @param ncounts The number of elements in counts
+ *
+ * @return The number of buckets in the histogram, regardless of ncounts
+ *
+ * @see libinput_device_reset_latency_histograms
+ *
+ * @since 1.18
+ */
+size_t
+libinput_device_get_latency_histogram(struct libinput_device *device,
+				      enum libinput_latency_stage stage,
+				      enum libinput_event_type type,
+				      uint64_t *counts,
+				      size_t ncounts);
+
+/**
+ * @ingroup device
+ *
+ * Reset all latency histograms of this device to zero.
+ *
+ * @param device A previously obtained device
+ *
+ * @see libinput_device_get_latency_histogram
+ *
+ * @since 1.18
+ */
+void
+libinput_device_reset_latency_histograms(struct libinput_device *device);
+
+/**
+ * @ingroup device
+ *
+ * Return the number of times the kernel's event buffer for this device
+ * overflowed and events were dropped (SYN_DROPPED) because they were not
+ * read in time.
+ *
+ * @param device A previously obtained device
+ * @return The number of SYN_DROPPED events since the device was added
+ *
+ * @see LIBINPUT_DISPATCH_STAT_SYN_DROPPED
+ *
+ * @since 1.18
+ */
+uint64_t
+libinput_device_get_syn_dropped_count(struct libinput_device *device);
+
 /**
  * @ingroup device
  *
@@ -5927,6 +6561,87 @@ libinput_device_config_rotation_get_angle(struct libinput_device *device);
 unsigned int
 libinput_device_config_rotation_get_default_angle(struct libinput_device *device);
 
+/**
+ * @ingroup config
+ *
+ * Enable motion prediction on this device. Pointer motion, touch and
+ * tablet tool events then include where the pointer, touch point or tool
+ * is expected to be horizon_ms after the event, e.g. to hide a frame of
+ * display latency when drawing the cursor. See
+ * libinput_event_pointer_get_dx_predicted(),
+ * libinput_event_touch_get_x_predicted() and
+ * libinput_event_tablet_tool_get_x_predicted().
+ *
+ * The prediction extrapolates the velocity and acceleration of the last
+ * few events. It starts afresh when a touch begins, a tool comes into
+ * proximity or the motion paused, and predicts a stop rather than a
+ * change of direction. Each touch slot is predicted separately, tablet
+ * tools are predicted per device, not per struct libinput_tablet_tool:
+ * a tool that comes back into proximity does not continue where it
+ * left off. Prediction only applies to events processed after
+ * this call, events already in the queue are unaffected.
+ *
+ * Motion prediction is disabled by default. Changing the horizon resets
+ * the error statistics, see libinput_device_get_motion_prediction_error().
+ *
+ * @param device A previously obtained device
+ * @param horizon_ms How far ahead to predict in ms, at most 100, or 0
+ * to disable motion prediction
+ *
+ * @return A config status code, @ref LIBINPUT_CONFIG_STATUS_INVALID if
+ * the horizon is out of range
+ *
+ * @see libinput_device_get_motion_prediction
+ *
+ * @since 1.18
+ */
+enum libinput_config_status
+libinput_device_set_motion_prediction(struct libinput_device *device,
+				      unsigned int horizon_ms);
+
+/**
+ * @ingroup config
+ *
+ * @param device A previously obtained device
+ * @return The motion prediction horizon in ms, or 0 if motion prediction
+ * is disabled
+ *
+ * @see libinput_device_set_motion_prediction
+ *
+ * @since 1.18
+ */
+unsigned int
+libinput_device_get_motion_prediction(struct libinput_device *device);
+
+/**
+ * @ingroup config
+ *
+ * Get the accuracy of the motion prediction on this device so far. Once
+ * the horizon of a predicted position has passed, libinput compares it
+ * against the position the device reported at that time, or against
+ * the last position if the touch ended or the tool left proximity
+ * before then. The error is the distance between the two, in mm for
+ * touch and tablet tool events and in the units of
+ * libinput_event_pointer_get_dx() for pointer events. If the device does
+ * not have a physical size, i.e. libinput_device_get_size() fails, the
+ * error for touch events is in device coordinates instead.
+ *
+ * @param device A previously obtained device
+ * @param mean_error Set to the mean error, may be NULL
+ * @param max_error Set to the largest error, may be NULL
+ *
+ * @return The number of predictions compared, both errors are 0 if this
+ * is 0
+ *
+ * @see libinput_device_set_motion_prediction
+ *
+ * @since 1.18
+ */
+uint64_t
+libinput_device_get_motion_prediction_error(struct libinput_device *device,
+					    double *mean_error,
+					    double *max_error);
+
 #ifdef __cplusplus
 }
 #endif
@@ -28,6 +28,7 @@
 #include <libudev.h>
 
 #include "evdev.h"
+#include "path-seat.h"
 
 struct path_input {
 	struct libinput base;
@@ -281,6 +282,9 @@ path_device_change_seat(struct libinput_device *device,
 	struct udev_device *udev_device = NULL;
 	int rc = -1;
 
+	if (evdev_device_is_virtual(evdev))
+		return -1;
+
 	udev_device = evdev->udev_device;
 	udev_device_ref(udev_device);
 	libinput_path_remove_device(device);
@@ -426,3 +430,52 @@ libinput_path_remove_device(struct libinput_device *device)
 	path_disable_device(evdev);
 	libinput_seat_unref(seat);
 }
+
+struct libinput_device *
+path_add_virtual_device(struct libinput *libinput,
+			struct libevdev *evdev,
+			const char *sysname,
+			char **properties)
+{
+	struct path_input *input = (struct path_input*)libinput;
+	struct path_seat *seat;
+	struct evdev_device *device;
+	const char *output_name;
+
+	if (libinput->interface_backend != &interface_backend) {
+		log_bug_client(libinput, "Mismatching backends.\n");
+		libevdev_free(evdev);
+		return NULL;
+	}
+
+	libinput_init_quirks(libinput);
+
+	seat = path_seat_get_named(input, default_seat, default_seat_name);
+	if (!seat)
+		seat = path_seat_create(input, default_seat, default_seat_name);
+	libinput_seat_ref(&seat->base);
+
+	device = evdev_device_create_virtual(&seat->base,
+					     evdev,
+					     sysname,
+					     properties);
+	libinput_seat_unref(&seat->base);
+
+	if (device == EVDEV_UNHANDLED_DEVICE) {
+		log_info(libinput,
+			 "%-7s - not using virtual input device.\n",
+			 sysname);
+		return NULL;
+	} else if (device == NULL) {
+		log_info(libinput,
+			 "%-7s - failed to create virtual input device.\n",
+			 sysname);
+		return NULL;
+	}
+
+	evdev_read_calibration_prop(device);
+	output_name = evdev_device_get_property(device, "WL_OUTPUT");
+	device->output_name = safe_strdup(output_name);
+
+	return &device->base;
+}
@@ -0,0 +1,46 @@
+/*
+ * Copyright © 2021 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef _PATH_SEAT_H_
+#define _PATH_SEAT_H_
+
+#include "config.h"
+
+#include <libevdev/libevdev.h>
+#include "libinput-private.h"
+
+/**
+ * Add a device without a kernel device node to a path context, see
+ * evdev_device_create_virtual(). The device takes ownership of the
+ * libevdev device, even on failure.
+ *
+ * This is not part of the public API, it is used by tools that link
+ * against libinput's internals to replay or benchmark event streams.
+ */
+struct libinput_device *
+path_add_virtual_device(struct libinput *libinput,
+			struct libevdev *evdev,
+			const char *sysname,
+			char **properties);
+
+#endif
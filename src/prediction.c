@@ -0,0 +1,298 @@
+/*
+ * Copyright © 2021 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <math.h>
+#include <string.h>
+
+#include "prediction.h"
+
+/* Only samples this recent are fitted, anything older belongs to a
+ * different part of the stroke. A gap this long resets the history. */
+#define PREDICTION_WINDOW ms2us(50)
+
+/* Below this many samples the acceleration is mostly noise */
+#define PREDICTION_MIN_QUADRATIC_SAMPLES 4
+
+/**
+ * Return a previous sample, where index of 0 means "most recent", 1 is
+ * "one before most recent", etc.
+ */
+static inline struct motion_sample *
+motion_predictor_get(struct motion_predictor *predictor, unsigned int index)
+{
+	assert(index < predictor->count);
+
+	index = (predictor->index + PREDICTION_HISTORY_LENGTH - index) %
+		PREDICTION_HISTORY_LENGTH;
+	return &predictor->samples[index];
+}
+
+void
+motion_predictor_init(struct motion_predictor *predictor,
+		      double scale_x,
+		      double scale_y)
+{
+	memset(predictor, 0, sizeof(*predictor));
+	predictor->scale.x = scale_x;
+	predictor->scale.y = scale_y;
+}
+
+/**
+ * Compare a pending prediction with the most recent position. Nothing
+ * moves between two samples, so that's where the point was at the
+ * predicted time.
+ */
+static void
+motion_predictor_score(struct motion_predictor *predictor,
+		       struct prediction_error *error,
+		       const struct motion_pending_prediction *p)
+{
+	double dx, dy, e;
+
+	dx = (p->point.x - predictor->last.x)/predictor->scale.x;
+	dy = (p->point.y - predictor->last.y)/predictor->scale.y;
+	e = hypot(dx, dy);
+
+	error->count++;
+	error->sum += e;
+	error->max = max(error->max, e);
+}
+
+/**
+ * Score and drop the pending predictions for a time before time.
+ */
+static void
+motion_predictor_evaluate(struct motion_predictor *predictor,
+			  struct prediction_error *error,
+			  uint64_t time)
+{
+	while (predictor->npending > 0) {
+		struct motion_pending_prediction *p;
+
+		p = &predictor->pending[predictor->pending_first];
+		if (p->time >= time)
+			break;
+
+		motion_predictor_score(predictor, error, p);
+		predictor->pending_first = (predictor->pending_first + 1) %
+					   PREDICTION_MAX_PENDING;
+		predictor->npending--;
+	}
+}
+
+static void
+motion_predictor_queue(struct motion_predictor *predictor,
+		       uint64_t time,
+		       const struct device_float_coords *point)
+{
+	struct motion_pending_prediction *p;
+	unsigned int index;
+
+	/* A second sample with the same timestamp replaces the first, so
+	 * does its prediction */
+	if (predictor->npending > 0) {
+		index = (predictor->pending_first + predictor->npending - 1) %
+			PREDICTION_MAX_PENDING;
+		p = &predictor->pending[index];
+		if (p->time == time) {
+			p->point = *point;
+			return;
+		}
+	}
+
+	/* Only devices faster than 1000Hz get here, the oldest prediction
+	 * is dropped without a score */
+	if (predictor->npending == PREDICTION_MAX_PENDING) {
+		predictor->pending_first = (predictor->pending_first + 1) %
+					   PREDICTION_MAX_PENDING;
+		predictor->npending--;
+	}
+
+	index = (predictor->pending_first + predictor->npending) %
+		PREDICTION_MAX_PENDING;
+	predictor->pending[index] = (struct motion_pending_prediction) {
+		.time = time,
+		.point = *point,
+	};
+	predictor->npending++;
+}
+
+void
+motion_predictor_reset(struct motion_predictor *predictor,
+		       struct prediction_error *error)
+{
+	motion_predictor_evaluate(predictor, error, UINT64_MAX);
+	predictor->count = 0;
+}
+
+static inline double
+det3(double a11, double a12, double a13,
+     double a21, double a22, double a23,
+     double a31, double a32, double a33)
+{
+	return a11 * (a22 * a33 - a23 * a32) -
+	       a12 * (a21 * a33 - a23 * a31) +
+	       a13 * (a21 * a32 - a22 * a31);
+}
+
+/**
+ * Least-squares fit of p(t) = p0 + v·t + ½a·t² to the samples in the
+ * window, with t in ms relative to the most recent sample. With too few
+ * samples for a meaningful acceleration, the fit is linear.
+ *
+ * @return false if there are not enough samples to fit
+ */
+static bool
+motion_predictor_fit(struct motion_predictor *predictor,
+		     struct device_float_coords *velocity,
+		     struct device_float_coords *acceleration)
+{
+	const struct motion_sample *newest = motion_predictor_get(predictor, 0);
+	double s0 = 0, s1 = 0, s2 = 0, s3 = 0, s4 = 0;
+	struct device_float_coords su = {0}, stu = {0}, sttu = {0};
+	double det;
+
+	for (unsigned int i = 0; i < predictor->count; i++) {
+		const struct motion_sample *s = motion_predictor_get(predictor, i);
+		double t, t2;
+		struct device_float_coords u;
+
+		if (s->time + PREDICTION_WINDOW < newest->time)
+			break;
+
+		t = -1.0 * (newest->time - s->time)/1000.0;
+		t2 = t * t;
+		u.x = s->point.x - newest->point.x;
+		u.y = s->point.y - newest->point.y;
+
+		s0 += 1;
+		s1 += t;
+		s2 += t2;
+		s3 += t2 * t;
+		s4 += t2 * t2;
+		su.x += u.x;
+		su.y += u.y;
+		stu.x += t * u.x;
+		stu.y += t * u.y;
+		sttu.x += t2 * u.x;
+		sttu.y += t2 * u.y;
+	}
+
+	if (s0 >= PREDICTION_MIN_QUADRATIC_SAMPLES) {
+		det = det3(s0, s1, s2,
+			   s1, s2, s3,
+			   s2, s3, s4);
+		if (fabs(det) > 1e-6) {
+			velocity->x = det3(s0, su.x, s2,
+					   s1, stu.x, s3,
+					   s2, sttu.x, s4)/det;
+			velocity->y = det3(s0, su.y, s2,
+					   s1, stu.y, s3,
+					   s2, sttu.y, s4)/det;
+			acceleration->x = 2 * det3(s0, s1, su.x,
+						   s1, s2, stu.x,
+						   s2, s3, sttu.x)/det;
+			acceleration->y = 2 * det3(s0, s1, su.y,
+						   s1, s2, stu.y,
+						   s2, s3, sttu.y)/det;
+			return true;
+		}
+	}
+
+	/* all samples have the same timestamp or there's just one */
+	det = s0 * s2 - s1 * s1;
+	if (s0 < 2 || fabs(det) < 1e-6)
+		return false;
+
+	velocity->x = (s0 * stu.x - s1 * su.x)/det;
+	velocity->y = (s0 * stu.y - s1 * su.y)/det;
+	acceleration->x = 0.0;
+	acceleration->y = 0.0;
+
+	return true;
+}
+
+/**
+ * Distance travelled within h ms. If the motion decelerates to a stop
+ * within the horizon, predict the stop rather than a reversal.
+ */
+static inline double
+extrapolate(double velocity, double acceleration, double h)
+{
+	if (acceleration != 0.0 &&
+	    velocity * (velocity + acceleration * h) < 0)
+		h = -velocity/acceleration;
+
+	return velocity * h + 0.5 * acceleration * h * h;
+}
+
+bool
+motion_predictor_push(struct motion_predictor *predictor,
+		      struct prediction_error *error,
+		      uint64_t horizon,
+		      uint64_t time,
+		      const struct device_float_coords *point,
+		      struct device_float_coords *predicted)
+{
+	struct motion_sample *sample;
+	struct device_float_coords velocity, acceleration;
+	double h = horizon/1000.0;
+
+	motion_predictor_evaluate(predictor, error, time);
+
+	/* Only the history, predictions from before the pause are scored
+	 * once their horizon has passed */
+	if (predictor->count > 0 &&
+	    motion_predictor_get(predictor, 0)->time + PREDICTION_WINDOW < time)
+		predictor->count = 0;
+
+	/* e.g. proximity in and the first axis event, the later one is
+	 * the more accurate one */
+	if (predictor->count == 0 ||
+	    motion_predictor_get(predictor, 0)->time != time) {
+		predictor->index = (predictor->index + 1) %
+				   PREDICTION_HISTORY_LENGTH;
+		predictor->count = min(predictor->count + 1,
+				       ARRAY_LENGTH(predictor->samples));
+	}
+	sample = &predictor->samples[predictor->index];
+	*sample = (struct motion_sample) {
+		.time = time,
+		.point = *point,
+	};
+	predictor->last = *point;
+
+	*predicted = *point;
+
+	if (!motion_predictor_fit(predictor, &velocity, &acceleration))
+		return false;
+
+	predicted->x += extrapolate(velocity.x, acceleration.x, h);
+	predicted->y += extrapolate(velocity.y, acceleration.y, h);
+	motion_predictor_queue(predictor, time + horizon, predicted);
+
+	return true;
+}
@@ -0,0 +1,130 @@
+/*
+ * Copyright © 2021 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PREDICTION_H
+#define PREDICTION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "libinput-private.h"
+
+/* Enough for 16ms of a 1000Hz mouse, the fit only looks at the last
+ * PREDICTION_WINDOW anyway */
+#define PREDICTION_HISTORY_LENGTH 16
+#define PREDICTION_MAX_TOUCHES 16
+#define PREDICTION_MAX_HORIZON_MS 100
+
+struct motion_sample {
+	uint64_t time;
+	struct device_float_coords point;
+};
+
+/* A prediction waiting for its horizon to pass */
+struct motion_pending_prediction {
+	uint64_t time; /* the time the prediction is for */
+	struct device_float_coords point;
+};
+
+/* One prediction per ms at most, see motion_predictor_push() */
+#define PREDICTION_MAX_PENDING (PREDICTION_MAX_HORIZON_MS + 1)
+
+/**
+ * The predictor for a single pointer, touch or the tool currently in
+ * proximity. It fits a velocity and acceleration to its recent history
+ * and extrapolates from there.
+ */
+struct motion_predictor {
+	struct motion_sample samples[PREDICTION_HISTORY_LENGTH];
+	unsigned int index; /* of the most recent sample */
+	unsigned int count;
+
+	/* Predictions not yet scored, oldest first. These outlive the
+	 * samples: the horizon may be longer than the history and longer
+	 * than the gap that resets it. */
+	struct motion_pending_prediction pending[PREDICTION_MAX_PENDING];
+	unsigned int pending_first;
+	unsigned int npending;
+	/* The most recent position, kept across a reset */
+	struct device_float_coords last;
+
+	/* Units per mm, or 1 for pointer motion. Only used to report the
+	 * error in mm. */
+	struct device_float_coords scale;
+};
+
+struct prediction_error {
+	uint64_t count;
+	double sum;
+	double max;
+};
+
+/* The per-device state, allocated once the caller enables prediction */
+struct motion_prediction {
+	uint64_t horizon; /* in us */
+	struct prediction_error error;
+
+	struct motion_predictor pointer;
+	/* Sum of the accelerated deltas, the pointer predictor needs a
+	 * position */
+	struct device_float_coords pointer_position;
+	/* Shared by all tools, the tablet only has one tool in proximity at
+	 * a time and each proximity in starts afresh */
+	struct motion_predictor tablet;
+	struct motion_predictor touches[PREDICTION_MAX_TOUCHES];
+};
+
+void
+motion_predictor_init(struct motion_predictor *predictor,
+		      double scale_x,
+		      double scale_y);
+
+/**
+ * End the current stroke, e.g. because the touch or tool went up or out
+ * of proximity, or went down or into proximity again without us seeing
+ * it leave. The predictions still pending are compared against the last
+ * position, that's where the stroke ended, and added to error. The
+ * history is dropped, the next position is unrelated.
+ */
+void
+motion_predictor_reset(struct motion_predictor *predictor,
+		       struct prediction_error *error);
+
+/**
+ * Add a new position to the predictor. Pending predictions whose
+ * horizon has passed are compared against the position at that time
+ * and added to error.
+ *
+ * @param predicted Set to the predicted position horizon us after time,
+ * or to point if there is not enough history to predict
+ * @return true if a prediction was made
+ */
+bool
+motion_predictor_push(struct motion_predictor *predictor,
+		      struct prediction_error *error,
+		      uint64_t horizon,
+		      uint64_t time,
+		      const struct device_float_coords *point,
+		      struct device_float_coords *predicted);
+
+#endif
@@ -33,12 +33,16 @@
 #include <stdlib.h>
 #include <libudev.h>
 #include <dirent.h>
+#include <fcntl.h>
 #include <fnmatch.h>
 #include <libgen.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #ifdef __FreeBSD__
 #include <kenv.h>
 #endif
 
+#include "libinput-version.h"
 #include "libinput-versionsort.h"
 #include "libinput-util.h"
 
@@ -75,23 +79,27 @@ struct quirk_array {
  * identifies which value in the union is defined and we expect callers to
  * already know which type yields which value.
  */
+union property_value {
+	bool b;
+	uint32_t u;
+	int32_t i;
+	char *s;
+	double d;
+	struct quirk_dimensions dim;
+	struct quirk_range range;
+	struct quirk_tuples tuples;
+	struct quirk_array array;
+};
+
 struct property {
 	size_t refcount;
 	struct list link; /* struct sections.properties */
 
 	enum quirk id;
 	enum property_type type;
-	union {
-		bool b;
-		uint32_t u;
-		int32_t i;
-		char *s;
-		double d;
-		struct quirk_dimensions dim;
-		struct quirk_range range;
-		struct quirk_tuples tuples;
-		struct quirk_array array;
-	} value;
+	union property_value value;
+
+	bool mapped; /* value.s points into the mmap'd cache */
 };
 
 enum match_flags {
@@ -162,6 +170,16 @@ struct section {
 	char *name;		/* the [Section Name] */
 	struct match match;
 	struct list properties;
+
+	bool mapped;		/* strings point into the mmap'd cache */
+
+	uint32_t index;		/* position in ctx->sections */
+	uint32_t context_matches; /* M_DMI and M_DT, if they match */
+};
+
+struct section_vid {
+	uint32_t vendor;
+	uint32_t index;
 };
 
 /**
@@ -190,8 +208,35 @@ struct quirks_context {
 	char *dmi;
 	char *dt;
 
+	char *data_path;
+	char *override_file;
+
 	struct list sections;
 
+	/* read-only mapping of the compiled cache, if the sections were
+	 * loaded from one. Section and property strings point into it. */
+	struct {
+		void *map;
+		size_t size;
+	} cache;
+
+	/* The sections that can match on this machine, bucketed by their
+	 * exact-match keys. Sections with a MatchVendor are only in vid,
+	 * sections with a MatchUdevType (but no MatchVendor) are in
+	 * udev_type for each type bit, all others are in other. The
+	 * uint32_t values are the section's index. */
+	struct {
+		struct section **sections;
+		size_t nsections;
+
+		struct section_vid *vid; /* sorted by vendor, index */
+		size_t nvid;
+		uint32_t *udev_type[8];
+		size_t nudev_type[8];
+		uint32_t *other;
+		size_t nother;
+	} index;
+
 	/* list of quirks handed to libinput, just for bookkeeping */
 	struct list quirks;
 };
@@ -286,6 +331,7 @@ quirk_get_name(enum quirk q)
 	case QUIRK_ATTR_EVENT_CODE_ENABLE:		return "AttrEventCodeEnable";
 	case QUIRK_ATTR_INPUT_PROP_DISABLE:		return "AttrInputPropDisable";
 	case QUIRK_ATTR_INPUT_PROP_ENABLE:		return "AttrInputPropEnable";
+	case QUIRK_ATTR_TABLET_SMOOTHING:		return "AttrTabletSmoothing";
 	default:
 		abort();
 	}
@@ -350,7 +396,7 @@ property_cleanup(struct property *p)
 	assert(p->refcount == 0);
 
 	list_remove(&p->link);
-	if (p->type == PT_STRING)
+	if (p->type == PT_STRING && !p->mapped)
 		free(p->value.s);
 	free(p);
 }
@@ -506,10 +552,12 @@ section_destroy(struct section *s)
 {
 	struct property *p;
 
-	free(s->name);
-	free(s->match.name);
-	free(s->match.dmi);
-	free(s->match.dt);
+	if (!s->mapped) {
+		free(s->name);
+		free(s->match.name);
+		free(s->match.dmi);
+		free(s->match.dt);
+	}
 
 	list_for_each_safe(p, &s->properties, link)
 		property_cleanup(p);
@@ -855,6 +903,15 @@ parse_attr(struct quirks_context *ctx,
 		p->value.array.nelements = nprops;
 		p->type = PT_UINT_ARRAY;
 
+		rc = true;
+	} else if (streq(key, quirk_get_name(QUIRK_ATTR_TABLET_SMOOTHING))) {
+		p->id = QUIRK_ATTR_TABLET_SMOOTHING;
+		if (!streq(value, "none") &&
+		    !streq(value, "average") &&
+		    !streq(value, "adaptive"))
+			goto out;
+		p->type = PT_STRING;
+		p->value.s = safe_strdup(value);
 		rc = true;
 	} else {
 		qlog_error(ctx, "Unknown key %s in %s\n", key, s->name);
@@ -1120,12 +1177,650 @@ parse_files(struct quirks_context *ctx, const char *data_path)
 	return idx == ndev;
 }
 
+/* The compiled quirks cache is a flat, native-endian dump of the parsed
+ * sections. We mmap it read-only and point the section and property
+ * strings directly into the mapping, so loading it costs a few stat()
+ * calls and one allocation per section and property.
+ *
+ * A cache is only valid for the files it was compiled from: each data
+ * file (and the override file, if any) is recorded with its size and
+ * mtime and the cache is ignored if any of those differ, if the set of
+ * files differs, or if it was written by a different libinput version.
+ *
+ * Layout:
+ *   struct quirks_cache_header
+ *   struct quirks_cache_file[nfiles]
+ *   struct quirks_cache_section[nsections]
+ *   struct quirks_cache_property[nproperties]
+ *   char strings[strings_size]
+ *
+ * Strings are offsets into the string table, offset 0 is NULL.
+ */
+#define QUIRKS_CACHE_MAGIC 0x4b525551 /* "QURK" */
+#define QUIRKS_CACHE_VERSION 1
+
+struct quirks_cache_header {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t libinput_version;
+	uint32_t nfiles;
+	uint32_t nsections;
+	uint32_t nproperties;
+	uint32_t strings_size;
+	uint32_t padding;
+};
+
+struct quirks_cache_file {
+	uint32_t path;
+	uint32_t padding;
+	uint64_t size;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+};
+
+struct quirks_cache_section {
+	uint32_t name;
+	uint32_t first_property;
+	uint32_t nproperties;
+	uint32_t bits;
+	uint32_t match_name;
+	uint32_t bus;
+	uint32_t vendor;
+	uint32_t product;
+	uint32_t version;
+	uint32_t udev_type;
+	uint32_t dmi;
+	uint32_t dt;
+};
+
+struct quirks_cache_property {
+	uint32_t id;
+	uint32_t type;
+	uint32_t string;
+	uint32_t padding;
+	union property_value value; /* value.s is unused */
+};
+
+struct file_stamp {
+	char *path;
+	uint64_t size;
+	int64_t mtime_sec;
+	int64_t mtime_nsec;
+};
+
+static void
+file_stamps_free(struct file_stamp *stamps, size_t nstamps)
+{
+	if (!stamps)
+		return;
+
+	for (size_t i = 0; i < nstamps; i++)
+		free(stamps[i].path);
+	free(stamps);
+}
+
+static bool
+file_stamp_init(struct file_stamp *stamp, const char *path)
+{
+	struct stat st;
+
+	if (stat(path, &st) < 0)
+		return false;
+
+	stamp->path = safe_strdup(path);
+	stamp->size = st.st_size;
+	stamp->mtime_sec = st.st_mtim.tv_sec;
+	stamp->mtime_nsec = st.st_mtim.tv_nsec;
+
+	return true;
+}
+
+/**
+ * Return the stamps for the same set of files, in the same order, that
+ * parse_files() and the override file would parse.
+ */
+static struct file_stamp *
+file_stamps_collect(const char *data_path,
+		    const char *override_file,
+		    size_t *nstamps_out)
+{
+	struct dirent **namelist;
+	struct file_stamp *stamps;
+	size_t nstamps = 0;
+	bool success = true;
+	int ndev;
+
+	ndev = scandir(data_path, &namelist, is_data_file, versionsort);
+	if (ndev <= 0)
+		return NULL;
+
+	stamps = zalloc((ndev + 1) * sizeof(*stamps));
+	for (int idx = 0; idx < ndev; idx++) {
+		char path[PATH_MAX];
+
+		snprintf(path,
+			 sizeof(path),
+			 "%s/%s",
+			 data_path,
+			 namelist[idx]->d_name);
+
+		if (success && file_stamp_init(&stamps[nstamps], path))
+			nstamps++;
+		else
+			success = false;
+	}
+
+	/* A missing override file is not an error, see parse_file() */
+	if (override_file && file_stamp_init(&stamps[nstamps], override_file))
+		nstamps++;
+
+	for (int i = 0; i < ndev; i++)
+		free(namelist[i]);
+	free(namelist);
+
+	if (!success) {
+		file_stamps_free(stamps, nstamps);
+		return NULL;
+	}
+
+	*nstamps_out = nstamps;
+	return stamps;
+}
+
+struct string_table {
+	char *data;
+	size_t size;
+	size_t allocated;
+};
+
+static uint32_t
+string_table_add(struct string_table *t, const char *str)
+{
+	size_t len;
+	uint32_t offset;
+
+	if (!str)
+		return 0;
+
+	len = strlen(str) + 1;
+	if (t->size + len > t->allocated) {
+		t->allocated = max(t->allocated * 2, t->size + len);
+		t->data = realloc(t->data, t->allocated);
+		if (!t->data)
+			abort();
+	}
+
+	offset = t->size;
+	memcpy(&t->data[offset], str, len);
+	t->size += len;
+
+	return offset;
+}
+
+static inline char *
+cache_string(const char *strings, uint32_t offset)
+{
+	return offset ? (char *)&strings[offset] : NULL;
+}
+
+bool
+quirks_context_write_cache(struct quirks_context *ctx, const char *cache_file)
+{
+	struct quirks_cache_header *hdr;
+	struct quirks_cache_file *files;
+	struct quirks_cache_section *sections;
+	struct quirks_cache_property *props;
+	struct string_table strings = {0};
+	struct file_stamp *stamps;
+	struct section *s;
+	struct property *p;
+	size_t nstamps = 0,
+	       nsections = 0,
+	       nprops = 0,
+	       sz;
+	char *buf, *tmpfile = NULL;
+	FILE *fp;
+	int fd;
+	bool rc = false;
+
+	stamps = file_stamps_collect(ctx->data_path,
+				     ctx->override_file,
+				     &nstamps);
+	if (!stamps) {
+		qlog_error(ctx, "%s: failed to find data files\n",
+			   ctx->data_path);
+		return false;
+	}
+
+	list_for_each(s, &ctx->sections, link) {
+		nsections++;
+		list_for_each(p, &s->properties, link)
+			nprops++;
+	}
+
+	sz = sizeof(*hdr) +
+	     nstamps * sizeof(*files) +
+	     nsections * sizeof(*sections) +
+	     nprops * sizeof(*props);
+	buf = zalloc(sz);
+	hdr = (struct quirks_cache_header *)buf;
+	files = (struct quirks_cache_file *)(hdr + 1);
+	sections = (struct quirks_cache_section *)(files + nstamps);
+	props = (struct quirks_cache_property *)(sections + nsections);
+
+	/* offset 0 is the empty string, used to represent NULL */
+	string_table_add(&strings, "");
+
+	hdr->magic = QUIRKS_CACHE_MAGIC;
+	hdr->version = QUIRKS_CACHE_VERSION;
+	hdr->libinput_version = string_table_add(&strings, LIBINPUT_VERSION);
+	hdr->nfiles = nstamps;
+	hdr->nsections = nsections;
+	hdr->nproperties = nprops;
+
+	for (size_t i = 0; i < nstamps; i++) {
+		files[i].path = string_table_add(&strings, stamps[i].path);
+		files[i].size = stamps[i].size;
+		files[i].mtime_sec = stamps[i].mtime_sec;
+		files[i].mtime_nsec = stamps[i].mtime_nsec;
+	}
+
+	nprops = 0;
+	list_for_each(s, &ctx->sections, link) {
+		struct quirks_cache_section *cs = sections++;
+
+		cs->name = string_table_add(&strings, s->name);
+		cs->first_property = nprops;
+		cs->bits = s->match.bits;
+		cs->match_name = string_table_add(&strings, s->match.name);
+		cs->bus = s->match.bus;
+		cs->vendor = s->match.vendor;
+		cs->product = s->match.product;
+		cs->version = s->match.version;
+		cs->udev_type = s->match.udev_type;
+		cs->dmi = string_table_add(&strings, s->match.dmi);
+		cs->dt = string_table_add(&strings, s->match.dt);
+
+		list_for_each(p, &s->properties, link) {
+			struct quirks_cache_property *cp = &props[nprops++];
+
+			cp->id = p->id;
+			cp->type = p->type;
+			cp->value = p->value;
+			if (p->type == PT_STRING) {
+				cp->string = string_table_add(&strings,
+							      p->value.s);
+				cp->value.s = NULL;
+			}
+			cs->nproperties++;
+		}
+	}
+	hdr->strings_size = strings.size;
+
+	xasprintf(&tmpfile, "%s.XXXXXX", cache_file);
+	fd = mkstemp(tmpfile);
+	if (fd < 0) {
+		qlog_error(ctx, "%s: failed to create cache file: %s\n",
+			   cache_file, strerror(errno));
+		goto out;
+	}
+
+	fchmod(fd, 0644);
+	fp = fdopen(fd, "w");
+	if (!fp) {
+		close(fd);
+		unlink(tmpfile);
+		goto out;
+	}
+
+	if (fwrite(buf, sz, 1, fp) != 1 ||
+	    fwrite(strings.data, strings.size, 1, fp) != 1) {
+		qlog_error(ctx, "%s: failed to write cache file: %s\n",
+			   cache_file, strerror(errno));
+		fclose(fp);
+		unlink(tmpfile);
+		goto out;
+	}
+
+	if (fclose(fp) != 0 || rename(tmpfile, cache_file) < 0) {
+		qlog_error(ctx, "%s: failed to write cache file: %s\n",
+			   cache_file, strerror(errno));
+		unlink(tmpfile);
+		goto out;
+	}
+
+	qlog_debug(ctx, "%s: wrote %zu sections, %zu properties\n",
+		   cache_file, nsections, nprops);
+	rc = true;
+out:
+	free(tmpfile);
+	free(strings.data);
+	free(buf);
+	file_stamps_free(stamps, nstamps);
+
+	return rc;
+}
+
+static bool
+quirks_cache_is_current(struct quirks_context *ctx,
+			const struct quirks_cache_header *hdr,
+			const struct quirks_cache_file *files,
+			const char *strings)
+{
+	struct file_stamp *stamps;
+	size_t nstamps = 0;
+	bool current = false;
+
+	if (!streq(cache_string(strings, hdr->libinput_version),
+		   LIBINPUT_VERSION))
+		return false;
+
+	stamps = file_stamps_collect(ctx->data_path,
+				     ctx->override_file,
+				     &nstamps);
+	if (!stamps)
+		return false;
+
+	if (nstamps != hdr->nfiles)
+		goto out;
+
+	for (size_t i = 0; i < nstamps; i++) {
+		const struct quirks_cache_file *f = &files[i];
+
+		if (f->path == 0 || f->path >= hdr->strings_size ||
+		    !streq(cache_string(strings, f->path), stamps[i].path) ||
+		    f->size != stamps[i].size ||
+		    f->mtime_sec != stamps[i].mtime_sec ||
+		    f->mtime_nsec != stamps[i].mtime_nsec)
+			goto out;
+	}
+
+	current = true;
+out:
+	file_stamps_free(stamps, nstamps);
+
+	return current;
+}
+
+static bool
+quirks_cache_load_sections(struct quirks_context *ctx,
+			   const struct quirks_cache_header *hdr,
+			   const struct quirks_cache_section *sections,
+			   const struct quirks_cache_property *props,
+			   const char *strings)
+{
+	const uint32_t nstrings = hdr->strings_size;
+
+	for (uint32_t i = 0; i < hdr->nsections; i++) {
+		const struct quirks_cache_section *cs = &sections[i];
+		struct section *s;
+
+		if (cs->name == 0 || cs->name >= nstrings ||
+		    cs->match_name >= nstrings ||
+		    cs->dmi >= nstrings ||
+		    cs->dt >= nstrings ||
+		    cs->first_property > hdr->nproperties ||
+		    cs->nproperties > hdr->nproperties - cs->first_property)
+			return false;
+
+		s = zalloc(sizeof(*s));
+		list_init(&s->properties);
+		list_append(&ctx->sections, &s->link);
+
+		s->mapped = true;
+		s->has_match = true;
+		s->has_property = true;
+		s->name = cache_string(strings, cs->name);
+		s->match.bits = cs->bits;
+		s->match.name = cache_string(strings, cs->match_name);
+		s->match.bus = cs->bus;
+		s->match.vendor = cs->vendor;
+		s->match.product = cs->product;
+		s->match.version = cs->version;
+		s->match.udev_type = cs->udev_type;
+		s->match.dmi = cache_string(strings, cs->dmi);
+		s->match.dt = cache_string(strings, cs->dt);
+
+		for (uint32_t j = 0; j < cs->nproperties; j++) {
+			const struct quirks_cache_property *cp;
+			struct property *p;
+
+			cp = &props[cs->first_property + j];
+			if ((cp->id < QUIRK_MODEL_ALPS_SERIAL_TOUCHPAD ||
+			     cp->id >= _QUIRK_LAST_MODEL_QUIRK_) &&
+			    (cp->id < QUIRK_ATTR_SIZE_HINT ||
+			     cp->id >= _QUIRK_LAST_ATTR_QUIRK_))
+				return false;
+
+			switch (cp->type) {
+			case PT_STRING:
+				if (cp->string == 0 || cp->string >= nstrings)
+					return false;
+				break;
+			case PT_TUPLES:
+				if (cp->value.tuples.ntuples >
+				    ARRAY_LENGTH(cp->value.tuples.tuples))
+					return false;
+				break;
+			case PT_UINT_ARRAY:
+				if (cp->value.array.nelements >
+				    ARRAY_LENGTH(cp->value.array.data.u))
+					return false;
+				break;
+			case PT_UINT:
+			case PT_INT:
+			case PT_BOOL:
+			case PT_DIMENSION:
+			case PT_RANGE:
+			case PT_DOUBLE:
+				break;
+			default:
+				return false;
+			}
+
+			p = property_new();
+			p->id = cp->id;
+			p->type = cp->type;
+			p->value = cp->value;
+			if (p->type == PT_STRING) {
+				p->value.s = cache_string(strings, cp->string);
+				p->mapped = true;
+			}
+			list_append(&s->properties, &p->link);
+		}
+	}
+
+	return true;
+}
+
+static bool
+quirks_cache_load(struct quirks_context *ctx, const char *cache_file)
+{
+	const struct quirks_cache_header *hdr;
+	const struct quirks_cache_file *files;
+	const struct quirks_cache_section *sections;
+	const struct quirks_cache_property *props;
+	const char *strings;
+	struct section *s;
+	struct stat st;
+	uint64_t sz;
+	void *map;
+	int fd;
+
+	fd = open(cache_file, O_RDONLY|O_CLOEXEC);
+	if (fd < 0) {
+		qlog_debug(ctx, "%s: no quirks cache (%s)\n",
+			   cache_file, strerror(errno));
+		return false;
+	}
+
+	if (fstat(fd, &st) < 0 || (size_t)st.st_size < sizeof(*hdr)) {
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	hdr = map;
+	if (hdr->magic != QUIRKS_CACHE_MAGIC ||
+	    hdr->version != QUIRKS_CACHE_VERSION)
+		goto invalid;
+
+	sz = sizeof(*hdr) +
+	     (uint64_t)hdr->nfiles * sizeof(*files) +
+	     (uint64_t)hdr->nsections * sizeof(*sections) +
+	     (uint64_t)hdr->nproperties * sizeof(*props) +
+	     hdr->strings_size;
+	if (sz != (uint64_t)st.st_size || hdr->strings_size == 0)
+		goto invalid;
+
+	files = (const struct quirks_cache_file *)(hdr + 1);
+	sections = (const struct quirks_cache_section *)(files + hdr->nfiles);
+	props = (const struct quirks_cache_property *)(sections + hdr->nsections);
+	strings = (const char *)(props + hdr->nproperties);
+
+	if (strings[hdr->strings_size - 1] != '\0' ||
+	    hdr->libinput_version >= hdr->strings_size)
+		goto invalid;
+
+	if (!quirks_cache_is_current(ctx, hdr, files, strings)) {
+		qlog_info(ctx, "%s: quirks cache is out of date\n", cache_file);
+		goto out;
+	}
+
+	if (!quirks_cache_load_sections(ctx, hdr, sections, props, strings)) {
+		list_for_each_safe(s, &ctx->sections, link)
+			section_destroy(s);
+		goto invalid;
+	}
+
+	ctx->cache.map = map;
+	ctx->cache.size = st.st_size;
+
+	qlog_debug(ctx, "%s: loaded quirks cache\n", cache_file);
+
+	return true;
+
+invalid:
+	qlog_error(ctx, "%s: invalid quirks cache, ignoring\n", cache_file);
+out:
+	munmap(map, st.st_size);
+	return false;
+}
+
+static void
+index_append(uint32_t **array, size_t *count, uint32_t value)
+{
+	uint32_t *tmp;
+
+	tmp = realloc(*array, (*count + 1) * sizeof(*tmp));
+	if (!tmp)
+		abort();
+
+	tmp[(*count)++] = value;
+	*array = tmp;
+}
+
+static int
+section_vid_cmp(const void *a, const void *b)
+{
+	const struct section_vid *va = a,
+				 *vb = b;
+
+	if (va->vendor != vb->vendor)
+		return va->vendor < vb->vendor ? -1 : 1;
+
+	return va->index < vb->index ? -1 : va->index > vb->index;
+}
+
+/**
+ * Build the section index. DMI and DT matches are against the context,
+ * not the device, so we evaluate them once here and leave any section
+ * that cannot match on this machine out of the index altogether.
+ */
+static void
+quirks_index_sections(struct quirks_context *ctx)
+{
+	struct section *s;
+	size_t nsections = 0;
+	uint32_t idx = 0;
+
+	list_for_each(s, &ctx->sections, link)
+		nsections++;
+
+	ctx->index.sections = zalloc((nsections + 1) *
+				     sizeof(*ctx->index.sections));
+	ctx->index.vid = zalloc((nsections + 1) * sizeof(*ctx->index.vid));
+
+	list_for_each(s, &ctx->sections, link) {
+		s->index = idx;
+		ctx->index.sections[idx++] = s;
+
+		s->context_matches = 0;
+		if ((s->match.bits & M_DMI) && ctx->dmi &&
+		    fnmatch(s->match.dmi, ctx->dmi, 0) == 0)
+			s->context_matches |= M_DMI;
+		if ((s->match.bits & M_DT) && ctx->dt &&
+		    fnmatch(s->match.dt, ctx->dt, 0) == 0)
+			s->context_matches |= M_DT;
+
+		if ((s->match.bits & (M_DMI|M_DT)) != s->context_matches)
+			continue;
+
+		if (s->match.bits & M_VID) {
+			struct section_vid *v;
+
+			v = &ctx->index.vid[ctx->index.nvid++];
+			v->vendor = s->match.vendor;
+			v->index = s->index;
+		} else if (s->match.bits & M_UDEV_TYPE) {
+			for (size_t t = 0; t < ARRAY_LENGTH(ctx->index.udev_type); t++) {
+				if ((s->match.udev_type & bit(t)) == 0)
+					continue;
+
+				index_append(&ctx->index.udev_type[t],
+					     &ctx->index.nudev_type[t],
+					     s->index);
+			}
+		} else {
+			index_append(&ctx->index.other,
+				     &ctx->index.nother,
+				     s->index);
+		}
+	}
+	ctx->index.nsections = nsections;
+
+	qsort(ctx->index.vid,
+	      ctx->index.nvid,
+	      sizeof(*ctx->index.vid),
+	      section_vid_cmp);
+}
+
 struct quirks_context *
 quirks_init_subsystem(const char *data_path,
 		      const char *override_file,
 		      libinput_log_handler log_handler,
 		      struct libinput *libinput,
 		      enum quirks_log_type log_type)
+{
+	return quirks_init_subsystem_with_cache(data_path,
+						override_file,
+						NULL,
+						log_handler,
+						libinput,
+						log_type);
+}
+
+struct quirks_context *
+quirks_init_subsystem_with_cache(const char *data_path,
+				 const char *override_file,
+				 const char *cache_file,
+				 libinput_log_handler log_handler,
+				 struct libinput *libinput,
+				 enum quirks_log_type log_type)
 {
 	struct quirks_context *ctx = zalloc(sizeof *ctx);
 
@@ -1135,6 +1830,8 @@ quirks_init_subsystem(const char *data_path,
 	ctx->log_handler = log_handler;
 	ctx->log_type = log_type;
 	ctx->libinput = libinput;
+	ctx->data_path = safe_strdup(data_path);
+	ctx->override_file = safe_strdup(override_file);
 	list_init(&ctx->quirks);
 	list_init(&ctx->sections);
 
@@ -1145,11 +1842,15 @@ quirks_init_subsystem(const char *data_path,
 	if (!ctx->dmi && !ctx->dt)
 		goto error;
 
-	if (!parse_files(ctx, data_path))
-		goto error;
+	if (!cache_file || !quirks_cache_load(ctx, cache_file)) {
+		if (!parse_files(ctx, data_path))
+			goto error;
 
-	if (override_file && !parse_file(ctx, override_file))
-		goto error;
+		if (override_file && !parse_file(ctx, override_file))
+			goto error;
+	}
+
+	quirks_index_sections(ctx);
 
 	return ctx;
 
@@ -1188,8 +1889,19 @@ quirks_context_unref(struct quirks_context *ctx)
 		section_destroy(s);
 	}
 
+	if (ctx->cache.map)
+		munmap(ctx->cache.map, ctx->cache.size);
+
+	free(ctx->index.sections);
+	free(ctx->index.vid);
+	for (size_t i = 0; i < ARRAY_LENGTH(ctx->index.udev_type); i++)
+		free(ctx->index.udev_type[i]);
+	free(ctx->index.other);
+
 	free(ctx->dmi);
 	free(ctx->dt);
+	free(ctx->data_path);
+	free(ctx->override_file);
 	free(ctx);
 
 	return NULL;
@@ -1229,17 +1941,27 @@ quirks_unref(struct quirks *q)
 	return NULL;
 }
 
+/* What we match on, either a udev device or, for devices without one,
+ * a list of "KEY=value" properties that stand in for udev's */
+struct match_source {
+	struct udev_device *udev_device;
+	char **properties;
+};
+
 /**
  * Searches for the udev property on this device and its parent devices.
  *
  * @return the value of the property or NULL
  */
 static const char *
-udev_prop(struct udev_device *device, const char *prop)
+udev_prop(const struct match_source *source, const char *prop)
 {
-	struct udev_device *d = device;
+	struct udev_device *d = source->udev_device;
 	const char *value = NULL;
 
+	if (!d)
+		return strv_find_value(source->properties, prop);
+
 	do {
 		value = udev_device_get_property_value(d, prop);
 		d = udev_device_get_parent(d);
@@ -1250,7 +1972,7 @@ udev_prop(struct udev_device *device, const char *prop)
 
 static inline void
 match_fill_name(struct match *m,
-		struct udev_device *device)
+		const struct match_source *device)
 {
 	const char *str = udev_prop(device, "NAME");
 	size_t slen;
@@ -1273,7 +1995,7 @@ match_fill_name(struct match *m,
 
 static inline void
 match_fill_bus_vid_pid(struct match *m,
-		       struct udev_device *device)
+		       const struct match_source *device)
 {
 	const char *str;
 	unsigned int product, vendor, bus, version;
@@ -1323,7 +2045,7 @@ match_fill_bus_vid_pid(struct match *m,
 
 static inline void
 match_fill_udev_type(struct match *m,
-		     struct udev_device *device)
+		     const struct match_source *device)
 {
 	struct ut_map {
 		const char *prop;
@@ -1362,7 +2084,7 @@ match_fill_dmi_dt(struct match *m, char *dmi, char *dt)
 }
 
 static struct match *
-match_new(struct udev_device *device,
+match_new(const struct match_source *device,
 	  char *dmi, char *dt)
 {
 	struct match *m = zalloc(sizeof *m);
@@ -1456,12 +2178,10 @@ quirk_match_section(struct quirks_context *ctx,
 				matched_flags |= flag;
 			break;
 		case M_DMI:
-			if (fnmatch(s->match.dmi, m->dmi, 0) == 0)
-				matched_flags |= flag;
-			break;
 		case M_DT:
-			if (fnmatch(s->match.dt, m->dt, 0) == 0)
-				matched_flags |= flag;
+			/* m->dmi and m->dt are the context's, see
+			 * quirks_index_sections() */
+			matched_flags |= s->context_matches & flag;
 			break;
 		case M_UDEV_TYPE:
 			if (s->match.udev_type & m->udev_type)
@@ -1487,28 +2207,85 @@ quirk_match_section(struct quirks_context *ctx,
 	return true;
 }
 
-struct quirks *
-quirks_fetch_for_device(struct quirks_context *ctx,
-			struct udev_device *udev_device)
+/**
+ * Match the device against the candidate sections from the index. The
+ * candidates are matched in their original order so later sections still
+ * override earlier ones.
+ */
+static void
+quirk_match_sections(struct quirks_context *ctx,
+		     struct quirks *q,
+		     struct match *m,
+		     struct udev_device *device)
 {
-	struct quirks *q = NULL;
-	struct section *s;
-	struct match *m;
+	unsigned char *candidates;
+	uint32_t *indices;
+	size_t nindices;
 
-	if (!ctx)
-		return NULL;
+	candidates = zalloc(NCHARS(ctx->index.nsections) + 1);
 
-	qlog_debug(ctx, "%s: fetching quirks\n",
-		   udev_device_get_devnode(udev_device));
+	if (m->bits & M_VID) {
+		size_t lo = 0,
+		       hi = ctx->index.nvid;
 
-	q = quirks_new();
+		while (lo < hi) {
+			size_t mid = lo + (hi - lo) / 2;
 
-	m = match_new(udev_device, ctx->dmi, ctx->dt);
+			if (ctx->index.vid[mid].vendor < m->vendor)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
 
-	list_for_each(s, &ctx->sections, link) {
-		quirk_match_section(ctx, q, s, m, udev_device);
+		for (size_t i = lo; i < ctx->index.nvid; i++) {
+			if (ctx->index.vid[i].vendor != m->vendor)
+				break;
+			set_bit(candidates, ctx->index.vid[i].index);
+		}
+	}
+
+	if (m->bits & M_UDEV_TYPE) {
+		for (size_t t = 0; t < ARRAY_LENGTH(ctx->index.udev_type); t++) {
+			if ((m->udev_type & bit(t)) == 0)
+				continue;
+
+			indices = ctx->index.udev_type[t];
+			nindices = ctx->index.nudev_type[t];
+			for (size_t i = 0; i < nindices; i++)
+				set_bit(candidates, indices[i]);
+		}
 	}
 
+	for (size_t i = 0; i < ctx->index.nother; i++)
+		set_bit(candidates, ctx->index.other[i]);
+
+	for (size_t i = 0; i < ctx->index.nsections; i++) {
+		if (!bit_is_set(candidates, i))
+			continue;
+
+		quirk_match_section(ctx,
+				    q,
+				    ctx->index.sections[i],
+				    m,
+				    device);
+	}
+
+	free(candidates);
+}
+
+static struct quirks *
+quirks_fetch(struct quirks_context *ctx,
+	     const struct match_source *source)
+{
+	struct quirks *q = NULL;
+	struct match *m;
+
+	q = quirks_new();
+
+	m = match_new(source, ctx->dmi, ctx->dt);
+
+	quirk_match_sections(ctx, q, m, source->udev_device);
+
 	match_free(m);
 
 	if (q->nproperties == 0) {
@@ -1521,6 +2298,41 @@ quirks_fetch_for_device(struct quirks_context *ctx,
 	return q;
 }
 
+struct quirks *
+quirks_fetch_for_device(struct quirks_context *ctx,
+			struct udev_device *udev_device)
+{
+	struct match_source source = {
+		.udev_device = udev_device,
+	};
+
+	/* Devices without a udev device have nothing to match on */
+	if (!ctx || !udev_device)
+		return NULL;
+
+	qlog_debug(ctx, "%s: fetching quirks\n",
+		   udev_device_get_devnode(udev_device));
+
+	return quirks_fetch(ctx, &source);
+}
+
+struct quirks *
+quirks_fetch_for_properties(struct quirks_context *ctx,
+			    const char *name,
+			    char **properties)
+{
+	struct match_source source = {
+		.properties = properties,
+	};
+
+	if (!ctx || !properties)
+		return NULL;
+
+	qlog_debug(ctx, "%s: fetching quirks\n", name);
+
+	return quirks_fetch(ctx, &source);
+}
+
 
 static inline struct property *
 quirk_find_prop(struct quirks *q, enum quirk which)
@@ -109,6 +109,7 @@ enum quirk {
 	QUIRK_ATTR_EVENT_CODE_ENABLE,
 	QUIRK_ATTR_INPUT_PROP_DISABLE,
 	QUIRK_ATTR_INPUT_PROP_ENABLE,
+	QUIRK_ATTR_TABLET_SMOOTHING,
 
 	_QUIRK_LAST_ATTR_QUIRK_, /* Guard: do not modify */
 };
@@ -166,6 +167,45 @@ quirks_init_subsystem(const char *data_path,
 		      struct libinput *libinput,
 		      enum quirks_log_type log_type);
 
+/**
+ * Initialize the quirks subsystem, see quirks_init_subsystem().
+ *
+ * If cache_file is not NULL and contains a compiled quirks cache that is
+ * current for the files in data_path and override_file, the quirks are
+ * loaded from that cache. Otherwise, or if cache_file is NULL, the quirks
+ * files are parsed.
+ *
+ * @param data_path The directory containing the various data files
+ * @param override_file A file path containing custom overrides
+ * @param cache_file A file path to a cache written with
+ * quirks_context_write_cache(), may be NULL
+ * @param log_handler The libinput log handler called for debugging output
+ * @param libinput The libinput struct passed to the log handler
+ *
+ * @return an opaque handle to the context
+ */
+struct quirks_context *
+quirks_init_subsystem_with_cache(const char *data_path,
+				 const char *override_file,
+				 const char *cache_file,
+				 libinput_log_handler log_handler,
+				 struct libinput *libinput,
+				 enum quirks_log_type log_type);
+
+/**
+ * Compile the quirks in this context into a cache file that can be
+ * passed to quirks_init_subsystem_with_cache(). The file is replaced
+ * atomically.
+ *
+ * The cache is tied to the modification time and size of the files it
+ * was compiled from and is ignored once any of those change.
+ *
+ * @return true on success or false on failure
+ */
+bool
+quirks_context_write_cache(struct quirks_context *ctx,
+			   const char *cache_file);
+
 /**
  * Clean up after ourselves. This function must be called
  * as the last call to the quirks subsystem.
@@ -191,6 +231,19 @@ struct quirks *
 quirks_fetch_for_device(struct quirks_context *ctx,
 			struct udev_device *device);
 
+/**
+ * Fetch the quirks for a device without a udev device. The properties
+ * are "KEY=value" strings in place of the udev properties, the ones
+ * matched on are NAME, PRODUCT and the ID_INPUT_* types, in the format
+ * udev uses. name is only used in the log messages.
+ *
+ * @return A new quirks struct, use quirks_unref() to release
+ */
+struct quirks *
+quirks_fetch_for_properties(struct quirks_context *ctx,
+			    const char *name,
+			    char **properties);
+
 /**
  * Reduce the refcount by one. When the refcount reaches zero, the
  * associated struct is released.
@@ -48,8 +48,7 @@ libinput_timer_init(struct libinput_timer *timer,
 void
 libinput_timer_destroy(struct libinput_timer *timer)
 {
-	if (timer->link.prev != NULL && timer->link.next != NULL &&
-	    !list_empty(&timer->link)) {
+	if (timer->expire != 0) {
 		log_bug_libinput(timer->libinput,
 				 "timer: %s has not been cancelled\n",
 				 timer->timer_name);
@@ -58,20 +57,142 @@ libinput_timer_destroy(struct libinput_timer *timer)
 	free(timer->timer_name);
 }
 
+/*
+ * The armed timers are kept in a binary min-heap ordered by expiry time,
+ * each timer stores its index in the heap so it can be moved or removed
+ * without searching for it.
+ */
+static inline void
+timer_heap_place(struct libinput *libinput,
+		 struct libinput_timer *timer,
+		 size_t index)
+{
+	libinput->timer.heap[index] = timer;
+	timer->heap_index = index;
+}
+
+static void
+timer_heap_sift_up(struct libinput *libinput, size_t index)
+{
+	struct libinput_timer **heap = libinput->timer.heap;
+	struct libinput_timer *timer = heap[index];
+
+	while (index > 0) {
+		size_t parent = (index - 1) / 2;
+
+		if (heap[parent]->expire <= timer->expire)
+			break;
+
+		timer_heap_place(libinput, heap[parent], index);
+		index = parent;
+	}
+
+	timer_heap_place(libinput, timer, index);
+}
+
+static void
+timer_heap_sift_down(struct libinput *libinput, size_t index)
+{
+	struct libinput_timer **heap = libinput->timer.heap;
+	struct libinput_timer *timer = heap[index];
+	size_t count = libinput->timer.heap_count;
+
+	while (true) {
+		size_t child = 2 * index + 1;
+
+		if (child >= count)
+			break;
+
+		if (child + 1 < count &&
+		    heap[child + 1]->expire < heap[child]->expire)
+			child++;
+
+		if (timer->expire <= heap[child]->expire)
+			break;
+
+		timer_heap_place(libinput, heap[child], index);
+		index = child;
+	}
+
+	timer_heap_place(libinput, timer, index);
+}
+
+static void
+timer_heap_insert(struct libinput *libinput, struct libinput_timer *timer)
+{
+	if (libinput->timer.heap_count == libinput->timer.heap_size) {
+		size_t size = max(libinput->timer.heap_size * 2, 16U);
+		struct libinput_timer **heap;
+
+		heap = realloc(libinput->timer.heap, size * sizeof(*heap));
+		if (!heap)
+			abort();
+
+		libinput->timer.heap = heap;
+		libinput->timer.heap_size = size;
+	}
+
+	timer_heap_place(libinput, timer, libinput->timer.heap_count++);
+	timer_heap_sift_up(libinput, timer->heap_index);
+}
+
+static void
+timer_heap_remove(struct libinput *libinput, struct libinput_timer *timer)
+{
+	size_t index = timer->heap_index;
+	struct libinput_timer *last;
+
+	assert(index < libinput->timer.heap_count);
+	assert(libinput->timer.heap[index] == timer);
+
+	last = libinput->timer.heap[--libinput->timer.heap_count];
+	if (last == timer)
+		return;
+
+	timer_heap_place(libinput, last, index);
+	if (index > 0 &&
+	    libinput->timer.heap[(index - 1) / 2]->expire > last->expire)
+		timer_heap_sift_up(libinput, index);
+	else
+		timer_heap_sift_down(libinput, index);
+}
+
+static inline struct libinput_timer *
+timer_heap_top(struct libinput *libinput)
+{
+	if (libinput->timer.heap_count == 0)
+		return NULL;
+
+	return libinput->timer.heap[0];
+}
+
 static void
 libinput_timer_arm_timer_fd(struct libinput *libinput)
 {
 	int r;
 	struct libinput_timer *timer;
 	struct itimerspec its = { { 0, 0 }, { 0, 0 } };
-	uint64_t earliest_expire = UINT64_MAX;
+	uint64_t earliest_expire = 0;
+
+	/* The handler re-arms once all expired timers are processed */
+	if (libinput->timer.in_handler)
+		return;
+
+	timer = timer_heap_top(libinput);
+	if (timer)
+		earliest_expire = timer->expire;
+
+	/* Only touch the timerfd if the earliest expiry changed */
+	if (earliest_expire == libinput->timer.next_expiry)
+		return;
 
-	list_for_each(timer, &libinput->timer.list, link) {
-		if (timer->expire < earliest_expire)
-			earliest_expire = timer->expire;
+	/* libinput_clock_advance() runs the timers */
+	if (libinput->clock.is_virtual) {
+		libinput->timer.next_expiry = earliest_expire;
+		return;
 	}
 
-	if (earliest_expire != UINT64_MAX) {
+	if (earliest_expire != 0) {
 		its.it_value.tv_sec = earliest_expire / ms2us(1000);
 		its.it_value.tv_nsec = (earliest_expire % ms2us(1000)) * 1000;
 	}
@@ -88,6 +209,9 @@ libinput_timer_set_flags(struct libinput_timer *timer,
 			 uint64_t expire,
 			 uint32_t flags)
 {
+	struct libinput *libinput = timer->libinput;
+	uint64_t old_expire = timer->expire;
+
 #ifndef NDEBUG
 	uint64_t now = libinput_now(timer->libinput);
 	if (expire < now) {
@@ -106,11 +230,16 @@ libinput_timer_set_flags(struct libinput_timer *timer,
 
 	assert(expire);
 
-	if (!timer->expire)
-		list_insert(&timer->libinput->timer.list, &timer->link);
-
 	timer->expire = expire;
-	libinput_timer_arm_timer_fd(timer->libinput);
+
+	if (!old_expire)
+		timer_heap_insert(libinput, timer);
+	else if (expire < old_expire)
+		timer_heap_sift_up(libinput, timer->heap_index);
+	else if (expire > old_expire)
+		timer_heap_sift_down(libinput, timer->heap_index);
+
+	libinput_timer_arm_timer_fd(libinput);
 }
 
 void
@@ -125,8 +254,8 @@ libinput_timer_cancel(struct libinput_timer *timer)
 	if (!timer->expire)
 		return;
 
+	timer_heap_remove(timer->libinput, timer);
 	timer->expire = 0;
-	list_remove(&timer->link);
 	libinput_timer_arm_timer_fd(timer->libinput);
 }
 
@@ -135,28 +264,27 @@ libinput_timer_handler(struct libinput *libinput , uint64_t now)
 {
 	struct libinput_timer *timer;
 
-restart:
-	list_for_each(timer, &libinput->timer.list, link) {
-		if (timer->expire == 0)
-			continue;
-
-		if (timer->expire <= now) {
-			/* Clear the timer before calling timer_func,
-			   as timer_func may re-arm it */
-			libinput_timer_cancel(timer);
-			timer->timer_func(now, timer->timer_func_data);
-
-			/*
-			 * Restart the loop. We can't use
-			 * list_for_each_safe() here because that only
-			 * allows removing one (our) timer per timer_func.
-			 * But the timer func may trigger another unrelated
-			 * timer to be cancelled and removed, causing a
-			 * segfault.
-			 */
-			goto restart;
-		}
+	/* Nested calls, e.g. through a libinput_timer_flush() in a
+	 * timer func, are handled by the outermost loop */
+	if (libinput->timer.in_handler)
+		return;
+
+	libinput->timer.in_handler = true;
+
+	/* The timer funcs may set or cancel any timer, including this one
+	 * and the next one to expire, so always look at the current
+	 * top of the heap */
+	while ((timer = timer_heap_top(libinput)) &&
+	       timer->expire <= now) {
+		/* Clear the timer before calling timer_func,
+		   as timer_func may re-arm it */
+		libinput_timer_cancel(timer);
+		libinput->dispatch_stats.timer_expiries++;
+		timer->timer_func(now, timer->timer_func_data);
 	}
+
+	libinput->timer.in_handler = false;
+	libinput_timer_arm_timer_fd(libinput);
 }
 
 static void
@@ -189,7 +317,10 @@ libinput_timer_subsys_init(struct libinput *libinput)
 	if (libinput->timer.fd < 0)
 		return -1;
 
-	list_init(&libinput->timer.list);
+	libinput->timer.heap = NULL;
+	libinput->timer.heap_count = 0;
+	libinput->timer.heap_size = 0;
+	libinput->timer.next_expiry = 0;
 
 	libinput->timer.source = libinput_add_fd(libinput,
 						 libinput->timer.fd,
@@ -207,20 +338,17 @@ void
 libinput_timer_subsys_destroy(struct libinput *libinput)
 {
 #ifndef NDEBUG
-	if (!list_empty(&libinput->timer.list)) {
-		struct libinput_timer *t;
-
-		list_for_each(t, &libinput->timer.list, link) {
-			log_bug_libinput(libinput,
-					 "timer: %s still present on shutdown\n",
-					 t->timer_name);
-		}
+	for (size_t i = 0; i < libinput->timer.heap_count; i++) {
+		log_bug_libinput(libinput,
+				 "timer: %s still present on shutdown\n",
+				 libinput->timer.heap[i]->timer_name);
 	}
 #endif
 
 	/* All timer users should have destroyed their timers now */
-	assert(list_empty(&libinput->timer.list));
+	assert(libinput->timer.heap_count == 0);
 
+	free(libinput->timer.heap);
 	libinput_remove_source(libinput, libinput->timer.source);
 	close(libinput->timer.fd);
 }
@@ -243,3 +371,53 @@ libinput_timer_flush(struct libinput *libinput, uint64_t now)
 
 	libinput_timer_handler(libinput, now);
 }
+
+void
+libinput_clock_enable_virtual(struct libinput *libinput, uint64_t now)
+{
+	struct itimerspec its = { { 0, 0 }, { 0, 0 } };
+
+	if (libinput->clock.is_virtual)
+		return;
+
+	libinput->clock.is_virtual = true;
+	libinput->clock.now = now;
+
+	/* Disarm the timerfd, anything already armed expires in the
+	 * virtual time now */
+	if (libinput->timer.next_expiry != 0 &&
+	    timerfd_settime(libinput->timer.fd, TFD_TIMER_ABSTIME, &its, NULL))
+		log_error(libinput, "timer: timerfd_settime error: %s\n", strerror(errno));
+}
+
+void
+libinput_clock_advance(struct libinput *libinput, uint64_t now)
+{
+	struct libinput_timer *timer;
+
+	assert(libinput->clock.is_virtual);
+
+	if (now < libinput->clock.now) {
+		log_bug_libinput(libinput,
+				 "timer: virtual clock moving backwards by %dms\n",
+				 us2ms(libinput->clock.now - now));
+		return;
+	}
+
+	if (libinput->timer.in_handler) {
+		log_bug_libinput(libinput,
+				 "timer: virtual clock advanced from a timer func\n");
+		return;
+	}
+
+	/* Step from one expiry to the next, a timer func re-arming a timer
+	 * relative to its now gets the same expiry it would have with
+	 * the real clock */
+	while ((timer = timer_heap_top(libinput)) &&
+	       timer->expire <= now) {
+		libinput->clock.now = max(libinput->clock.now, timer->expire);
+		libinput_timer_handler(libinput, libinput->clock.now);
+	}
+
+	libinput->clock.now = now;
+}
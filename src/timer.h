@@ -33,7 +33,7 @@ struct libinput;
 struct libinput_timer {
 	struct libinput *libinput;
 	char *timer_name;
-	struct list link;
+	size_t heap_index; /* only valid while the timer is armed */
 	uint64_t expire; /* in absolute us CLOCK_MONOTONIC */
 	void (*timer_func)(uint64_t now, void *timer_func_data);
 	void *timer_func_data;
@@ -74,4 +74,16 @@ libinput_timer_subsys_destroy(struct libinput *libinput);
 void
 libinput_timer_flush(struct libinput *libinput, uint64_t now);
 
+/* Switch the context to a virtual clock starting at now, in us. From
+ * then on libinput_now() returns the virtual time, events read from the
+ * devices are stamped with it and the timers only expire in
+ * libinput_clock_advance(). There is no way back to the real clock */
+void
+libinput_clock_enable_virtual(struct libinput *libinput, uint64_t now);
+
+/* Move the virtual clock forward to now, in us, and run the timers that
+ * expire until then, in order and each with its own expiry time */
+void
+libinput_clock_advance(struct libinput *libinput, uint64_t now);
+
 #endif
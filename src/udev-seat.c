@@ -24,6 +24,7 @@
 
 #include "config.h"
 
+#include <pthread.h>
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -34,6 +35,8 @@
 static const char default_seat[] = "seat0";
 static const char default_seat_name[] = "default";
 
+#define UDEV_MAX_PROBE_THREADS 16
+
 static struct udev_seat *
 udev_seat_create(struct udev_input *input,
 		 const char *device_seat,
@@ -73,25 +76,51 @@ filter_duplicates(struct udev_seat *udev_seat,
 	return ignore_device;
 }
 
+static inline const char *
+device_get_seat(struct udev_device *udev_device)
+{
+	const char *device_seat;
+
+	device_seat = udev_device_get_property_value(udev_device, "ID_SEAT");
+	if (!device_seat)
+		device_seat = default_seat;
+
+	return device_seat;
+}
+
+static inline bool
+device_is_on_seat(struct udev_device *udev_device,
+		  struct udev_input *input)
+{
+	if (!streq(device_get_seat(udev_device), input->seat_id))
+		return false;
+
+	if (ignore_litest_test_suite_device(udev_device))
+		return false;
+
+	return true;
+}
+
+/**
+ * Add the device to the seat. If probe is not NULL, the device was
+ * already opened with evdev_device_probe(), the caller releases the
+ * probe afterwards.
+ */
 static int
 device_added(struct udev_device *udev_device,
 	     struct udev_input *input,
-	     const char *seat_name)
+	     const char *seat_name,
+	     struct evdev_probe *probe)
 {
 	struct evdev_device *device;
 	const char *devnode, *sysname;
 	const char *device_seat, *output_name;
 	struct udev_seat *seat;
 
-	device_seat = udev_device_get_property_value(udev_device, "ID_SEAT");
-	if (!device_seat)
-		device_seat = default_seat;
-
-	if (!streq(device_seat, input->seat_id))
+	if (!device_is_on_seat(udev_device, input))
 		return 0;
 
-	if (ignore_litest_test_suite_device(udev_device))
-		return 0;
+	device_seat = device_get_seat(udev_device);
 
 	devnode = udev_device_get_devnode(udev_device);
 	sysname = udev_device_get_sysname(udev_device);
@@ -119,7 +148,10 @@ device_added(struct udev_device *udev_device,
 			return -1;
 	}
 
-	device = evdev_device_create(&seat->base, udev_device);
+	if (probe)
+		device = evdev_device_create_probed(&seat->base, probe);
+	else
+		device = evdev_device_create(&seat->base, udev_device);
 	libinput_seat_unref(&seat->base);
 
 	if (device == EVDEV_UNHANDLED_DEVICE) {
@@ -166,6 +198,138 @@ device_removed(struct udev_device *udev_device, struct udev_input *input)
 	}
 }
 
+struct probe_job {
+	struct udev_device *udev_device;
+	struct evdev_probe probe;
+	bool probed;
+	bool done;		/* protected by the pool lock */
+};
+
+struct probe_pool {
+	struct libinput *libinput;
+	struct probe_job *jobs;
+	size_t njobs;
+
+	pthread_mutex_t lock;
+	pthread_cond_t done_cond;
+	size_t next_job;
+};
+
+static void *
+probe_pool_worker(void *data)
+{
+	struct probe_pool *pool = data;
+
+	while (true) {
+		struct probe_job *job;
+
+		pthread_mutex_lock(&pool->lock);
+		job = pool->next_job < pool->njobs ?
+			&pool->jobs[pool->next_job++] : NULL;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (!job)
+			break;
+
+		if (job->probed)
+			evdev_device_probe(pool->libinput, &job->probe);
+
+		pthread_mutex_lock(&pool->lock);
+		job->done = true;
+		pthread_cond_broadcast(&pool->done_cond);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	return NULL;
+}
+
+/**
+ * Wait until the job at index is probed. Jobs are handed out in order,
+ * if no worker has picked this one up yet, the caller probes it itself
+ * rather than waiting for a worker to get to it.
+ */
+static void
+probe_pool_wait(struct probe_pool *pool, size_t index)
+{
+	struct probe_job *job = &pool->jobs[index];
+	bool probe_here = false;
+
+	pthread_mutex_lock(&pool->lock);
+	/* Anything between next_job and index wasn't probed, the caller
+	 * waited for all probed jobs before this one */
+	if (pool->next_job <= index) {
+		pool->next_job = index + 1;
+		probe_here = true;
+	}
+	while (!probe_here && !job->done)
+		pthread_cond_wait(&pool->done_cond, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+
+	if (probe_here)
+		evdev_device_probe(pool->libinput, &job->probe);
+}
+
+/**
+ * Open the devices on up to input->probe_threads threads, the calling
+ * thread included, and add each device to the seat as soon as it and
+ * all devices before it are open. The calling thread adds the devices
+ * while the workers open the remaining ones. If we cannot create a
+ * thread the calling thread picks up the slack.
+ */
+static int
+udev_input_probe_devices(struct udev_input *input,
+			 struct probe_job *jobs,
+			 size_t njobs)
+{
+	struct probe_pool pool = {
+		.libinput = &input->base,
+		.jobs = jobs,
+		.njobs = njobs,
+		.next_job = 0,
+	};
+	pthread_t threads[UDEV_MAX_PROBE_THREADS];
+	size_t nthreads = 0;
+	int rc = 0;
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_cond_init(&pool.done_cond, NULL);
+
+	while (nthreads + 1 < input->probe_threads &&
+	       nthreads + 1 < njobs) {
+		if (pthread_create(&threads[nthreads],
+				   NULL,
+				   probe_pool_worker,
+				   &pool) != 0)
+			break;
+		nthreads++;
+	}
+
+	/* Commit the devices in enumeration order, same as the serial
+	 * path */
+	for (size_t i = 0; i < njobs; i++) {
+		struct probe_job *job = &jobs[i];
+
+		if (!job->probed)
+			continue;
+
+		probe_pool_wait(&pool, i);
+
+		if (rc == 0)
+			rc = device_added(job->udev_device,
+					  input,
+					  NULL,
+					  &job->probe);
+	}
+
+	for (size_t i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_cond_destroy(&pool.done_cond);
+	pthread_mutex_destroy(&pool.lock);
+
+	return rc;
+}
+
 static int
 udev_input_add_devices(struct udev_input *input, struct udev *udev)
 {
@@ -173,11 +337,17 @@ udev_input_add_devices(struct udev_input *input, struct udev *udev)
 	struct udev_list_entry *entry;
 	struct udev_device *device;
 	const char *path, *sysname;
+	struct probe_job *jobs = NULL;
+	size_t njobs = 0;
+	uint64_t start = libinput_now(&input->base);
+	int rc = 0;
 
 	e = udev_enumerate_new(udev);
 	udev_enumerate_add_match_subsystem(e, "input");
 	udev_enumerate_scan_devices(e);
 	udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(e)) {
+		struct probe_job *tmp;
+
 		path = udev_list_entry_get_name(entry);
 		device = udev_device_new_from_syspath(udev, path);
 		if (!device)
@@ -200,17 +370,59 @@ udev_input_add_devices(struct udev_input *input, struct udev *udev)
 			continue;
 		}
 
-		if (device_added(device, input, NULL) < 0) {
+		if (input->probe_threads <= 1) {
+			rc = device_added(device, input, NULL, NULL);
 			udev_device_unref(device);
-			udev_enumerate_unref(e);
-			return -1;
+			if (rc < 0)
+				break;
+			continue;
 		}
 
-		udev_device_unref(device);
+		tmp = realloc(jobs, (njobs + 1) * sizeof(*jobs));
+		if (!tmp) {
+			udev_device_unref(device);
+			rc = -1;
+			break;
+		}
+		jobs = tmp;
+		jobs[njobs].udev_device = device;
+		jobs[njobs].probed = false;
+		jobs[njobs].done = false;
+		njobs++;
 	}
 	udev_enumerate_unref(e);
 
-	return 0;
+	/* Devices not on our seat are never opened, the checks in
+	 * evdev_device_probe_init() may log so they stay on this thread */
+	for (size_t i = 0; rc == 0 && i < njobs; i++) {
+		struct probe_job *job = &jobs[i];
+
+		if (!device_is_on_seat(job->udev_device, input))
+			continue;
+
+		job->probed = evdev_device_probe_init(&input->base,
+						      &job->probe,
+						      job->udev_device);
+	}
+
+	if (rc == 0 && njobs > 0)
+		rc = udev_input_probe_devices(input, jobs, njobs);
+
+	for (size_t i = 0; i < njobs; i++) {
+		struct probe_job *job = &jobs[i];
+
+		if (job->probed)
+			evdev_device_probe_release(&input->base, &job->probe);
+		udev_device_unref(job->udev_device);
+	}
+	free(jobs);
+
+	log_debug(&input->base,
+		  "udev: seat %s enumerated in %.1fms\n",
+		  input->seat_id,
+		  (libinput_now(&input->base) - start) / 1000.0);
+
+	return rc;
 }
 
 static void
@@ -232,7 +444,7 @@ evdev_udev_handler(void *data)
 		goto out;
 
 	if (streq(action, "add"))
-		device_added(udev_device, input, NULL);
+		device_added(udev_device, input, NULL, NULL);
 	else if (streq(action, "remove"))
 		device_removed(udev_device, input);
 
@@ -381,7 +593,7 @@ udev_device_change_seat(struct libinput_device *device,
 
 	udev_device_ref(udev_device);
 	device_removed(udev_device, input);
-	rc = device_added(udev_device, input, seat_name);
+	rc = device_added(udev_device, input, seat_name, NULL);
 	udev_device_unref(udev_device);
 
 	return rc;
@@ -418,6 +630,22 @@ libinput_udev_create_context(const struct libinput_interface *interface,
 	return &input->base;
 }
 
+LIBINPUT_EXPORT int
+libinput_udev_set_probe_threads(struct libinput *libinput,
+				unsigned int nthreads)
+{
+	struct udev_input *input = (struct udev_input*)libinput;
+
+	if (libinput->interface_backend != &interface_backend) {
+		log_bug_client(libinput, "Mismatching backends.\n");
+		return -1;
+	}
+
+	input->probe_threads = min(nthreads, UDEV_MAX_PROBE_THREADS);
+
+	return 0;
+}
+
 LIBINPUT_EXPORT int
 libinput_udev_assign_seat(struct libinput *libinput,
 			  const char *seat_id)
@@ -39,6 +39,10 @@ struct udev_input {
 	struct udev_monitor *udev_monitor;
 	struct libinput_source *udev_monitor_source;
 	char *seat_id;
+
+	/* threads used to open devices during enumeration,
+	 * see libinput_udev_set_probe_threads() */
+	unsigned int probe_threads;
 };
 
 #endif
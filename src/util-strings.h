@@ -272,6 +272,25 @@ strv_free(char **strv) {
 	free (strv);
 }
 
+/**
+ * Look up key in a NULL-terminated list of "KEY=value" strings, e.g. the
+ * properties of a virtual device. strv may be NULL.
+ *
+ * @return the value of the first entry for key or NULL
+ */
+static inline const char *
+strv_find_value(char **strv, const char *key)
+{
+	size_t len = strlen(key);
+
+	for (char **s = strv; s && *s; s++) {
+		if (strneq(*s, key, len) && (*s)[len] == '=')
+			return *s + len + 1;
+	}
+
+	return NULL;
+}
+
 struct key_value_str{
 	char *key;
 	char *value;
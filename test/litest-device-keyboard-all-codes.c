@@ -66,9 +66,12 @@ all_codes_create(struct litest_device *d)
 	events[idx++] = -1;
 	events[idx++] = -1;
 
-	d->uinput = litest_create_uinput_device_from_description(NAME,
-								 &input_id,
-								 NULL,
-								 events);
+	if (litest_has_virtual_devices())
+		d->evdev = litest_create_libevdev(NAME, &input_id, NULL, events);
+	else
+		d->uinput = litest_create_uinput_device_from_description(NAME,
+									 &input_id,
+									 NULL,
+									 events);
 	return false;
 }
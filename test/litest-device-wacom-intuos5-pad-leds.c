@@ -0,0 +1,91 @@
+/*
+ * Copyright © 2021 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include "config.h"
+
+#include "litest.h"
+#include "litest-int.h"
+
+/* Same as the wacom-intuos5-pad but with mode LEDs backed by files in
+ * LITEST_PAD_LED_DIR. The name must not share a prefix with the
+ * other device, the udev rules match on the name */
+
+static struct input_event down[] = {
+	{ .type = -1, .code = -1 },
+};
+
+static struct input_event move[] = {
+	{ .type = -1, .code = -1 },
+};
+
+static struct litest_device_interface interface = {
+	.touch_down_events = down,
+	.touch_move_events = move,
+};
+
+static struct input_absinfo absinfo[] = {
+	{ ABS_X, 0, 1, 0, 0, 0 },
+	{ ABS_Y, 0, 1, 0, 0, 0 },
+	{ ABS_WHEEL, 0, 71, 0, 0, 0 },
+	{ ABS_MISC, 0, 0, 0, 0, 10 },
+	{ .value = -1 },
+};
+
+static struct input_id input_id = {
+	.bustype = 0x3,
+	.vendor = 0x56a,
+	.product = 0x27,
+};
+
+static int events[] = {
+	EV_KEY, BTN_0,
+	EV_KEY, BTN_1,
+	EV_KEY, BTN_2,
+	EV_KEY, BTN_3,
+	EV_KEY, BTN_4,
+	EV_KEY, BTN_5,
+	EV_KEY, BTN_6,
+	EV_KEY, BTN_7,
+	EV_KEY, BTN_8,
+	EV_KEY, BTN_STYLUS,
+	-1, -1,
+};
+
+TEST_DEVICE("wacom-intuos5-pad-leds",
+	.type = LITEST_WACOM_INTUOS5_PAD_LEDS,
+	.features = LITEST_IGNORED | LITEST_TABLET_PAD | LITEST_RING,
+	.interface = &interface,
+
+	.name = "Wacom Intuos5 touch M LED Pad",
+	.id = &input_id,
+	.events = events,
+	.absinfo = absinfo,
+	.udev_properties = {
+		{ "ID_INPUT_TABLET_PAD", "1" },
+		{ "LIBINPUT_DEVICE_GROUP", "wacom-i5-led-group" },
+		{ "LIBINPUT_TEST_TABLET_PAD_SYSFS_PATH", LITEST_PAD_LED_DIR "/input0::wacom-" },
+		{ NULL },
+	},
+)
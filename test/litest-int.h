@@ -151,6 +151,10 @@ struct path {
 struct litest_context {
 	struct litest_user_data *user_data;
 	struct list paths;
+
+	struct list link; /* litest_contexts */
+	struct libinput *libinput;
+	uint64_t now; /* with --virtual-clock only */
 };
 
 void litest_set_current_device(struct litest_device *device);
@@ -61,6 +61,10 @@
 #include "litest-int.h"
 #include "libinput-util.h"
 #include "quirks.h"
+#include "timer.h"
+#include "evdev.h"
+#include "path-seat.h"
+#include "util-input-event.h"
 #include "builddir.h"
 
 #include <linux/kd.h>
@@ -75,10 +79,14 @@
 #define UDEV_DEVICE_GROUPS_FILE UDEV_RULES_D \
 	"/80-libinput-device-groups-litest-XXXXXX.rules"
 
+#define LITEST_VIRTUAL_MAX_PROPERTIES 64
+
 static int jobs;
 static bool in_debugger = false;
 static bool verbose = false;
 static bool run_deviceless = false;
+static bool use_virtual_clock = false;
+static bool use_virtual_devices = false;
 static bool use_system_rules_quirks = false;
 const char *filter_test = NULL;
 const char *filter_device = NULL;
@@ -94,6 +102,9 @@ struct created_file {
 struct list created_files_list; /* list of all files to remove at the end of
 				   the test run */
 
+/* all contexts from litest_create_context(), see litest_sleep_ms() */
+static struct list litest_contexts = { &litest_contexts, &litest_contexts };
+
 static void litest_init_udev_rules(struct list *created_files_list);
 static void litest_remove_udev_rules(struct list *created_files_list);
 
@@ -808,7 +819,7 @@ litest_init_all_device_udev_rules(struct list *created_files)
 }
 
 static int
-open_restricted(const char *path, int flags, void *userdata)
+litest_open_restricted(const char *path, int flags, void *userdata)
 {
 	const char prefix[] = "/dev/input/event";
 	struct litest_context *ctx = userdata;
@@ -838,7 +849,7 @@ open_restricted(const char *path, int flags, void *userdata)
 }
 
 static void
-close_restricted(int fd, void *userdata)
+litest_close_restricted(int fd, void *userdata)
 {
 	struct litest_context *ctx = userdata;
 	struct path *p;
@@ -855,8 +866,8 @@ close_restricted(int fd, void *userdata)
 }
 
 struct libinput_interface interface = {
-	.open_restricted = open_restricted,
-	.close_restricted = close_restricted,
+	.open_restricted = litest_open_restricted,
+	.close_restricted = litest_close_restricted,
 };
 
 static void
@@ -1254,6 +1265,10 @@ litest_run(int argc, char **argv)
 	if (run_deviceless) {
 		litest_setup_quirks(&created_files_list,
 				    QUIRKS_SETUP_USE_SRCDIR);
+	} else if (use_virtual_devices) {
+		/* No udev rules, the properties are assigned when the
+		 * device is added, see litest_virtual_device_properties() */
+		litest_setup_quirks(&created_files_list, QUIRKS_SETUP_FULL);
 	} else {
 		enum quirks_setup_mode mode;
 		litest_init_udev_rules(&created_files_list);
@@ -1531,7 +1546,10 @@ litest_setup_quirks(struct list *created_files_list,
 {
 	struct created_file *file = NULL;
 	const char *dirname;
-	char tmpdir[] = "/run/litest-XXXXXX";
+	char tmpdir_run[] = "/run/litest-XXXXXX";
+	char tmpdir_tmp[] = "/tmp/litest-XXXXXX";
+	/* /run is usually only writable by root */
+	char *tmpdir = use_virtual_devices ? tmpdir_tmp : tmpdir_run;
 
 	switch (mode) {
 	case QUIRKS_SETUP_USE_SRCDIR:
@@ -1597,7 +1615,8 @@ litest_remove_udev_rules(struct list *created_files_list)
 	struct created_file *f;
 	bool reload_udev;
 
-	reload_udev = !list_empty(created_files_list);
+	reload_udev = !use_virtual_devices &&
+		      !list_empty(created_files_list);
 
 	list_for_each_safe(f, created_files_list, link) {
 		list_remove(&f->link);
@@ -1612,7 +1631,9 @@ litest_remove_udev_rules(struct list *created_files_list)
 }
 
 /**
- * Creates a uinput device but does not add it to a libinput context
+ * Creates a uinput device but does not add it to a libinput context. With
+ * --virtual-devices, only the libevdev description is created, the device
+ * exists once it is added to a context.
  */
 struct litest_device *
 litest_create(enum litest_device_type which,
@@ -1659,10 +1680,13 @@ litest_create(enum litest_device_type which,
 	id = id_override ? id_override : dev->id;
 
 	if (create_device) {
-		d->uinput = litest_create_uinput_device_from_description(name,
-									 id,
-									 abs,
-									 events);
+		if (use_virtual_devices)
+			d->evdev = litest_create_libevdev(name, id, abs, events);
+		else
+			d->uinput = litest_create_uinput_device_from_description(name,
+										 id,
+										 abs,
+										 events);
 		d->interface = dev->interface;
 
 		for (e = events; *e != -1; e += 2) {
@@ -1680,6 +1704,9 @@ litest_create(enum litest_device_type which,
 	free(abs);
 	free(events);
 
+	if (d->evdev)
+		return d;
+
 	path = libevdev_uinput_get_devnode(d->uinput);
 	litest_assert_ptr_notnull(path);
 	fd = open(path, O_RDWR|O_NONBLOCK);
@@ -1708,6 +1735,17 @@ litest_create_context(void)
 	if (verbose)
 		libinput_log_set_priority(libinput, LIBINPUT_LOG_PRIORITY_DEBUG);
 
+	ctx->libinput = libinput;
+	list_append(&litest_contexts, &ctx->link);
+
+	if (use_virtual_clock) {
+		struct timespec ts;
+
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		ctx->now = s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
+		libinput_clock_enable_virtual(libinput, ctx->now);
+	}
+
 	return libinput;
 }
 
@@ -1720,6 +1758,7 @@ litest_destroy_context(struct libinput *li)
 
 	ctx = libinput_get_user_data(li);
 	litest_assert_ptr_notnull(ctx);
+	list_remove(&ctx->link);
 	libinput_unref(li);
 
 	list_for_each_safe(p, &ctx->paths, link) {
@@ -1762,6 +1801,297 @@ litest_set_log_handler_bug(struct libinput *libinput)
 	libinput_log_set_handler(libinput, litest_bug_log_handler);
 }
 
+/* A copy of the device description, libinput takes ownership of the
+ * libevdev device it is given while litest keeps its own as the
+ * "kernel" state of a virtual device */
+static struct libevdev *
+litest_copy_libevdev(struct libevdev *evdev)
+{
+	struct libevdev *copy;
+	unsigned int type, code, prop;
+
+	copy = libevdev_new();
+	litest_assert_ptr_notnull(copy);
+
+	libevdev_set_name(copy, libevdev_get_name(evdev));
+	libevdev_set_id_bustype(copy, libevdev_get_id_bustype(evdev));
+	libevdev_set_id_vendor(copy, libevdev_get_id_vendor(evdev));
+	libevdev_set_id_product(copy, libevdev_get_id_product(evdev));
+	libevdev_set_id_version(copy, libevdev_get_id_version(evdev));
+
+	for (prop = 0; prop < INPUT_PROP_CNT; prop++) {
+		if (libevdev_has_property(evdev, prop))
+			libevdev_enable_property(copy, prop);
+	}
+
+	for (type = 0; type < EV_CNT; type++) {
+		int max = libevdev_event_type_get_max(type);
+
+		if (max < 0 || !libevdev_has_event_type(evdev, type))
+			continue;
+
+		libevdev_enable_event_type(copy, type);
+		for (code = 0; code <= (unsigned int)max; code++) {
+			const void *data = NULL;
+			int rep;
+
+			if (!libevdev_has_event_code(evdev, type, code))
+				continue;
+
+			if (type == EV_ABS) {
+				data = libevdev_get_abs_info(evdev, code);
+			} else if (type == EV_REP) {
+				rep = libevdev_get_event_value(evdev, type, code);
+				data = &rep;
+			}
+			libevdev_enable_event_code(copy, type, code, data);
+		}
+	}
+
+	return copy;
+}
+
+LIBINPUT_ATTRIBUTE_PRINTF(3, 4)
+static void
+litest_virtual_property_append(char **properties,
+			       size_t *nprops,
+			       const char *format,
+			       ...)
+{
+	va_list args;
+	int rc;
+
+	/* properties are NULL-terminated */
+	litest_assert_int_lt(*nprops, LITEST_VIRTUAL_MAX_PROPERTIES - 1);
+
+	va_start(args, format);
+	rc = vasprintf(&properties[*nprops], format, args);
+	va_end(args);
+	litest_assert_int_ne(rc, -1);
+
+	(*nprops)++;
+}
+
+static void
+litest_virtual_apply_evdev_abs(struct libevdev *evdev,
+			       const char *key,
+			       const char *value)
+{
+	struct input_absinfo abs;
+	unsigned int code;
+	uint32_t mask;
+
+	if (!safe_atou_base(key + strlen("EVDEV_ABS_"), &code, 16) ||
+	    !libevdev_has_event_code(evdev, EV_ABS, code))
+		return;
+
+	mask = parse_evdev_abs_prop(value, &abs);
+	if (mask & ABS_MASK_MIN)
+		libevdev_set_abs_minimum(evdev, code, abs.minimum);
+	if (mask & ABS_MASK_MAX)
+		libevdev_set_abs_maximum(evdev, code, abs.maximum);
+	if (mask & ABS_MASK_RES)
+		libevdev_set_abs_resolution(evdev, code, abs.resolution);
+	if (mask & ABS_MASK_FUZZ)
+		libevdev_set_abs_fuzz(evdev, code, abs.fuzz);
+	if (mask & ABS_MASK_FLAT)
+		libevdev_set_abs_flat(evdev, code, abs.flat);
+}
+
+/* The device types as udev's input_id builtin assigns them, as far as
+ * libinput cares */
+static void
+litest_virtual_classify(struct libevdev *evdev,
+			char **properties,
+			size_t *nprops)
+{
+	bool has_abs = libevdev_has_event_code(evdev, EV_ABS, ABS_X) &&
+		       libevdev_has_event_code(evdev, EV_ABS, ABS_Y);
+	bool has_mt = libevdev_has_event_code(evdev, EV_ABS, ABS_MT_POSITION_X) &&
+		      libevdev_has_event_code(evdev, EV_ABS, ABS_MT_POSITION_Y);
+	bool has_rel = libevdev_has_event_code(evdev, EV_REL, REL_X) &&
+		       libevdev_has_event_code(evdev, EV_REL, REL_Y);
+	bool is_tablet = libevdev_has_event_code(evdev, EV_KEY, BTN_STYLUS) ||
+			 libevdev_has_event_code(evdev, EV_KEY, BTN_TOOL_PEN);
+	bool is_direct = libevdev_has_property(evdev, INPUT_PROP_DIRECT);
+	bool finger_but_no_pen = libevdev_has_event_code(evdev, EV_KEY, BTN_TOOL_FINGER) &&
+				 !libevdev_has_event_code(evdev, EV_KEY, BTN_TOOL_PEN);
+	bool has_mouse_button = libevdev_has_event_code(evdev, EV_KEY, BTN_LEFT) ||
+				libevdev_has_event_code(evdev, EV_KEY, BTN_RIGHT) ||
+				libevdev_has_event_code(evdev, EV_KEY, BTN_MIDDLE);
+	bool has_touch = libevdev_has_event_code(evdev, EV_KEY, BTN_TOUCH);
+	bool has_joystick_button = false;
+	bool has_key = false, is_keyboard = true;
+	bool is_touchpad = false, is_touchscreen = false, is_mouse = false;
+	unsigned int code;
+
+	if (libevdev_has_property(evdev, INPUT_PROP_ACCELEROMETER)) {
+		litest_virtual_property_append(properties, nprops,
+					       "ID_INPUT_ACCELEROMETER=1");
+		return;
+	}
+
+	for (code = BTN_JOYSTICK; code < BTN_DIGI; code++)
+		has_joystick_button |= libevdev_has_event_code(evdev, EV_KEY, code);
+	for (code = KEY_ESC; code < BTN_MISC; code++)
+		has_key |= libevdev_has_event_code(evdev, EV_KEY, code);
+	for (code = KEY_OK; code < BTN_TRIGGER_HAPPY; code++)
+		has_key |= libevdev_has_event_code(evdev, EV_KEY, code);
+	for (code = KEY_ESC; code <= KEY_D; code++)
+		is_keyboard &= libevdev_has_event_code(evdev, EV_KEY, code);
+
+	if (has_abs) {
+		if (is_tablet)
+			litest_virtual_property_append(properties, nprops,
+						       "ID_INPUT_TABLET=1");
+		else if (finger_but_no_pen && !is_direct)
+			is_touchpad = true;
+		else if (has_mouse_button)
+			is_mouse = true;
+		else if (has_touch || is_direct)
+			is_touchscreen = true;
+		else if (has_joystick_button)
+			litest_virtual_property_append(properties, nprops,
+						       "ID_INPUT_JOYSTICK=1");
+	} else if (has_mt) {
+		if (finger_but_no_pen && !is_direct)
+			is_touchpad = true;
+		else if (has_touch || is_direct)
+			is_touchscreen = true;
+	}
+
+	if (has_rel && has_mouse_button)
+		is_mouse = true;
+
+	if (is_touchpad)
+		litest_virtual_property_append(properties, nprops,
+					       "ID_INPUT_TOUCHPAD=1");
+	if (is_touchscreen)
+		litest_virtual_property_append(properties, nprops,
+					       "ID_INPUT_TOUCHSCREEN=1");
+	if (is_mouse)
+		litest_virtual_property_append(properties, nprops,
+					       "ID_INPUT_MOUSE=1");
+	if (libevdev_has_property(evdev, INPUT_PROP_POINTING_STICK))
+		litest_virtual_property_append(properties, nprops,
+					       "ID_INPUT_POINTINGSTICK=1");
+	if (has_key)
+		litest_virtual_property_append(properties, nprops,
+					       "ID_INPUT_KEY=1");
+	if (is_keyboard)
+		litest_virtual_property_append(properties, nprops,
+					       "ID_INPUT_KEYBOARD=1");
+	if (libevdev_has_event_type(evdev, EV_SW))
+		litest_virtual_property_append(properties, nprops,
+					       "ID_INPUT_SWITCH=1");
+}
+
+/**
+ * The properties udev would assign to the uinput device: the device's
+ * own litest rules, the input_id classification and the fuzz override.
+ * Like the keyboard builtin and the fuzz override, this modifies the
+ * device's absinfo.
+ */
+static char **
+litest_virtual_device_properties(struct litest_device *d)
+{
+	struct litest_test_device *dev;
+	struct libevdev *evdev = d->evdev;
+	char **properties;
+	size_t nprops = 0;
+	char prefix[256];
+	const char *str;
+	unsigned int axes[] = { ABS_X, ABS_Y,
+				ABS_MT_POSITION_X, ABS_MT_POSITION_Y };
+	unsigned int *code;
+
+	properties = zalloc(LITEST_VIRTUAL_MAX_PROPERTIES * sizeof(*properties));
+
+	/* Same match as in litest_init_device_udev_rules() */
+	list_for_each(dev, &devices, node) {
+		const struct key_value_str *kv;
+
+		if (dev->type != d->which)
+			continue;
+
+		snprintf(prefix, sizeof(prefix), "litest %s", dev->name);
+		if (!strstartswith(libevdev_get_name(evdev), prefix))
+			break;
+
+		for (kv = dev->udev_properties; kv->key; kv++) {
+			litest_virtual_property_append(properties, &nprops,
+						       "%s=%s",
+						       kv->key, kv->value);
+			if (strneq(kv->key, "EVDEV_ABS_", 10))
+				litest_virtual_apply_evdev_abs(evdev,
+							       kv->key,
+							       kv->value);
+		}
+		break;
+	}
+
+	litest_virtual_property_append(properties, &nprops, "ID_INPUT=1");
+	litest_virtual_classify(evdev, properties, &nprops);
+	litest_virtual_property_append(properties, &nprops,
+				       "LIBINPUT_TEST_DEVICE=1");
+	litest_virtual_property_append(properties, &nprops,
+				       "NAME=\"%s\"",
+				       libevdev_get_name(evdev));
+	litest_virtual_property_append(properties, &nprops,
+				       "PRODUCT=%x/%x/%x/%x",
+				       libevdev_get_id_bustype(evdev),
+				       libevdev_get_id_vendor(evdev),
+				       libevdev_get_id_product(evdev),
+				       libevdev_get_id_version(evdev));
+
+	/* see 90-libinput-fuzz-override.rules */
+	str = strv_find_value(properties, "ID_INPUT_TOUCHPAD");
+	if (!str || !streq(str, "1"))
+		str = strv_find_value(properties, "ID_INPUT_TOUCHSCREEN");
+	if (str && streq(str, "1")) {
+		ARRAY_FOR_EACH(axes, code) {
+			int fuzz;
+
+			if (!libevdev_has_event_code(evdev, EV_ABS, *code))
+				continue;
+
+			fuzz = libevdev_get_abs_fuzz(evdev, *code);
+			if (fuzz == 0)
+				continue;
+
+			litest_virtual_property_append(properties, &nprops,
+						       "LIBINPUT_FUZZ_%02x=%d",
+						       *code, fuzz);
+			libevdev_set_abs_fuzz(evdev, *code, 0);
+		}
+	}
+
+	return properties;
+}
+
+static void
+litest_add_virtual_device(struct libinput *libinput,
+			  struct litest_device *d)
+{
+	static unsigned int count;
+	char sysname[64];
+	char **properties;
+
+	snprintf(sysname, sizeof(sysname), "litest%u", count++);
+	properties = litest_virtual_device_properties(d);
+
+	d->libinput = libinput;
+	d->libinput_device = path_add_virtual_device(libinput,
+						     litest_copy_libevdev(d->evdev),
+						     sysname,
+						     properties);
+	litest_assert_ptr_notnull(d->libinput_device);
+	d->quirks = quirks_fetch_for_properties(quirks_context,
+						sysname,
+						properties);
+	d->properties = properties;
+}
+
 struct litest_device *
 litest_add_device_with_overrides(struct libinput *libinput,
 				 enum litest_device_type which,
@@ -1780,15 +2110,20 @@ litest_add_device_with_overrides(struct libinput *libinput,
 			  abs_override,
 			  events_override);
 
-	path = libevdev_uinput_get_devnode(d->uinput);
-	litest_assert_ptr_notnull(path);
-
-	d->libinput = libinput;
-	d->libinput_device = libinput_path_add_device(d->libinput, path);
-	litest_assert_ptr_notnull(d->libinput_device);
-	ud = libinput_device_get_udev_device(d->libinput_device);
-	d->quirks = quirks_fetch_for_device(quirks_context, ud);
-	udev_device_unref(ud);
+	/* Devices with a custom create method may still use uinput */
+	if (!d->uinput) {
+		litest_add_virtual_device(libinput, d);
+	} else {
+		path = libevdev_uinput_get_devnode(d->uinput);
+		litest_assert_ptr_notnull(path);
+
+		d->libinput = libinput;
+		d->libinput_device = libinput_path_add_device(d->libinput, path);
+		litest_assert_ptr_notnull(d->libinput_device);
+		ud = libinput_device_get_udev_device(d->libinput_device);
+		d->quirks = quirks_fetch_for_device(quirks_context, ud);
+		udev_device_unref(ud);
+	}
 
 	libinput_device_ref(d->libinput_device);
 
@@ -1910,17 +2245,19 @@ void
 litest_delete_device(struct litest_device *d)
 {
 
-	struct udev_monitor *udev_monitor;
+	struct udev_monitor *udev_monitor = NULL;
 	struct udev_device *udev_device;
 	char path[PATH_MAX];
 
 	if (!d)
 		return;
 
-	udev_monitor = udev_setup_monitor();
-	snprintf(path, sizeof(path),
-		 "%s/event",
-		 libevdev_uinput_get_syspath(d->uinput));
+	if (d->uinput) {
+		udev_monitor = udev_setup_monitor();
+		snprintf(path, sizeof(path),
+			 "%s/event",
+			 libevdev_uinput_get_syspath(d->uinput));
+	}
 
 	litest_assert_int_eq(d->skip_ev_syn, 0);
 
@@ -1934,13 +2271,18 @@ litest_delete_device(struct litest_device *d)
 		libinput_dispatch(d->libinput);
 		litest_destroy_context(d->libinput);
 	}
-	close(libevdev_get_fd(d->evdev));
+	if (d->uinput)
+		close(libevdev_get_fd(d->evdev));
 	libevdev_free(d->evdev);
 	libevdev_uinput_destroy(d->uinput);
+	strv_free(d->properties);
 	free(d->private);
 	memset(d,0, sizeof(*d));
 	free(d);
 
+	if (!udev_monitor)
+		return;
+
 	udev_device = udev_wait_for_device_event(udev_monitor,
 						 "remove",
 						 path);
@@ -1948,6 +2290,135 @@ litest_delete_device(struct litest_device *d)
 	udev_monitor_unref(udev_monitor);
 }
 
+static void
+litest_virtual_queue_event(struct litest_device *d,
+			   unsigned int type,
+			   unsigned int code,
+			   int value)
+{
+	struct input_event *ev;
+
+	litest_assert_int_lt(d->frame.nevents, ARRAY_LENGTH(d->frame.events));
+
+	ev = &d->frame.events[d->frame.nevents++];
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+}
+
+static inline int
+litest_virtual_defuzz(int value, int old, int fuzz)
+{
+	if (fuzz) {
+		if (value > old - fuzz / 2 && value < old + fuzz / 2)
+			return old;
+
+		if (value > old - fuzz && value < old + fuzz)
+			return (old * 3 + value) / 4;
+
+		if (value > old - fuzz * 2 && value < old + fuzz * 2)
+			return (old + value) / 2;
+	}
+
+	return value;
+}
+
+/**
+ * Virtual devices get what the kernel's input core would pass on to the
+ * event node: unchanged values and empty frames are dropped, the fuzz
+ * is applied and ABS_MT_SLOT is only sent ahead of a slot's changed
+ * values. The frame goes to libinput on SYN_REPORT.
+ */
+static void
+litest_virtual_event(struct litest_device *d,
+		     unsigned int type,
+		     unsigned int code,
+		     int value)
+{
+	struct libevdev *evdev = d->evdev;
+	bool is_mt_event, is_slot_event;
+	uint64_t now;
+	int old;
+
+	switch (type) {
+	case EV_SYN:
+		if (code != SYN_REPORT)
+			break;
+
+		if (d->frame.nevents == 0 || !d->libinput_device)
+			return;
+
+		litest_virtual_queue_event(d, type, code, value);
+		now = libinput_now(d->libinput);
+		for (size_t i = 0; i < d->frame.nevents; i++)
+			input_event_set_time(&d->frame.events[i], now);
+		evdev_device_inject_frame(evdev_device(d->libinput_device),
+					  d->frame.events,
+					  d->frame.nevents);
+		d->frame.nevents = 0;
+		return;
+	case EV_KEY:
+	case EV_SW:
+		old = libevdev_get_event_value(evdev, type, code);
+		/* key repeat is only passed on for keys that are down */
+		if (type == EV_KEY && value == 2) {
+			if (!old)
+				return;
+		} else if (old == !!value) {
+			return;
+		}
+		libevdev_set_event_value(evdev, type, code, !!value);
+		break;
+	case EV_REL:
+		if (value == 0)
+			return;
+		break;
+	case EV_ABS:
+		if (code == ABS_MT_SLOT) {
+			d->frame.slot = value;
+			return;
+		}
+
+		is_mt_event = code >= ABS_MT_TOUCH_MAJOR &&
+			      code <= ABS_MT_TOOL_Y;
+		is_slot_event = is_mt_event &&
+				libevdev_get_num_slots(evdev) > 0;
+
+		/* protocol A values are passed on as-is */
+		if (is_mt_event && !is_slot_event)
+			break;
+
+		if (is_slot_event)
+			old = libevdev_get_slot_value(evdev, d->frame.slot, code);
+		else
+			old = libevdev_get_event_value(evdev, type, code);
+
+		value = litest_virtual_defuzz(value,
+					      old,
+					      libevdev_get_abs_fuzz(evdev, code));
+		if (value == old)
+			return;
+
+		if (is_slot_event) {
+			libevdev_set_slot_value(evdev, d->frame.slot, code, value);
+			if (d->frame.slot != d->frame.last_slot) {
+				litest_virtual_queue_event(d,
+							   EV_ABS,
+							   ABS_MT_SLOT,
+							   d->frame.slot);
+				d->frame.last_slot = d->frame.slot;
+			}
+		} else {
+			libevdev_set_event_value(evdev, type, code, value);
+		}
+		break;
+	default:
+		break;
+	}
+
+	litest_virtual_queue_event(d, type, code, value);
+}
+
 void
 litest_event(struct litest_device *d, unsigned int type,
 	     unsigned int code, int value)
@@ -1960,6 +2431,11 @@ litest_event(struct litest_device *d, unsigned int type,
 	if (d->skip_ev_syn && type == EV_SYN && code == SYN_REPORT)
 		return;
 
+	if (!d->uinput) {
+		litest_virtual_event(d, type, code, value);
+		return;
+	}
+
 	ret = libevdev_uinput_write_event(d->uinput, type, code, value);
 	litest_assert_int_eq(ret, 0);
 }
@@ -2390,7 +2866,7 @@ litest_touch_move_to_extended(struct litest_device *d,
 					   y_from + (y_to - y_from)/steps * i,
 					   axes);
 		libinput_dispatch(d->libinput);
-		msleep(sleep_ms);
+		litest_sleep_ms(sleep_ms);
 		libinput_dispatch(d->libinput);
 	}
 	litest_touch_move_extended(d, slot, x_to, y_to, axes);
@@ -2557,7 +3033,7 @@ litest_touch_move_two_touches(struct litest_device *d,
 					y1 + dy / steps * i);
 		litest_pop_event_frame(d);
 		libinput_dispatch(d->libinput);
-		msleep(sleep_ms);
+		litest_sleep_ms(sleep_ms);
 		libinput_dispatch(d->libinput);
 	}
 	litest_push_event_frame(d);
@@ -2587,7 +3063,7 @@ litest_touch_move_three_touches(struct litest_device *d,
 		litest_pop_event_frame(d);
 
 		libinput_dispatch(d->libinput);
-		msleep(sleep_ms);
+		litest_sleep_ms(sleep_ms);
 	}
 	libinput_dispatch(d->libinput);
 }
@@ -2666,7 +3142,7 @@ litest_hover_move_to(struct litest_device *d,
 				  x_from + (x_to - x_from)/steps * i,
 				  y_from + (y_to - y_from)/steps * i);
 		libinput_dispatch(d->libinput);
-		msleep(sleep_ms);
+		litest_sleep_ms(sleep_ms);
 		libinput_dispatch(d->libinput);
 	}
 	litest_hover_move(d, slot, x_to, y_to);
@@ -2689,7 +3165,7 @@ litest_hover_move_two_touches(struct litest_device *d,
 					y1 + dy / steps * i);
 		litest_pop_event_frame(d);
 		libinput_dispatch(d->libinput);
-		msleep(sleep_ms);
+		litest_sleep_ms(sleep_ms);
 		libinput_dispatch(d->libinput);
 	}
 	litest_push_event_frame(d);
@@ -2975,6 +3451,7 @@ litest_wait_for_event_of_type(struct libinput *li, ...)
 	size_t ntypes = 0;
 	enum libinput_event_type type;
 	struct pollfd fds;
+	int waited = 0;
 
 	va_start(args, li);
 	type = va_arg(args, int);
@@ -2995,7 +3472,18 @@ litest_wait_for_event_of_type(struct libinput *li, ...)
 		struct libinput_event *event;
 
 		while ((type = libinput_next_event_type(li)) == LIBINPUT_EVENT_NONE) {
-			int rc = poll(&fds, 1, 2000);
+			int rc;
+
+			/* Nothing but a timer can make an event show up
+			 * here, wait for it in 1ms steps */
+			if (use_virtual_clock) {
+				litest_assert_int_lt(waited++, 2000);
+				litest_sleep_ms(1);
+				libinput_dispatch(li);
+				continue;
+			}
+
+			rc = poll(&fds, 1, 2000);
 			litest_assert_int_gt(rc, 0);
 			libinput_dispatch(li);
 		}
@@ -3301,16 +3789,15 @@ litest_assert_empty_queue(struct libinput *li)
 	litest_assert(empty_queue);
 }
 
-static struct libevdev_uinput *
-litest_create_uinput(const char *name,
-		     const struct input_id *id,
-		     const struct input_absinfo *abs_info,
-		     const int *events)
+struct libevdev *
+litest_create_libevdev(const char *name,
+		       const struct input_id *id,
+		       const struct input_absinfo *abs_info,
+		       const int *events)
 {
-	struct libevdev_uinput *uinput;
 	struct libevdev *dev;
 	int type, code;
-	int rc, fd;
+	int rc;
 	const struct input_absinfo *abs;
 	const struct input_absinfo default_abs = {
 		.value = 0,
@@ -3321,7 +3808,6 @@ litest_create_uinput(const char *name,
 		.resolution = 100
 	};
 	char buf[512];
-	const char *devnode;
 
 	dev = libevdev_new();
 	litest_assert_ptr_notnull(dev);
@@ -3359,6 +3845,23 @@ litest_create_uinput(const char *name,
 		litest_assert_int_eq(rc, 0);
 	}
 
+	return dev;
+}
+
+static struct libevdev_uinput *
+litest_create_uinput(const char *name,
+		     const struct input_id *id,
+		     const struct input_absinfo *abs_info,
+		     const int *events)
+{
+	struct libevdev_uinput *uinput;
+	struct libevdev *dev;
+	int rc, fd;
+	const struct input_absinfo *abs;
+	const char *devnode;
+
+	dev = litest_create_libevdev(name, id, abs_info, events);
+
 	rc = libevdev_uinput_create_from_device(dev,
 					        LIBEVDEV_UINPUT_OPEN_MANAGED,
 						&uinput);
@@ -4065,100 +4568,174 @@ litest_assert_touch_cancel(struct libinput *li)
 	libinput_event_destroy(event);
 }
 
+/**
+ * Wait for ms. With --virtual-clock, the pending events are processed
+ * and the clock of all contexts moves forward by ms instead, firing the
+ * timers that expire until then.
+ */
+void
+litest_sleep_ms(unsigned int ms)
+{
+	struct litest_context *ctx;
+
+	if (!use_virtual_clock) {
+		msleep(ms);
+		return;
+	}
+
+	/* The events already written happened before the sleep, with the
+	 * real clock they'd have the kernel's timestamp from back then */
+	list_for_each(ctx, &litest_contexts, link) {
+		libinput_dispatch(ctx->libinput);
+		ctx->now += ms2us(ms);
+		libinput_clock_advance(ctx->libinput, ctx->now);
+	}
+}
+
+/**
+ * @return true if the test suite runs with --virtual-clock. Tests that
+ * depend on the real time passing are not registered in that case.
+ */
+bool
+litest_has_virtual_clock(void)
+{
+	return use_virtual_clock;
+}
+
+/**
+ * @return true if the test suite runs with --virtual-devices. Tests
+ * that need uinput, a device node or udev are not registered in that
+ * case.
+ */
+bool
+litest_has_virtual_devices(void)
+{
+	return use_virtual_devices;
+}
+
+/**
+ * Look up one of the device's udev properties. With --virtual-devices
+ * the device has no udev device, these are the properties litest
+ * assigned to it instead.
+ *
+ * @return a newly allocated copy of the value or NULL
+ */
+char *
+litest_device_get_property(struct litest_device *d, const char *key)
+{
+	struct udev_device *ud;
+	const char *value;
+	char *copy = NULL;
+
+	if (!d->uinput) {
+		value = strv_find_value(d->properties, key);
+		return value ? safe_strdup(value) : NULL;
+	}
+
+	ud = libinput_device_get_udev_device(d->libinput_device);
+	litest_assert_ptr_notnull(ud);
+	value = udev_device_get_property_value(ud, key);
+	if (value)
+		copy = safe_strdup(value);
+	udev_device_unref(ud);
+
+	return copy;
+}
+
 void
 litest_timeout_tap(void)
 {
-	msleep(300);
+	litest_sleep_ms(300);
 }
 
 void
 litest_timeout_tapndrag(void)
 {
-	msleep(520);
+	litest_sleep_ms(520);
 }
 
 void
 litest_timeout_debounce(void)
 {
-	msleep(30);
+	litest_sleep_ms(30);
 }
 
 void
 litest_timeout_softbuttons(void)
 {
-	msleep(300);
+	litest_sleep_ms(300);
 }
 
 void
 litest_timeout_buttonscroll(void)
 {
-	msleep(300);
+	litest_sleep_ms(300);
 }
 
 void
 litest_timeout_finger_switch(void)
 {
-	msleep(120);
+	litest_sleep_ms(120);
 }
 
 void
 litest_timeout_edgescroll(void)
 {
-	msleep(300);
+	litest_sleep_ms(300);
 }
 
 void
 litest_timeout_middlebutton(void)
 {
-	msleep(70);
+	litest_sleep_ms(70);
 }
 
 void
 litest_timeout_dwt_short(void)
 {
-	msleep(220);
+	litest_sleep_ms(220);
 }
 
 void
 litest_timeout_dwt_long(void)
 {
-	msleep(520);
+	litest_sleep_ms(520);
 }
 
 void
 litest_timeout_gesture(void)
 {
-	msleep(120);
+	litest_sleep_ms(120);
 }
 
 void
 litest_timeout_gesture_scroll(void)
 {
-	msleep(180);
+	litest_sleep_ms(180);
 }
 
 void
 litest_timeout_trackpoint(void)
 {
-	msleep(320);
+	litest_sleep_ms(320);
 }
 
 void
 litest_timeout_tablet_proxout(void)
 {
-	msleep(170);
+	litest_sleep_ms(170);
 }
 
 void
 litest_timeout_touch_arbitration(void)
 {
-	msleep(100);
+	litest_sleep_ms(100);
 }
 
 void
 litest_timeout_hysteresis(void)
 {
-	msleep(90);
+	litest_sleep_ms(90);
 }
 
 void
@@ -4356,6 +4933,8 @@ litest_parse_argv(int argc, char **argv)
 		OPT_JOBS,
 		OPT_LIST,
 		OPT_VERBOSE,
+		OPT_VIRTUAL_CLOCK,
+		OPT_VIRTUAL_DEVICES,
 	};
 	static const struct option opts[] = {
 		{ "filter-test", 1, 0, OPT_FILTER_TEST },
@@ -4366,6 +4945,8 @@ litest_parse_argv(int argc, char **argv)
 		{ "jobs", 1, 0, OPT_JOBS },
 		{ "list", 0, 0, OPT_LIST },
 		{ "verbose", 0, 0, OPT_VERBOSE },
+		{ "virtual-clock", 0, 0, OPT_VIRTUAL_CLOCK },
+		{ "virtual-devices", 0, 0, OPT_VIRTUAL_DEVICES },
 		{ "help", 0, 0, 'h'},
 		{ 0, 0, 0, 0}
 	};
@@ -4426,6 +5007,11 @@ litest_parse_argv(int argc, char **argv)
 			       "	  This overrides the LITEST_JOBS environment variable.\n"
 			       "    --list\n"
 			       "          List all tests\n"
+			       "    --virtual-clock\n"
+			       "          Move libinput's clock forward instead of sleeping\n"
+			       "    --virtual-devices\n"
+			       "          Feed the events to libinput directly instead of\n"
+			       "          through uinput, does not need root\n"
 			       "\n"
 			       "See the libinput-test-suite(1) man page for details.\n",
 			       program_invocation_short_name);
@@ -4457,6 +5043,12 @@ litest_parse_argv(int argc, char **argv)
 		case OPT_VERBOSE:
 			verbose = true;
 			break;
+		case OPT_VIRTUAL_CLOCK:
+			use_virtual_clock = true;
+			break;
+		case OPT_VIRTUAL_DEVICES:
+			use_virtual_devices = true;
+			break;
 		case OPT_FILTER_DEVICELESS:
 			run_deviceless = true;
 			break;
@@ -4578,6 +5170,7 @@ disable_tty(void)
 	 * without forking, leave it as-is.
 	 */
 	if (!run_deviceless &&
+	    !use_virtual_devices &&
 	    jobs > 1 &&
 	    !in_debugger &&
 	    getenv("CK_FORK") == NULL &&
@@ -4630,7 +5223,9 @@ main(int argc, char **argv)
 		return EXIT_SUCCESS;
 	}
 
-	if (!run_deviceless && (rc = check_device_access()) != 0)
+	if (!run_deviceless &&
+	    !use_virtual_devices &&
+	    (rc = check_device_access()) != 0)
 		return rc;
 
 	setenv("CK_DEFAULT_TIMEOUT", "30", 0);
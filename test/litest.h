@@ -319,8 +319,15 @@ enum litest_device_type {
 	LITEST_KEYBOARD_QUIRKED,
 	LITEST_SYNAPTICS_PRESSUREPAD,
 	LITEST_GENERIC_PRESSUREPAD,
+	LITEST_WACOM_INTUOS5_PAD_LEDS,
+	LITEST_GENERIC_ADAPTIVE_PEN,
 };
 
+/* The LITEST_WACOM_INTUOS5_PAD_LEDS mode LEDs are read from
+ * LITEST_PAD_LED_DIR/input0::wacom-<group>.<mode>/brightness, the
+ * test needs to create those before adding the device */
+#define LITEST_PAD_LED_DIR	"/tmp/litest-intuos5-pad-leds"
+
 #define LITEST_DEVICELESS	-2
 #define LITEST_DISABLE_DEVICE	-1
 #define LITEST_ANY		0
@@ -389,6 +396,15 @@ struct litest_device {
 	int skip_ev_syn;
 	struct litest_semi_mt semi_mt; /** only used for semi-mt device */
 
+	/* only used for devices without uinput, see --virtual-devices */
+	char **properties;
+	struct {
+		struct input_event events[256];
+		size_t nevents;
+		int slot;
+		int last_slot;
+	} frame;
+
 	void *private; /* device-specific data */
 };
 
@@ -504,6 +520,11 @@ litest_create_uinput_device_from_description(const char *name,
 					     const struct input_id *id,
 					     const struct input_absinfo *abs,
 					     const int *events);
+struct libevdev *
+litest_create_libevdev(const char *name,
+		       const struct input_id *id,
+		       const struct input_absinfo *abs_info,
+		       const int *events);
 struct litest_device *
 litest_create(enum litest_device_type which,
 	      const char *name_override,
@@ -856,6 +877,18 @@ litest_create_uinput_abs_device(const char *name,
 				const struct input_absinfo *abs,
 				...);
 
+void
+litest_sleep_ms(unsigned int ms);
+
+bool
+litest_has_virtual_clock(void);
+
+bool
+litest_has_virtual_devices(void);
+
+char *
+litest_device_get_property(struct litest_device *d, const char *key);
+
 void
 litest_timeout_tap(void);
 
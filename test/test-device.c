@@ -1697,6 +1697,143 @@ START_TEST(device_button_down_remove)
 }
 END_TEST
 
+static uint64_t
+latency_histogram_total(struct libinput_device *device,
+			enum libinput_latency_stage stage,
+			enum libinput_event_type type)
+{
+	uint64_t counts[64] = {0};
+	uint64_t total = 0;
+	size_t nbuckets;
+
+	nbuckets = libinput_device_get_latency_histogram(device,
+							 stage,
+							 type,
+							 counts,
+							 ARRAY_LENGTH(counts));
+	litest_assert_int_gt(nbuckets, 0);
+	litest_assert_int_le(nbuckets, ARRAY_LENGTH(counts));
+
+	for (size_t i = 0; i < nbuckets; i++)
+		total += counts[i];
+
+	return total;
+}
+
+START_TEST(device_latency_histogram)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	uint64_t nmotion = 0;
+
+	litest_drain_events(li);
+	libinput_device_reset_latency_histograms(device);
+
+	ck_assert_int_gt(libinput_device_get_latency_histogram(device,
+							       LIBINPUT_LATENCY_STAGE_READ,
+							       LIBINPUT_EVENT_NONE,
+							       NULL,
+							       0),
+			 0);
+
+	for (int i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 5);
+		litest_event(dev, EV_REL, REL_Y, 5);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_POINTER_MOTION)
+			nmotion++;
+		libinput_event_destroy(event);
+	}
+	ck_assert_int_gt(nmotion, 0);
+
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_LATENCY_STAGE_READ,
+						 LIBINPUT_EVENT_NONE),
+			 5);
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_LATENCY_STAGE_READ,
+						 LIBINPUT_EVENT_POINTER_MOTION),
+			 0);
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_LATENCY_STAGE_QUEUED,
+						 LIBINPUT_EVENT_POINTER_MOTION),
+			 nmotion);
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_LATENCY_STAGE_DELIVERED,
+						 LIBINPUT_EVENT_POINTER_MOTION),
+			 nmotion);
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_LATENCY_STAGE_DELIVERED,
+						 LIBINPUT_EVENT_NONE),
+			 nmotion);
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_LATENCY_STAGE_DELIVERED,
+						 LIBINPUT_EVENT_KEYBOARD_KEY),
+			 0);
+
+	libinput_device_reset_latency_histograms(device);
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_LATENCY_STAGE_READ,
+						 LIBINPUT_EVENT_NONE),
+			 0);
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_LATENCY_STAGE_DELIVERED,
+						 LIBINPUT_EVENT_POINTER_MOTION),
+			 0);
+}
+END_TEST
+
+START_TEST(device_latency_histogram_suspend)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	enum libinput_config_status status;
+	uint64_t nkeys = 0;
+
+	litest_keyboard_key(dev, KEY_A, true);
+	litest_drain_events(li);
+	libinput_device_reset_latency_histograms(device);
+
+	/* The key release is queued by the config call, not by
+	 * libinput_dispatch() */
+	status = libinput_device_config_send_events_set_mode(device,
+			     LIBINPUT_CONFIG_SEND_EVENTS_DISABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) ==
+		    LIBINPUT_EVENT_KEYBOARD_KEY)
+			nkeys++;
+		libinput_event_destroy(event);
+	}
+	ck_assert_int_eq(nkeys, 1);
+
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_LATENCY_STAGE_QUEUED,
+						 LIBINPUT_EVENT_KEYBOARD_KEY),
+			 nkeys);
+	ck_assert_int_eq(latency_histogram_total(device,
+						 LIBINPUT_LATENCY_STAGE_DELIVERED,
+						 LIBINPUT_EVENT_KEYBOARD_KEY),
+			 nkeys);
+
+	status = libinput_device_config_send_events_set_mode(device,
+			     LIBINPUT_CONFIG_SEND_EVENTS_ENABLED);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	litest_keyboard_key(dev, KEY_A, false);
+	litest_drain_events(li);
+}
+END_TEST
+
 TEST_COLLECTION(device)
 {
 	struct range abs_range = { 0, ABS_MISC };
@@ -1729,31 +1866,40 @@ TEST_COLLECTION(device)
 	litest_add_for_device(device_context, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device(device_user_data, LITEST_SYNAPTICS_CLICKPAD_X220);
 
-	litest_add(device_get_udev_handle, LITEST_ANY, LITEST_ANY);
+	if (!litest_has_virtual_devices())
+		litest_add(device_get_udev_handle, LITEST_ANY, LITEST_ANY);
 
 	litest_add(device_group_get, LITEST_ANY, LITEST_ANY);
 	litest_add_no_device(device_group_ref);
-	litest_add_no_device(device_group_leak);
-
-	litest_add_no_device(abs_device_no_absx);
-	litest_add_no_device(abs_device_no_absy);
-	litest_add_no_device(abs_mt_device_no_absx);
-	litest_add_no_device(abs_mt_device_no_absy);
+	if (!litest_has_virtual_devices())
+		litest_add_no_device(device_group_leak);
+
+	if (!litest_has_virtual_devices()) {
+		litest_add_no_device(abs_device_no_absx);
+		litest_add_no_device(abs_device_no_absy);
+		litest_add_no_device(abs_mt_device_no_absx);
+		litest_add_no_device(abs_mt_device_no_absy);
+	}
 	litest_add_ranged_no_device(abs_device_no_range, &abs_range);
 	litest_add_ranged_no_device(abs_mt_device_no_range, &abs_mt_range);
 	litest_add_no_device(abs_device_missing_res);
 	litest_add_no_device(abs_mt_device_missing_res);
-	litest_add_no_device(ignore_joystick);
+	if (!litest_has_virtual_devices())
+		litest_add_no_device(ignore_joystick);
 
 	litest_add(device_wheel_only, LITEST_WHEEL, LITEST_RELATIVE|LITEST_ABSOLUTE|LITEST_TABLET);
-	litest_add_no_device(device_accelerometer);
+	if (!litest_has_virtual_devices())
+		litest_add_no_device(device_accelerometer);
 
-	litest_add(device_udev_tag_wacom_tablet, LITEST_TABLET, LITEST_TOTEM);
+	if (!litest_has_virtual_devices())
+		litest_add(device_udev_tag_wacom_tablet, LITEST_TABLET, LITEST_TOTEM);
 
-	litest_add_no_device(device_nonpointer_rel);
-	litest_add_no_device(device_touchpad_rel);
-	litest_add_no_device(device_touch_rel);
-	litest_add_no_device(device_abs_rel);
+	if (!litest_has_virtual_devices()) {
+		litest_add_no_device(device_nonpointer_rel);
+		litest_add_no_device(device_touchpad_rel);
+		litest_add_no_device(device_touch_rel);
+		litest_add_no_device(device_abs_rel);
+	}
 
 	litest_add_for_device(device_quirks_no_abs_mt_y, LITEST_ANKER_MOUSE_KBD);
 	litest_add_for_device(device_quirks_cyborg_rat_mode_button, LITEST_CYBORG_RAT);
@@ -1763,7 +1909,8 @@ TEST_COLLECTION(device)
 
 	litest_add(device_capability_at_least_one, LITEST_ANY, LITEST_ANY);
 	litest_add(device_capability_check_invalid, LITEST_ANY, LITEST_ANY);
-	litest_add_no_device(device_capability_nocaps_ignored);
+	if (!litest_has_virtual_devices())
+		litest_add_no_device(device_capability_nocaps_ignored);
 
 	litest_add(device_has_size, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add(device_has_size, LITEST_TABLET, LITEST_ANY);
@@ -1777,4 +1924,7 @@ TEST_COLLECTION(device)
 	litest_add(device_seat_phys_name, LITEST_ANY, LITEST_ANY);
 
 	litest_add(device_button_down_remove, LITEST_BUTTON, LITEST_ANY);
+
+	litest_add_for_device(device_latency_histogram, LITEST_MOUSE);
+	litest_add_for_device(device_latency_histogram_suspend, LITEST_KEYBOARD);
 }
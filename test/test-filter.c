@@ -0,0 +1,160 @@
+/*
+ * Copyright © 2021 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <check.h>
+#include <math.h>
+
+#include "filter.h"
+#include "filter-private.h"
+#include "libinput-util.h"
+
+struct profile_test {
+	const char *name;
+	struct motion_filter *(*create)(int dpi, bool use_velocity_averaging);
+	accel_profile_func_t profile;
+	int dpi;
+};
+
+static struct motion_filter *
+create_touchpad(int dpi, bool use_velocity_averaging)
+{
+	return create_pointer_accelerator_filter_touchpad(dpi, 0, 0,
+							  use_velocity_averaging);
+}
+
+static struct motion_filter *
+create_trackpoint(int dpi, bool use_velocity_averaging)
+{
+	return create_pointer_accelerator_filter_trackpoint(1.0,
+							    use_velocity_averaging);
+}
+
+static const struct profile_test profile_tests[] = {
+	{ "mouse", create_pointer_accelerator_filter_linear,
+	  pointer_accel_profile_linear, 1000 },
+	{ "mouse-8000", create_pointer_accelerator_filter_linear,
+	  pointer_accel_profile_linear, 8000 },
+	{ "low-dpi-400", create_pointer_accelerator_filter_linear_low_dpi,
+	  pointer_accel_profile_linear_low_dpi, 400 },
+	{ "low-dpi-200", create_pointer_accelerator_filter_linear_low_dpi,
+	  pointer_accel_profile_linear_low_dpi, 200 },
+	{ "touchpad", create_touchpad,
+	  touchpad_accel_profile_linear, 1000 },
+	{ "x230", create_pointer_accelerator_filter_lenovo_x230,
+	  touchpad_lenovo_x230_accel_profile, 1000 },
+	{ "trackpoint", create_trackpoint,
+	  trackpoint_accel_profile, 0 },
+};
+
+START_TEST(profile_lut_matches_profile)
+{
+	const struct profile_test *t = &profile_tests[_i];
+	double speeds[] = { -1.0, -0.75, -0.5, 0.0, 0.3, 0.5, 1.0 };
+	double *speed;
+
+	ARRAY_FOR_EACH(speeds, speed) {
+		struct motion_filter *filter;
+		double max_velocity;
+
+		filter = t->create(t->dpi, true);
+		ck_assert_notnull(filter);
+		ck_assert(filter_set_speed(filter, *speed));
+		ck_assert_notnull(filter->lut);
+
+		/* sweep past the end of the table, the profile is either
+		 * constant or called directly up there */
+		max_velocity = filter->lut->max_velocity * 2;
+		for (int i = 0; i <= 100000; i++) {
+			double velocity = i * max_velocity/100000;
+			double expected, factor;
+
+			expected = t->profile(filter, NULL, velocity, 0);
+			factor = filter_profile_factor(filter, t->profile,
+						       NULL, velocity, 0);
+			if (fabs(expected - factor) > ACCEL_LUT_TOLERANCE * 2)
+				ck_abort_msg("%s speed %.2f: factor %f for %f units/ms, expected %f",
+					     t->name, *speed, factor,
+					     v_us2ms(velocity), expected);
+		}
+
+		filter_destroy(filter);
+	}
+}
+END_TEST
+
+START_TEST(profile_lut_rebuilt_on_set_speed)
+{
+	struct motion_filter *filter;
+	double velocity = v_ms2us(0.5);
+	double slow, fast;
+
+	filter = create_pointer_accelerator_filter_linear(1000, true);
+	ck_assert(filter_set_speed(filter, -1.0));
+	slow = filter_profile_factor(filter, pointer_accel_profile_linear,
+				     NULL, velocity, 0);
+	ck_assert(filter_set_speed(filter, 1.0));
+	fast = filter_profile_factor(filter, pointer_accel_profile_linear,
+				     NULL, velocity, 0);
+
+	ck_assert_double_gt(fast, slow);
+	ck_assert_double_eq_tol(fast,
+				pointer_accel_profile_linear(filter, NULL, velocity, 0),
+				ACCEL_LUT_TOLERANCE);
+
+	filter_destroy(filter);
+}
+END_TEST
+
+static Suite *
+litest_filter_suite(void)
+{
+	TCase *tc;
+	Suite *s;
+
+	s = suite_create("filter:profile");
+	tc = tcase_create("filter:profile");
+	tcase_add_loop_test(tc, profile_lut_matches_profile,
+			    0, ARRAY_LENGTH(profile_tests));
+	tcase_add_test(tc, profile_lut_rebuilt_on_set_speed);
+	suite_add_tcase(s, tc);
+
+	return s;
+}
+
+int main(int argc, char **argv)
+{
+	int nfailed;
+	Suite *s;
+	SRunner *sr;
+
+	s = litest_filter_suite();
+	sr = srunner_create(s);
+
+	srunner_run_all(sr, CK_ENV);
+	nfailed = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return (nfailed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
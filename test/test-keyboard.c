@@ -479,7 +479,8 @@ END_TEST
 TEST_COLLECTION(keyboard)
 {
 	litest_add_no_device(keyboard_seat_key_count);
-	litest_add_no_device(keyboard_ignore_no_pressed_release);
+	if (!litest_has_virtual_devices())
+		litest_add_no_device(keyboard_ignore_no_pressed_release);
 	litest_add_no_device(keyboard_key_auto_release);
 	litest_add(keyboard_has_key, LITEST_KEYS, LITEST_ANY);
 	litest_add(keyboard_keys_bad_device, LITEST_ANY, LITEST_ANY);
@@ -33,6 +33,7 @@
 
 #include "litest.h"
 #include "libinput-util.h"
+#include "timer.h"
 
 static int open_restricted(const char *path, int flags, void *data)
 {
@@ -581,6 +582,137 @@ START_TEST(config_status_string)
 }
 END_TEST
 
+START_TEST(event_pool_recycling)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t hits, misses;
+
+	litest_drain_events(li);
+
+	for (int i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	ck_assert_int_ge(libinput_event_pool_get_stat(li,
+				LIBINPUT_EVENT_POOL_STAT_HIGH_WATER_MARK),
+			 5);
+	litest_drain_events(li);
+
+	hits = libinput_event_pool_get_stat(li, LIBINPUT_EVENT_POOL_STAT_HITS);
+	misses = libinput_event_pool_get_stat(li, LIBINPUT_EVENT_POOL_STAT_MISSES);
+
+	/* The previous events went back into the pool, so these ones must
+	 * not need any new allocations */
+	for (int i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	ck_assert_int_ge(libinput_event_pool_get_stat(li,
+				LIBINPUT_EVENT_POOL_STAT_HITS),
+			 hits + 5);
+	ck_assert_int_eq(libinput_event_pool_get_stat(li,
+				LIBINPUT_EVENT_POOL_STAT_MISSES),
+			 misses);
+}
+END_TEST
+
+START_TEST(event_get_batch)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *events[4];
+	size_t count, total = 0;
+
+	litest_drain_events(li);
+
+	/* Move the ring buffer's read position so the batch wraps around */
+	for (int round = 0; round < 3; round++) {
+		for (int i = 0; i < 10; i++) {
+			litest_event(dev, EV_REL, REL_X, 1);
+			litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		}
+		libinput_dispatch(li);
+
+		while ((count = libinput_get_events(li,
+						    events,
+						    ARRAY_LENGTH(events)))) {
+			ck_assert_int_le(count, ARRAY_LENGTH(events));
+			for (size_t i = 0; i < count; i++)
+				ck_assert_int_eq(libinput_event_get_type(events[i]),
+						 LIBINPUT_EVENT_POINTER_MOTION);
+			libinput_events_destroy(events, count);
+			total += count;
+		}
+
+		ck_assert_int_eq(total, (round + 1) * 10);
+	}
+
+	ck_assert_int_eq(libinput_get_events(li, events, 0), 0);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(dispatch_stats)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	uint64_t dispatches, queued, consumed;
+
+	litest_drain_events(li);
+
+	dispatches = libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_DISPATCHES);
+	queued = libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_EVENTS_QUEUED);
+	consumed = libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_EVENTS_CONSUMED);
+	ck_assert_int_eq(queued, consumed);
+
+	for (int i = 0; i < 20; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	ck_assert_int_eq(libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_DISPATCHES),
+			 dispatches + 1);
+	ck_assert_int_ge(libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_WAKEUPS),
+			 1);
+	ck_assert_int_eq(libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_EVENTS_QUEUED),
+			 queued + 20);
+	ck_assert_int_ge(libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_QUEUE_HIGH_WATER_MARK),
+			 20);
+	ck_assert_int_ge(libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_QUEUE_REALLOCATIONS),
+			 1);
+
+	litest_drain_events(li);
+	ck_assert_int_eq(libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_EVENTS_CONSUMED),
+			 consumed + 20);
+
+	ck_assert_int_eq(libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_SYN_DROPPED),
+			 0);
+	ck_assert_int_eq(libinput_device_get_syn_dropped_count(dev->libinput_device),
+			 0);
+
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_get_dispatch_stat(li, 0), 0);
+	litest_restore_log_handler(li);
+}
+END_TEST
+
 static int open_restricted_leak(const char *path, int flags, void *data)
 {
 	return *(int*)data;
@@ -727,6 +859,327 @@ START_TEST(timer_delay_bug_warning)
 }
 END_TEST
 
+struct virtual_clock_timer {
+	struct libinput_timer timer;
+	uint64_t now[4];
+	size_t count;
+};
+
+static void
+virtual_clock_timer_func(uint64_t now, void *data)
+{
+	struct virtual_clock_timer *t = data;
+
+	litest_assert_int_lt(t->count, ARRAY_LENGTH(t->now));
+	t->now[t->count++] = now;
+
+	/* Re-arm relative to the expiry we were called for */
+	if (t->count < 3)
+		libinput_timer_set(&t->timer, now + ms2us(10));
+}
+
+START_TEST(timer_virtual_clock)
+{
+	struct libinput *li;
+	struct virtual_clock_timer t = {0};
+	uint64_t start = s2us(1);
+
+	li = libinput_path_create_context(&simple_interface, NULL);
+	ck_assert_notnull(li);
+
+	libinput_clock_enable_virtual(li, start);
+	libinput_timer_init(&t.timer, li, "virtual clock",
+			    virtual_clock_timer_func, &t);
+	libinput_timer_set(&t.timer, start + ms2us(10));
+
+	/* The real clock doesn't matter anymore */
+	libinput_dispatch(li);
+	ck_assert_int_eq(t.count, 0);
+
+	libinput_clock_advance(li, start + ms2us(5));
+	ck_assert_int_eq(t.count, 0);
+
+	/* One advance past several expiries runs each timer with its own
+	 * expiry time */
+	libinput_clock_advance(li, start + ms2us(25));
+	ck_assert_int_eq(t.count, 2);
+	ck_assert_uint_eq(t.now[0], start + ms2us(10));
+	ck_assert_uint_eq(t.now[1], start + ms2us(20));
+
+	libinput_clock_advance(li, start + ms2us(100));
+	ck_assert_int_eq(t.count, 3);
+	ck_assert_uint_eq(t.now[2], start + ms2us(30));
+
+	libinput_timer_cancel(&t.timer);
+	libinput_timer_destroy(&t.timer);
+	libinput_unref(li);
+}
+END_TEST
+
+struct expiry_timers {
+	struct expiry_timer {
+		struct libinput_timer timer;
+		struct expiry_timers *all;
+		int cancel;		/* timer to cancel on expiry or -1 */
+		unsigned int rearm;	/* times to re-arm, 10ms later */
+	} t[5];
+	struct {
+		size_t index;
+		uint64_t now;
+	} log[8];
+	size_t count;
+};
+
+static void
+expiry_timer_func(uint64_t now, void *data)
+{
+	struct expiry_timer *t = data;
+	struct expiry_timers *all = t->all;
+
+	litest_assert_int_lt(all->count, ARRAY_LENGTH(all->log));
+	all->log[all->count].index = t - all->t;
+	all->log[all->count].now = now;
+	all->count++;
+
+	if (t->cancel != -1)
+		libinput_timer_cancel(&all->t[t->cancel].timer);
+
+	if (t->rearm > 0) {
+		t->rearm--;
+		libinput_timer_set(&t->timer, now + ms2us(10));
+	}
+}
+
+START_TEST(timer_modify_during_expiry)
+{
+	struct libinput *li;
+	struct expiry_timers timers = {0};
+	uint64_t start = s2us(1);
+	struct {
+		uint64_t expire;
+		int cancel;
+		unsigned int rearm;
+	} setup[] = {
+		{ ms2us(10), 1, 1 },	/* cancels a pending timer, re-arms */
+		{ ms2us(15), -1, 0 },
+		{ ms2us(25), 3, 0 },	/* 2 and 3 cancel each other */
+		{ ms2us(25), 2, 0 },
+		{ ms2us(100), -1, 0 },	/* must survive the heap changes */
+	};
+	size_t winner;
+
+	li = libinput_path_create_context(&simple_interface, NULL);
+	ck_assert_notnull(li);
+	libinput_clock_enable_virtual(li, start);
+
+	for (size_t i = 0; i < ARRAY_LENGTH(setup); i++) {
+		struct expiry_timer *t = &timers.t[i];
+
+		t->all = &timers;
+		t->cancel = setup[i].cancel;
+		t->rearm = setup[i].rearm;
+		libinput_timer_init(&t->timer, li, "expiry",
+				    expiry_timer_func, t);
+		libinput_timer_set(&t->timer, start + setup[i].expire);
+	}
+
+	libinput_clock_advance(li, start + ms2us(50));
+
+	/* 0 fired twice, 1 was cancelled by 0 before its expiry, of the two
+	 * timers with the same expiry only the first one fired */
+	ck_assert_int_eq(timers.count, 3);
+	ck_assert_int_eq(timers.log[0].index, 0);
+	ck_assert_uint_eq(timers.log[0].now, start + ms2us(10));
+	ck_assert_int_eq(timers.log[1].index, 0);
+	ck_assert_uint_eq(timers.log[1].now, start + ms2us(20));
+	winner = timers.log[2].index;
+	ck_assert(winner == 2 || winner == 3);
+	ck_assert_uint_eq(timers.log[2].now, start + ms2us(25));
+
+	for (size_t i = 0; i < 4; i++)
+		ck_assert_uint_eq(timers.t[i].timer.expire, 0);
+	ck_assert_uint_eq(timers.t[4].timer.expire, start + ms2us(100));
+
+	libinput_clock_advance(li, start + ms2us(100));
+	ck_assert_int_eq(timers.count, 4);
+	ck_assert_int_eq(timers.log[3].index, 4);
+	ck_assert_uint_eq(timers.log[3].now, start + ms2us(100));
+
+	for (size_t i = 0; i < ARRAY_LENGTH(timers.t); i++) {
+		libinput_timer_cancel(&timers.t[i].timer);
+		libinput_timer_destroy(&timers.t[i].timer);
+	}
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(input_thread)
+{
+	struct libinput *li;
+	struct litest_device *dev, *keyboard;
+	struct libinput_event *event;
+	int nmotion = 0;
+
+	li = litest_create_context();
+	ck_assert_int_eq(libinput_enable_input_thread(li), 0);
+	dev = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	/* Already enabled, this is a noop */
+	ck_assert_int_eq(libinput_enable_input_thread(li), 0);
+
+	for (int i = 0; i < 20; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+
+	while (nmotion < 20) {
+		litest_wait_for_event(li);
+		while (libinput_next_event_type(li) ==
+		       LIBINPUT_EVENT_POINTER_MOTION) {
+			event = libinput_get_event(li);
+			litest_is_motion_event(event);
+			libinput_event_destroy(event);
+			nmotion++;
+		}
+	}
+	ck_assert_int_eq(nmotion, 20);
+
+	litest_wait_for_event_of_type(li,
+				      LIBINPUT_EVENT_POINTER_BUTTON,
+				      -1);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_wait_for_event_of_type(li,
+				      LIBINPUT_EVENT_POINTER_BUTTON,
+				      -1);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+	ck_assert_int_eq(libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_SYN_DROPPED),
+			 0);
+
+	/* A device added later is read by the input thread too */
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+	litest_keyboard_key(keyboard, KEY_A, true);
+	litest_wait_for_event_of_type(li,
+				      LIBINPUT_EVENT_KEYBOARD_KEY,
+				      -1);
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_PRESSED);
+	litest_keyboard_key(keyboard, KEY_A, false);
+	litest_wait_for_event_of_type(li,
+				      LIBINPUT_EVENT_KEYBOARD_KEY,
+				      -1);
+	litest_assert_key_event(li, KEY_A, LIBINPUT_KEY_STATE_RELEASED);
+
+	litest_delete_device(keyboard);
+	litest_delete_device(dev);
+	litest_drain_events(li);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(input_thread_overflow)
+{
+	struct libinput *li;
+	struct litest_device *dev;
+	struct libinput_event *event;
+	int nmotion = 0;
+	const int nframes = 2000;
+	uint64_t ndropped;
+
+	li = litest_create_context();
+	ck_assert_int_eq(libinput_enable_input_thread(li), 0);
+	dev = litest_add_device(li, LITEST_MOUSE);
+	litest_drain_events(li);
+
+	/* More frames than fit into the ring without dispatching. We
+	 * pause every few frames so the input thread keeps up with the
+	 * kernel's much smaller buffer and it's the ring that overflows */
+	for (int i = 0; i < nframes; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		if (i % 8 == 0)
+			msleep(1);
+	}
+
+	/* Dropped while the ring is full, the resync after the
+	 * SYN_DROPPED picks up the button state from the kernel */
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	msleep(50);
+
+	libinput_dispatch(li);
+	while (libinput_next_event_type(li) == LIBINPUT_EVENT_POINTER_MOTION) {
+		event = libinput_get_event(li);
+		litest_is_motion_event(event);
+		libinput_event_destroy(event);
+		nmotion++;
+	}
+	ck_assert_int_gt(nmotion, 0);
+	ck_assert_int_lt(nmotion, nframes);
+
+	event = libinput_get_event(li);
+	litest_is_button_event(event, BTN_LEFT, LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	/* The kernel may have dropped events too if we were too fast for
+	 * the input thread, that's another SYN_DROPPED */
+	ndropped = libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_SYN_DROPPED);
+	ck_assert_int_ge(ndropped, 1);
+	ck_assert_int_eq(libinput_device_get_syn_dropped_count(dev->libinput_device),
+			 ndropped);
+
+	/* Back to normal once the ring was drained */
+	litest_event(dev, EV_KEY, BTN_LEFT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_wait_for_event_of_type(li,
+				      LIBINPUT_EVENT_POINTER_BUTTON,
+				      -1);
+	litest_assert_button_event(li, BTN_LEFT,
+				   LIBINPUT_BUTTON_STATE_RELEASED);
+
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_wait_for_event_of_type(li,
+				      LIBINPUT_EVENT_POINTER_MOTION,
+				      -1);
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+
+	ck_assert_int_eq(libinput_get_dispatch_stat(li,
+				LIBINPUT_DISPATCH_STAT_SYN_DROPPED),
+			 ndropped);
+
+	litest_delete_device(dev);
+	litest_drain_events(li);
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(input_thread_after_device)
+{
+	struct libinput *li;
+	struct litest_device *dev;
+
+	li = litest_create_context();
+	dev = litest_add_device(li, LITEST_MOUSE);
+
+	litest_disable_log_handler(li);
+	ck_assert_int_eq(libinput_enable_input_thread(li), -1);
+	litest_restore_log_handler(li);
+
+	litest_delete_device(dev);
+	libinput_unref(li);
+}
+END_TEST
+
 START_TEST(timer_flush)
 {
 	struct libinput *li;
@@ -880,7 +1333,8 @@ END_TEST
 
 TEST_COLLECTION(misc)
 {
-	litest_add_no_device(event_conversion_device_notify);
+	if (!litest_has_virtual_devices())
+		litest_add_no_device(event_conversion_device_notify);
 	litest_add_for_device(event_conversion_pointer, LITEST_MOUSE);
 	litest_add_for_device(event_conversion_pointer_abs, LITEST_XEN_VIRTUAL_POINTER);
 	litest_add_for_device(event_conversion_key, LITEST_KEYBOARD);
@@ -893,11 +1347,26 @@ TEST_COLLECTION(misc)
 	litest_add_deviceless(context_ref_counting);
 	litest_add_deviceless(config_status_string);
 
-	litest_add_for_device(timer_offset_bug_warning, LITEST_SYNAPTICS_TOUCHPAD);
-	litest_add_for_device(timer_delay_bug_warning, LITEST_MOUSE);
+	litest_add_for_device(event_pool_recycling, LITEST_MOUSE);
+	litest_add_for_device(dispatch_stats, LITEST_MOUSE);
+	litest_add_for_device(event_get_batch, LITEST_MOUSE);
+
+	/* These check the warnings about timers and events that are late
+	 * in real time */
+	if (!litest_has_virtual_clock()) {
+		litest_add_for_device(timer_offset_bug_warning, LITEST_SYNAPTICS_TOUCHPAD);
+		litest_add_for_device(timer_delay_bug_warning, LITEST_MOUSE);
+	}
 	litest_add_no_device(timer_flush);
+	litest_add_deviceless(timer_virtual_clock);
+	litest_add_deviceless(timer_modify_during_expiry);
+	litest_add_no_device(input_thread);
+	litest_add_no_device(input_thread_overflow);
+	litest_add_no_device(input_thread_after_device);
 
-	litest_add_no_device(fd_no_event_leak);
+	if (!litest_has_virtual_devices())
+		litest_add_no_device(fd_no_event_leak);
 
-	litest_add_for_device(udev_absinfo_override, LITEST_ABSINFO_OVERRIDE);
+	if (!litest_has_virtual_devices())
+		litest_add_for_device(udev_absinfo_override, LITEST_ABSINFO_OVERRIDE);
 }
@@ -29,6 +29,7 @@
 #include <libinput.h>
 #include <unistd.h>
 #include <stdbool.h>
+#include <sys/stat.h>
 
 #if HAVE_LIBWACOM
 #include <libwacom/libwacom.h>
@@ -100,7 +101,7 @@ START_TEST(pad_time)
 	libinput_event_destroy(ev);
 
 	litest_drain_events(li);
-	msleep(10);
+	litest_sleep_ms(10);
 
 	litest_button_click(dev, code, 1);
 	litest_button_click(dev, code, 0);
@@ -916,6 +917,121 @@ START_TEST(pad_mode_group_has_no_toggle)
 }
 END_TEST
 
+#if HAVE_LIBWACOM
+static void
+pad_led_dir(char *path, size_t sz, unsigned int mode)
+{
+	snprintf(path, sz, "%s/input0::wacom-0.%u", LITEST_PAD_LED_DIR, mode);
+}
+
+/* Lights up the LED for the given mode, the others are switched off */
+static void
+pad_set_leds(unsigned int nmodes, unsigned int lit)
+{
+	char path[PATH_MAX];
+	unsigned int mode;
+	FILE *fp;
+
+	for (mode = 0; mode < nmodes; mode++) {
+		pad_led_dir(path, sizeof(path), mode);
+		strncat(path, "/brightness", sizeof(path) - strlen(path) - 1);
+		fp = fopen(path, "w");
+		litest_assert_ptr_notnull(fp);
+		fprintf(fp, "%d\n", mode == lit ? 127 : 0);
+		fclose(fp);
+	}
+}
+
+static unsigned int
+pad_press_button(struct litest_device *dev, unsigned int code)
+{
+	struct libinput *li = dev->libinput;
+	struct libinput_event *ev;
+	struct libinput_event_tablet_pad *pev;
+	unsigned int mode;
+
+	litest_button_click(dev, code, 1);
+	litest_button_click(dev, code, 0);
+	libinput_dispatch(li);
+
+	ev = libinput_get_event(li);
+	pev = litest_is_pad_button_event(ev,
+					 0,
+					 LIBINPUT_BUTTON_STATE_PRESSED);
+	mode = libinput_event_tablet_pad_get_mode(pev);
+	libinput_event_destroy(ev);
+
+	ev = libinput_get_event(li);
+	pev = litest_is_pad_button_event(ev,
+					 0,
+					 LIBINPUT_BUTTON_STATE_RELEASED);
+	ck_assert_int_eq(libinput_event_tablet_pad_get_mode(pev), mode);
+	libinput_event_destroy(ev);
+
+	return mode;
+}
+#endif
+
+START_TEST(pad_mode_toggle_leds)
+{
+#if HAVE_LIBWACOM
+	struct libinput *li;
+	struct litest_device *dev;
+	struct libinput_tablet_pad_mode_group *group;
+	char path[PATH_MAX];
+	const unsigned int nmodes = 4;
+	unsigned int mode;
+
+	mkdir(LITEST_PAD_LED_DIR, 0755);
+	for (mode = 0; mode < nmodes; mode++) {
+		pad_led_dir(path, sizeof(path), mode);
+		mkdir(path, 0755);
+	}
+	pad_set_leds(nmodes, 0);
+
+	li = litest_create_context();
+	dev = litest_add_device(li, LITEST_WACOM_INTUOS5_PAD_LEDS);
+	litest_drain_events(li);
+
+	group = libinput_device_tablet_pad_get_mode_group(dev->libinput_device,
+							  0);
+	ck_assert_int_eq(libinput_tablet_pad_mode_group_get_num_modes(group),
+			 nmodes);
+	ck_assert_int_eq(libinput_tablet_pad_mode_group_get_mode(group), 0);
+	/* BTN_0 is the ring button */
+	ck_assert(libinput_tablet_pad_mode_group_button_is_toggle(group, 0));
+
+	/* The kernel cycles the LEDs on each press */
+	for (mode = 1; mode <= nmodes; mode++) {
+		pad_set_leds(nmodes, mode % nmodes);
+		ck_assert_int_eq(pad_press_button(dev, BTN_0), mode % nmodes);
+		ck_assert_int_eq(libinput_tablet_pad_mode_group_get_mode(group),
+				 mode % nmodes);
+	}
+
+	/* Mode changed behind our back to 2, the press cycles to 3 instead
+	 * of the 1 we'd expect from our own state */
+	pad_set_leds(nmodes, 3);
+	ck_assert_int_eq(pad_press_button(dev, BTN_0), 3);
+	ck_assert_int_eq(libinput_tablet_pad_mode_group_get_mode(group), 3);
+
+	litest_assert_empty_queue(li);
+
+	litest_delete_device(dev);
+	litest_destroy_context(li);
+
+	for (mode = 0; mode < nmodes; mode++) {
+		pad_led_dir(path, sizeof(path), mode);
+		strncat(path, "/brightness", sizeof(path) - strlen(path) - 1);
+		unlink(path);
+		pad_led_dir(path, sizeof(path), mode);
+		rmdir(path);
+	}
+	rmdir(LITEST_PAD_LED_DIR);
+#endif
+}
+END_TEST
+
 static bool
 pad_has_keys(struct litest_device *dev)
 {
@@ -1016,6 +1132,8 @@ TEST_COLLECTION(tablet_pad)
 	litest_add(pad_mode_group_has, LITEST_TABLET_PAD, LITEST_ANY);
 	litest_add(pad_mode_group_has_invalid, LITEST_TABLET_PAD, LITEST_ANY);
 	litest_add(pad_mode_group_has_no_toggle, LITEST_TABLET_PAD, LITEST_ANY);
+	if (!litest_has_virtual_devices())
+		litest_add_no_device(pad_mode_toggle_leds);
 
 	litest_add(pad_keys, LITEST_TABLET_PAD, LITEST_ANY);
 }
@@ -40,13 +40,12 @@ test_relative_event(struct litest_device *dev, double dx, double dy)
 	struct libinput *li = dev->libinput;
 	struct libinput_event_pointer *ptrev;
 	struct libinput_event *event;
-	struct udev_device *ud;
 	double ev_dx, ev_dy;
 	double expected_dir;
 	double expected_length;
 	double actual_dir;
 	double actual_length;
-	const char *prop;
+	char *prop;
 	int dpi = 1000;
 
 	litest_event(dev, EV_REL, REL_X, dx);
@@ -63,9 +62,7 @@ test_relative_event(struct litest_device *dev, double dx, double dy)
 	 * movement. Work aorund this here by checking for the MOUSE_DPI
 	 * property.
 	 */
-	ud = libinput_device_get_udev_device(dev->libinput_device);
-	litest_assert_ptr_notnull(ud);
-	prop = udev_device_get_property_value(ud, "MOUSE_DPI");
+	prop = litest_device_get_property(dev, "MOUSE_DPI");
 	if (prop) {
 		dpi = parse_mouse_dpi_property(prop);
 		ck_assert_int_ne(dpi, 0);
@@ -73,7 +70,7 @@ test_relative_event(struct litest_device *dev, double dx, double dy)
 		dx *= 1000.0/dpi;
 		dy *= 1000.0/dpi;
 	}
-	udev_device_unref(ud);
+	free(prop);
 
 	expected_length = sqrt(4 * dx*dx + 4 * dy*dy);
 	expected_dir = atan2(dx, dy);
@@ -362,6 +359,147 @@ START_TEST(pointer_motion_unaccel)
 }
 END_TEST
 
+static void
+assert_unaccelerated_motion(struct libinput *li, double dx, double dy)
+{
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev), dx);
+	ck_assert_double_eq(libinput_event_pointer_get_dy_unaccelerated(ptrev), dy);
+	libinput_event_destroy(event);
+}
+
+START_TEST(pointer_motion_coalesced)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+
+	ck_assert_int_eq(libinput_set_event_coalescing(li, 1), 0);
+	litest_drain_events(li);
+
+	for (int i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_REL, REL_Y, -2);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	for (int i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_X, -1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	for (int i = 0; i < 4; i++) {
+		litest_event(dev, EV_REL, REL_WHEEL, -1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	/* the button event splits the motion */
+	assert_unaccelerated_motion(li, 5, -10);
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+	assert_unaccelerated_motion(li, -3, 0);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_axis_event(event,
+				     LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL,
+				     LIBINPUT_POINTER_AXIS_SOURCE_WHEEL);
+	ck_assert_double_eq(
+		libinput_event_pointer_get_axis_value_discrete(ptrev,
+				LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL),
+		4);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+
+	/* Without coalescing, every frame is its own event */
+	ck_assert_int_eq(libinput_set_event_coalescing(li, 0), 0);
+	for (int i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+	for (int i = 0; i < 3; i++)
+		assert_unaccelerated_motion(li, 1, 0);
+	litest_assert_empty_queue(li);
+
+	litest_event(dev, EV_KEY, BTN_LEFT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(pointer_motion_prediction)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	double mean_error = -1, max_error = -1;
+
+	ck_assert_int_eq(libinput_device_get_motion_prediction(device), 0);
+	ck_assert_int_eq(libinput_device_set_motion_prediction(device, 101),
+			 LIBINPUT_CONFIG_STATUS_INVALID);
+	ck_assert_int_eq(libinput_device_set_motion_prediction(device, 10),
+			 LIBINPUT_CONFIG_STATUS_SUCCESS);
+	ck_assert_int_eq(libinput_device_get_motion_prediction(device), 10);
+
+	litest_drain_events(li);
+
+	for (int i = 0; i < 10; i++) {
+		litest_event(dev, EV_REL, REL_X, 5);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		litest_sleep_ms(5);
+	}
+	libinput_dispatch(li);
+
+	/* nothing to predict from yet */
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert_double_eq(libinput_event_pointer_get_dx_predicted(ptrev), 0.0);
+	ck_assert_double_eq(libinput_event_pointer_get_dy_predicted(ptrev), 0.0);
+	libinput_event_destroy(event);
+
+	while ((event = libinput_get_event(li))) {
+		ptrev = litest_is_motion_event(event);
+		ck_assert_double_gt(libinput_event_pointer_get_dx_predicted(ptrev), 0.0);
+		ck_assert_double_eq(libinput_event_pointer_get_dy_predicted(ptrev), 0.0);
+		libinput_event_destroy(event);
+	}
+
+	ck_assert_int_gt(libinput_device_get_motion_prediction_error(device,
+								     &mean_error,
+								     &max_error),
+			 0);
+	ck_assert_double_ge(mean_error, 0.0);
+	ck_assert_double_ge(max_error, mean_error);
+
+	ck_assert_int_eq(libinput_device_set_motion_prediction(device, 0),
+			 LIBINPUT_CONFIG_STATUS_SUCCESS);
+	ck_assert_int_eq(libinput_device_get_motion_prediction(device), 0);
+	ck_assert_int_eq(libinput_device_get_motion_prediction_error(device,
+								     NULL,
+								     NULL),
+			 0);
+
+	litest_event(dev, EV_REL, REL_X, 5);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert_double_eq(libinput_event_pointer_get_dx_predicted(ptrev), 0.0);
+	libinput_event_destroy(event);
+}
+END_TEST
+
 static void
 test_button_event(struct litest_device *dev, unsigned int button, int state)
 {
@@ -494,6 +632,87 @@ START_TEST(pointer_button_auto_release)
 }
 END_TEST
 
+START_TEST(pointer_button_many_keys_in_frame)
+{
+	struct libinput *li;
+	struct litest_device *dev;
+	int events[2 * (KEY_D - KEY_ESC + 1) + 2];
+	unsigned int i = 0;
+
+	/* More keys than fallback tracks per frame, see
+	 * hw_key_mark_changed() */
+	for (unsigned int code = KEY_ESC; code <= KEY_D; code++) {
+		events[i++] = EV_KEY;
+		events[i++] = code;
+	}
+	events[i++] = -1;
+	events[i++] = -1;
+
+	li = litest_create_context();
+	dev = litest_add_device_with_overrides(li,
+					       LITEST_MOUSE,
+					       "Generic mouse with keys",
+					       NULL, NULL, events);
+	litest_drain_events(li);
+
+	for (unsigned int code = KEY_ESC; code <= KEY_D; code++)
+		litest_event(dev, EV_KEY, code, 1);
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+
+	for (unsigned int code = KEY_ESC; code <= KEY_D; code++)
+		litest_assert_key_event(li, code, LIBINPUT_KEY_STATE_PRESSED);
+	litest_assert_button_event(li, BTN_LEFT, LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_empty_queue(li);
+
+	for (unsigned int code = KEY_ESC; code <= KEY_D; code++)
+		litest_event(dev, EV_KEY, code, 0);
+	litest_event(dev, EV_KEY, BTN_LEFT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+
+	for (unsigned int code = KEY_ESC; code <= KEY_D; code++)
+		litest_assert_key_event(li, code, LIBINPUT_KEY_STATE_RELEASED);
+	litest_assert_button_event(li, BTN_LEFT, LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+
+	/* The next frame only looks at the keys that changed in it */
+	test_button_event(dev, BTN_RIGHT, 1);
+	test_button_event(dev, BTN_RIGHT, 0);
+	litest_assert_empty_queue(li);
+
+	litest_delete_device(dev);
+	litest_destroy_context(li);
+}
+END_TEST
+
+START_TEST(pointer_button_press_release_same_frame)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+
+	litest_drain_events(li);
+
+	/* The button changed twice but its state didn't change */
+	litest_event(dev, EV_KEY, BTN_LEFT, 1);
+	litest_event(dev, EV_KEY, BTN_LEFT, 0);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+	litest_timeout_debounce();
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+
+	test_button_event(dev, BTN_LEFT, 1);
+	test_button_event(dev, BTN_LEFT, 0);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
 START_TEST(pointer_button_has_no_button)
 {
 	struct litest_device *dev = litest_current_device();
@@ -546,18 +765,14 @@ END_TEST
 static inline double
 wheel_click_count(struct litest_device *dev, int which)
 {
-	struct udev_device *d;
-	const char *prop = NULL;
+	char *prop = NULL;
 	int count;
 	double angle = 0.0;
 
-	d = libinput_device_get_udev_device(dev->libinput_device);
-	litest_assert_ptr_notnull(d);
-
 	if (which == REL_HWHEEL)
-		prop = udev_device_get_property_value(d, "MOUSE_WHEEL_CLICK_COUNT_HORIZONTAL");
+		prop = litest_device_get_property(dev, "MOUSE_WHEEL_CLICK_COUNT_HORIZONTAL");
 	if (!prop)
-		prop = udev_device_get_property_value(d, "MOUSE_WHEEL_CLICK_COUNT");
+		prop = litest_device_get_property(dev, "MOUSE_WHEEL_CLICK_COUNT");
 	if (!prop)
 		goto out;
 
@@ -566,15 +781,14 @@ wheel_click_count(struct litest_device *dev, int which)
 	angle = 360.0/count;
 
 out:
-	udev_device_unref(d);
+	free(prop);
 	return angle;
 }
 
 static inline double
 wheel_click_angle(struct litest_device *dev, int which)
 {
-	struct udev_device *d;
-	const char *prop = NULL;
+	char *prop = NULL;
 	const int default_angle = 15;
 	double angle;
 
@@ -583,13 +797,11 @@ wheel_click_angle(struct litest_device *dev, int which)
 		return angle;
 
 	angle = default_angle;
-	d = libinput_device_get_udev_device(dev->libinput_device);
-	litest_assert_ptr_notnull(d);
 
 	if (which == REL_HWHEEL)
-		prop = udev_device_get_property_value(d, "MOUSE_WHEEL_CLICK_ANGLE_HORIZONTAL");
+		prop = litest_device_get_property(dev, "MOUSE_WHEEL_CLICK_ANGLE_HORIZONTAL");
 	if (!prop)
-		prop = udev_device_get_property_value(d, "MOUSE_WHEEL_CLICK_ANGLE");
+		prop = litest_device_get_property(dev, "MOUSE_WHEEL_CLICK_ANGLE");
 	if (!prop)
 		goto out;
 
@@ -598,7 +810,7 @@ wheel_click_angle(struct litest_device *dev, int which)
 		angle = default_angle;
 
 out:
-	udev_device_unref(d);
+	free(prop);
 	return angle;
 }
 
@@ -3159,8 +3371,12 @@ TEST_COLLECTION(pointer)
 	litest_add_ranged(pointer_motion_relative_min_decel, LITEST_RELATIVE, LITEST_POINTINGSTICK, &compass);
 	litest_add(pointer_motion_absolute, LITEST_ABSOLUTE, LITEST_ANY);
 	litest_add(pointer_motion_unaccel, LITEST_RELATIVE, LITEST_ANY);
+	litest_add_for_device(pointer_motion_coalesced, LITEST_MOUSE);
+	litest_add(pointer_motion_prediction, LITEST_RELATIVE, LITEST_POINTINGSTICK);
 	litest_add(pointer_button, LITEST_BUTTON, LITEST_CLICKPAD);
 	litest_add_no_device(pointer_button_auto_release);
+	litest_add_no_device(pointer_button_many_keys_in_frame);
+	litest_add_for_device(pointer_button_press_release_same_frame, LITEST_MOUSE);
 	litest_add_no_device(pointer_seat_button_count);
 	litest_add_for_device(pointer_button_has_no_button, LITEST_KEYBOARD);
 	litest_add(pointer_recover_from_lost_button_count, LITEST_BUTTON, LITEST_CLICKPAD);
@@ -3226,7 +3442,8 @@ TEST_COLLECTION(pointer)
 	litest_add(middlebutton_device_remove_while_down, LITEST_BUTTON, LITEST_CLICKPAD);
 	litest_add(middlebutton_device_remove_while_one_is_down, LITEST_BUTTON, LITEST_CLICKPAD);
 
-	litest_add_ranged(pointer_absolute_initial_state, LITEST_ABSOLUTE, LITEST_ANY, &axis_range);
+	if (!litest_has_virtual_devices())
+		litest_add_ranged(pointer_absolute_initial_state, LITEST_ABSOLUTE, LITEST_ANY, &axis_range);
 
 	litest_add(pointer_time_usec, LITEST_RELATIVE, LITEST_ANY);
 
@@ -24,7 +24,9 @@
 #include <config.h>
 
 #include <check.h>
+#include <fcntl.h>
 #include <libinput.h>
+#include <sys/stat.h>
 
 #include "libinput-util.h"
 #include "litest.h"
@@ -1166,6 +1168,7 @@ START_TEST(quirks_parse_string_attr)
 		QUIRK_ATTR_TPKBCOMBO_LAYOUT,
 		QUIRK_ATTR_LID_SWITCH_RELIABILITY,
 		QUIRK_ATTR_KEYBOARD_INTEGRATION,
+		QUIRK_ATTR_TABLET_SMOOTHING,
 	};
 	enum quirk *a;
 	struct qtest_str test_values[] = {
@@ -1174,6 +1177,9 @@ START_TEST(quirks_parse_string_attr)
 		{ "write_open", QUIRK_ATTR_LID_SWITCH_RELIABILITY },
 		{ "internal", QUIRK_ATTR_KEYBOARD_INTEGRATION },
 		{ "external", QUIRK_ATTR_KEYBOARD_INTEGRATION },
+		{ "none", QUIRK_ATTR_TABLET_SMOOTHING },
+		{ "average", QUIRK_ATTR_TABLET_SMOOTHING },
+		{ "adaptive", QUIRK_ATTR_TABLET_SMOOTHING },
 
 		{ "10", 0 },
 		{ "-10", 0 },
@@ -1305,6 +1311,55 @@ START_TEST(quirks_model_zero)
 }
 END_TEST
 
+START_TEST(quirks_model_properties)
+{
+	struct quirks_context *ctx;
+	const char quirks_file[] =
+	"[Section name]\n"
+	"MatchUdevType=touchpad\n"
+	"MatchName=*Virtual Touchpad\n"
+	"MatchVendor=0x1234\n"
+	"ModelAppleTouchpad=1\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	char *properties[] = {
+		"ID_INPUT=1",
+		"ID_INPUT_TOUCHPAD=1",
+		"NAME=\"Some Virtual Touchpad\"",
+		"PRODUCT=3/1234/5678/1",
+		NULL,
+	};
+	char *other_properties[] = {
+		"ID_INPUT=1",
+		"ID_INPUT_TOUCHPAD=1",
+		"NAME=\"Some Virtual Touchpad\"",
+		"PRODUCT=3/4321/5678/1",
+		NULL,
+	};
+	struct quirks *q;
+	bool isset;
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+
+	q = quirks_fetch_for_properties(ctx, "virtual", properties);
+	ck_assert_notnull(q);
+	ck_assert(quirks_get_bool(q, QUIRK_MODEL_APPLE_TOUCHPAD, &isset));
+	ck_assert(isset == true);
+	quirks_unref(q);
+
+	q = quirks_fetch_for_properties(ctx, "virtual", other_properties);
+	ck_assert(!quirks_get_bool(q, QUIRK_MODEL_APPLE_TOUCHPAD, &isset));
+	quirks_unref(q);
+
+	quirks_context_unref(ctx);
+	cleanup_data_dir(dd);
+}
+END_TEST
+
 START_TEST(quirks_model_override)
 {
 	struct litest_device *dev = litest_current_device();
@@ -1434,6 +1489,7 @@ END_TEST
 START_TEST(quirks_call_NULL)
 {
 	ck_assert(!quirks_fetch_for_device(NULL, NULL));
+	ck_assert(!quirks_fetch_for_properties(NULL, NULL, NULL));
 
 	ck_assert(!quirks_get_uint32(NULL, 0, NULL));
 	ck_assert(!quirks_get_int32(NULL, 0, NULL));
@@ -1470,6 +1526,143 @@ START_TEST(quirks_ctx_ref)
 }
 END_TEST
 
+START_TEST(quirks_cache)
+{
+	struct litest_device *dev = litest_current_device();
+	struct udev_device *ud = libinput_device_get_udev_device(dev->libinput_device);
+	struct quirks_context *ctx;
+	const char quirks_file[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=1\n"
+	"AttrKeyboardIntegration=internal\n"
+	"AttrSizeHint=10x20\n";
+	const char quirks_file_same_size[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=0\n"
+	"AttrKeyboardIntegration=internal\n"
+	"AttrSizeHint=10x20\n";
+	const char quirks_file_changed[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"ModelAppleTouchpad=0\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	struct quirks *q;
+	struct quirk_dimensions dim;
+	struct timespec times[2];
+	struct stat st;
+	char *cache_file;
+	char *str;
+	bool isset;
+	FILE *fp;
+
+	xasprintf(&cache_file, "%s/quirks.cache", dd.dirname);
+
+	ctx = quirks_init_subsystem(dd.dirname,
+				    NULL,
+				    log_handler,
+				    NULL,
+				    QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+	ck_assert(quirks_context_write_cache(ctx, cache_file));
+	quirks_context_unref(ctx);
+
+	/* Change the data file behind the cache's back: same size, same
+	 * mtime. The cache still matches the file stamps, so the old value
+	 * can only come from the cache */
+	ck_assert_int_eq(stat(dd.filename, &st), 0);
+	fp = fopen(dd.filename, "w");
+	litest_assert_notnull(fp);
+	fputs(quirks_file_same_size, fp);
+	fclose(fp);
+	times[0] = st.st_atim;
+	times[1] = st.st_mtim;
+	ck_assert_int_eq(utimensat(AT_FDCWD, dd.filename, times, 0), 0);
+
+	/* Loaded from the cache */
+	ctx = quirks_init_subsystem_with_cache(dd.dirname,
+					       NULL,
+					       cache_file,
+					       log_handler,
+					       NULL,
+					       QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+
+	q = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q);
+	ck_assert(quirks_get_bool(q, QUIRK_MODEL_APPLE_TOUCHPAD, &isset));
+	ck_assert(isset == true);
+	ck_assert(quirks_get_string(q, QUIRK_ATTR_KEYBOARD_INTEGRATION, &str));
+	ck_assert_str_eq(str, "internal");
+	ck_assert(quirks_get_dimensions(q, QUIRK_ATTR_SIZE_HINT, &dim));
+	ck_assert_int_eq(dim.x, 10);
+	ck_assert_int_eq(dim.y, 20);
+	quirks_unref(q);
+	quirks_context_unref(ctx);
+
+	/* Changing the data file invalidates the cache */
+	fp = fopen(dd.filename, "w");
+	litest_assert_notnull(fp);
+	fputs(quirks_file_changed, fp);
+	fclose(fp);
+
+	ctx = quirks_init_subsystem_with_cache(dd.dirname,
+					       NULL,
+					       cache_file,
+					       log_handler,
+					       NULL,
+					       QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+
+	q = quirks_fetch_for_device(ctx, ud);
+	ck_assert_notnull(q);
+	ck_assert(quirks_get_bool(q, QUIRK_MODEL_APPLE_TOUCHPAD, &isset));
+	ck_assert(isset == false);
+	ck_assert(!quirks_has_quirk(q, QUIRK_ATTR_KEYBOARD_INTEGRATION));
+	quirks_unref(q);
+	quirks_context_unref(ctx);
+
+	unlink(cache_file);
+	free(cache_file);
+	cleanup_data_dir(dd);
+	udev_device_unref(ud);
+}
+END_TEST
+
+START_TEST(quirks_cache_invalid)
+{
+	struct quirks_context *ctx;
+	const char quirks_file[] =
+	"[Section name]\n"
+	"MatchUdevType=mouse\n"
+	"AttrSizeHint=10x10\n";
+	struct data_dir dd = make_data_dir(quirks_file);
+	char *cache_file;
+	FILE *fp;
+
+	xasprintf(&cache_file, "%s/quirks.cache", dd.dirname);
+	fp = fopen(cache_file, "w");
+	litest_assert_notnull(fp);
+	fputs("this is not a quirks cache", fp);
+	fclose(fp);
+
+	/* Garbage cache falls back to the text files */
+	ctx = quirks_init_subsystem_with_cache(dd.dirname,
+					       NULL,
+					       cache_file,
+					       log_handler,
+					       NULL,
+					       QLOG_CUSTOM_LOG_PRIORITIES);
+	ck_assert_notnull(ctx);
+	quirks_context_unref(ctx);
+
+	unlink(cache_file);
+	free(cache_file);
+	cleanup_data_dir(dd);
+}
+END_TEST
+
 TEST_COLLECTION(quirks)
 {
 	struct range boolean = {0, 2};
@@ -1512,16 +1705,20 @@ TEST_COLLECTION(quirks)
 	litest_add_deviceless(quirks_parse_dmi);
 	litest_add_deviceless(quirks_parse_dmi_invalid);
 
-	litest_add_for_device(quirks_parse_dimension_attr, LITEST_MOUSE);
-	litest_add_for_device(quirks_parse_range_attr, LITEST_MOUSE);
-	litest_add_for_device(quirks_parse_uint_attr, LITEST_MOUSE);
-	litest_add_for_device(quirks_parse_double_attr, LITEST_MOUSE);
-	litest_add_for_device(quirks_parse_string_attr, LITEST_MOUSE);
-	litest_add_for_device(quirks_parse_integration_attr, LITEST_MOUSE);
+	if (!litest_has_virtual_devices()) {
+		litest_add_for_device(quirks_parse_dimension_attr, LITEST_MOUSE);
+		litest_add_for_device(quirks_parse_range_attr, LITEST_MOUSE);
+		litest_add_for_device(quirks_parse_uint_attr, LITEST_MOUSE);
+		litest_add_for_device(quirks_parse_double_attr, LITEST_MOUSE);
+		litest_add_for_device(quirks_parse_string_attr, LITEST_MOUSE);
+		litest_add_for_device(quirks_parse_integration_attr, LITEST_MOUSE);
 
-	litest_add_for_device(quirks_model_one, LITEST_MOUSE);
-	litest_add_for_device(quirks_model_zero, LITEST_MOUSE);
-	litest_add_ranged_for_device(quirks_model_override, LITEST_MOUSE, &boolean);
+		litest_add_for_device(quirks_model_one, LITEST_MOUSE);
+		litest_add_for_device(quirks_model_zero, LITEST_MOUSE);
+	}
+	litest_add_deviceless(quirks_model_properties);
+	if (!litest_has_virtual_devices())
+		litest_add_ranged_for_device(quirks_model_override, LITEST_MOUSE, &boolean);
 
 	litest_add(quirks_model_alps, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add(quirks_model_wacom, LITEST_TOUCHPAD, LITEST_ANY);
@@ -1530,4 +1727,8 @@ TEST_COLLECTION(quirks)
 
 	litest_add_deviceless(quirks_call_NULL);
 	litest_add_deviceless(quirks_ctx_ref);
+
+	if (!litest_has_virtual_devices())
+		litest_add_for_device(quirks_cache, LITEST_MOUSE);
+	litest_add_deviceless(quirks_cache_invalid);
 }
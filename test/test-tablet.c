@@ -1817,6 +1817,63 @@ START_TEST(motion)
 }
 END_TEST
 
+START_TEST(motion_prediction)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_tablet_tool *tev = NULL;
+	struct axis_replacement axes[] = {
+		{ ABS_DISTANCE, 10 },
+		{ ABS_PRESSURE, 0 },
+		{ -1, -1 }
+	};
+	double x, y;
+
+	ck_assert_int_eq(libinput_device_set_motion_prediction(dev->libinput_device,
+								16),
+			 LIBINPUT_CONFIG_STATUS_SUCCESS);
+	litest_drain_events(li);
+
+	litest_tablet_proximity_in(dev, 10, 50, axes);
+	libinput_dispatch(li);
+
+	/* a new tool has no history, the prediction is where it is */
+	event = libinput_get_event(li);
+	tev = litest_is_tablet_event(event,
+				     LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	ck_assert_double_eq(libinput_event_tablet_tool_get_x_predicted(tev),
+			    libinput_event_tablet_tool_get_x(tev));
+	ck_assert_double_eq(libinput_event_tablet_tool_get_y_predicted(tev),
+			    libinput_event_tablet_tool_get_y(tev));
+	libinput_event_destroy(event);
+	tev = NULL;
+	litest_drain_events(li);
+
+	for (int i = 1; i <= 10; i++) {
+		litest_tablet_motion(dev, 10 + 2 * i, 50, axes);
+		litest_sleep_ms(5);
+	}
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		if (tev)
+			libinput_event_destroy(libinput_event_tablet_tool_get_base_event(tev));
+		tev = litest_is_tablet_event(event,
+					     LIBINPUT_EVENT_TABLET_TOOL_AXIS);
+	}
+
+	/* moving right at constant speed */
+	x = libinput_event_tablet_tool_get_x(tev);
+	y = libinput_event_tablet_tool_get_y(tev);
+	ck_assert_double_gt(libinput_event_tablet_tool_get_x_predicted(tev), x);
+	ck_assert_double_eq(libinput_event_tablet_tool_get_y_predicted(tev), y);
+	ck_assert_double_gt(libinput_event_tablet_tool_get_x_predicted_transformed(tev, 1000),
+			    libinput_event_tablet_tool_get_x_transformed(tev, 1000));
+	libinput_event_destroy(libinput_event_tablet_tool_get_base_event(tev));
+}
+END_TEST
+
 START_TEST(left_handed)
 {
 #if HAVE_LIBWACOM
@@ -2431,6 +2488,73 @@ START_TEST(serial_changes_tool)
 }
 END_TEST
 
+START_TEST(tool_registry_eviction)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event_tablet_tool *tablet_event;
+	struct libinput_event *event;
+	struct libinput_tablet_tool *tool, *kept = NULL;
+	void *userdata = &dev; /* not dereferenced */
+	const int ntools = 200;
+
+	litest_drain_events(li);
+
+	for (int i = 0; i < ntools; i++) {
+		litest_event(dev, EV_KEY, BTN_TOOL_PEN, 1);
+		litest_event(dev, EV_MSC, MSC_SERIAL, 1000 + i);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		libinput_dispatch(li);
+
+		event = libinput_get_event(li);
+		tablet_event = litest_is_tablet_event(event,
+					LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+		tool = libinput_event_tablet_tool_get_tool(tablet_event);
+		ck_assert_uint_eq(libinput_tablet_tool_get_serial(tool), 1000 + i);
+
+		/* The caller's reference keeps the first tool alive */
+		if (i == 0) {
+			kept = libinput_tablet_tool_ref(tool);
+			libinput_tablet_tool_set_user_data(kept, userdata);
+		}
+		libinput_event_destroy(event);
+
+		litest_event(dev, EV_KEY, BTN_TOOL_PEN, 0);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		litest_drain_events(li);
+	}
+
+	ck_assert_uint_lt(libinput_tablet_tool_registry_get_stat(li,
+				LIBINPUT_TABLET_TOOL_REGISTRY_STAT_TOOLS),
+			  ntools);
+	ck_assert_uint_gt(libinput_tablet_tool_registry_get_stat(li,
+				LIBINPUT_TABLET_TOOL_REGISTRY_STAT_EVICTIONS),
+			  0);
+	ck_assert_uint_ge(libinput_tablet_tool_registry_get_stat(li,
+				LIBINPUT_TABLET_TOOL_REGISTRY_STAT_MISSES),
+			  ntools);
+
+	litest_event(dev, EV_KEY, BTN_TOOL_PEN, 1);
+	litest_event(dev, EV_MSC, MSC_SERIAL, 1000);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	tablet_event = litest_is_tablet_event(event,
+				LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+	tool = libinput_event_tablet_tool_get_tool(tablet_event);
+	ck_assert_ptr_eq(tool, kept);
+	ck_assert_ptr_eq(libinput_tablet_tool_get_user_data(tool), userdata);
+	libinput_event_destroy(event);
+
+	ck_assert_uint_gt(libinput_tablet_tool_registry_get_stat(li,
+				LIBINPUT_TABLET_TOOL_REGISTRY_STAT_HITS),
+			  0);
+
+	libinput_tablet_tool_unref(kept);
+}
+END_TEST
+
 START_TEST(invalid_serials)
 {
 	struct litest_device *dev = litest_current_device();
@@ -5892,7 +6016,7 @@ START_TEST(huion_static_btn_tool_pen_no_timeout_during_usage)
 		litest_event(dev, EV_ABS, ABS_Y, 20000 - 10 * i);
 		litest_event(dev, EV_SYN, SYN_REPORT, 0);
 		libinput_dispatch(li);
-		msleep(5);
+		litest_sleep_ms(5);
 	}
 	litest_assert_only_typed_events(li,
 					LIBINPUT_EVENT_TABLET_TOOL_AXIS);
@@ -6069,6 +6193,101 @@ START_TEST(tablet_smoothing)
 }
 END_TEST
 
+START_TEST(tablet_smoothing_adaptive_slow)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct axis_replacement axes[] = {
+		{ ABS_PRESSURE, 0 },
+		{ -1, -1 }
+	};
+	int res = libevdev_get_abs_resolution(dev->evdev, ABS_X);
+	int x0 = litest_scale(dev, ABS_X, 50);
+	double last_x = 1.0 * x0/res;
+
+	litest_tablet_proximity_in(dev, 50, 50, axes);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	/* Drift slowly with 0.2mm of noise on either side, so the raw
+	 * position jumps back and forth by 0.4mm every frame. The filter
+	 * must not pass that through. */
+	for (int i = 1; i <= 60; i++) {
+		struct libinput_event *event;
+		int jitter = (i % 2) ? res/5 : -res/5;
+
+		litest_sleep_ms(5);
+		litest_event(dev, EV_ABS, ABS_X, x0 + i * 2 + jitter);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		libinput_dispatch(li);
+
+		/* No event if the smoothed position didn't change */
+		while ((event = libinput_get_event(li))) {
+			struct libinput_event_tablet_tool *tev;
+			double x;
+
+			tev = litest_is_tablet_event(event,
+						     LIBINPUT_EVENT_TABLET_TOOL_AXIS);
+			x = libinput_event_tablet_tool_get_x(tev);
+			litest_assert_double_lt(fabs(x - last_x), 0.2);
+			last_x = x;
+			libinput_event_destroy(event);
+		}
+	}
+
+	litest_tablet_proximity_out(dev);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(tablet_smoothing_adaptive_fast)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct axis_replacement axes[] = {
+		{ ABS_PRESSURE, 0 },
+		{ -1, -1 }
+	};
+	int res = libevdev_get_abs_resolution(dev->evdev, ABS_X);
+	int x0 = litest_scale(dev, ABS_X, 10);
+	int step = 4 * res; /* 4mm per frame, 800mm/s */
+	int x = x0;
+	double lag = 0.0;
+
+	litest_tablet_proximity_in(dev, 10, 50, axes);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	for (int i = 0; i < 40; i++) {
+		struct libinput_event *event;
+		struct libinput_event_tablet_tool *tev;
+
+		x += step;
+		litest_sleep_ms(5);
+		litest_event(dev, EV_ABS, ABS_X, x);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		libinput_dispatch(li);
+
+		event = libinput_get_event(li);
+		tev = litest_is_tablet_event(event,
+					     LIBINPUT_EVENT_TABLET_TOOL_AXIS);
+		lag = 1.0 * x/res - libinput_event_tablet_tool_get_x(tev);
+		litest_assert_double_ge(lag, 0.0);
+		libinput_event_destroy(event);
+	}
+
+	/* Once the filter has picked up the speed it must stay well within
+	 * one frame of the pen, averaging the last four frames would lag
+	 * by 6mm here */
+	litest_assert_double_lt(lag, 1.0);
+
+	litest_tablet_proximity_out(dev);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+}
+END_TEST
+
 TEST_COLLECTION(tablet)
 {
 	struct range with_timeout = { 0, 2 };
@@ -6080,18 +6299,21 @@ TEST_COLLECTION(tablet)
 	litest_add(tool_capability, LITEST_TABLET, LITEST_ANY);
 	litest_add_no_device(tool_capabilities);
 	litest_add(tool_type, LITEST_TABLET, LITEST_FORCED_PROXOUT);
-	litest_add(tool_in_prox_before_start, LITEST_TABLET, LITEST_TOTEM);
+	if (!litest_has_virtual_devices())
+		litest_add(tool_in_prox_before_start, LITEST_TABLET, LITEST_TOTEM);
 	litest_add(tool_direct_switch_skip_tool_update, LITEST_TABLET, LITEST_ANY);
 	litest_add(tool_direct_switch_with_forced_proxout, LITEST_TABLET, LITEST_ANY);
 
 	/* Tablets hold back the proximity until the first event from the
 	 * kernel, the totem sends it immediately */
-	litest_add(tool_in_prox_before_start, LITEST_TABLET, LITEST_TOTEM);
+	if (!litest_has_virtual_devices())
+		litest_add(tool_in_prox_before_start, LITEST_TABLET, LITEST_TOTEM);
 	litest_add(tool_unique, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add(tool_serial, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add(tool_id, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add(serial_changes_tool, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add(invalid_serials, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
+	litest_add(tool_registry_eviction, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add_no_device(tools_with_serials);
 	litest_add_no_device(tools_without_serials);
 	litest_add_for_device(tool_delayed_serial, LITEST_WACOM_HID4800_PEN);
@@ -6129,6 +6351,7 @@ TEST_COLLECTION(tablet)
 	litest_add_no_device(tip_up_on_delete);
 	litest_add(motion, LITEST_TABLET, LITEST_ANY);
 	litest_add(motion_event_state, LITEST_TABLET, LITEST_ANY);
+	litest_add(motion_prediction, LITEST_TABLET, LITEST_ANY);
 	litest_add_for_device(motion_outside_bounds, LITEST_WACOM_CINTIQ_24HD);
 	litest_add(tilt_available, LITEST_TABLET|LITEST_TILT, LITEST_ANY);
 	litest_add(tilt_not_available, LITEST_TABLET, LITEST_TILT);
@@ -6195,4 +6418,10 @@ TEST_COLLECTION(tablet)
 	litest_add_ranged_for_device(huion_static_btn_tool_pen_disable_quirk_on_prox_out, LITEST_HUION_TABLET, &with_timeout);
 
 	litest_add_for_device(tablet_smoothing, LITEST_WACOM_HID4800_PEN);
+	/* The filter depends on the time between frames, these need the
+	 * frames stamped by the virtual clock */
+	if (litest_has_virtual_clock() && litest_has_virtual_devices()) {
+		litest_add_for_device(tablet_smoothing_adaptive_slow, LITEST_GENERIC_ADAPTIVE_PEN);
+		litest_add_for_device(tablet_smoothing_adaptive_fast, LITEST_GENERIC_ADAPTIVE_PEN);
+	}
 }
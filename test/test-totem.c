@@ -589,14 +589,17 @@ TEST_COLLECTION(totem)
 	litest_add(totem_type, LITEST_TOTEM, LITEST_ANY);
 	litest_add(totem_axes, LITEST_TOTEM, LITEST_ANY);
 	litest_add(totem_proximity_in_out, LITEST_TOTEM, LITEST_ANY);
-	litest_add(totem_proximity_in_on_init, LITEST_TOTEM, LITEST_ANY);
-	litest_add(totem_proximity_out_on_suspend, LITEST_TOTEM, LITEST_ANY);
+	if (!litest_has_virtual_devices()) {
+		litest_add(totem_proximity_in_on_init, LITEST_TOTEM, LITEST_ANY);
+		litest_add(totem_proximity_out_on_suspend, LITEST_TOTEM, LITEST_ANY);
+	}
 
 	litest_add(totem_motion, LITEST_TOTEM, LITEST_ANY);
 	litest_add(totem_rotation, LITEST_TOTEM, LITEST_ANY);
 	litest_add(totem_size, LITEST_TOTEM, LITEST_ANY);
 	litest_add(totem_button, LITEST_TOTEM, LITEST_ANY);
-	litest_add(totem_button_down_on_init, LITEST_TOTEM, LITEST_ANY);
+	if (!litest_has_virtual_devices())
+		litest_add(totem_button_down_on_init, LITEST_TOTEM, LITEST_ANY);
 	litest_add_no_device(totem_button_up_on_delete);
 
 	litest_add(totem_arbitration_below, LITEST_TOTEM, LITEST_ANY);
@@ -1338,6 +1338,322 @@ START_TEST(touch_palm_detect_tool_palm_keep_type_2fg)
 }
 END_TEST
 
+/* PREDICTION_MAX_TOUCHES in src/prediction.h, slots above that aren't
+ * predicted */
+#define PREDICTION_MAX_TOUCHES 16
+
+/* Returns the next touch event of the given type, the frame after it
+ * is discarded */
+static struct libinput_event *
+touch_prediction_next(struct libinput *li, enum libinput_event_type type)
+{
+	struct libinput_event *event, *frame;
+
+	libinput_dispatch(li);
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, type);
+
+	frame = libinput_get_event(li);
+	litest_is_touch_event(frame, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(frame);
+
+	return event;
+}
+
+static void
+assert_touch_not_predicted(struct libinput_event *event)
+{
+	struct libinput_event_touch *tev = libinput_event_get_touch_event(event);
+
+	ck_assert_double_eq(libinput_event_touch_get_x_predicted(tev),
+			    libinput_event_touch_get_x(tev));
+	ck_assert_double_eq(libinput_event_touch_get_y_predicted(tev),
+			    libinput_event_touch_get_y(tev));
+	ck_assert_double_eq(libinput_event_touch_get_x_predicted_transformed(tev, 1000),
+			    libinput_event_touch_get_x_transformed(tev, 1000));
+	ck_assert_double_eq(libinput_event_touch_get_y_predicted_transformed(tev, 1000),
+			    libinput_event_touch_get_y_transformed(tev, 1000));
+}
+
+static inline void
+assert_prediction_ahead(double value, double predicted, double delta)
+{
+	if (delta > 0.0)
+		ck_assert_double_gt(predicted, value);
+	else if (delta < 0.0)
+		ck_assert_double_lt(predicted, value);
+	else
+		ck_assert_double_eq(predicted, value);
+}
+
+/* The touch moves in a straight line at constant speed, so the
+ * prediction is ahead of it in the direction it moved since the
+ * previous position in x and y. Those are updated to this event's. */
+static void
+assert_touch_predicted(struct libinput_event *event, double *x, double *y)
+{
+	struct libinput_event_touch *tev = libinput_event_get_touch_event(event);
+	double dx = libinput_event_touch_get_x(tev) - *x,
+	       dy = libinput_event_touch_get_y(tev) - *y;
+
+	ck_assert(dx != 0.0 || dy != 0.0);
+
+	assert_prediction_ahead(libinput_event_touch_get_x(tev),
+				libinput_event_touch_get_x_predicted(tev),
+				dx);
+	assert_prediction_ahead(libinput_event_touch_get_y(tev),
+				libinput_event_touch_get_y_predicted(tev),
+				dy);
+	assert_prediction_ahead(libinput_event_touch_get_x_transformed(tev, 1000),
+				libinput_event_touch_get_x_predicted_transformed(tev, 1000),
+				dx);
+	assert_prediction_ahead(libinput_event_touch_get_y_transformed(tev, 1000),
+				libinput_event_touch_get_y_predicted_transformed(tev, 1000),
+				dy);
+
+	*x = libinput_event_touch_get_x(tev);
+	*y = libinput_event_touch_get_y(tev);
+}
+
+START_TEST(touch_motion_prediction)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput_event *event;
+	struct libinput_event_touch *tev;
+	double x, y;
+
+	ck_assert_int_eq(libinput_device_set_motion_prediction(device, 10),
+			 LIBINPUT_CONFIG_STATUS_SUCCESS);
+	litest_drain_events(li);
+
+	/* a new touch has no history, the prediction is where it is */
+	litest_touch_down(dev, 0, 20, 50);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_DOWN);
+	assert_touch_not_predicted(event);
+	tev = libinput_event_get_touch_event(event);
+	x = libinput_event_touch_get_x(tev);
+	y = libinput_event_touch_get_y(tev);
+	libinput_event_destroy(event);
+
+	for (int i = 1; i <= 10; i++) {
+		litest_sleep_ms(5);
+		litest_touch_move(dev, 0, 20 + 2 * i, 50);
+		event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_MOTION);
+		assert_touch_predicted(event, &x, &y);
+		libinput_event_destroy(event);
+	}
+
+	litest_touch_up(dev, 0);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_UP);
+	libinput_event_destroy(event);
+
+	/* the next touch on the same slot starts afresh, even though it
+	 * goes down where the last one was heading */
+	litest_sleep_ms(5);
+	litest_touch_down(dev, 0, 50, 50);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_DOWN);
+	assert_touch_not_predicted(event);
+	libinput_event_destroy(event);
+
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_device_set_motion_prediction(device, 0),
+			 LIBINPUT_CONFIG_STATUS_SUCCESS);
+}
+END_TEST
+
+START_TEST(touch_motion_prediction_slots)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput_event *event;
+	struct libinput_event_touch *tev;
+	double x0, y0, x1, y1;
+
+	ck_assert_int_eq(libinput_device_set_motion_prediction(device, 10),
+			 LIBINPUT_CONFIG_STATUS_SUCCESS);
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 20, 30);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_DOWN);
+	tev = libinput_event_get_touch_event(event);
+	x0 = libinput_event_touch_get_x(tev);
+	y0 = libinput_event_touch_get_y(tev);
+	libinput_event_destroy(event);
+
+	for (int i = 1; i <= 5; i++) {
+		litest_sleep_ms(5);
+		litest_touch_move(dev, 0, 20 + 2 * i, 30);
+		event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_MOTION);
+		assert_touch_predicted(event, &x0, &y0);
+		libinput_event_destroy(event);
+	}
+
+	/* the second touch has its own history... */
+	litest_sleep_ms(5);
+	litest_touch_down(dev, 1, 20, 70);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_DOWN);
+	assert_touch_not_predicted(event);
+	tev = libinput_event_get_touch_event(event);
+	x1 = libinput_event_touch_get_x(tev);
+	y1 = libinput_event_touch_get_y(tev);
+	libinput_event_destroy(event);
+
+	/* ...and going down didn't reset the first touch's */
+	litest_sleep_ms(5);
+	litest_touch_move(dev, 0, 32, 30);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_MOTION);
+	assert_touch_predicted(event, &x0, &y0);
+	libinput_event_destroy(event);
+
+	litest_sleep_ms(5);
+	litest_touch_move(dev, 1, 24, 70);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_MOTION);
+	assert_touch_predicted(event, &x1, &y1);
+	libinput_event_destroy(event);
+
+	/* a new touch on the first slot starts afresh */
+	litest_touch_up(dev, 0);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_UP);
+	libinput_event_destroy(event);
+	litest_sleep_ms(5);
+	litest_touch_down(dev, 0, 40, 30);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_DOWN);
+	assert_touch_not_predicted(event);
+	libinput_event_destroy(event);
+
+	litest_touch_up(dev, 0);
+	litest_touch_up(dev, 1);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+}
+END_TEST
+
+START_TEST(touch_motion_prediction_max_slots)
+{
+	struct litest_device *dev;
+	struct libinput *li;
+	struct libinput_event *event;
+	struct libinput_event_touch *tev;
+	const int last = PREDICTION_MAX_TOUCHES - 1;
+	double x, y;
+	struct input_absinfo abs[] = {
+		{ ABS_MT_SLOT, 0, PREDICTION_MAX_TOUCHES, 0, 0, 0 },
+		{ .value = -1 },
+	};
+
+	dev = litest_create_device_with_overrides(LITEST_WACOM_TOUCH,
+						  "litest Multi-touch device",
+						  NULL, abs, NULL);
+	li = dev->libinput;
+
+	ck_assert_int_eq(libinput_device_set_motion_prediction(dev->libinput_device,
+								10),
+			 LIBINPUT_CONFIG_STATUS_SUCCESS);
+	litest_drain_events(li);
+
+	litest_touch_down(dev, last, 20, 30);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_DOWN);
+	tev = libinput_event_get_touch_event(event);
+	x = libinput_event_touch_get_x(tev);
+	y = libinput_event_touch_get_y(tev);
+	libinput_event_destroy(event);
+
+	litest_touch_down(dev, last + 1, 20, 70);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_DOWN);
+	libinput_event_destroy(event);
+
+	/* the last slot with a predictor keeps predicting, the one after
+	 * it never does */
+	for (int i = 1; i <= 5; i++) {
+		litest_sleep_ms(5);
+		litest_touch_move(dev, last, 20 + 2 * i, 30);
+		event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_MOTION);
+		assert_touch_predicted(event, &x, &y);
+		libinput_event_destroy(event);
+
+		litest_touch_move(dev, last + 1, 20 + 2 * i, 70);
+		event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_MOTION);
+		assert_touch_not_predicted(event);
+		libinput_event_destroy(event);
+	}
+
+	litest_touch_up(dev, last);
+	litest_touch_up(dev, last + 1);
+	libinput_dispatch(li);
+	litest_drain_events(li);
+
+	litest_delete_device(dev);
+}
+END_TEST
+
+START_TEST(touch_motion_prediction_error)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput_event *event;
+	struct libinput_event_touch *tev;
+	double x, y, step = 0.0;
+	double mean_error = -1, max_error = -1;
+	uint64_t nmotion = 0;
+
+	/* 2.4 frames ahead, the predictions fall between two events */
+	ck_assert_int_eq(libinput_device_set_motion_prediction(device, 12),
+			 LIBINPUT_CONFIG_STATUS_SUCCESS);
+	litest_drain_events(li);
+
+	litest_touch_down(dev, 0, 20, 50);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_DOWN);
+	tev = libinput_event_get_touch_event(event);
+	x = libinput_event_touch_get_x(tev);
+	y = libinput_event_touch_get_y(tev);
+	libinput_event_destroy(event);
+
+	for (int i = 1; i <= 20; i++) {
+		double dx, dy;
+
+		litest_sleep_ms(5);
+		litest_touch_move(dev, 0, 20 + 2 * i, 50);
+		event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_MOTION);
+		tev = libinput_event_get_touch_event(event);
+		dx = libinput_event_touch_get_x(tev) - x;
+		dy = libinput_event_touch_get_y(tev) - y;
+		step = hypot(dx, dy);
+		x = libinput_event_touch_get_x(tev);
+		y = libinput_event_touch_get_y(tev);
+		libinput_event_destroy(event);
+		nmotion++;
+	}
+
+	litest_touch_up(dev, 0);
+	event = touch_prediction_next(li, LIBINPUT_EVENT_TOUCH_UP);
+	libinput_event_destroy(event);
+
+	/* Every motion event made a prediction and every prediction is
+	 * scored, the ones still pending at touch up against where the
+	 * touch ended */
+	ck_assert_int_eq(libinput_device_get_motion_prediction_error(device,
+								     &mean_error,
+								     &max_error),
+			 nmotion);
+
+	/* The prediction lands 0.4 steps past the last event before its
+	 * horizon, only the last ones overshoot the end of the stroke by
+	 * up to 2.4 steps. Without prediction each event would be 2.4
+	 * steps behind. */
+	ck_assert_double_gt(step, 0.0);
+	ck_assert_double_lt(mean_error, step);
+	ck_assert_double_lt(max_error, 3 * step);
+	ck_assert_double_ge(max_error, mean_error);
+}
+END_TEST
+
 TEST_COLLECTION(touch)
 {
 	struct range axes = { ABS_X, ABS_Y + 1};
@@ -1356,7 +1672,8 @@ TEST_COLLECTION(touch)
 	litest_add(touch_calibration_translation, LITEST_TOUCH, LITEST_TOUCHPAD);
 	litest_add(touch_calibration_translation, LITEST_SINGLE_TOUCH, LITEST_TOUCHPAD);
 	litest_add_for_device(touch_calibrated_screen_path, LITEST_CALIBRATED_TOUCHSCREEN);
-	litest_add_for_device(touch_calibrated_screen_udev, LITEST_CALIBRATED_TOUCHSCREEN);
+	if (!litest_has_virtual_devices())
+		litest_add_for_device(touch_calibrated_screen_udev, LITEST_CALIBRATED_TOUCHSCREEN);
 	litest_add(touch_calibration_config, LITEST_TOUCH, LITEST_ANY);
 
 	litest_add(touch_no_left_handed, LITEST_TOUCH, LITEST_ANY);
@@ -1368,12 +1685,14 @@ TEST_COLLECTION(touch)
 	litest_add(touch_protocol_a_touch, LITEST_PROTOCOL_A, LITEST_ANY);
 	litest_add(touch_protocol_a_2fg_touch, LITEST_PROTOCOL_A, LITEST_ANY);
 
-	litest_add_ranged(touch_initial_state, LITEST_TOUCH, LITEST_PROTOCOL_A, &axes);
+	if (!litest_has_virtual_devices())
+		litest_add_ranged(touch_initial_state, LITEST_TOUCH, LITEST_PROTOCOL_A, &axes);
 
 	litest_add(touch_time_usec, LITEST_TOUCH, LITEST_TOUCHPAD);
 
 	litest_add_for_device(touch_fuzz, LITEST_MULTITOUCH_FUZZ_SCREEN);
-	litest_add_for_device(touch_fuzz_property, LITEST_MULTITOUCH_FUZZ_SCREEN);
+	if (!litest_has_virtual_devices())
+		litest_add_for_device(touch_fuzz_property, LITEST_MULTITOUCH_FUZZ_SCREEN);
 
 	litest_add_no_device(touch_release_on_unplug);
 
@@ -1391,4 +1710,11 @@ TEST_COLLECTION(touch)
 	litest_add(touch_palm_detect_tool_palm_2fg, LITEST_TOUCH, LITEST_SINGLE_TOUCH);
 	litest_add(touch_palm_detect_tool_palm_on_off_2fg, LITEST_TOUCH, LITEST_SINGLE_TOUCH);
 	litest_add(touch_palm_detect_tool_palm_keep_type_2fg, LITEST_TOUCH, LITEST_ANY);
+
+	litest_add(touch_motion_prediction, LITEST_TOUCH, LITEST_ANY);
+	litest_add(touch_motion_prediction_slots, LITEST_TOUCH, LITEST_SINGLE_TOUCH|LITEST_PROTOCOL_A);
+	litest_add_no_device(touch_motion_prediction_max_slots);
+	/* needs events timestamped by the clock the test sleeps on */
+	if (!litest_has_virtual_clock() || litest_has_virtual_devices())
+		litest_add(touch_motion_prediction_error, LITEST_TOUCH, LITEST_ANY);
 }
@@ -2192,5 +2192,6 @@ TEST_COLLECTION(touchpad_buttons)
 	litest_add(clickpad_middleemulation_click_disable_while_down, LITEST_CLICKPAD, LITEST_ANY);
 
 	litest_add_no_device(touchpad_clickpad_detection);
-	litest_add_no_device(touchpad_non_clickpad_detection);
+	if (!litest_has_virtual_devices())
+		litest_add_no_device(touchpad_non_clickpad_detection);
 }
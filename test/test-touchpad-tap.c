@@ -118,7 +118,7 @@ START_TEST(touchpad_doubletap)
 		/* fallthrough */
 		break;
 	}
-	msleep(10);
+	litest_sleep_ms(10);
 	switch (nfingers) {
 	case 3:
 		litest_touch_up(dev, 2);
@@ -131,7 +131,7 @@ START_TEST(touchpad_doubletap)
 		/* fallthrough */
 		break;
 	}
-	msleep(10);
+	litest_sleep_ms(10);
 
 	switch (nfingers2) {
 	case 3:
@@ -145,7 +145,7 @@ START_TEST(touchpad_doubletap)
 		/* fallthrough */
 		break;
 	}
-	msleep(10);
+	litest_sleep_ms(10);
 	switch (nfingers2) {
 	case 3:
 		litest_touch_up(dev, 2);
@@ -261,7 +261,7 @@ START_TEST(touchpad_multitap)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	litest_timeout_tap();
@@ -351,7 +351,7 @@ START_TEST(touchpad_multitap_n_drag_move)
 			break;
 		}
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	libinput_dispatch(li);
@@ -465,7 +465,7 @@ START_TEST(touchpad_multitap_n_drag_2fg)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	libinput_dispatch(li);
@@ -580,7 +580,7 @@ START_TEST(touchpad_multitap_n_drag_click)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	litest_touch_down(dev, 0, 50, 50);
@@ -668,7 +668,7 @@ START_TEST(touchpad_multitap_timeout)
 			/* fallthrough */
 			break;
 		}
-		msleep(10);
+		litest_sleep_ms(10);
 		switch (nfingers) {
 		case 3:
 			litest_touch_up(dev, 2);
@@ -683,7 +683,7 @@ START_TEST(touchpad_multitap_timeout)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	libinput_dispatch(li);
@@ -759,7 +759,7 @@ START_TEST(touchpad_multitap_n_drag_timeout)
 			/* fallthrough */
 			break;
 		}
-		msleep(10);
+		litest_sleep_ms(10);
 		switch (nfingers) {
 		case 3:
 			litest_touch_up(dev, 2);
@@ -774,7 +774,7 @@ START_TEST(touchpad_multitap_n_drag_timeout)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	libinput_dispatch(li);
@@ -875,7 +875,7 @@ START_TEST(touchpad_multitap_n_drag_high_delay)
 			break;
 		}
 		libinput_dispatch(li);
-		msleep(100);
+		litest_sleep_ms(100);
 
 		switch (nfingers) {
 		case 3:
@@ -890,7 +890,7 @@ START_TEST(touchpad_multitap_n_drag_high_delay)
 			break;
 		}
 		libinput_dispatch(li);
-		msleep(100);
+		litest_sleep_ms(100);
 	}
 
 	libinput_dispatch(li);
@@ -968,7 +968,7 @@ START_TEST(touchpad_multitap_n_drag_tap)
 			/* fallthrough */
 			break;
 		}
-		msleep(10);
+		litest_sleep_ms(10);
 		switch (nfingers) {
 		case 3:
 			litest_touch_up(dev, 2);
@@ -983,7 +983,7 @@ START_TEST(touchpad_multitap_n_drag_tap)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	libinput_dispatch(li);
@@ -1084,7 +1084,7 @@ START_TEST(touchpad_multitap_n_drag_tap_click)
 			/* fallthrough */
 			break;
 		}
-		msleep(10);
+		litest_sleep_ms(10);
 		switch (nfingers) {
 		case 3:
 			litest_touch_up(dev, 2);
@@ -1099,7 +1099,7 @@ START_TEST(touchpad_multitap_n_drag_tap_click)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	libinput_dispatch(li);
@@ -2845,11 +2845,11 @@ START_TEST(touchpad_3fg_tap)
 		litest_drain_events(li);
 
 		litest_touch_down(dev, 0, 50, 50);
-		msleep(5);
+		litest_sleep_ms(5);
 		litest_touch_down(dev, 1, 70, 50);
-		msleep(5);
+		litest_sleep_ms(5);
 		litest_touch_down(dev, 2, 80, 50);
-		msleep(10);
+		litest_sleep_ms(10);
 
 		litest_touch_up(dev, (i + 2) % 3);
 		litest_touch_up(dev, (i + 1) % 3);
@@ -2896,15 +2896,15 @@ START_TEST(touchpad_3fg_tap_tap_again)
 	litest_drain_events(li);
 
 	litest_touch_down(dev, 0, 50, 50);
-	msleep(5);
+	litest_sleep_ms(5);
 	litest_touch_down(dev, 1, 70, 50);
-	msleep(5);
+	litest_sleep_ms(5);
 	litest_touch_down(dev, 2, 80, 50);
-	msleep(10);
+	litest_sleep_ms(10);
 	litest_touch_up(dev, 0);
-	msleep(10);
+	litest_sleep_ms(10);
 	litest_touch_down(dev, 0, 80, 50);
-	msleep(10);
+	litest_sleep_ms(10);
 	litest_touch_up(dev, 0);
 	litest_touch_up(dev, 1);
 	litest_touch_up(dev, 2);
@@ -3261,7 +3261,7 @@ START_TEST(touchpad_3fg_tap_slot_release_btntool)
 	litest_event(dev, EV_KEY, BTN_TOUCH, 1);
 	litest_event(dev, EV_SYN, SYN_REPORT, 0);
 	libinput_dispatch(li);
-	msleep(2);
+	litest_sleep_ms(2);
 
 	/* touch 2 and TRIPLETAP down */
 	litest_event(dev, EV_ABS, ABS_MT_SLOT, 1);
@@ -3273,7 +3273,7 @@ START_TEST(touchpad_3fg_tap_slot_release_btntool)
 	litest_event(dev, EV_KEY, BTN_TOOL_TRIPLETAP, 1);
 	litest_event(dev, EV_SYN, SYN_REPORT, 0);
 	libinput_dispatch(li);
-	msleep(2);
+	litest_sleep_ms(2);
 
 	/* touch 2 up, coordinate jump + ends slot 1, TRIPLETAP stays */
 	litest_disable_log_handler(li);
@@ -3288,7 +3288,7 @@ START_TEST(touchpad_3fg_tap_slot_release_btntool)
 	litest_event(dev, EV_ABS, ABS_PRESSURE, 78);
 	litest_event(dev, EV_SYN, SYN_REPORT, 0);
 	libinput_dispatch(li);
-	msleep(2);
+	litest_sleep_ms(2);
 
 	/* slot 2 reactivated
 	 */
@@ -4005,7 +4005,7 @@ START_TEST(touchpad_drag_disabled_immediate)
 		/* fallthrough */
 		break;
 	}
-	msleep(10); /* to force a time difference */
+	litest_sleep_ms(10); /* to force a time difference */
 	libinput_dispatch(li);
 	switch (nfingers) {
 	case 3:
@@ -4101,7 +4101,7 @@ START_TEST(touchpad_drag_disabled_multitap_no_drag)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	libinput_dispatch(li);
@@ -5157,7 +5157,7 @@ START_TEST(touchpad_tap_palm_multitap)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	litest_touch_down(dev, 0, 50, 50);
@@ -5244,7 +5244,7 @@ START_TEST(touchpad_tap_palm_multitap_timeout)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	litest_touch_down(dev, 0, 50, 50);
@@ -5330,7 +5330,7 @@ START_TEST(touchpad_tap_palm_multitap_down_again)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	litest_touch_down(dev, 0, 50, 50);
@@ -5365,7 +5365,7 @@ START_TEST(touchpad_tap_palm_multitap_down_again)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	litest_timeout_tap();
@@ -5449,7 +5449,7 @@ START_TEST(touchpad_tap_palm_multitap_click)
 		}
 
 		libinput_dispatch(li);
-		msleep(10);
+		litest_sleep_ms(10);
 	}
 
 	litest_touch_down(dev, 0, 50, 50);
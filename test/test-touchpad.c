@@ -330,7 +330,7 @@ START_TEST(touchpad_2fg_scroll_axis_lock_switch)
 	ck_assert(is_single_axis_2fg_scroll(dev, axis));
 	litest_drain_events(li);
 
-	msleep(200);
+	litest_sleep_ms(200);
 	libinput_dispatch(li);
 
 	/* Move roughly vertically for >100ms to switch axis lock. This will
@@ -3768,7 +3768,7 @@ START_TEST(touchpad_dwt_enable_touch)
 
 	/* finger down after last key event, but
 	   we're still within timeout - no events */
-	msleep(10);
+	litest_sleep_ms(10);
 	litest_touch_down(touchpad, 0, 50, 50);
 	litest_touch_move_to(touchpad, 0, 50, 50, 70, 50, 10);
 	litest_assert_empty_queue(li);
@@ -3800,7 +3800,7 @@ START_TEST(touchpad_dwt_touch_hold)
 	litest_drain_events(li);
 
 	litest_keyboard_key(keyboard, KEY_A, true);
-	msleep(1); /* make sure touch starts after key press */
+	litest_sleep_ms(1); /* make sure touch starts after key press */
 	litest_touch_down(touchpad, 0, 50, 50);
 	litest_touch_move_to(touchpad, 0, 50, 50, 70, 50, 5);
 
@@ -4353,7 +4353,7 @@ START_TEST(touchpad_dwt_tap_drag)
 
 	litest_keyboard_key(keyboard, KEY_A, true);
 	libinput_dispatch(li);
-	msleep(1); /* make sure touch starts after key press */
+	litest_sleep_ms(1); /* make sure touch starts after key press */
 	litest_touch_down(touchpad, 0, 50, 50);
 	litest_touch_up(touchpad, 0);
 	litest_touch_down(touchpad, 0, 50, 50);
@@ -5303,7 +5303,7 @@ START_TEST(touchpad_thumb_no_doublethumb)
 	 * between to make it more likely that this is really testing thumb
 	 * detection.
 	 */
-	msleep(200);
+	litest_sleep_ms(200);
 	libinput_dispatch(li);
 	litest_touch_down(dev, 1, 70, 99);
 	libinput_dispatch(li);
@@ -5342,7 +5342,7 @@ START_TEST(touchpad_tool_tripletap_touch_count)
 	litest_event(dev, EV_KEY, BTN_TOUCH, 1);
 	litest_event(dev, EV_SYN, SYN_REPORT, 0);
 	libinput_dispatch(li);
-	msleep(2);
+	litest_sleep_ms(2);
 
 	/* touch 2 down */
 	litest_event(dev, EV_ABS, ABS_MT_SLOT, 1);
@@ -5354,7 +5354,7 @@ START_TEST(touchpad_tool_tripletap_touch_count)
 	litest_event(dev, EV_KEY, BTN_TOOL_DOUBLETAP, 1);
 	litest_event(dev, EV_SYN, SYN_REPORT, 0);
 	libinput_dispatch(li);
-	msleep(2);
+	litest_sleep_ms(2);
 
 	/* touch 3 down, coordinate jump + ends slot 1 */
 	litest_event(dev, EV_ABS, ABS_MT_SLOT, 0);
@@ -5370,7 +5370,7 @@ START_TEST(touchpad_tool_tripletap_touch_count)
 	litest_event(dev, EV_KEY, BTN_TOOL_TRIPLETAP, 1);
 	litest_event(dev, EV_SYN, SYN_REPORT, 0);
 	libinput_dispatch(li);
-	msleep(2);
+	litest_sleep_ms(2);
 
 	/* slot 2 reactivated */
 	litest_event(dev, EV_ABS, ABS_MT_SLOT, 0);
@@ -5387,7 +5387,7 @@ START_TEST(touchpad_tool_tripletap_touch_count)
 	litest_event(dev, EV_ABS, ABS_PRESSURE, 78);
 	litest_event(dev, EV_SYN, SYN_REPORT, 0);
 	libinput_dispatch(li);
-	msleep(2);
+	litest_sleep_ms(2);
 
 	/* now a click should trigger middle click */
 	litest_event(dev, EV_KEY, BTN_LEFT, 1);
@@ -5448,7 +5448,7 @@ START_TEST(touchpad_tool_tripletap_touch_count_late)
 	litest_event(dev, EV_KEY, BTN_TOUCH, 1);
 	litest_event(dev, EV_SYN, SYN_REPORT, 0);
 	libinput_dispatch(li);
-	msleep(10);
+	litest_sleep_ms(10);
 
 	/* touch 2 and TRIPLETAP down */
 	litest_event(dev, EV_ABS, ABS_MT_SLOT, 1);
@@ -5460,7 +5460,7 @@ START_TEST(touchpad_tool_tripletap_touch_count_late)
 	litest_event(dev, EV_KEY, BTN_TOOL_TRIPLETAP, 1);
 	litest_event(dev, EV_SYN, SYN_REPORT, 0);
 	libinput_dispatch(li);
-	msleep(10);
+	litest_sleep_ms(10);
 
 	/* touch 2 up, coordinate jump + ends slot 1, TRIPLETAP stays */
 	litest_disable_log_handler(li);
@@ -5475,7 +5475,7 @@ START_TEST(touchpad_tool_tripletap_touch_count_late)
 	litest_event(dev, EV_ABS, ABS_PRESSURE, 78);
 	litest_event(dev, EV_SYN, SYN_REPORT, 0);
 	libinput_dispatch(li);
-	msleep(10);
+	litest_sleep_ms(10);
 
 	/* slot 2 reactivated */
 	litest_event(dev, EV_ABS, ABS_MT_SLOT, 0);
@@ -5492,7 +5492,7 @@ START_TEST(touchpad_tool_tripletap_touch_count_late)
 	litest_event(dev, EV_ABS, ABS_PRESSURE, 78);
 	litest_event(dev, EV_SYN, SYN_REPORT, 0);
 	libinput_dispatch(li);
-	msleep(10);
+	litest_sleep_ms(10);
 	litest_restore_log_handler(li);
 
 	/* now a click should trigger middle click */
@@ -7106,8 +7106,10 @@ TEST_COLLECTION(touchpad)
 	litest_add_for_device(touchpad_trackpoint_buttons_2fg_scroll, LITEST_SYNAPTICS_TRACKPOINT_BUTTONS);
 	litest_add_for_device(touchpad_trackpoint_no_trackpoint, LITEST_SYNAPTICS_TRACKPOINT_BUTTONS);
 
-	litest_add_ranged(touchpad_initial_state, LITEST_TOUCHPAD, LITEST_ANY, &axis_range);
-	litest_add_ranged(touchpad_fingers_down_before_init, LITEST_TOUCHPAD, LITEST_ANY, &five_fingers);
+	if (!litest_has_virtual_devices()) {
+		litest_add_ranged(touchpad_initial_state, LITEST_TOUCHPAD, LITEST_ANY, &axis_range);
+		litest_add_ranged(touchpad_fingers_down_before_init, LITEST_TOUCHPAD, LITEST_ANY, &five_fingers);
+	}
 	litest_add(touchpad_state_after_syn_dropped_2fg_change, LITEST_TOUCHPAD, LITEST_SINGLE_TOUCH);
 
 	litest_add(touchpad_dwt, LITEST_TOUCHPAD, LITEST_ANY);
@@ -7158,7 +7160,8 @@ TEST_COLLECTION(touchpad)
 	litest_add_for_device(touchpad_tool_tripletap_touch_count, LITEST_SYNAPTICS_TOPBUTTONPAD);
 	litest_add_for_device(touchpad_tool_tripletap_touch_count_late, LITEST_SYNAPTICS_TOPBUTTONPAD);
 	litest_add_for_device(touchpad_slot_swap, LITEST_SYNAPTICS_TOPBUTTONPAD);
-	litest_add_for_device(touchpad_finger_always_down, LITEST_SYNAPTICS_TOPBUTTONPAD);
+	if (!litest_has_virtual_devices())
+		litest_add_for_device(touchpad_finger_always_down, LITEST_SYNAPTICS_TOPBUTTONPAD);
 
 	litest_add(touchpad_time_usec, LITEST_TOUCHPAD, LITEST_ANY);
 
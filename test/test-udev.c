@@ -221,6 +221,112 @@ START_TEST(udev_added_seat_default)
 }
 END_TEST
 
+/* Enumerating with probe threads must add the same devices in the same
+ * order as the serial enumeration */
+START_TEST(udev_probe_threads)
+{
+	struct libinput *li;
+	struct libinput_event *event;
+	struct udev *udev;
+	char *serial[64] = {0},
+	     *threaded[64] = {0};
+	size_t nserial = 0,
+	       nthreaded = 0;
+
+	udev = udev_new();
+	ck_assert_notnull(udev);
+
+	li = libinput_udev_create_context(&simple_interface, NULL, udev);
+	ck_assert_notnull(li);
+	ck_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		struct libinput_device *device;
+
+		if (libinput_event_get_type(event) == LIBINPUT_EVENT_DEVICE_ADDED &&
+		    nserial < ARRAY_LENGTH(serial)) {
+			device = libinput_event_get_device(event);
+			serial[nserial++] = safe_strdup(libinput_device_get_sysname(device));
+		}
+		libinput_event_destroy(event);
+	}
+	libinput_unref(li);
+
+	li = libinput_udev_create_context(&simple_interface, NULL, udev);
+	ck_assert_notnull(li);
+	ck_assert_int_eq(libinput_udev_set_probe_threads(li, 4), 0);
+	ck_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		struct libinput_device *device;
+
+		if (libinput_event_get_type(event) == LIBINPUT_EVENT_DEVICE_ADDED &&
+		    nthreaded < ARRAY_LENGTH(threaded)) {
+			device = libinput_event_get_device(event);
+			threaded[nthreaded++] = safe_strdup(libinput_device_get_sysname(device));
+		}
+		libinput_event_destroy(event);
+	}
+	libinput_unref(li);
+
+	/* Same devices in the same order */
+	ck_assert_int_gt(nserial, 0);
+	ck_assert_int_eq(nserial, nthreaded);
+	for (size_t i = 0; i < nserial; i++) {
+		ck_assert_str_eq(serial[i], threaded[i]);
+		free(serial[i]);
+		free(threaded[i]);
+	}
+
+	udev_unref(udev);
+}
+END_TEST
+
+static size_t
+count_added_devices(struct libinput *li)
+{
+	struct libinput_event *event;
+	size_t count = 0;
+
+	libinput_dispatch(li);
+	while ((event = libinput_get_event(li))) {
+		if (libinput_event_get_type(event) == LIBINPUT_EVENT_DEVICE_ADDED)
+			count++;
+		libinput_event_destroy(event);
+	}
+
+	return count;
+}
+
+START_TEST(udev_probe_threads_resume)
+{
+	struct libinput *li;
+	struct udev *udev;
+	size_t nadded;
+
+	udev = udev_new();
+	ck_assert_notnull(udev);
+
+	li = libinput_udev_create_context(&simple_interface, NULL, udev);
+	ck_assert_notnull(li);
+	ck_assert_int_eq(libinput_udev_set_probe_threads(li, 4), 0);
+	ck_assert_int_eq(libinput_udev_assign_seat(li, "seat0"), 0);
+	nadded = count_added_devices(li);
+	ck_assert_int_gt(nadded, 0);
+
+	libinput_suspend(li);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_resume(li), 0);
+	ck_assert_int_eq(count_added_devices(li), nadded);
+
+	libinput_unref(li);
+	udev_unref(udev);
+}
+END_TEST
+
 /**
  * This test only works if there's at least one device in the system that is
  * assigned the default seat. Should cover the 99% case.
@@ -674,6 +780,10 @@ END_TEST
 
 TEST_COLLECTION(udev)
 {
+	/* All of these use a udev context */
+	if (litest_has_virtual_devices())
+		return;
+
 	litest_add_no_device(udev_create_NULL);
 	litest_add_no_device(udev_create_seat0);
 	litest_add_no_device(udev_create_empty_seat);
@@ -682,6 +792,8 @@ TEST_COLLECTION(udev)
 
 	litest_add_no_device(udev_added_seat_default);
 	litest_add_no_device(udev_change_seat);
+	litest_add_for_device(udev_probe_threads, LITEST_SYNAPTICS_CLICKPAD_X220);
+	litest_add_for_device(udev_probe_threads_resume, LITEST_SYNAPTICS_CLICKPAD_X220);
 
 	litest_add_for_device(udev_double_suspend, LITEST_SYNAPTICS_CLICKPAD_X220);
 	litest_add_for_device(udev_double_resume, LITEST_SYNAPTICS_CLICKPAD_X220);
@@ -1060,6 +1060,30 @@ START_TEST(strargv_test)
 }
 END_TEST
 
+START_TEST(strv_find_value_test)
+{
+	char *props[] = {
+		"ID_INPUT=1",
+		"ID_INPUT_MOUSE=1",
+		"NAME=",
+		"MOUSE_DPI=800@125",
+		NULL,
+	};
+
+	ck_assert_str_eq(strv_find_value(props, "ID_INPUT"), "1");
+	ck_assert_str_eq(strv_find_value(props, "ID_INPUT_MOUSE"), "1");
+	ck_assert_str_eq(strv_find_value(props, "NAME"), "");
+	ck_assert_str_eq(strv_find_value(props, "MOUSE_DPI"), "800@125");
+
+	/* prefixes of a key don't match */
+	ck_assert_ptr_eq(strv_find_value(props, "ID_IN"), NULL);
+	ck_assert_ptr_eq(strv_find_value(props, "MOUSE"), NULL);
+	ck_assert_ptr_eq(strv_find_value(props, "ID_INPUT_TOUCHPAD"), NULL);
+
+	ck_assert_ptr_eq(strv_find_value(NULL, "ID_INPUT"), NULL);
+}
+END_TEST
+
 START_TEST(kvsplit_double_test)
 {
 	struct kvsplit_dbl_test {
@@ -1417,6 +1441,7 @@ litest_utils_suite(void)
 	tcase_add_test(tc, safe_atod_test);
 	tcase_add_test(tc, strsplit_test);
 	tcase_add_test(tc, strargv_test);
+	tcase_add_test(tc, strv_find_value_test);
 	tcase_add_test(tc, kvsplit_double_test);
 	tcase_add_test(tc, strjoin_test);
 	tcase_add_test(tc, strstrip_test);
@@ -0,0 +1,1320 @@
+/*
+ * Copyright © 2021 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Replays a libinput record file through an in-process libinput context.
+ *
+ * This tool links against libinput's internals: the recorded devices are
+ * created as virtual devices (see evdev_device_create_virtual()) so no
+ * uinput devices, udev or root privileges are required. Events are fed
+ * straight into the device's dispatch, either as fast as possible or
+ * scaled to the recorded timing.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <libevdev/libevdev.h>
+
+#include "libinput.h"
+#include "libinput-private.h"
+#include "evdev.h"
+#include "path-seat.h"
+#include "timer.h"
+#include "util-input-event.h"
+#include "shared.h"
+
+#define FILE_VERSION_NUMBER 1
+
+struct replay_frame {
+	uint64_t time;		/* recorded time of the first event */
+	size_t first;		/* index into replay_device.events */
+	size_t nevents;
+};
+
+/* Recorded and replayed events are compared by type, time and, for the
+ * event types listed in event_values(), their payload. The payload is
+ * compared within the precision libinput record prints it with, the time
+ * within TIME_TOLERANCE_US: timers fire on time during the replay but
+ * whenever the process got to it during the recording. */
+#define VALUE_TOLERANCE 0.01
+#define TIME_TOLERANCE_US ms2us(10)
+#define MAX_VALUES 6
+
+struct replay_event {
+	enum libinput_event_type type;
+	uint64_t time;		/* in recording time */
+	double values[MAX_VALUES];
+	size_t nvalues;
+};
+
+struct event_list {
+	struct replay_event *events;
+	size_t nevents;
+	size_t sz;
+};
+
+struct replay_device {
+	char *node;
+	char *name;
+	int id[4];
+
+	struct libevdev *evdev;
+	char **properties;
+	size_t nproperties;
+
+	struct input_event *events;
+	size_t nevents;
+	size_t events_sz;
+
+	struct replay_frame *frames;
+	size_t nframes;
+	size_t frames_sz;
+	bool frame_open;
+
+	struct event_list recorded;
+	struct event_list replayed;
+
+	struct libinput_device *device;
+	size_t next_frame;
+};
+
+struct replay_context {
+	struct replay_device *devices;
+	size_t ndevices;
+
+	double speed;		/* 0 means as fast as possible */
+	bool verbose;
+
+	struct libinput *libinput;
+	uint64_t base;		/* libinput time the replay started */
+	uint64_t offset;	/* recorded time of the first frame */
+
+	struct input_event *frame; /* scratch buffer for the current frame */
+	uint64_t *frame_times;	/* processing time per frame in ns */
+	size_t nframe_times;
+	uint64_t nevdev_events;
+	uint64_t nlibinput_events;
+};
+
+static const struct {
+	enum libinput_event_type type;
+	const char *name;
+} event_names[] = {
+	{ LIBINPUT_EVENT_KEYBOARD_KEY, "KEYBOARD_KEY" },
+	{ LIBINPUT_EVENT_POINTER_MOTION, "POINTER_MOTION" },
+	{ LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, "POINTER_MOTION_ABSOLUTE" },
+	{ LIBINPUT_EVENT_POINTER_BUTTON, "POINTER_BUTTON" },
+	{ LIBINPUT_EVENT_POINTER_AXIS, "POINTER_AXIS" },
+	{ LIBINPUT_EVENT_TOUCH_DOWN, "TOUCH_DOWN" },
+	{ LIBINPUT_EVENT_TOUCH_UP, "TOUCH_UP" },
+	{ LIBINPUT_EVENT_TOUCH_MOTION, "TOUCH_MOTION" },
+	{ LIBINPUT_EVENT_TOUCH_CANCEL, "TOUCH_CANCEL" },
+	{ LIBINPUT_EVENT_TOUCH_FRAME, "TOUCH_FRAME" },
+	{ LIBINPUT_EVENT_TABLET_TOOL_AXIS, "TABLET_TOOL_AXIS" },
+	{ LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY, "TABLET_TOOL_PROXIMITY" },
+	{ LIBINPUT_EVENT_TABLET_TOOL_TIP, "TABLET_TOOL_TIP" },
+	{ LIBINPUT_EVENT_TABLET_TOOL_BUTTON, "TABLET_TOOL_BUTTON" },
+	{ LIBINPUT_EVENT_TABLET_PAD_BUTTON, "TABLET_PAD_BUTTON" },
+	{ LIBINPUT_EVENT_TABLET_PAD_RING, "TABLET_PAD_RING" },
+	{ LIBINPUT_EVENT_TABLET_PAD_STRIP, "TABLET_PAD_STRIP" },
+	{ LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN, "GESTURE_SWIPE_BEGIN" },
+	{ LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE, "GESTURE_SWIPE_UPDATE" },
+	{ LIBINPUT_EVENT_GESTURE_SWIPE_END, "GESTURE_SWIPE_END" },
+	{ LIBINPUT_EVENT_GESTURE_PINCH_BEGIN, "GESTURE_PINCH_BEGIN" },
+	{ LIBINPUT_EVENT_GESTURE_PINCH_UPDATE, "GESTURE_PINCH_UPDATE" },
+	{ LIBINPUT_EVENT_GESTURE_PINCH_END, "GESTURE_PINCH_END" },
+	{ LIBINPUT_EVENT_SWITCH_TOGGLE, "SWITCH_TOGGLE" },
+};
+
+static const char *
+event_type_name(enum libinput_event_type type)
+{
+	for (size_t i = 0; i < ARRAY_LENGTH(event_names); i++) {
+		if (event_names[i].type == type)
+			return event_names[i].name;
+	}
+
+	return NULL;
+}
+
+static enum libinput_event_type
+event_type_from_name(const char *name, size_t len)
+{
+	for (size_t i = 0; i < ARRAY_LENGTH(event_names); i++) {
+		if (strlen(event_names[i].name) == len &&
+		    strneq(event_names[i].name, name, len))
+			return event_names[i].type;
+	}
+
+	return LIBINPUT_EVENT_NONE;
+}
+
+static void *
+grow(void *array, size_t *sz, size_t n, size_t elsize)
+{
+	if (n < *sz)
+		return array;
+
+	*sz = max(*sz * 2, 64U);
+	array = realloc(array, *sz * elsize);
+	if (!array)
+		abort();
+
+	return array;
+}
+
+static struct replay_event *
+event_list_append(struct event_list *l, enum libinput_event_type type)
+{
+	struct replay_event *e;
+
+	l->events = grow(l->events, &l->sz, l->nevents, sizeof(*l->events));
+	e = &l->events[l->nevents++];
+	memset(e, 0, sizeof(*e));
+	e->type = type;
+
+	return e;
+}
+
+static inline uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Parsing the recording. This is not a YAML parser, it only understands
+ * the subset of YAML that libinput record writes. */
+
+enum section {
+	SECTION_NONE,
+	SECTION_EVDEV,
+	SECTION_CODES,
+	SECTION_ABSINFO,
+	SECTION_UDEV,
+	SECTION_EVENTS,
+	SECTION_EVENTS_EVDEV,
+	SECTION_EVENTS_LIBINPUT,
+	SECTION_OTHER,
+};
+
+struct parser {
+	const char *filename;
+	unsigned int lineno;
+	enum section section;
+	struct replay_device *device;
+
+	/* The description, applied to the libevdev device once the
+	 * device's events start */
+	unsigned char codes[EV_CNT][NCHARS(KEY_CNT)];
+	struct input_absinfo absinfo[ABS_CNT];
+	unsigned char props[NCHARS(INPUT_PROP_CNT)];
+};
+
+static void
+parser_error(struct parser *p, const char *msg)
+{
+	fprintf(stderr, "%s:%u: %s\n", p->filename, p->lineno, msg);
+}
+
+/* Parses a "[1, 2, 3]" list, returns the number of values or -1 */
+static int
+parse_int_list(const char *str, int *values, size_t nvalues)
+{
+	size_t n = 0;
+	char *end;
+
+	str = strchr(str, '[');
+	if (!str)
+		return -1;
+	str++;
+
+	while (*str) {
+		long v;
+
+		while (*str == ' ')
+			str++;
+		if (*str == ']')
+			return n;
+
+		errno = 0;
+		v = strtol(str, &end, 10);
+		if (errno != 0 || end == str || n >= nvalues)
+			return -1;
+		values[n++] = v;
+
+		str = end;
+		while (*str == ' ')
+			str++;
+		if (*str == ',')
+			str++;
+	}
+
+	return -1;
+}
+
+static bool
+parser_new_device(struct parser *p,
+		  struct replay_context *ctx,
+		  const char *node)
+{
+	struct replay_device *d;
+
+	ctx->devices = realloc(ctx->devices,
+			       (ctx->ndevices + 1) * sizeof(*ctx->devices));
+	if (!ctx->devices)
+		abort();
+
+	d = &ctx->devices[ctx->ndevices++];
+	memset(d, 0, sizeof(*d));
+	d->node = safe_strdup(node);
+
+	p->device = d;
+	p->section = SECTION_NONE;
+	memset(p->codes, 0, sizeof(p->codes));
+	memset(p->absinfo, 0, sizeof(p->absinfo));
+	memset(p->props, 0, sizeof(p->props));
+
+	return true;
+}
+
+static bool
+parser_build_evdev(struct parser *p)
+{
+	struct replay_device *d = p->device;
+	struct libevdev *evdev;
+
+	if (d->evdev)
+		return true;
+
+	if (!d->name) {
+		parser_error(p, "device without an evdev description");
+		return false;
+	}
+
+	evdev = libevdev_new();
+	if (!evdev)
+		abort();
+
+	libevdev_set_name(evdev, d->name);
+	libevdev_set_id_bustype(evdev, d->id[0]);
+	libevdev_set_id_vendor(evdev, d->id[1]);
+	libevdev_set_id_product(evdev, d->id[2]);
+	libevdev_set_id_version(evdev, d->id[3]);
+
+	for (unsigned int type = 0; type < EV_CNT; type++) {
+		int max = libevdev_event_type_get_max(type);
+
+		for (int code = 0; code <= max; code++) {
+			const void *data = NULL;
+			int rep;
+
+			if (!bit_is_set(p->codes[type], code))
+				continue;
+
+			if (type == EV_ABS) {
+				data = &p->absinfo[code];
+			} else if (type == EV_REP) {
+				rep = code == REP_DELAY ? 500 : 20;
+				data = &rep;
+			}
+
+			libevdev_enable_event_code(evdev, type, code, data);
+		}
+	}
+
+	for (unsigned int prop = 0; prop < INPUT_PROP_CNT; prop++) {
+		if (bit_is_set(p->props, prop))
+			libevdev_enable_property(evdev, prop);
+	}
+
+	d->evdev = evdev;
+
+	return true;
+}
+
+static bool
+parser_evdev_key(struct parser *p, const char *line)
+{
+	struct replay_device *d = p->device;
+	int values[INPUT_PROP_CNT];
+	int n;
+
+	if (strneq(line, "name: ", 6)) {
+		const char *name = line + 6;
+		size_t len = strlen(name);
+
+		if (len >= 2 && name[0] == '"' && name[len - 1] == '"')
+			d->name = strndup(name + 1, len - 2);
+		else
+			d->name = safe_strdup(name);
+	} else if (strneq(line, "id: ", 4)) {
+		if (parse_int_list(line, d->id, 4) != 4) {
+			parser_error(p, "invalid device id");
+			return false;
+		}
+	} else if (streq(line, "codes:")) {
+		p->section = SECTION_CODES;
+	} else if (streq(line, "absinfo:")) {
+		p->section = SECTION_ABSINFO;
+	} else if (strneq(line, "properties: ", 12)) {
+		n = parse_int_list(line, values, ARRAY_LENGTH(values));
+		if (n < 0) {
+			parser_error(p, "invalid property list");
+			return false;
+		}
+		for (int i = 0; i < n; i++) {
+			if (values[i] >= 0 && values[i] < INPUT_PROP_CNT)
+				set_bit(p->props, values[i]);
+		}
+		p->section = SECTION_EVDEV;
+	}
+
+	return true;
+}
+
+static bool
+parser_evdev_data(struct parser *p, const char *line)
+{
+	int values[KEY_CNT];
+	char *end;
+	long idx;
+	int n;
+
+	errno = 0;
+	idx = strtol(line, &end, 10);
+	if (errno != 0 || end == line || *end != ':') {
+		parser_error(p, "invalid evdev data");
+		return false;
+	}
+
+	n = parse_int_list(end, values, ARRAY_LENGTH(values));
+	if (n < 0) {
+		parser_error(p, "invalid evdev data");
+		return false;
+	}
+
+	if (p->section == SECTION_CODES) {
+		if (idx < 0 || idx >= EV_CNT)
+			return true;
+
+		for (int i = 0; i < n; i++) {
+			if (values[i] >= 0 &&
+			    values[i] <= libevdev_event_type_get_max(idx))
+				set_bit(p->codes[idx], values[i]);
+		}
+	} else {
+		struct input_absinfo *abs;
+
+		if (idx < 0 || idx >= ABS_CNT || n != 5) {
+			parser_error(p, "invalid absinfo");
+			return false;
+		}
+
+		abs = &p->absinfo[idx];
+		abs->minimum = values[0];
+		abs->maximum = values[1];
+		abs->fuzz = values[2];
+		abs->flat = values[3];
+		abs->resolution = values[4];
+	}
+
+	return true;
+}
+
+static bool
+parser_evdev_event(struct parser *p, const char *line)
+{
+	struct replay_device *d = p->device;
+	struct input_event *e;
+	struct replay_frame *f;
+	uint64_t sec;
+	unsigned int usec;
+	int type, code, value;
+
+	if (sscanf(line, "- [%" SCNu64 ",%u,%d,%d,%d]",
+		   &sec, &usec, &type, &code, &value) != 5) {
+		parser_error(p, "invalid evdev event");
+		return false;
+	}
+
+	d->events = grow(d->events, &d->events_sz, d->nevents,
+			 sizeof(*d->events));
+	e = &d->events[d->nevents];
+	*e = input_event_init(s2us(sec) + usec, type, code, value);
+
+	if (!d->frame_open) {
+		d->frames = grow(d->frames, &d->frames_sz, d->nframes,
+				 sizeof(*d->frames));
+		f = &d->frames[d->nframes++];
+		f->time = input_event_time(e);
+		f->first = d->nevents;
+		f->nevents = 0;
+		d->frame_open = true;
+	}
+
+	f = &d->frames[d->nframes - 1];
+	f->nevents++;
+	d->nevents++;
+
+	if (type == EV_SYN && code == SYN_REPORT)
+		d->frame_open = false;
+
+	return true;
+}
+
+/* Collects the numbers after the event type in the order libinput record
+ * prints them, button and key states count as 1 and 0 */
+static void
+parser_event_values(struct replay_event *e, const char *str)
+{
+	while (*str && e->nvalues < ARRAY_LENGTH(e->values)) {
+		char *end;
+
+		if (strneq(str, "pressed", 7)) {
+			e->values[e->nvalues++] = 1;
+			str += 7;
+		} else if (strneq(str, "released", 8)) {
+			e->values[e->nvalues++] = 0;
+			str += 8;
+		} else if ((*str >= 'a' && *str <= 'z') || *str == '_') {
+			/* skip keys and other words, e.g. wheel-tilt */
+			while ((*str >= 'a' && *str <= 'z') ||
+			       *str == '_' || *str == '-')
+				str++;
+		} else if ((*str >= '0' && *str <= '9') || *str == '-') {
+			double v = strtod(str, &end);
+
+			if (end == str) {
+				str++;
+				continue;
+			}
+			e->values[e->nvalues++] = v;
+			str = end;
+		} else {
+			str++;
+		}
+	}
+}
+
+static bool
+parser_libinput_event(struct parser *p, const char *line)
+{
+	enum libinput_event_type type;
+	struct replay_event *e;
+	const char *str;
+	uint64_t sec;
+	unsigned int usec;
+	size_t len = 0;
+
+	str = strstr(line, "type: ");
+	if (!str)
+		return true;
+
+	str += 6;
+	while ((str[len] >= 'A' && str[len] <= 'Z') || str[len] == '_')
+		len++;
+
+	type = event_type_from_name(str, len);
+	if (type == LIBINPUT_EVENT_NONE)
+		return true;
+
+	e = event_list_append(&p->device->recorded, type);
+	parser_event_values(e, str + len);
+
+	line = strstr(line, "time: ");
+	if (line &&
+	    sscanf(line, "time: %" SCNu64 ".%u", &sec, &usec) == 2)
+		e->time = s2us(sec) + usec;
+
+	return true;
+}
+
+static bool
+parser_line(struct parser *p, struct replay_context *ctx, const char *line)
+{
+	size_t indent = 0;
+	int version;
+
+	while (line[indent] == ' ')
+		indent++;
+	line += indent;
+
+	if (*line == '\0' || *line == '#')
+		return true;
+
+	if (indent == 0) {
+		if (strneq(line, "version: ", 9)) {
+			if (!safe_atoi(line + 9, &version) ||
+			    version != FILE_VERSION_NUMBER) {
+				parser_error(p, "unsupported file version");
+				return false;
+			}
+		} else if (strneq(line, "- node: ", 8)) {
+			return parser_new_device(p, ctx, line + 8);
+		} else {
+			p->device = NULL;
+			p->section = SECTION_OTHER;
+		}
+		return true;
+	}
+
+	if (!p->device)
+		return true;
+
+	/* Device-level keys */
+	if (indent == 2) {
+		if (streq(line, "evdev:"))
+			p->section = SECTION_EVDEV;
+		else if (streq(line, "udev:"))
+			p->section = SECTION_UDEV;
+		else if (streq(line, "events:") || streq(line, "events: []"))
+			p->section = SECTION_EVENTS;
+		else if (p->section == SECTION_EVENTS ||
+			 p->section == SECTION_EVENTS_EVDEV ||
+			 p->section == SECTION_EVENTS_LIBINPUT) {
+			if (streq(line, "- evdev:"))
+				p->section = SECTION_EVENTS_EVDEV;
+			else if (streq(line, "- libinput:"))
+				p->section = SECTION_EVENTS_LIBINPUT;
+			else
+				p->section = SECTION_EVENTS;
+		} else
+			p->section = SECTION_OTHER;
+
+		if (p->section == SECTION_EVENTS_EVDEV ||
+		    p->section == SECTION_EVENTS_LIBINPUT)
+			return parser_build_evdev(p);
+
+		return true;
+	}
+
+	switch (p->section) {
+	case SECTION_EVDEV:
+	case SECTION_CODES:
+	case SECTION_ABSINFO:
+		if (indent == 4)
+			return parser_evdev_key(p, line);
+		if (p->section != SECTION_EVDEV)
+			return parser_evdev_data(p, line);
+		break;
+	case SECTION_UDEV:
+		if (strneq(line, "- ", 2) && strchr(line, '=')) {
+			struct replay_device *d = p->device;
+
+			d->properties = realloc(d->properties,
+						(d->nproperties + 2) *
+						sizeof(*d->properties));
+			if (!d->properties)
+				abort();
+			d->properties[d->nproperties++] = safe_strdup(line + 2);
+			d->properties[d->nproperties] = NULL;
+		}
+		break;
+	case SECTION_EVENTS_EVDEV:
+	case SECTION_EVENTS_LIBINPUT:
+		if (streq(line, "evdev:")) {
+			p->section = SECTION_EVENTS_EVDEV;
+		} else if (streq(line, "libinput:")) {
+			p->section = SECTION_EVENTS_LIBINPUT;
+		} else if (strneq(line, "- ", 2)) {
+			if (p->section == SECTION_EVENTS_EVDEV)
+				return parser_evdev_event(p, line);
+			else
+				return parser_libinput_event(p, line);
+		}
+		break;
+	default:
+		break;
+	}
+
+	return true;
+}
+
+static bool
+parse_recording(struct replay_context *ctx, const char *filename)
+{
+	struct parser *p;
+	FILE *fp;
+	char *line = NULL;
+	size_t sz = 0;
+	ssize_t len;
+	bool rc = true;
+
+	fp = fopen(filename, "r");
+	if (!fp) {
+		fprintf(stderr, "Failed to open %s: %m\n", filename);
+		return false;
+	}
+
+	p = zalloc(sizeof(*p));
+	p->filename = filename;
+
+	while (rc && (len = getline(&line, &sz, fp)) != -1) {
+		p->lineno++;
+
+		if (len > 0 && line[len - 1] == '\n')
+			line[len - 1] = '\0';
+
+		rc = parser_line(p, ctx, line);
+	}
+
+	/* Devices without events still need their libevdev device */
+	for (size_t i = 0; rc && i < ctx->ndevices; i++) {
+		p->device = &ctx->devices[i];
+		if (!p->device->evdev) {
+			fprintf(stderr,
+				"%s: device %s has no events\n",
+				filename,
+				p->device->node);
+			rc = false;
+		}
+	}
+
+	if (rc && ctx->ndevices == 0) {
+		fprintf(stderr, "%s: no devices in recording\n", filename);
+		rc = false;
+	}
+
+	free(line);
+	free(p);
+	fclose(fp);
+
+	return rc;
+}
+
+/* Replaying */
+
+static struct replay_device *
+next_device(struct replay_context *ctx)
+{
+	struct replay_device *next = NULL;
+
+	for (size_t i = 0; i < ctx->ndevices; i++) {
+		struct replay_device *d = &ctx->devices[i];
+
+		if (d->next_frame >= d->nframes)
+			continue;
+
+		if (!next ||
+		    d->frames[d->next_frame].time <
+		    next->frames[next->next_frame].time)
+			next = d;
+	}
+
+	return next;
+}
+
+static uint64_t
+event_time(struct libinput_event *event)
+{
+	switch (libinput_event_get_type(event)) {
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return libinput_event_keyboard_get_time_usec(
+			libinput_event_get_keyboard_event(event));
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		return libinput_event_pointer_get_time_usec(
+			libinput_event_get_pointer_event(event));
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return libinput_event_touch_get_time_usec(
+			libinput_event_get_touch_event(event));
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		return libinput_event_tablet_tool_get_time_usec(
+			libinput_event_get_tablet_tool_event(event));
+	case LIBINPUT_EVENT_TABLET_PAD_BUTTON:
+	case LIBINPUT_EVENT_TABLET_PAD_RING:
+	case LIBINPUT_EVENT_TABLET_PAD_STRIP:
+		return libinput_event_tablet_pad_get_time_usec(
+			libinput_event_get_tablet_pad_event(event));
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:
+		return libinput_event_gesture_get_time_usec(
+			libinput_event_get_gesture_event(event));
+	case LIBINPUT_EVENT_SWITCH_TOGGLE:
+		return libinput_event_switch_get_time_usec(
+			libinput_event_get_switch_event(event));
+	default:
+		return 0;
+	}
+}
+
+/* The payload in the order libinput record prints it. Events not
+ * handled here are only compared by type and time. */
+static void
+event_values(struct replay_event *e, struct libinput_event *event)
+{
+	struct libinput_event_keyboard *k;
+	struct libinput_event_pointer *p;
+	struct libinput_event_touch *t;
+	double *v = e->values;
+
+	switch (e->type) {
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		k = libinput_event_get_keyboard_event(event);
+		v[0] = libinput_event_keyboard_get_key(k);
+		v[1] = libinput_event_keyboard_get_key_state(k) ==
+			LIBINPUT_KEY_STATE_PRESSED;
+		e->nvalues = 2;
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		p = libinput_event_get_pointer_event(event);
+		v[0] = libinput_event_pointer_get_dx(p);
+		v[1] = libinput_event_pointer_get_dy(p);
+		v[2] = libinput_event_pointer_get_dx_unaccelerated(p);
+		v[3] = libinput_event_pointer_get_dy_unaccelerated(p);
+		e->nvalues = 4;
+		break;
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+		p = libinput_event_get_pointer_event(event);
+		v[0] = libinput_event_pointer_get_absolute_x(p);
+		v[1] = libinput_event_pointer_get_absolute_y(p);
+		v[2] = libinput_event_pointer_get_absolute_x_transformed(p, 100);
+		v[3] = libinput_event_pointer_get_absolute_y_transformed(p, 100);
+		e->nvalues = 4;
+		break;
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+		p = libinput_event_get_pointer_event(event);
+		v[0] = libinput_event_pointer_get_button(p);
+		v[1] = libinput_event_pointer_get_button_state(p) ==
+			LIBINPUT_BUTTON_STATE_PRESSED;
+		v[2] = libinput_event_pointer_get_seat_button_count(p);
+		e->nvalues = 3;
+		break;
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		p = libinput_event_get_pointer_event(event);
+		for (int i = 0; i < 2; i++) {
+			enum libinput_pointer_axis axis = i == 0 ?
+				LIBINPUT_POINTER_AXIS_SCROLL_HORIZONTAL :
+				LIBINPUT_POINTER_AXIS_SCROLL_VERTICAL;
+
+			if (!libinput_event_pointer_has_axis(p, axis))
+				continue;
+
+			v[i] = libinput_event_pointer_get_axis_value(p, axis);
+			v[i + 2] = libinput_event_pointer_get_axis_value_discrete(p, axis);
+		}
+		e->nvalues = 4;
+		break;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+		t = libinput_event_get_touch_event(event);
+		v[2] = libinput_event_touch_get_x(t);
+		v[3] = libinput_event_touch_get_y(t);
+		v[4] = libinput_event_touch_get_x_transformed(t, 100);
+		v[5] = libinput_event_touch_get_y_transformed(t, 100);
+		e->nvalues = 6;
+		/* fallthrough */
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+		t = libinput_event_get_touch_event(event);
+		v[0] = libinput_event_touch_get_slot(t);
+		v[1] = libinput_event_touch_get_seat_slot(t);
+		if (e->nvalues == 0)
+			e->nvalues = 2;
+		break;
+	default:
+		break;
+	}
+}
+
+/* Maps a libinput event time back onto the recording's time */
+static uint64_t
+recording_time(struct replay_context *ctx, uint64_t time)
+{
+	if (time < ctx->base)
+		return ctx->offset;
+
+	if (ctx->speed > 0.0)
+		return ctx->offset + (time - ctx->base) * ctx->speed;
+
+	return ctx->offset + (time - ctx->base);
+}
+
+static void
+drain_events(struct replay_context *ctx)
+{
+	struct libinput_event *event;
+
+	libinput_dispatch(ctx->libinput);
+
+	while ((event = libinput_get_event(ctx->libinput))) {
+		enum libinput_event_type type = libinput_event_get_type(event);
+		struct libinput_device *device;
+		struct replay_device *d;
+		struct replay_event *e;
+
+		ctx->nlibinput_events++;
+
+		device = libinput_event_get_device(event);
+		d = libinput_device_get_user_data(device);
+		if (d && event_type_name(type)) {
+			e = event_list_append(&d->replayed, type);
+			e->time = recording_time(ctx, event_time(event));
+			event_values(e, event);
+		}
+
+		libinput_event_destroy(event);
+	}
+}
+
+/* In scaled mode, wait for the frame's time while handling whatever
+ * timers expire until then */
+static void
+wait_until(struct replay_context *ctx, uint64_t time)
+{
+	struct pollfd fds;
+	uint64_t now;
+
+	fds.fd = libinput_get_fd(ctx->libinput);
+	fds.events = POLLIN;
+
+	while ((now = libinput_now(ctx->libinput)) < time) {
+		int timeout = (time - now + 999) / 1000;
+
+		if (poll(&fds, 1, timeout) > 0)
+			drain_events(ctx);
+	}
+}
+
+static void
+replay_frame(struct replay_context *ctx,
+	     struct replay_device *d,
+	     uint64_t base,
+	     uint64_t offset)
+{
+	struct replay_frame *f = &d->frames[d->next_frame++];
+	struct evdev_device *device = evdev_device(d->device);
+	struct input_event *frame = ctx->frame;
+	uint64_t time, start;
+
+	if (ctx->speed > 0.0)
+		time = base + (f->time - offset) / ctx->speed;
+	else
+		time = base + (f->time - offset);
+
+	if (ctx->speed > 0.0)
+		wait_until(ctx, time);
+	else
+		libinput_clock_advance(ctx->libinput, time);
+
+	memcpy(frame, &d->events[f->first], f->nevents * sizeof(*frame));
+	for (size_t i = 0; i < f->nevents; i++)
+		input_event_set_time(&frame[i], time);
+
+	start = now_ns();
+	evdev_device_inject_frame(device, frame, f->nevents);
+	drain_events(ctx);
+	ctx->frame_times[ctx->nframe_times++] = now_ns() - start;
+	ctx->nevdev_events += f->nevents;
+}
+
+static void
+replay(struct replay_context *ctx)
+{
+	struct replay_device *d;
+	uint64_t base, offset = UINT64_MAX, last = 0;
+	size_t nframes = 0, maxevents = 0;
+
+	for (size_t i = 0; i < ctx->ndevices; i++) {
+		d = &ctx->devices[i];
+		nframes += d->nframes;
+		if (d->nframes > 0) {
+			offset = min(offset, d->frames[0].time);
+			last = max(last, d->frames[d->nframes - 1].time);
+		}
+		for (size_t f = 0; f < d->nframes; f++)
+			maxevents = max(maxevents, d->frames[f].nevents);
+	}
+
+	ctx->frame_times = zalloc((nframes + 1) * sizeof(*ctx->frame_times));
+	ctx->frame = zalloc((maxevents + 1) * sizeof(*ctx->frame));
+
+	if (nframes == 0)
+		return;
+
+	base = libinput_now(ctx->libinput);
+	ctx->base = base;
+	ctx->offset = offset;
+
+	while ((d = next_device(ctx)))
+		replay_frame(ctx, d, base, offset);
+
+	/* Anything still pending is timer-driven, fire those timers as if
+	 * the caller was idle for a while after the last frame */
+	if (ctx->speed > 0.0)
+		last = base + (last - offset) / ctx->speed;
+	else
+		last = base + (last - offset);
+	if (ctx->speed > 0.0)
+		libinput_timer_flush(ctx->libinput, last + s2us(5));
+	else
+		libinput_clock_advance(ctx->libinput, last + s2us(5));
+	drain_events(ctx);
+}
+
+static int
+compare_u64(const void *a, const void *b)
+{
+	const uint64_t *x = a, *y = b;
+
+	return *x < *y ? -1 : *x > *y;
+}
+
+static const char *
+events_differ(const struct replay_event *rec, const struct replay_event *rep)
+{
+	uint64_t dt;
+
+	if (rec->type != rep->type)
+		return "type";
+
+	dt = rec->time > rep->time ? rec->time - rep->time : rep->time - rec->time;
+	if (dt > TIME_TOLERANCE_US)
+		return "time";
+
+	if (rep->nvalues == 0)
+		return NULL;
+
+	if (rec->nvalues != rep->nvalues)
+		return "payload";
+
+	for (size_t i = 0; i < rep->nvalues; i++) {
+		/* libinput record hides most keycodes as -1 */
+		if (i == 0 && rec->type == LIBINPUT_EVENT_KEYBOARD_KEY &&
+		    rec->values[0] == -1)
+			continue;
+
+		if (fabs(rec->values[i] - rep->values[i]) > VALUE_TOLERANCE)
+			return "payload";
+	}
+
+	return NULL;
+}
+
+static void
+print_event(const char *which, const struct replay_event *e)
+{
+	printf("    %s: %s at %" PRIu64 ".%06" PRIu64,
+	       which,
+	       event_type_name(e->type),
+	       e->time / 1000000,
+	       e->time % 1000000);
+	for (size_t i = 0; i < e->nvalues; i++)
+		printf("%s%.2f", i == 0 ? ", values " : " ", e->values[i]);
+	printf("\n");
+}
+
+static bool
+print_device_results(struct replay_device *d)
+{
+	struct event_list *rec = &d->recorded,
+			  *rep = &d->replayed;
+	const char *difference = NULL;
+	size_t i;
+
+	printf("%s: %s\n", d->node, d->name);
+	printf("  frames:             %zd\n", d->nframes);
+	printf("  evdev events:       %zd\n", d->nevents);
+	printf("  libinput events:    %zd\n", rep->nevents);
+
+	if (rec->nevents == 0) {
+		printf("  recorded events:    none, recording has no libinput events\n");
+		return true;
+	}
+
+	printf("  recorded events:    %zd\n", rec->nevents);
+
+	for (i = 0; i < min(rec->nevents, rep->nevents); i++) {
+		difference = events_differ(&rec->events[i], &rep->events[i]);
+		if (difference)
+			break;
+	}
+
+	if (i == rec->nevents && i == rep->nevents) {
+		printf("  result:             match\n");
+		return true;
+	}
+
+	printf("  result:             mismatch at event %zd: %s differs\n",
+	       i,
+	       difference ? difference : "number of events");
+	if (i < rec->nevents)
+		print_event("recorded", &rec->events[i]);
+	else
+		printf("    recorded: <end>\n");
+	if (i < rep->nevents)
+		print_event("replayed", &rep->events[i]);
+	else
+		printf("    replayed: <end>\n");
+
+	return false;
+}
+
+static bool
+print_results(struct replay_context *ctx)
+{
+	uint64_t total = 0;
+	uint64_t *t = ctx->frame_times;
+	size_t n = ctx->nframe_times;
+	bool match = true;
+
+	for (size_t i = 0; i < ctx->ndevices; i++)
+		match = print_device_results(&ctx->devices[i]) && match;
+
+	if (n == 0)
+		return match;
+
+	for (size_t i = 0; i < n; i++)
+		total += t[i];
+
+	qsort(t, n, sizeof(*t), compare_u64);
+
+	printf("Replayed %zd frames in %.3fms\n", n, total/1e6);
+	printf("  evdev events/s:     %.0f\n",
+	       ctx->nevdev_events / (total/1e9));
+	printf("  libinput events/s:  %.0f\n",
+	       ctx->nlibinput_events / (total/1e9));
+	printf("  frame time (us):    min %.2f, median %.2f, p99 %.2f, max %.2f\n",
+	       t[0]/1e3,
+	       t[n/2]/1e3,
+	       t[min(n - 1, n * 99 / 100)]/1e3,
+	       t[n - 1]/1e3);
+
+	return match;
+}
+
+static int
+replay_open_restricted(const char *path, int flags, void *user_data)
+{
+	/* Virtual devices are never opened */
+	return -ENODEV;
+}
+
+static void
+replay_close_restricted(int fd, void *user_data)
+{
+}
+
+static const struct libinput_interface interface = {
+	.open_restricted = replay_open_restricted,
+	.close_restricted = replay_close_restricted,
+};
+
+LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
+static void
+log_handler(struct libinput *li,
+	    enum libinput_log_priority priority,
+	    const char *format,
+	    va_list args)
+{
+	struct replay_context *ctx = libinput_get_user_data(li);
+
+	if (ctx->verbose)
+		vfprintf(stderr, format, args);
+}
+
+static bool
+setup_context(struct replay_context *ctx)
+{
+	struct libinput *li;
+
+	li = libinput_path_create_context(&interface, ctx);
+	if (!li)
+		return false;
+
+	/* Timers are driven by the recorded timestamps. Faster than real
+	 * time that trips libinput's timer sanity checks, so libinput's
+	 * messages are only printed when asked for */
+	libinput_log_set_handler(li, log_handler);
+	if (ctx->verbose)
+		libinput_log_set_priority(li, LIBINPUT_LOG_PRIORITY_DEBUG);
+	ctx->libinput = li;
+
+	/* As fast as possible, the clock jumps from one frame to the next
+	 * and the timers in between expire in the recorded order */
+	if (ctx->speed == 0.0)
+		libinput_clock_enable_virtual(li, libinput_now(li));
+
+	for (size_t i = 0; i < ctx->ndevices; i++) {
+		struct replay_device *d = &ctx->devices[i];
+		const char *sysname = strrchr(d->node, '/');
+
+		sysname = sysname ? sysname + 1 : d->node;
+		d->device = path_add_virtual_device(li,
+						    d->evdev,
+						    sysname,
+						    d->properties);
+		d->evdev = NULL; /* owned by the device now */
+		if (!d->device) {
+			fprintf(stderr,
+				"%s: failed to create device '%s'\n",
+				d->node,
+				d->name);
+			return false;
+		}
+
+		libinput_device_ref(d->device);
+		libinput_device_set_user_data(d->device, d);
+	}
+
+	/* DEVICE_ADDED isn't part of the comparison */
+	drain_events(ctx);
+	ctx->nlibinput_events = 0;
+
+	return true;
+}
+
+static void
+teardown_context(struct replay_context *ctx)
+{
+	for (size_t i = 0; i < ctx->ndevices; i++) {
+		struct replay_device *d = &ctx->devices[i];
+
+		if (d->device) {
+			libinput_device_set_user_data(d->device, NULL);
+			libinput_path_remove_device(d->device);
+			libinput_device_unref(d->device);
+		}
+
+		libevdev_free(d->evdev);
+		strv_free(d->properties);
+		free(d->node);
+		free(d->name);
+		free(d->events);
+		free(d->frames);
+		free(d->recorded.events);
+		free(d->replayed.events);
+	}
+
+	libinput_unref(ctx->libinput);
+	free(ctx->devices);
+	free(ctx->frame);
+	free(ctx->frame_times);
+}
+
+static void
+usage(void)
+{
+	printf("Usage: libinput analyze replay [--help] [--speed=<factor>] [--verbose] recording.yml\n"
+	       "\n"
+	       "Replays a recording made with libinput record through libinput,\n"
+	       "without creating kernel devices. If the recording has libinput\n"
+	       "events, the replayed events are compared with those by type, time\n"
+	       "and, for keyboard, pointer and touch events, by their payload.\n"
+	       "Device quirks are not applied to the replayed devices.\n"
+	       "\n"
+	       "This tool is not installed, run it from the build directory.\n"
+	       "\n"
+	       "Options:\n"
+	       "  --speed=<factor> ... replay at the given multiple of the recorded speed,\n"
+	       "                       default: as fast as possible\n"
+	       "  --verbose .......... print libinput's log messages\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct replay_context ctx = {0};
+	bool match;
+
+	while (1) {
+		int c;
+		int option_index = 0;
+		enum {
+			OPT_SPEED = 1,
+			OPT_VERBOSE,
+		};
+		static struct option opts[] = {
+			{ "help",    no_argument,       0, 'h' },
+			{ "speed",   required_argument, 0, OPT_SPEED },
+			{ "verbose", no_argument,       0, OPT_VERBOSE },
+			{ 0, 0, 0, 0}
+		};
+
+		c = getopt_long(argc, argv, "h", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch(c) {
+		case 'h':
+			usage();
+			return EXIT_SUCCESS;
+		case OPT_SPEED:
+			if (!safe_atod(optarg, &ctx.speed) || ctx.speed < 0.0) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			break;
+		case OPT_VERBOSE:
+			ctx.verbose = true;
+			break;
+		default:
+			usage();
+			return EXIT_INVALID_USAGE;
+		}
+	}
+
+	if (optind != argc - 1) {
+		usage();
+		return EXIT_INVALID_USAGE;
+	}
+
+	if (!parse_recording(&ctx, argv[optind]) ||
+	    !setup_context(&ctx)) {
+		teardown_context(&ctx);
+		return EXIT_FAILURE;
+	}
+
+	replay(&ctx);
+	match = print_results(&ctx);
+
+	teardown_context(&ctx);
+
+	return match ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,1286 @@
+/*
+ * Copyright © 2021 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+/* Microbenchmarks for libinput's event pipeline.
+ *
+ * Synthetic event streams are pushed through the real code paths: the
+ * pointer acceleration filters, virtual devices (see
+ * evdev_device_create_virtual()) for the touchpad, fallback and tablet
+ * dispatch, the quirks lookup and the event queue. No uinput devices or
+ * root privileges are required.
+ *
+ * The results are printed as JSON. The input streams are fixed, so two
+ * runs on the same machine are comparable.
+ */
+
+#include "config.h"
+
+#include <assert.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+#include <libevdev/libevdev.h>
+#include <libudev.h>
+
+#include "libinput.h"
+#include "libinput-private.h"
+#include "libinput-version.h"
+#include "evdev.h"
+#include "filter.h"
+#include "path-seat.h"
+#include "quirks.h"
+#include "util-input-event.h"
+#include "shared.h"
+
+#define DEFAULT_ITERATIONS 10000
+#define MAX_FRAME_EVENTS 64
+#define MAX_BENCH_TOUCHES 5
+
+static bool verbose = false;
+
+/* Allocations are counted by linking with --wrap for the allocator
+ * functions, see meson.build. This only counts the allocations made by
+ * libinput and this tool, not those made inside other libraries, and it
+ * leaves the allocator itself alone so it works with sanitizers and any
+ * C library. Without linker support no allocation count is reported. */
+#ifndef HAVE_ALLOCATION_COUNT
+#define HAVE_ALLOCATION_COUNT 0
+#endif
+
+static uint64_t allocation_count;
+
+#if HAVE_ALLOCATION_COUNT
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t nmemb, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size);
+void *__wrap_calloc(size_t nmemb, size_t size);
+void *__wrap_realloc(void *ptr, size_t size);
+
+void *
+__wrap_malloc(size_t size)
+{
+	allocation_count++;
+	return __real_malloc(size);
+}
+
+void *
+__wrap_calloc(size_t nmemb, size_t size)
+{
+	allocation_count++;
+	return __real_calloc(nmemb, size);
+}
+
+void *
+__wrap_realloc(void *ptr, size_t size)
+{
+	allocation_count++;
+	return __real_realloc(ptr, size);
+}
+#endif
+
+/* Cache misses are counted with the hardware counters where the kernel
+ * lets us, see perf_event_paranoid. Otherwise they're reported as null */
+static int cache_miss_fd = -1;
+
+static void
+cache_miss_counter_init(void)
+{
+#ifdef __linux__
+	struct perf_event_attr attr = {
+		.type = PERF_TYPE_HARDWARE,
+		.size = sizeof(attr),
+		.config = PERF_COUNT_HW_CACHE_MISSES,
+		.exclude_kernel = 1,
+		.exclude_hv = 1,
+	};
+
+	cache_miss_fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+static inline uint64_t
+cache_miss_count(void)
+{
+	uint64_t count = 0;
+
+	if (cache_miss_fd != -1 &&
+	    read(cache_miss_fd, &count, sizeof(count)) != sizeof(count))
+		count = 0;
+
+	return count;
+}
+
+static inline uint64_t
+now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+struct bench_result {
+	const char *name;
+	const char *skipped; /* reason, or NULL */
+
+	uint64_t nevents;
+	uint64_t nallocs;
+	uint64_t ncache_misses;
+	uint64_t *frame_times; /* ns */
+	size_t nframes;
+};
+
+struct bench_context {
+	unsigned int iterations;
+	unsigned int warmup;
+
+	struct bench_result *results;
+	size_t nresults;
+	size_t results_sz;
+};
+
+static struct bench_result *
+bench_result_new(struct bench_context *ctx, const char *name)
+{
+	struct bench_result *r;
+
+	if (ctx->nresults == ctx->results_sz) {
+		ctx->results_sz = ctx->results_sz ? ctx->results_sz * 2 : 16;
+		ctx->results = realloc(ctx->results,
+				       ctx->results_sz * sizeof(*ctx->results));
+		if (!ctx->results)
+			abort();
+	}
+
+	r = &ctx->results[ctx->nresults++];
+	memset(r, 0, sizeof(*r));
+	r->name = name;
+	r->frame_times = zalloc(ctx->iterations * sizeof(*r->frame_times));
+
+	return r;
+}
+
+/* A frame is the unit of work that is timed, e.g. one filter call or one
+ * SYN_REPORT-terminated set of events. The allocation count covers the
+ * frame only, and so does the cache miss count. */
+struct frame_timer {
+	uint64_t start;
+	uint64_t allocs;
+	uint64_t cache_misses;
+};
+
+static inline void
+frame_begin(struct frame_timer *t)
+{
+	t->allocs = allocation_count;
+	t->cache_misses = cache_miss_count();
+	t->start = now_ns();
+}
+
+static inline void
+frame_end(struct frame_timer *t,
+	  struct bench_result *r,
+	  bool measure,
+	  size_t nevents)
+{
+	uint64_t elapsed = now_ns() - t->start;
+	uint64_t cache_misses = cache_miss_count() - t->cache_misses;
+
+	if (!measure)
+		return;
+
+	r->nallocs += allocation_count - t->allocs;
+	r->ncache_misses += cache_misses;
+	r->nevents += nevents;
+	r->frame_times[r->nframes++] = elapsed;
+}
+
+/* Pointer acceleration filters */
+
+struct filter_bench {
+	const char *name;
+	struct motion_filter *(*create)(void);
+	uint64_t interval; /* µs between events */
+};
+
+static struct motion_filter *
+create_flat(void)
+{
+	return create_pointer_accelerator_filter_flat(1000);
+}
+
+static struct motion_filter *
+create_linear(void)
+{
+	return create_pointer_accelerator_filter_linear(1000, true);
+}
+
+static struct motion_filter *
+create_low_dpi(void)
+{
+	return create_pointer_accelerator_filter_linear_low_dpi(400, true);
+}
+
+static struct motion_filter *
+create_touchpad(void)
+{
+	return create_pointer_accelerator_filter_touchpad(1000,
+							  ms2us(12),
+							  ms2us(8),
+							  true);
+}
+
+static struct motion_filter *
+create_touchpad_flat(void)
+{
+	return create_pointer_accelerator_filter_touchpad_flat(1000);
+}
+
+static struct motion_filter *
+create_x230(void)
+{
+	return create_pointer_accelerator_filter_lenovo_x230(1000, true);
+}
+
+static struct motion_filter *
+create_trackpoint(void)
+{
+	return create_pointer_accelerator_filter_trackpoint(1.0, true);
+}
+
+static const struct filter_bench filter_benches[] = {
+	{ "filter-flat", create_flat, 1000 },
+	{ "filter-linear", create_linear, 1000 },
+	{ "filter-linear-low-dpi", create_low_dpi, 8000 },
+	{ "filter-touchpad", create_touchpad, 7000 },
+	{ "filter-touchpad-flat", create_touchpad_flat, 7000 },
+	{ "filter-lenovo-x230", create_x230, 7000 },
+	{ "filter-trackpoint", create_trackpoint, 10000 },
+};
+
+static void
+run_filter_bench(struct bench_context *ctx, const struct filter_bench *b)
+{
+	struct bench_result *r = bench_result_new(ctx, b->name);
+	struct motion_filter *filter = b->create();
+	uint64_t time = 0;
+
+	filter_set_speed(filter, 0.0);
+
+	for (unsigned int n = 0; n < ctx->warmup + ctx->iterations; n++) {
+		struct device_float_coords delta;
+		struct frame_timer t;
+
+		/* Slow and fast movements so every part of the accel
+		 * curve is hit. Every 500 events the pointer stops for
+		 * a while so the filter's trackers are reset. */
+		delta.x = 1 + 15 * (1 + sin(n / 40.0));
+		delta.y = 8 * cos(n / 25.0);
+		time += (n % 500 == 0) ? ms2us(500) : b->interval;
+
+		frame_begin(&t);
+		filter_dispatch(filter, &delta, NULL, time);
+		frame_end(&t, r, n >= ctx->warmup, 1);
+	}
+
+	filter_destroy(filter);
+}
+
+/* Virtual devices */
+
+struct bench_device {
+	const char *name;
+	struct input_id id;
+	const int *codes; /* type, code pairs, terminated by -1, -1 */
+	const struct input_absinfo *absinfo; /* value is the code */
+	const int *props; /* terminated by -1 */
+	char **udev_properties;
+};
+
+static const int touchpad_codes[] = {
+	EV_KEY, BTN_LEFT,
+	EV_KEY, BTN_TOOL_FINGER,
+	EV_KEY, BTN_TOOL_QUINTTAP,
+	EV_KEY, BTN_TOUCH,
+	EV_KEY, BTN_TOOL_DOUBLETAP,
+	EV_KEY, BTN_TOOL_TRIPLETAP,
+	EV_KEY, BTN_TOOL_QUADTAP,
+	-1, -1,
+};
+
+static const struct input_absinfo touchpad_absinfo[] = {
+	{ ABS_X, 0, 4000, 0, 0, 40 },
+	{ ABS_Y, 0, 2400, 0, 0, 40 },
+	{ ABS_MT_SLOT, 0, 4, 0, 0, 0 },
+	{ ABS_MT_POSITION_X, 0, 4000, 0, 0, 40 },
+	{ ABS_MT_POSITION_Y, 0, 2400, 0, 0, 40 },
+	{ ABS_MT_TRACKING_ID, 0, 65535, 0, 0, 0 },
+	{ .value = -1 },
+};
+
+static const int touchpad_props[] = {
+	INPUT_PROP_POINTER,
+	INPUT_PROP_BUTTONPAD,
+	-1,
+};
+
+static char *touchpad_udev_properties[] = {
+	"ID_INPUT=1",
+	"ID_INPUT_TOUCHPAD=1",
+	NULL,
+};
+
+static const struct bench_device touchpad_device = {
+	.name = "libinput-bench touchpad",
+	.id = { BUS_I8042, 0x2, 0x7, 0x1b1 },
+	.codes = touchpad_codes,
+	.absinfo = touchpad_absinfo,
+	.props = touchpad_props,
+	.udev_properties = touchpad_udev_properties,
+};
+
+/* Like the touchpad above, but with as many slots as the Apple Magic
+ * Trackpad. Each frame walks all touches, whether they're down or not */
+static const struct input_absinfo multitouch_absinfo[] = {
+	{ ABS_X, 0, 6000, 0, 0, 60 },
+	{ ABS_Y, 0, 4000, 0, 0, 60 },
+	{ ABS_MT_SLOT, 0, 15, 0, 0, 0 },
+	{ ABS_MT_POSITION_X, 0, 6000, 0, 0, 60 },
+	{ ABS_MT_POSITION_Y, 0, 4000, 0, 0, 60 },
+	{ ABS_MT_TRACKING_ID, 0, 65535, 0, 0, 0 },
+	{ .value = -1 },
+};
+
+static const struct bench_device multitouch_device = {
+	.name = "libinput-bench multitouch touchpad",
+	.id = { BUS_USB, 0x1, 0x1, 0x1 },
+	.codes = touchpad_codes,
+	.absinfo = multitouch_absinfo,
+	.props = touchpad_props,
+	.udev_properties = touchpad_udev_properties,
+};
+
+static const int mouse_codes[] = {
+	EV_KEY, BTN_LEFT,
+	EV_KEY, BTN_RIGHT,
+	EV_KEY, BTN_MIDDLE,
+	EV_REL, REL_X,
+	EV_REL, REL_Y,
+	EV_REL, REL_WHEEL,
+	EV_MSC, MSC_SCAN,
+	-1, -1,
+};
+
+static char *mouse_udev_properties[] = {
+	"ID_INPUT=1",
+	"ID_INPUT_MOUSE=1",
+	NULL,
+};
+
+static const struct bench_device mouse_device = {
+	.name = "libinput-bench mouse",
+	.id = { BUS_USB, 0x17ef, 0x6019, 0x111 },
+	.codes = mouse_codes,
+	.udev_properties = mouse_udev_properties,
+};
+
+static char *keyboard_udev_properties[] = {
+	"ID_INPUT=1",
+	"ID_INPUT_KEY=1",
+	"ID_INPUT_KEYBOARD=1",
+	NULL,
+};
+
+/* keys are filled in by bench_device_new() */
+static const int keyboard_codes[] = {
+	EV_MSC, MSC_SCAN,
+	-1, -1,
+};
+
+static const struct bench_device keyboard_device = {
+	.name = "libinput-bench keyboard",
+	.id = { BUS_I8042, 0x1, 0x1, 0xab41 },
+	.codes = keyboard_codes,
+	.udev_properties = keyboard_udev_properties,
+};
+
+static const int tablet_codes[] = {
+	EV_KEY, BTN_TOOL_PEN,
+	EV_KEY, BTN_TOUCH,
+	EV_KEY, BTN_STYLUS,
+	EV_KEY, BTN_STYLUS2,
+	EV_MSC, MSC_SCAN,
+	-1, -1,
+};
+
+static const struct input_absinfo tablet_absinfo[] = {
+	{ ABS_X, 0, 40000, 0, 0, 157 },
+	{ ABS_Y, 0, 25000, 0, 0, 157 },
+	{ ABS_PRESSURE, 0, 2047, 0, 0, 0 },
+	{ ABS_TILT_X, -64, 63, 0, 0, 57 },
+	{ ABS_TILT_Y, -64, 63, 0, 0, 57 },
+	{ .value = -1 },
+};
+
+static char *tablet_udev_properties[] = {
+	"ID_INPUT=1",
+	"ID_INPUT_TABLET=1",
+	NULL,
+};
+
+static const struct bench_device tablet_device = {
+	.name = "libinput-bench tablet",
+	.id = { BUS_USB, 0x256c, 0x6e, 0x1 },
+	.codes = tablet_codes,
+	.absinfo = tablet_absinfo,
+	.udev_properties = tablet_udev_properties,
+};
+
+static struct libevdev *
+bench_device_new_evdev(const struct bench_device *desc)
+{
+	struct libevdev *evdev = libevdev_new();
+
+	libevdev_set_name(evdev, desc->name);
+	libevdev_set_id_bustype(evdev, desc->id.bustype);
+	libevdev_set_id_vendor(evdev, desc->id.vendor);
+	libevdev_set_id_product(evdev, desc->id.product);
+	libevdev_set_id_version(evdev, desc->id.version);
+	libevdev_enable_event_code(evdev, EV_SYN, SYN_REPORT, NULL);
+
+	for (const int *c = desc->codes; c[0] != -1; c += 2)
+		libevdev_enable_event_code(evdev, c[0], c[1], NULL);
+
+	for (const struct input_absinfo *a = desc->absinfo;
+	     a && a->value != -1;
+	     a++) {
+		struct input_absinfo abs = *a;
+
+		abs.value = 0;
+		libevdev_enable_event_code(evdev, EV_ABS, a->value, &abs);
+	}
+
+	for (const int *p = desc->props; p && *p != -1; p++)
+		libevdev_enable_property(evdev, *p);
+
+	if (desc == &keyboard_device) {
+		for (int code = KEY_ESC; code <= KEY_KPDOT; code++)
+			libevdev_enable_event_code(evdev, EV_KEY, code, NULL);
+	}
+
+	return evdev;
+}
+
+static int
+bench_open_restricted(const char *path, int flags, void *user_data)
+{
+	/* Virtual devices are never opened */
+	return -ENODEV;
+}
+
+static void
+bench_close_restricted(int fd, void *user_data)
+{
+}
+
+static const struct libinput_interface interface = {
+	.open_restricted = bench_open_restricted,
+	.close_restricted = bench_close_restricted,
+};
+
+LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
+static void
+log_handler(struct libinput *li,
+	    enum libinput_log_priority priority,
+	    const char *format,
+	    va_list args)
+{
+	if (verbose)
+		vfprintf(stderr, format, args);
+}
+
+static struct libinput *
+bench_create_context(void)
+{
+	struct libinput *li;
+
+	li = libinput_path_create_context(&interface, NULL);
+	if (!li)
+		return NULL;
+
+	/* Event timestamps run ahead of the clock, which trips the timer
+	 * sanity checks. Only print libinput's messages when asked for */
+	libinput_log_set_handler(li, log_handler);
+	if (verbose)
+		libinput_log_set_priority(li, LIBINPUT_LOG_PRIORITY_DEBUG);
+
+	return li;
+}
+
+static size_t
+drain_events(struct libinput *li)
+{
+	struct libinput_event *event;
+	size_t count = 0;
+
+	while ((event = libinput_get_event(li))) {
+		libinput_event_destroy(event);
+		count++;
+	}
+
+	return count;
+}
+
+/* Generates the events for device benchmarks */
+struct device_bench_state {
+	struct input_event events[MAX_FRAME_EVENTS];
+	size_t nevents;
+
+	/* touchpad */
+	struct bench_touch {
+		bool down;
+		int x, y;
+	} touches[MAX_BENCH_TOUCHES], current[MAX_BENCH_TOUCHES];
+	int tracking_id;
+};
+
+static void
+add_event(struct device_bench_state *s,
+	  unsigned int type,
+	  unsigned int code,
+	  int value)
+{
+	struct input_event *ev;
+
+	assert(s->nevents < ARRAY_LENGTH(s->events));
+
+	ev = &s->events[s->nevents++];
+	ev->type = type;
+	ev->code = code;
+	ev->value = value;
+}
+
+static unsigned int
+touch_count(const struct bench_touch *touches)
+{
+	unsigned int count = 0;
+
+	for (size_t i = 0; i < MAX_BENCH_TOUCHES; i++) {
+		if (touches[i].down)
+			count++;
+	}
+
+	return count;
+}
+
+/* Turns the wanted touch state into the events to get there */
+static void
+touchpad_frame(struct device_bench_state *s)
+{
+	static const unsigned int tools[] = {
+		BTN_TOUCH, /* unused */
+		BTN_TOOL_FINGER,
+		BTN_TOOL_DOUBLETAP,
+		BTN_TOOL_TRIPLETAP,
+		BTN_TOOL_QUADTAP,
+		BTN_TOOL_QUINTTAP,
+	};
+	unsigned int old_count = touch_count(s->current),
+		     new_count = touch_count(s->touches);
+
+	for (size_t i = 0; i < MAX_BENCH_TOUCHES; i++) {
+		struct bench_touch *want = &s->touches[i],
+				   *have = &s->current[i];
+
+		if (!want->down && !have->down)
+			continue;
+
+		add_event(s, EV_ABS, ABS_MT_SLOT, i);
+
+		if (want->down != have->down) {
+			add_event(s, EV_ABS, ABS_MT_TRACKING_ID,
+				  want->down ? ++s->tracking_id : -1);
+			if (!want->down) {
+				*have = *want;
+				continue;
+			}
+		}
+
+		if (want->x != have->x || !have->down)
+			add_event(s, EV_ABS, ABS_MT_POSITION_X, want->x);
+		if (want->y != have->y || !have->down)
+			add_event(s, EV_ABS, ABS_MT_POSITION_Y, want->y);
+
+		*have = *want;
+	}
+
+	if ((old_count == 0) != (new_count == 0))
+		add_event(s, EV_KEY, BTN_TOUCH, new_count > 0);
+
+	if (old_count != new_count) {
+		if (old_count > 0)
+			add_event(s, EV_KEY, tools[old_count], 0);
+		if (new_count > 0)
+			add_event(s, EV_KEY, tools[new_count], 1);
+	}
+}
+
+static inline void
+touch_set(struct device_bench_state *s, size_t slot, int x, int y)
+{
+	s->touches[slot].down = true;
+	s->touches[slot].x = x;
+	s->touches[slot].y = y;
+}
+
+static inline void
+touch_up(struct device_bench_state *s, size_t slot)
+{
+	s->touches[slot].down = false;
+}
+
+/* The scenario callbacks fill in the events for frame n and return the
+ * time in µs since the previous frame. */
+
+static uint64_t
+touchpad_motion(struct device_bench_state *s, unsigned int n)
+{
+	unsigned int step = n % 200;
+
+	if (step == 199)
+		touch_up(s, 0);
+	else
+		touch_set(s, 0,
+			  500 + step * 15,
+			  1200 + 600 * sin(step / 20.0));
+
+	touchpad_frame(s);
+
+	return step == 0 ? ms2us(300) : ms2us(7);
+}
+
+static uint64_t
+touchpad_scroll(struct device_bench_state *s, unsigned int n)
+{
+	unsigned int step = n % 100;
+
+	if (step == 99) {
+		touch_up(s, 0);
+		touch_up(s, 1);
+	} else {
+		touch_set(s, 0, 1600, 400 + step * 15);
+		touch_set(s, 1, 2400, 420 + step * 15);
+	}
+
+	touchpad_frame(s);
+
+	return step == 0 ? ms2us(300) : ms2us(7);
+}
+
+static uint64_t
+touchpad_tap(struct device_bench_state *s, unsigned int n)
+{
+	unsigned int step = n % 4;
+
+	/* Alternating one- and two-finger taps, the tap timeouts expire
+	 * before the next tap */
+	switch (step) {
+	case 0:
+		touch_set(s, 0, 2000, 1200);
+		break;
+	case 1:
+		touch_up(s, 0);
+		break;
+	case 2:
+		touch_set(s, 0, 1800, 1200);
+		touch_set(s, 1, 2400, 1200);
+		break;
+	case 3:
+		touch_up(s, 0);
+		touch_up(s, 1);
+		break;
+	}
+
+	touchpad_frame(s);
+
+	return (step == 0 || step == 2) ? ms2us(400) : ms2us(50);
+}
+
+static uint64_t
+touchpad_pinch(struct device_bench_state *s, unsigned int n)
+{
+	unsigned int step = n % 60;
+
+	if (step == 59) {
+		touch_up(s, 0);
+		touch_up(s, 1);
+		touch_up(s, 2);
+	} else if ((n / 60) % 2) {
+		/* three-finger swipe */
+		touch_set(s, 0, 1400, 600 + step * 20);
+		touch_set(s, 1, 2000, 600 + step * 20);
+		touch_set(s, 2, 2600, 600 + step * 20);
+	} else {
+		touch_set(s, 0, 1900 - step * 15, 1200 - step * 8);
+		touch_set(s, 1, 2100 + step * 15, 1200 + step * 8);
+	}
+
+	touchpad_frame(s);
+
+	return step == 0 ? ms2us(300) : ms2us(7);
+}
+
+static uint64_t
+touchpad_palm_thumb(struct device_bench_state *s, unsigned int n)
+{
+	unsigned int step = n % 150;
+
+	if (step == 149) {
+		touch_up(s, 0);
+		touch_up(s, 1);
+		touch_up(s, 2);
+	} else {
+		/* a palm along the edge, a thumb resting in the lower
+		 * area, and a finger moving around */
+		touch_set(s, 0, 50, 300 + step * 10);
+		if (step >= 10)
+			touch_set(s, 1, 1500, 2350);
+		if (step >= 20)
+			touch_set(s, 2, 1000 + step * 15, 800 + step * 3);
+	}
+
+	touchpad_frame(s);
+
+	return step == 0 ? ms2us(300) : ms2us(7);
+}
+
+static uint64_t
+touchpad_four_finger(struct device_bench_state *s, unsigned int n)
+{
+	unsigned int step = n % 80;
+
+	if (step == 79) {
+		for (size_t i = 0; i < MAX_BENCH_TOUCHES; i++)
+			touch_up(s, i);
+	} else if ((n / 80) % 2) {
+		/* four-finger swipe */
+		for (size_t i = 0; i < 4; i++)
+			touch_set(s, i, 1500 + i * 900, 800 + step * 30);
+	} else {
+		/* pinch with a thumb resting at the bottom edge */
+		touch_set(s, 0, 2800 - step * 15, 1800 - step * 8);
+		touch_set(s, 1, 3200 + step * 15, 2200 + step * 8);
+		touch_set(s, 4, 3000, 3900);
+	}
+
+	touchpad_frame(s);
+
+	return step == 0 ? ms2us(300) : ms2us(11);
+}
+
+static uint64_t
+mouse_motion(struct device_bench_state *s, unsigned int n)
+{
+	add_event(s, EV_REL, REL_X, 1 + 10 * (1 + sin(n / 30.0)));
+	add_event(s, EV_REL, REL_Y, 6 * cos(n / 20.0));
+
+	if (n % 50 == 0 || n % 50 == 10) {
+		add_event(s, EV_MSC, MSC_SCAN, 0x90001);
+		add_event(s, EV_KEY, BTN_LEFT, n % 50 == 0);
+	}
+
+	if (n % 20 == 5)
+		add_event(s, EV_REL, REL_WHEEL, -1);
+
+	return ms2us(1);
+}
+
+static uint64_t
+keyboard_typing(struct device_bench_state *s, unsigned int n)
+{
+	unsigned int key = KEY_Q + (n / 2) % 10; /* KEY_Q...KEY_P */
+
+	add_event(s, EV_MSC, MSC_SCAN, 0x70000 + key);
+	add_event(s, EV_KEY, key, n % 2 == 0);
+
+	return ms2us(40);
+}
+
+static uint64_t
+tablet_stroke(struct device_bench_state *s, unsigned int n)
+{
+	unsigned int step = n % 100;
+	int x = 10000 + step * 150,
+	    y = 8000 + 4000 * sin(step / 15.0);
+
+	if (step == 99) {
+		add_event(s, EV_KEY, BTN_TOOL_PEN, 0);
+		return ms2us(5);
+	}
+
+	add_event(s, EV_ABS, ABS_X, x);
+	add_event(s, EV_ABS, ABS_Y, y);
+	add_event(s, EV_ABS, ABS_PRESSURE,
+		  (step >= 5 && step < 95) ? 200 + step * 15 : 0);
+	add_event(s, EV_ABS, ABS_TILT_X, -20 + step % 40);
+	add_event(s, EV_ABS, ABS_TILT_Y, 10 - step % 20);
+
+	if (step == 0)
+		add_event(s, EV_KEY, BTN_TOOL_PEN, 1);
+	else if (step == 5)
+		add_event(s, EV_KEY, BTN_TOUCH, 1);
+	else if (step == 95)
+		add_event(s, EV_KEY, BTN_TOUCH, 0);
+
+	return step == 0 ? ms2us(200) : ms2us(5);
+}
+
+struct device_bench {
+	const char *name;
+	const struct bench_device *device;
+	uint64_t (*frame)(struct device_bench_state *s, unsigned int n);
+};
+
+static const struct device_bench device_benches[] = {
+	{ "touchpad-motion", &touchpad_device, touchpad_motion },
+	{ "touchpad-scroll", &touchpad_device, touchpad_scroll },
+	{ "touchpad-tap", &touchpad_device, touchpad_tap },
+	{ "touchpad-gestures", &touchpad_device, touchpad_pinch },
+	{ "touchpad-palm-thumb", &touchpad_device, touchpad_palm_thumb },
+	{ "touchpad-16-slots-gestures", &multitouch_device, touchpad_pinch },
+	{ "touchpad-16-slots-four-finger", &multitouch_device, touchpad_four_finger },
+	{ "fallback-mouse", &mouse_device, mouse_motion },
+	{ "fallback-keyboard", &keyboard_device, keyboard_typing },
+	{ "tablet-pen", &tablet_device, tablet_stroke },
+};
+
+static void
+configure_device(struct libinput_device *device)
+{
+	/* Enable what the defaults leave off so those code paths are
+	 * part of the benchmark */
+	if (libinput_device_config_tap_get_finger_count(device) > 0) {
+		libinput_device_config_tap_set_enabled(device,
+						       LIBINPUT_CONFIG_TAP_ENABLED);
+		libinput_device_config_dwt_set_enabled(device,
+						       LIBINPUT_CONFIG_DWT_ENABLED);
+	}
+}
+
+static void
+run_device_bench(struct bench_context *ctx, const struct device_bench *b)
+{
+	struct bench_result *r = bench_result_new(ctx, b->name);
+	struct device_bench_state state = {0};
+	struct libinput *li;
+	struct libinput_device *device;
+	uint64_t time;
+
+	li = bench_create_context();
+	if (!li) {
+		r->skipped = "failed to create a libinput context";
+		return;
+	}
+
+	device = path_add_virtual_device(li,
+					 bench_device_new_evdev(b->device),
+					 "event0",
+					 b->device->udev_properties);
+	if (!device) {
+		r->skipped = "failed to create the device";
+		libinput_unref(li);
+		return;
+	}
+
+	configure_device(device);
+	drain_events(li);
+
+	time = libinput_now(li);
+
+	for (unsigned int n = 0; n < ctx->warmup + ctx->iterations; n++) {
+		struct frame_timer t;
+
+		state.nevents = 0;
+		time += b->frame(&state, n);
+		add_event(&state, EV_SYN, SYN_REPORT, 0);
+
+		for (size_t i = 0; i < state.nevents; i++)
+			input_event_set_time(&state.events[i], time);
+
+		frame_begin(&t);
+		evdev_device_inject_frame(evdev_device(device),
+					  state.events,
+					  state.nevents);
+		drain_events(li);
+		frame_end(&t, r, n >= ctx->warmup, state.nevents);
+	}
+
+	libinput_path_remove_device(device);
+	libinput_unref(li);
+}
+
+/* The event queue, without any device processing: events are posted
+ * through the notify functions and read back by the caller */
+
+#define EVENT_QUEUE_BATCH 32
+
+static void
+run_event_queue_bench(struct bench_context *ctx)
+{
+	struct bench_result *r = bench_result_new(ctx, "event-queue");
+	struct libinput *li;
+	struct libinput_device *device;
+	uint64_t time;
+
+	li = bench_create_context();
+	if (!li) {
+		r->skipped = "failed to create a libinput context";
+		return;
+	}
+
+	device = path_add_virtual_device(li,
+					 bench_device_new_evdev(&keyboard_device),
+					 "event0",
+					 keyboard_device.udev_properties);
+	if (!device) {
+		r->skipped = "failed to create the device";
+		libinput_unref(li);
+		return;
+	}
+	drain_events(li);
+
+	time = libinput_now(li);
+
+	for (unsigned int n = 0; n < ctx->warmup + ctx->iterations; n++) {
+		struct frame_timer t;
+		size_t count;
+
+		frame_begin(&t);
+		for (unsigned int i = 0; i < EVENT_QUEUE_BATCH; i += 2) {
+			time += ms2us(1);
+			keyboard_notify_key(device, time, KEY_A + i/2,
+					    LIBINPUT_KEY_STATE_PRESSED);
+			keyboard_notify_key(device, time, KEY_A + i/2,
+					    LIBINPUT_KEY_STATE_RELEASED);
+		}
+		count = drain_events(li);
+		frame_end(&t, r, n >= ctx->warmup, count);
+	}
+
+	libinput_path_remove_device(device);
+	libinput_unref(li);
+}
+
+/* Quirks lookup for the first input device on this machine, the quirks
+ * data is taken from the source tree */
+
+LIBINPUT_ATTRIBUTE_PRINTF(3, 0)
+static void
+quirks_log_handler(struct libinput *li,
+		   enum libinput_log_priority priority,
+		   const char *format,
+		   va_list args)
+{
+	if (verbose)
+		vfprintf(stderr, format, args);
+}
+
+static struct udev_device *
+find_input_device(struct udev *udev)
+{
+	struct udev_enumerate *e;
+	struct udev_list_entry *entry;
+	struct udev_device *device = NULL;
+
+	e = udev_enumerate_new(udev);
+	udev_enumerate_add_match_subsystem(e, "input");
+	udev_enumerate_add_match_sysname(e, "event*");
+	udev_enumerate_scan_devices(e);
+
+	udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(e)) {
+		const char *path = udev_list_entry_get_name(entry);
+
+		device = udev_device_new_from_syspath(udev, path);
+		if (device)
+			break;
+	}
+
+	udev_enumerate_unref(e);
+
+	return device;
+}
+
+static void
+run_quirks_bench(struct bench_context *ctx)
+{
+	struct bench_result *r = bench_result_new(ctx, "quirks");
+	struct quirks_context *quirks;
+	struct udev *udev;
+	struct udev_device *device = NULL;
+
+	udev = udev_new();
+	if (udev)
+		device = find_input_device(udev);
+	if (!device) {
+		r->skipped = "no input device found";
+		udev_unref(udev);
+		return;
+	}
+
+	quirks = quirks_init_subsystem(LIBINPUT_QUIRKS_SRCDIR,
+				       NULL,
+				       quirks_log_handler,
+				       NULL,
+				       QLOG_CUSTOM_LOG_PRIORITIES);
+	if (!quirks) {
+		r->skipped = "failed to load the quirks";
+		udev_device_unref(device);
+		udev_unref(udev);
+		return;
+	}
+
+	for (unsigned int n = 0; n < ctx->warmup + ctx->iterations; n++) {
+		struct frame_timer t;
+		struct quirks *q;
+
+		frame_begin(&t);
+		q = quirks_fetch_for_device(quirks, device);
+		quirks_unref(q);
+		frame_end(&t, r, n >= ctx->warmup, 1);
+	}
+
+	quirks_context_unref(quirks);
+	udev_device_unref(device);
+	udev_unref(udev);
+}
+
+/* Output */
+
+static int
+compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t*)a,
+		 y = *(const uint64_t*)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void
+print_result(const struct bench_result *r, bool last)
+{
+	uint64_t total = 0;
+
+	printf("    {\n");
+	printf("      \"name\": \"%s\",\n", r->name);
+
+	if (r->skipped || r->nframes == 0) {
+		printf("      \"skipped\": \"%s\"\n",
+		       r->skipped ? r->skipped : "no frames");
+		printf("    }%s\n", last ? "" : ",");
+		return;
+	}
+
+	qsort(r->frame_times, r->nframes, sizeof(*r->frame_times), compare_u64);
+	for (size_t i = 0; i < r->nframes; i++)
+		total += r->frame_times[i];
+
+	printf("      \"frames\": %zu,\n", r->nframes);
+	printf("      \"events\": %" PRIu64 ",\n", r->nevents);
+	printf("      \"ns_per_event\": %.1f,\n",
+	       r->nevents ? (double)total / r->nevents : 0.0);
+	if (HAVE_ALLOCATION_COUNT)
+		printf("      \"allocs_per_event\": %.3f,\n",
+		       r->nevents ? (double)r->nallocs / r->nevents : 0.0);
+	else
+		printf("      \"allocs_per_event\": null,\n");
+	if (cache_miss_fd != -1)
+		printf("      \"cache_misses_per_frame\": %.1f,\n",
+		       (double)r->ncache_misses / r->nframes);
+	else
+		printf("      \"cache_misses_per_frame\": null,\n");
+	printf("      \"frame_ns\": {\n");
+	printf("        \"p50\": %" PRIu64 ",\n",
+	       r->frame_times[r->nframes * 50 / 100]);
+	printf("        \"p99\": %" PRIu64 ",\n",
+	       r->frame_times[min(r->nframes - 1, r->nframes * 99 / 100)]);
+	printf("        \"max\": %" PRIu64 "\n",
+	       r->frame_times[r->nframes - 1]);
+	printf("      }\n");
+	printf("    }%s\n", last ? "" : ",");
+}
+
+static void
+print_results(struct bench_context *ctx)
+{
+	printf("{\n");
+	printf("  \"version\": 1,\n");
+	printf("  \"libinput\": \"%s\",\n", LIBINPUT_VERSION);
+	printf("  \"iterations\": %u,\n", ctx->iterations);
+	printf("  \"benchmarks\": [\n");
+	for (size_t i = 0; i < ctx->nresults; i++)
+		print_result(&ctx->results[i], i == ctx->nresults - 1);
+	printf("  ]\n");
+	printf("}\n");
+}
+
+static void
+usage(void)
+{
+	printf("Usage: libinput-bench [--help] [--list] [--iterations=<count>] [--benchmark=<pattern>] [--verbose]\n"
+	       "\n"
+	       "Runs synthetic event streams through libinput and prints the\n"
+	       "processing times as JSON.\n"
+	       "\n"
+	       "Options:\n"
+	       "  --list ................. list the benchmarks and exit\n"
+	       "  --iterations=<count> ... the number of frames per benchmark (default: %d)\n"
+	       "  --benchmark=<pattern> .. only run benchmarks matching the shell-style pattern\n"
+	       "  --verbose .............. print libinput's log messages\n",
+	       DEFAULT_ITERATIONS);
+}
+
+static bool
+want_bench(const char *name, const char *pattern, bool list)
+{
+	if (pattern && fnmatch(pattern, name, 0) == FNM_NOMATCH)
+		return false;
+
+	if (list) {
+		printf("%s\n", name);
+		return false;
+	}
+
+	return true;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct bench_context ctx = {
+		.iterations = DEFAULT_ITERATIONS,
+	};
+	const char *pattern = NULL;
+	bool list = false;
+
+	while (1) {
+		enum opts {
+			OPT_ITERATIONS,
+			OPT_BENCHMARK,
+			OPT_LIST,
+			OPT_VERBOSE,
+		};
+		static struct option opts[] = {
+			{ "help", no_argument, 0, 'h' },
+			{ "iterations", required_argument, 0, OPT_ITERATIONS },
+			{ "benchmark", required_argument, 0, OPT_BENCHMARK },
+			{ "list", no_argument, 0, OPT_LIST },
+			{ "verbose", no_argument, 0, OPT_VERBOSE },
+			{ 0, 0, 0, 0 },
+		};
+		int c;
+		int option_index = 0;
+
+		c = getopt_long(argc, argv, "h", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch (c) {
+		case 'h':
+			usage();
+			return EXIT_SUCCESS;
+		case OPT_ITERATIONS:
+			if (!safe_atou(optarg, &ctx.iterations) ||
+			    ctx.iterations == 0) {
+				usage();
+				return EXIT_INVALID_USAGE;
+			}
+			break;
+		case OPT_BENCHMARK:
+			pattern = optarg;
+			break;
+		case OPT_LIST:
+			list = true;
+			break;
+		case OPT_VERBOSE:
+			verbose = true;
+			break;
+		default:
+			usage();
+			return EXIT_INVALID_USAGE;
+		}
+	}
+
+	if (optind < argc) {
+		usage();
+		return EXIT_INVALID_USAGE;
+	}
+
+	ctx.warmup = max(ctx.iterations / 10, 1U);
+
+	if (!list)
+		cache_miss_counter_init();
+
+	for (size_t i = 0; i < ARRAY_LENGTH(filter_benches); i++) {
+		if (want_bench(filter_benches[i].name, pattern, list))
+			run_filter_bench(&ctx, &filter_benches[i]);
+	}
+
+	for (size_t i = 0; i < ARRAY_LENGTH(device_benches); i++) {
+		if (want_bench(device_benches[i].name, pattern, list))
+			run_device_bench(&ctx, &device_benches[i]);
+	}
+
+	if (want_bench("event-queue", pattern, list))
+		run_event_queue_bench(&ctx);
+
+	if (want_bench("quirks", pattern, list))
+		run_quirks_bench(&ctx);
+
+	if (list)
+		return EXIT_SUCCESS;
+
+	print_results(&ctx);
+
+	for (size_t i = 0; i < ctx.nresults; i++)
+		free(ctx.results[i].frame_times);
+	free(ctx.results);
+
+	if (cache_miss_fd != -1)
+		close(cache_miss_fd);
+
+	return EXIT_SUCCESS;
+}
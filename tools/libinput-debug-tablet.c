@@ -28,6 +28,7 @@
 #include <fcntl.h>
 #include <inttypes.h>
 #include <getopt.h>
+#include <math.h>
 #include <poll.h>
 #include <stdio.h>
 #include <string.h>
@@ -38,6 +39,7 @@
 #include <libevdev/libevdev.h>
 
 #include "shared.h"
+#include "util-input-event.h"
 #include "util-macros.h"
 
 static volatile sig_atomic_t stop = 0;
@@ -70,6 +72,25 @@ struct context {
 		int tilt_x, tilt_y;
 		int distance, pressure;
 	} abs;
+
+	/* The libinput position lags behind the evdev position by however
+	 * much the smoothing holds it back. We keep the last few evdev
+	 * positions (in mm) and look up where the tool was at the time of
+	 * the libinput event and when it was where libinput says it is. */
+	struct {
+		struct {
+			uint64_t time;
+			double x, y;
+		} samples[64];
+		unsigned int index;
+		unsigned int count;
+
+		uint64_t time; /* of the last libinput axis event */
+		bool pending;
+		bool valid;
+		double mm;
+		double ms;
+	} lag;
 };
 
 static void
@@ -221,7 +242,11 @@ print_state(struct context *ctx)
 	print_buttons(ctx,
 		      ctx->buttons_down,
 		      ARRAY_LENGTH(ctx->buttons_down));
-	lines_printed += 11;
+	if (ctx->lag.valid)
+		print_line("  lag: %.2fmm %.1fms", ctx->lag.mm, ctx->lag.ms);
+	else
+		print_line("  lag: -");
+	lines_printed += 12;
 
 	printf("evdev:\n");
 	print_bar("ABS_X:", ctx->abs.x, normalize(ctx->evdev, ABS_X, ctx->abs.x));
@@ -299,6 +324,9 @@ update_tablet_axes(struct context *ctx, struct libinput_event_tablet_tool *t)
 	ctx->pressure = libinput_event_tablet_tool_get_pressure(t);
 	ctx->rotation = libinput_event_tablet_tool_get_rotation(t);
 	ctx->slider = libinput_event_tablet_tool_get_slider_position(t);
+
+	ctx->lag.time = libinput_event_tablet_tool_get_time_usec(t);
+	ctx->lag.pending = true;
 }
 
 static void
@@ -393,6 +421,82 @@ handle_libinput_events(struct context *ctx)
 	}
 }
 
+static void
+record_evdev_position(struct context *ctx, const struct input_event *event)
+{
+	const struct input_absinfo *ax, *ay;
+	unsigned int index;
+
+	ax = libevdev_get_abs_info(ctx->evdev, ABS_X);
+	ay = libevdev_get_abs_info(ctx->evdev, ABS_Y);
+	if (!ax || !ay || ax->resolution == 0 || ay->resolution == 0)
+		return;
+
+	index = (ctx->lag.index + 1) % ARRAY_LENGTH(ctx->lag.samples);
+	ctx->lag.samples[index].time = input_event_time(event);
+	ctx->lag.samples[index].x = 1.0 * (ctx->abs.x - ax->minimum)/ax->resolution;
+	ctx->lag.samples[index].y = 1.0 * (ctx->abs.y - ay->minimum)/ay->resolution;
+	ctx->lag.index = index;
+	ctx->lag.count = min(ctx->lag.count + 1, ARRAY_LENGTH(ctx->lag.samples));
+}
+
+static void
+update_lag(struct context *ctx)
+{
+	double w = 0, h = 0;
+	bool flip = false;
+	bool found = false;
+	double best = INFINITY;
+
+	if (!ctx->lag.pending || !ctx->device)
+		return;
+
+	ctx->lag.pending = false;
+	ctx->lag.valid = false;
+
+	/* evdev doesn't know about left-handed, calibration isn't
+	 * accounted for */
+	if (libinput_device_config_left_handed_is_available(ctx->device) &&
+	    libinput_device_config_left_handed_get(ctx->device)) {
+		libinput_device_get_size(ctx->device, &w, &h);
+		flip = true;
+	}
+
+	for (unsigned int i = 0; i < ctx->lag.count; i++) {
+		size_t sz = ARRAY_LENGTH(ctx->lag.samples);
+		unsigned int index = (ctx->lag.index + sz - i) % sz;
+		double x = ctx->lag.samples[index].x,
+		       y = ctx->lag.samples[index].y;
+		uint64_t time = ctx->lag.samples[index].time;
+		double dist;
+
+		if (time > ctx->lag.time)
+			continue;
+
+		if (flip) {
+			x = w - x;
+			y = h - y;
+		}
+
+		dist = hypot(ctx->x - x, ctx->y - y);
+
+		/* The most recent sample is where the tool really was */
+		if (!found) {
+			ctx->lag.mm = dist;
+			found = true;
+		}
+
+		/* The closest one is when the tool was where libinput
+		 * says it is now */
+		if (dist < best) {
+			best = dist;
+			ctx->lag.ms = (ctx->lag.time - time)/1000.0;
+		}
+	}
+
+	ctx->lag.valid = found;
+}
+
 static void
 handle_libevdev_events(struct context *ctx)
 {
@@ -452,6 +556,9 @@ handle_libevdev_events(struct context *ctx)
 		case evbit(EV_ABS, ABS_DISTANCE):
 			ctx->abs.distance = event.value;
 			break;
+		case evbit(EV_SYN, SYN_REPORT):
+			record_evdev_position(ctx, &event);
+			break;
 		}
 	}
 }
@@ -476,6 +583,7 @@ mainloop(struct context *ctx)
 	do {
 		handle_libinput_events(ctx);
 		handle_libevdev_events(ctx);
+		update_lag(ctx);
 
 		printf(ANSI_LEFT, 1000);
 		printf(ANSI_UP, lines_printed);
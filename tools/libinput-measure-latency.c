@@ -0,0 +1,376 @@
+/*
+ * Copyright © 2021 Red Hat, Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <getopt.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+
+#include <libinput.h>
+
+#include "shared.h"
+#include "util-macros.h"
+
+static volatile sig_atomic_t stop = 0;
+
+#define MAX_DEVICES 64
+#define MAX_BUCKETS 64
+
+struct context {
+	struct libinput *libinput;
+	struct libinput_device *devices[MAX_DEVICES];
+	size_t ndevices;
+	bool print_histogram;
+};
+
+static const struct {
+	enum libinput_event_type type;
+	const char *name;
+} event_types[] = {
+	{ LIBINPUT_EVENT_KEYBOARD_KEY, "KEYBOARD_KEY" },
+	{ LIBINPUT_EVENT_POINTER_MOTION, "POINTER_MOTION" },
+	{ LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE, "POINTER_MOTION_ABSOLUTE" },
+	{ LIBINPUT_EVENT_POINTER_BUTTON, "POINTER_BUTTON" },
+	{ LIBINPUT_EVENT_POINTER_AXIS, "POINTER_AXIS" },
+	{ LIBINPUT_EVENT_TOUCH_DOWN, "TOUCH_DOWN" },
+	{ LIBINPUT_EVENT_TOUCH_UP, "TOUCH_UP" },
+	{ LIBINPUT_EVENT_TOUCH_MOTION, "TOUCH_MOTION" },
+	{ LIBINPUT_EVENT_TOUCH_CANCEL, "TOUCH_CANCEL" },
+	{ LIBINPUT_EVENT_TOUCH_FRAME, "TOUCH_FRAME" },
+	{ LIBINPUT_EVENT_TABLET_TOOL_AXIS, "TABLET_TOOL_AXIS" },
+	{ LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY, "TABLET_TOOL_PROXIMITY" },
+	{ LIBINPUT_EVENT_TABLET_TOOL_TIP, "TABLET_TOOL_TIP" },
+	{ LIBINPUT_EVENT_TABLET_TOOL_BUTTON, "TABLET_TOOL_BUTTON" },
+	{ LIBINPUT_EVENT_TABLET_PAD_BUTTON, "TABLET_PAD_BUTTON" },
+	{ LIBINPUT_EVENT_TABLET_PAD_RING, "TABLET_PAD_RING" },
+	{ LIBINPUT_EVENT_TABLET_PAD_STRIP, "TABLET_PAD_STRIP" },
+	{ LIBINPUT_EVENT_TABLET_PAD_KEY, "TABLET_PAD_KEY" },
+	{ LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN, "GESTURE_SWIPE_BEGIN" },
+	{ LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE, "GESTURE_SWIPE_UPDATE" },
+	{ LIBINPUT_EVENT_GESTURE_SWIPE_END, "GESTURE_SWIPE_END" },
+	{ LIBINPUT_EVENT_GESTURE_PINCH_BEGIN, "GESTURE_PINCH_BEGIN" },
+	{ LIBINPUT_EVENT_GESTURE_PINCH_UPDATE, "GESTURE_PINCH_UPDATE" },
+	{ LIBINPUT_EVENT_GESTURE_PINCH_END, "GESTURE_PINCH_END" },
+	{ LIBINPUT_EVENT_SWITCH_TOGGLE, "SWITCH_TOGGLE" },
+};
+
+/* Upper bound of the bucket in us, bucket 0 is [0, 2us) */
+static inline uint64_t
+bucket_upper_bound(size_t bucket)
+{
+	return 2ULL << bucket;
+}
+
+static void
+format_bucket(char *buf, size_t sz, size_t bucket, size_t nbuckets)
+{
+	const char *prefix = "<";
+	uint64_t us = bucket_upper_bound(bucket);
+
+	if (bucket == nbuckets - 1) {
+		prefix = ">=";
+		us = bucket_upper_bound(bucket - 1);
+	}
+
+	if (us >= 1000000)
+		snprintf(buf, sz, "%s%.1fs", prefix, us/1000000.0);
+	else if (us >= 1000)
+		snprintf(buf, sz, "%s%.1fms", prefix, us/1000.0);
+	else
+		snprintf(buf, sz, "%s%" PRIu64 "us", prefix, us);
+}
+
+/* The bucket the given percentile of samples falls into */
+static size_t
+percentile_bucket(const uint64_t *counts, size_t nbuckets,
+		  uint64_t total, unsigned int percentile)
+{
+	uint64_t threshold = (total * percentile + 99) / 100;
+	uint64_t sum = 0;
+
+	for (size_t i = 0; i < nbuckets; i++) {
+		sum += counts[i];
+		if (sum >= threshold)
+			return i;
+	}
+
+	return nbuckets - 1;
+}
+
+static void
+print_histogram(struct context *ctx,
+		struct libinput_device *device,
+		enum libinput_latency_stage stage,
+		enum libinput_event_type type,
+		const char *stagename,
+		const char *typename)
+{
+	uint64_t counts[MAX_BUCKETS] = {0};
+	size_t nbuckets;
+	uint64_t total = 0;
+	size_t max = 0;
+	char p50[16], p90[16], p99[16], pmax[16];
+
+	nbuckets = libinput_device_get_latency_histogram(device,
+							 stage,
+							 type,
+							 counts,
+							 ARRAY_LENGTH(counts));
+	nbuckets = min(nbuckets, ARRAY_LENGTH(counts));
+
+	for (size_t i = 0; i < nbuckets; i++) {
+		total += counts[i];
+		if (counts[i] > 0)
+			max = i;
+	}
+
+	if (total == 0)
+		return;
+
+	format_bucket(p50, sizeof(p50),
+		      percentile_bucket(counts, nbuckets, total, 50), nbuckets);
+	format_bucket(p90, sizeof(p90),
+		      percentile_bucket(counts, nbuckets, total, 90), nbuckets);
+	format_bucket(p99, sizeof(p99),
+		      percentile_bucket(counts, nbuckets, total, 99), nbuckets);
+	format_bucket(pmax, sizeof(pmax), max, nbuckets);
+
+	printf("  %-10s %-24s %10" PRIu64 " %9s %9s %9s %9s\n",
+	       stagename, typename, total, p50, p90, p99, pmax);
+
+	if (!ctx->print_histogram)
+		return;
+
+	for (size_t i = 0; i <= max; i++) {
+		char bucket[16];
+
+		format_bucket(bucket, sizeof(bucket), i, nbuckets);
+		printf("  %47s %10" PRIu64 "\n", bucket, counts[i]);
+	}
+}
+
+static void
+print_device(struct context *ctx, struct libinput_device *device)
+{
+	printf("%-7s - %s\n",
+	       libinput_device_get_sysname(device),
+	       libinput_device_get_name(device));
+	printf("  %-10s %-24s %10s %9s %9s %9s %9s\n",
+	       "stage", "event type", "count", "p50", "p90", "p99", "max");
+
+	print_histogram(ctx, device,
+			LIBINPUT_LATENCY_STAGE_READ,
+			LIBINPUT_EVENT_NONE,
+			"read", "-");
+
+	for (size_t i = 0; i < ARRAY_LENGTH(event_types); i++) {
+		print_histogram(ctx, device,
+				LIBINPUT_LATENCY_STAGE_QUEUED,
+				event_types[i].type,
+				"queued", event_types[i].name);
+		print_histogram(ctx, device,
+				LIBINPUT_LATENCY_STAGE_DELIVERED,
+				event_types[i].type,
+				"delivered", event_types[i].name);
+	}
+	printf("\n");
+}
+
+static void
+handle_device_added(struct context *ctx, struct libinput_device *device)
+{
+	if (ctx->ndevices >= ARRAY_LENGTH(ctx->devices)) {
+		fprintf(stderr,
+			"Too many devices, ignoring %s\n",
+			libinput_device_get_sysname(device));
+		return;
+	}
+
+	ctx->devices[ctx->ndevices++] = libinput_device_ref(device);
+	printf("Measuring %s - %s\n",
+	       libinput_device_get_sysname(device),
+	       libinput_device_get_name(device));
+}
+
+static void
+handle_device_removed(struct context *ctx, struct libinput_device *device)
+{
+	for (size_t i = 0; i < ctx->ndevices; i++) {
+		if (ctx->devices[i] != device)
+			continue;
+
+		print_device(ctx, device);
+		libinput_device_unref(device);
+		ctx->devices[i] = ctx->devices[--ctx->ndevices];
+		break;
+	}
+}
+
+static void
+handle_libinput_events(struct context *ctx)
+{
+	struct libinput_event *ev;
+
+	libinput_dispatch(ctx->libinput);
+	while ((ev = libinput_get_event(ctx->libinput))) {
+		struct libinput_device *device = libinput_event_get_device(ev);
+
+		switch (libinput_event_get_type(ev)) {
+		case LIBINPUT_EVENT_DEVICE_ADDED:
+			handle_device_added(ctx, device);
+			break;
+		case LIBINPUT_EVENT_DEVICE_REMOVED:
+			handle_device_removed(ctx, device);
+			break;
+		default:
+			break;
+		}
+
+		libinput_event_destroy(ev);
+	}
+}
+
+static void
+sighandler(int signal, siginfo_t *siginfo, void *userdata)
+{
+	stop = 1;
+}
+
+static void
+mainloop(struct context *ctx)
+{
+	struct pollfd fds;
+
+	fds.fd = libinput_get_fd(ctx->libinput);
+	fds.events = POLLIN;
+	fds.revents = 0;
+
+	printf("Measuring input latency, hit Ctrl+C to stop and print the results\n");
+
+	do {
+		handle_libinput_events(ctx);
+	} while (!stop && poll(&fds, 1, -1) > -1);
+
+	printf("\n");
+
+	for (size_t i = 0; i < ctx->ndevices; i++) {
+		print_device(ctx, ctx->devices[i]);
+		libinput_device_unref(ctx->devices[i]);
+	}
+	ctx->ndevices = 0;
+}
+
+static void
+usage(void) {
+	printf("Usage: libinput measure latency [--histogram] [--udev <seat>|--device /dev/input/event0]\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	struct context ctx = {0};
+	struct libinput *li;
+	enum tools_backend backend = BACKEND_NONE;
+	const char *seat_or_device[2] = {"seat0", NULL};
+	struct sigaction act;
+	bool grab = false;
+
+	while (1) {
+		int c;
+		int option_index = 0;
+		enum {
+			OPT_DEVICE = 1,
+			OPT_UDEV,
+			OPT_HISTOGRAM,
+		};
+		static struct option opts[] = {
+			{ "help",                      no_argument,       0, 'h' },
+			{ "device",                    required_argument, 0, OPT_DEVICE },
+			{ "udev",                      required_argument, 0, OPT_UDEV },
+			{ "histogram",                 no_argument,       0, OPT_HISTOGRAM },
+			{ 0, 0, 0, 0}
+		};
+
+		c = getopt_long(argc, argv, "h", opts, &option_index);
+		if (c == -1)
+			break;
+
+		switch(c) {
+		case '?':
+			exit(EXIT_INVALID_USAGE);
+			break;
+		case 'h':
+			usage();
+			exit(EXIT_SUCCESS);
+			break;
+		case OPT_DEVICE:
+			backend = BACKEND_DEVICE;
+			seat_or_device[0] = optarg;
+			break;
+		case OPT_UDEV:
+			backend = BACKEND_UDEV;
+			seat_or_device[0] = optarg;
+			break;
+		case OPT_HISTOGRAM:
+			ctx.print_histogram = true;
+			break;
+		}
+	}
+
+	if (optind < argc) {
+		if (optind < argc - 1 || backend != BACKEND_NONE) {
+			usage();
+			return EXIT_INVALID_USAGE;
+		}
+		backend = BACKEND_DEVICE;
+		seat_or_device[0] = argv[optind];
+	} else if (backend == BACKEND_NONE) {
+		backend = BACKEND_UDEV;
+	}
+
+	memset(&act, 0, sizeof(act));
+	act.sa_sigaction = sighandler;
+	act.sa_flags = SA_SIGINFO;
+
+	if (sigaction(SIGINT, &act, NULL) == -1) {
+		fprintf(stderr, "Failed to set up signal handling (%s)\n",
+				strerror(errno));
+		return EXIT_FAILURE;
+	}
+
+	li = tools_open_backend(backend, seat_or_device, false, &grab);
+	if (!li)
+		return EXIT_FAILURE;
+
+	ctx.libinput = li;
+	mainloop(&ctx);
+
+	libinput_unref(li);
+
+	return EXIT_SUCCESS;
+}
@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <errno.h>
 #include <getopt.h>
+#include <libgen.h>
 #include <sys/stat.h>
 
 #include "quirks.h"
@@ -78,7 +79,10 @@ usage(void)
 	       "	Print the quirks for the given device\n"
 	       "\n"
 	       "  libinput quirks validate [--data-dir /path/to/quirks/dir]\n"
-	       "	Validate the database\n");
+	       "	Validate the database\n"
+	       "\n"
+	       "  libinput quirks compile [--data-dir /path/to/quirks/dir] [--output /path/to/cache]\n"
+	       "	Compile the database into a cache file\n");
 }
 
 static void
@@ -94,10 +98,12 @@ main(int argc, char **argv)
 	struct udev_device *device = NULL;
 	const char *path;
 	const char *data_path = NULL,
-	           *override_file = NULL;
+	           *override_file = NULL,
+	           *cache_file = NULL;
 	int rc = 1;
 	struct quirks_context *quirks;
-	bool validate = false;
+	bool validate = false,
+	     compile = false;
 
 	while (1) {
 		int c;
@@ -105,11 +111,13 @@ main(int argc, char **argv)
 		enum {
 			OPT_VERBOSE,
 			OPT_DATADIR,
+			OPT_OUTPUT,
 		};
 		static struct option opts[] = {
 			{ "help",     no_argument,       0, 'h' },
 			{ "verbose",  no_argument,       0, OPT_VERBOSE },
 			{ "data-dir", required_argument, 0, OPT_DATADIR },
+			{ "output",   required_argument, 0, OPT_OUTPUT },
 			{ 0, 0, 0, 0}
 		};
 
@@ -131,6 +139,9 @@ main(int argc, char **argv)
 		case OPT_DATADIR:
 			data_path = optarg;
 			break;
+		case OPT_OUTPUT:
+			cache_file = optarg;
+			break;
 		default:
 			usage();
 			return 1;
@@ -155,6 +166,13 @@ main(int argc, char **argv)
 			return 1;
 		}
 		validate = true;
+	} else if (streq(argv[optind], "compile")) {
+		optind++;
+		if (optind < argc) {
+			usage();
+			return 1;
+		}
+		compile = true;
 	} else {
 		fprintf(stderr, "Unnkown action '%s'\n", argv[optind]);
 		return 1;
@@ -172,6 +190,19 @@ main(int argc, char **argv)
 		}
 	}
 
+	/* The system cache must only ever hold the system quirks, anything
+	 * else makes it stale for the installed files */
+	if (compile && !cache_file) {
+		if (!streq(data_path, LIBINPUT_QUIRKS_DIR)) {
+			fprintf(stderr,
+				"Error: --output is required to compile quirks "
+				"other than the ones in %s\n",
+				LIBINPUT_QUIRKS_DIR);
+			return 1;
+		}
+		cache_file = LIBINPUT_QUIRKS_CACHE_FILE;
+	}
+
 	quirks = quirks_init_subsystem(data_path,
 				      override_file,
 				      log_handler,
@@ -190,6 +221,19 @@ main(int argc, char **argv)
 		goto out;
 	}
 
+	if (compile) {
+		char *dir = safe_strdup(cache_file);
+
+		/* Only create the last path component, the rest
+		 * is expected to exist */
+		if (mkdir(dirname(dir), 0755) < 0 && errno != EEXIST)
+			fprintf(stderr, "Error: %s: %m\n", dir);
+		free(dir);
+
+		rc = quirks_context_write_cache(quirks, cache_file) ? 0 : 1;
+		goto out;
+	}
+
 	udev = udev_new();
 	if (!udev)
 		goto out;
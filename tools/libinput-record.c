@@ -23,6 +23,7 @@
 
 #include "config.h"
 
+#include <assert.h>
 #include <errno.h>
 #include <sys/epoll.h>
 #include <inttypes.h>
@@ -48,6 +49,7 @@
 #include "libinput-git-version.h"
 #include "shared.h"
 #include "builddir.h"
+#include "util-bits.h"
 #include "util-list.h"
 #include "util-time.h"
 #include "util-input-event.h"
@@ -55,6 +57,75 @@
 
 static const int FILE_VERSION_NUMBER = 1;
 
+/* The binary format is a struct record_bin_header followed by a stream of
+ * chunks, each one a struct record_bin_chunk followed by length bytes of
+ * payload. All values are in host byte order.
+ *
+ * Anything that isn't an evdev event (the header, the device
+ * descriptions, comments, libinput events) is stored as the YAML text the
+ * YAML format would have printed, in a CHUNK_TEXT. The evdev events are
+ * stored as CHUNK_EVDEV_FRAME, the YAML comments for those are generated
+ * by libinput record convert.
+ */
+#define RECORD_BIN_MAGIC "LIBINREC"
+static const uint32_t RECORD_BIN_VERSION = 1;
+
+struct record_bin_header {
+	char magic[8];		/* RECORD_BIN_MAGIC, not null-terminated */
+	uint32_t version;
+	uint32_t reserved;
+};
+
+enum record_bin_chunk_type {
+	CHUNK_TEXT = 1,		/* YAML text */
+	CHUNK_ABS_STATE,	/* struct record_bin_abs[] */
+	CHUNK_EVDEV_FRAME,	/* struct record_bin_event[] */
+};
+
+/* Device index for text that is not part of a device, e.g. the header */
+#define RECORD_BIN_NO_DEVICE 0xffff
+#define RECORD_BIN_MAX_CHUNK_SIZE (64 * 1024 * 1024)
+
+struct record_bin_chunk {
+	uint16_t type;		/* enum record_bin_chunk_type */
+	uint16_t device;	/* index in the recording */
+	uint32_t length;	/* bytes of payload */
+};
+
+enum record_bin_event_flags {
+	RECORD_BIN_EVENT_OBFUSCATED = bit(0),
+};
+
+struct record_bin_event {
+	uint64_t time;		/* us since the start of the recording */
+	uint8_t type;
+	uint8_t flags;		/* enum record_bin_event_flags */
+	uint16_t code;
+	int32_t value;
+};
+
+/* The state of the device's EV_ABS axes when recording starts, required
+ * to print the deltas */
+#define RECORD_BIN_NO_SLOT 0xffff
+
+struct record_bin_abs {
+	uint16_t code;
+	uint16_t slot;		/* RECORD_BIN_NO_SLOT for the axis value */
+	int32_t minimum;
+	int32_t maximum;
+	int32_t value;
+};
+
+static_assert(sizeof(struct record_bin_header) == 16, "Unexpected header size");
+static_assert(sizeof(struct record_bin_chunk) == 8, "Unexpected chunk size");
+static_assert(sizeof(struct record_bin_event) == 16, "Unexpected event size");
+static_assert(sizeof(struct record_bin_abs) == 16, "Unexpected abs size");
+
+enum record_format {
+	FORMAT_YAML,
+	FORMAT_BINARY,
+};
+
 /* Indentation levels for the various data nodes */
 enum indent {
 	I_NONE = 0,
@@ -74,27 +145,48 @@ enum indent {
 	I_EVENT = 6,			/* event data */
 };
 
+struct touch_state {
+	bool is_touch_device;
+	uint16_t slot_state;
+	uint16_t last_slot_state;
+};
+
 struct record_device {
 	struct record_context *ctx;
 	struct list link;
+	uint16_t index;		/* index in the recording */
 	char *devnode;		/* device node of the source device */
 	struct libevdev *evdev;
 	struct libevdev *evdev_prev; /* previous value, used for EV_ABS
 					deltas */
 	struct libinput_device *device;
 
-	struct {
-		bool is_touch_device;
-		uint16_t slot_state;
-		uint16_t last_slot_state;
-	} touch;
+	struct touch_state touch;
 
+	/* For FORMAT_YAML, the output file. For FORMAT_BINARY, a memstream
+	 * collecting the text written between two frames */
 	FILE *fp;
+
+	struct {
+		char *text;	/* the memstream buffer */
+		size_t text_len;
+
+		struct record_bin_event *events; /* the current frame */
+		size_t nevents;
+		size_t sz;
+	} binary;
 };
 
 struct record_context {
 	int timeout;
 	bool show_keycodes;
+	enum record_format format;
+
+	/* FORMAT_BINARY only, the output file and the errno of the first
+	 * write that failed. After a short write the file can't be parsed
+	 * past that point, so nothing else is written. */
+	FILE *out;
+	int write_error;
 
 	uint64_t offset;
 
@@ -205,20 +297,18 @@ time_offset(struct record_context *ctx, uint64_t time)
 	return ctx->offset ? time - ctx->offset : 0;
 }
 
+/**
+ * Print one evdev event with its description. evdev_prev holds the previous
+ * axis values and is updated with this event.
+ */
 static void
-print_evdev_event(struct record_device *dev,
-		  struct input_event *ev)
+print_evdev_event_data(FILE *fp,
+		       struct libevdev *evdev_prev,
+		       const struct input_event *ev,
+		       bool was_modified)
 {
 	const char *tname, *cname;
-	bool was_modified = false;
 	char desc[1024];
-	uint64_t time = input_event_time(ev) - dev->ctx->offset;
-
-	input_event_set_time(ev, time);
-
-	/* Don't leak passwords unless the user wants to */
-	if (!dev->ctx->show_keycodes)
-		was_modified = obfuscate_keycode(ev);
 
 	tname = libevdev_event_type_get_name(ev->type);
 	cname = libevdev_event_code_get_name(ev->type, ev->code);
@@ -256,7 +346,7 @@ print_evdev_event(struct record_device *dev,
 		 */
 		switch (ev->code) {
 		case ABS_MT_SLOT:
-			libevdev_set_event_value(dev->evdev_prev,
+			libevdev_set_event_value(evdev_prev,
 						 ev->type,
 						 ev->code,
 						 ev->value);
@@ -268,7 +358,7 @@ print_evdev_event(struct record_device *dev,
 			break;
 		case ABS_MT_TOUCH_MAJOR ... ABS_MT_POSITION_Y:
 		case ABS_MT_PRESSURE ... ABS_MT_TOOL_Y:
-			if (libevdev_get_num_slots(dev->evdev_prev) > 0)
+			if (libevdev_get_num_slots(evdev_prev) > 0)
 				want = SLOT_DELTA;
 			break;
 		default:
@@ -277,20 +367,20 @@ print_evdev_event(struct record_device *dev,
 
 		switch (want) {
 		case DELTA:
-			oldval = libevdev_get_event_value(dev->evdev_prev,
+			oldval = libevdev_get_event_value(evdev_prev,
 							  ev->type,
 							  ev->code);
-			libevdev_set_event_value(dev->evdev_prev,
+			libevdev_set_event_value(evdev_prev,
 						 ev->type,
 						 ev->code,
 						 ev->value);
 			break;
 		case SLOT_DELTA: {
-			int slot = libevdev_get_current_slot(dev->evdev_prev);
-			oldval = libevdev_get_slot_value(dev->evdev_prev,
+			int slot = libevdev_get_current_slot(evdev_prev);
+			oldval = libevdev_get_slot_value(evdev_prev,
 							 slot,
 							 ev->code);
-			libevdev_set_slot_value(dev->evdev_prev,
+			libevdev_set_slot_value(evdev_prev,
 						slot,
 						ev->code,
 						ev->value);
@@ -333,7 +423,7 @@ print_evdev_event(struct record_device *dev,
 			 was_modified ? " (obfuscated)" : "");
 	}
 
-	iprintf(dev->fp,
+	iprintf(fp,
 		I_EVENT,
 		"- [%3lu, %6u, %3d, %3d, %7d] # %s\n",
 		ev->input_event_sec,
@@ -344,17 +434,253 @@ print_evdev_event(struct record_device *dev,
 		desc);
 }
 
+static void
+print_evdev_event(struct record_device *dev,
+		  struct input_event *ev)
+{
+	bool was_modified = false;
+	uint64_t time = input_event_time(ev) - dev->ctx->offset;
+
+	input_event_set_time(ev, time);
+
+	/* Don't leak passwords unless the user wants to */
+	if (!dev->ctx->show_keycodes)
+		was_modified = obfuscate_keycode(ev);
+
+	print_evdev_event_data(dev->fp, dev->evdev_prev, ev, was_modified);
+}
+
+static void
+touch_state_update(struct touch_state *touch,
+		   struct libevdev *evdev,
+		   const struct input_event *e)
+{
+	unsigned int slot;
+
+	if (!touch->is_touch_device ||
+	    e->type != EV_ABS ||
+	    e->code != ABS_MT_TRACKING_ID)
+		return;
+
+	slot = libevdev_get_current_slot(evdev);
+	assert(slot < sizeof(touch->slot_state) * 8);
+
+	if (e->value != -1)
+		touch->slot_state |= 1 << slot;
+	else
+		touch->slot_state &= ~(1 << slot);
+}
+
+static void
+touch_state_print(struct touch_state *touch, FILE *fp)
+{
+	if (touch->slot_state == touch->last_slot_state)
+		return;
+
+	touch->last_slot_state = touch->slot_state;
+	if (touch->slot_state == 0) {
+		iprintf(fp,
+			I_EVENT,
+			 "                                 # Touch device in neutral state\n");
+	}
+}
+
+static void
+binary_write(struct record_context *ctx, const void *data, size_t length)
+{
+	if (ctx->write_error != 0)
+		return;
+
+	if (fwrite(data, length, 1, ctx->out) != 1) {
+		ctx->write_error = errno ? errno : EIO;
+		ctx->stop = true;
+	}
+}
+
+static void
+binary_flush(struct record_context *ctx)
+{
+	if (ctx->write_error != 0)
+		return;
+
+	if (fflush(ctx->out) != 0) {
+		ctx->write_error = errno ? errno : EIO;
+		ctx->stop = true;
+	}
+}
+
+static void
+binary_write_chunk(struct record_context *ctx,
+		   enum record_bin_chunk_type type,
+		   uint16_t device,
+		   const void *data,
+		   size_t length)
+{
+	struct record_bin_chunk chunk = {
+		.type = type,
+		.device = device,
+		.length = length,
+	};
+
+	assert(length <= RECORD_BIN_MAX_CHUNK_SIZE);
+
+	binary_write(ctx, &chunk, sizeof(chunk));
+	if (length > 0)
+		binary_write(ctx, data, length);
+}
+
+static void
+binary_write_header(struct record_context *ctx)
+{
+	struct record_bin_header header = {
+		.version = RECORD_BIN_VERSION,
+	};
+
+	memcpy(header.magic, RECORD_BIN_MAGIC, sizeof(header.magic));
+	binary_write(ctx, &header, sizeof(header));
+}
+
+static void
+binary_open_text(struct record_device *d)
+{
+	d->fp = open_memstream(&d->binary.text, &d->binary.text_len);
+	assert(d->fp);
+}
+
+static void
+binary_close_text(struct record_device *d)
+{
+	fclose(d->fp);
+	d->fp = NULL;
+	free(d->binary.text);
+	d->binary.text = NULL;
+	d->binary.text_len = 0;
+}
+
+/**
+ * Write out any text printed to this device since the last call. Text
+ * written before the first device's description goes into the recording's
+ * header, pass RECORD_BIN_NO_DEVICE for this.
+ */
+static void
+binary_flush_text(struct record_device *d, uint16_t device)
+{
+	if (ftello(d->fp) <= 0)
+		return;
+
+	/* A memstream's buffer is only guaranteed to be stable after
+	 * fclose, reopening is cheap enough for the few text chunks we
+	 * have */
+	fclose(d->fp);
+	binary_write_chunk(d->ctx,
+			   CHUNK_TEXT,
+			   device,
+			   d->binary.text,
+			   d->binary.text_len);
+	free(d->binary.text);
+	d->binary.text = NULL;
+	d->binary.text_len = 0;
+	binary_open_text(d);
+}
+
+static void
+binary_write_abs_state(struct record_device *d)
+{
+	struct libevdev *evdev = d->evdev;
+	struct record_bin_abs *abs = NULL;
+	size_t nabs = 0, sz = 0;
+	int nslots = libevdev_get_num_slots(evdev);
+
+	for (unsigned int code = 0; code < ABS_CNT; code++) {
+		const struct input_absinfo *absinfo;
+
+		absinfo = libevdev_get_abs_info(evdev, code);
+		if (!absinfo)
+			continue;
+
+		if (nabs + nslots + 1 >= sz)
+			resize(abs, sz);
+
+		abs[nabs++] = (struct record_bin_abs) {
+			.code = code,
+			.slot = RECORD_BIN_NO_SLOT,
+			.minimum = absinfo->minimum,
+			.maximum = absinfo->maximum,
+			.value = absinfo->value,
+		};
+
+		if (code <= ABS_MT_SLOT)
+			continue;
+
+		for (int slot = 0; slot < nslots; slot++) {
+			abs[nabs++] = (struct record_bin_abs) {
+				.code = code,
+				.slot = slot,
+				.minimum = absinfo->minimum,
+				.maximum = absinfo->maximum,
+				.value = libevdev_get_slot_value(evdev,
+								 slot,
+								 code),
+			};
+		}
+	}
+
+	binary_write_chunk(d->ctx,
+			   CHUNK_ABS_STATE,
+			   d->index,
+			   abs,
+			   nabs * sizeof(*abs));
+	free(abs);
+}
+
+static void
+binary_queue_event(struct record_device *d, struct input_event *ev)
+{
+	uint64_t time = input_event_time(ev) - d->ctx->offset;
+	uint8_t flags = 0;
+
+	if (!d->ctx->show_keycodes && obfuscate_keycode(ev))
+		flags |= RECORD_BIN_EVENT_OBFUSCATED;
+
+	if (d->binary.nevents >= d->binary.sz)
+		resize(d->binary.events, d->binary.sz);
+
+	d->binary.events[d->binary.nevents++] = (struct record_bin_event) {
+		.time = time,
+		.type = ev->type,
+		.flags = flags,
+		.code = ev->code,
+		.value = ev->value,
+	};
+}
+
+static void
+binary_write_frame(struct record_device *d)
+{
+	/* Anything printed since the last frame (libinput events,
+	 * timestamps) goes first to keep the device's order intact */
+	binary_flush_text(d, d->index);
+	binary_write_chunk(d->ctx,
+			   CHUNK_EVDEV_FRAME,
+			   d->index,
+			   d->binary.events,
+			   d->binary.nevents * sizeof(*d->binary.events));
+	d->binary.nevents = 0;
+}
+
 static bool
 handle_evdev_frame(struct record_device *d)
 {
 	struct libevdev *evdev = d->evdev;
 	struct input_event e;
+	bool binary = d->ctx->format == FORMAT_BINARY;
 
 	if (libevdev_next_event(evdev, LIBEVDEV_READ_FLAG_NORMAL, &e) !=
 		LIBEVDEV_READ_STATUS_SUCCESS)
 		return false;
 
-	iprintf(d->fp, I_EVENTTYPE, "- evdev:\n");
+	if (!binary)
+		iprintf(d->fp, I_EVENTTYPE, "- evdev:\n");
 	do {
 
 		if (d->ctx->offset == 0) {
@@ -362,19 +688,12 @@ handle_evdev_frame(struct record_device *d)
 			d->ctx->offset = time;
 		}
 
-		print_evdev_event(d, &e);
-
-		if (d->touch.is_touch_device &&
-		    e.type == EV_ABS &&
-		    e.code == ABS_MT_TRACKING_ID) {
-			unsigned int slot = libevdev_get_current_slot(evdev);
-			assert(slot < sizeof(d->touch.slot_state) * 8);
+		if (binary)
+			binary_queue_event(d, &e);
+		else
+			print_evdev_event(d, &e);
 
-			if (e.value != -1)
-				d->touch.slot_state |= 1 << slot;
-			else
-				d->touch.slot_state &= ~(1 << slot);
-		}
+		touch_state_update(&d->touch, evdev, &e);
 
 		if (e.type == EV_SYN && e.code == SYN_REPORT)
 			break;
@@ -382,14 +701,11 @@ handle_evdev_frame(struct record_device *d)
 				     LIBEVDEV_READ_FLAG_NORMAL,
 				     &e) == LIBEVDEV_READ_STATUS_SUCCESS);
 
-	if (d->touch.slot_state != d->touch.last_slot_state) {
-		d->touch.last_slot_state = d->touch.slot_state;
-		if (d->touch.slot_state == 0) {
-			iprintf(d->fp,
-				I_EVENT,
-				 "                                 # Touch device in neutral state\n");
-		}
-	}
+	/* The neutral state comment is generated during conversion */
+	if (binary)
+		binary_write_frame(d);
+	else
+		touch_state_print(&d->touch, d->fp);
 
 	return true;
 }
@@ -1259,7 +1575,9 @@ handle_events(struct record_context *ctx, struct record_device *d)
 							     !has_events);
 	}
 
-	fflush(d->fp);
+	/* Binary recordings are flushed by the timer only */
+	if (ctx->format == FORMAT_YAML)
+		fflush(d->fp);
 }
 
 static void
@@ -1927,6 +2245,21 @@ open_output_files(struct record_context *ctx, bool is_prefix)
 		out_file = stdout;
 	}
 
+	if (ctx->format == FORMAT_BINARY) {
+		/* Events are small, write them out in large blocks */
+		setvbuf(out_file, NULL, _IOFBF, 1024 * 1024);
+		ctx->out = out_file;
+		ctx->write_error = 0;
+		binary_write_header(ctx);
+
+		/* All devices write into the same file, the text of each
+		 * device is collected until its next frame */
+		list_for_each(d, &ctx->devices, link)
+			binary_open_text(d);
+
+		return true;
+	}
+
 	ctx->first_device->fp = out_file;
 
 	list_for_each(d, &ctx->devices, link) {
@@ -1965,8 +2298,14 @@ print_wall_time(struct record_context *ctx)
 			I_DEVICE,
 			"# Current time is %02d:%02d:%02d\n",
 			tm.tm_hour, tm.tm_min, tm.tm_sec);
-		fflush(d->fp);
+		if (ctx->format == FORMAT_BINARY)
+			binary_flush_text(d, d->index);
+		else
+			fflush(d->fp);
 	}
+
+	if (ctx->format == FORMAT_BINARY)
+		binary_flush(ctx);
 }
 
 static void
@@ -2168,11 +2507,19 @@ mainloop(struct record_context *ctx)
 
 		iprintf(ctx->first_device->fp, I_TOPLEVEL, "devices:\n");
 
+		if (ctx->format == FORMAT_BINARY)
+			binary_flush_text(ctx->first_device,
+					  RECORD_BIN_NO_DEVICE);
+
 		/* we only print the first device's description, the
 		 * rest is assembled after CTRL+C */
 		list_for_each(d, &ctx->devices, link) {
 			print_device_description(d);
 			iprintf(d->fp, I_DEVICE, "events:\n");
+			if (ctx->format == FORMAT_BINARY) {
+				binary_flush_text(d, d->index);
+				binary_write_abs_state(d);
+			}
 		}
 		print_wall_time(ctx);
 
@@ -2181,7 +2528,8 @@ mainloop(struct record_context *ctx)
 			handle_libinput_events(ctx, ctx->first_device, true);
 		}
 
-		while (true) {
+		/* stop is also set if writing the recording failed */
+		while (!ctx->stop) {
 			int rc = dispatch_sources(ctx);
 			if (rc < 0) { /* error */
 				fprintf(stderr, "Error: %s\n", strerror(-rc));
@@ -2201,7 +2549,9 @@ mainloop(struct record_context *ctx)
 
 			}
 
-			if (ctx->first_device->fp != stdout)
+			if (ctx->format == FORMAT_BINARY ?
+			    ctx->out != stdout :
+			    ctx->first_device->fp != stdout)
 				print_progress_bar();
 
 		}
@@ -2215,6 +2565,36 @@ mainloop(struct record_context *ctx)
 			}
 		}
 
+		if (ctx->format == FORMAT_BINARY) {
+			list_for_each(d, &ctx->devices, link) {
+				binary_flush_text(d, d->index);
+				binary_close_text(d);
+			}
+			binary_flush(ctx);
+
+			if (ctx->write_error != 0) {
+				fprintf(stderr,
+					"Failed to write to '%s' (%s), the recording is incomplete\n",
+					ctx->output_file.name_with_suffix,
+					strerror(ctx->write_error));
+			}
+
+			if (ctx->out != stdout) {
+				fclose(ctx->out);
+				if (!ctx->had_events && ctx->write_error == 0) {
+					fprintf(stderr,
+						"No events recorded, deleting '%s'\n",
+						ctx->output_file.name_with_suffix);
+					unlink(ctx->output_file.name_with_suffix);
+				}
+			}
+			ctx->out = NULL;
+
+			free(ctx->output_file.name_with_suffix);
+			ctx->output_file.name_with_suffix = NULL;
+			continue;
+		}
+
 		/* First device is printed, now append all the data from the
 		 * other devices, if any */
 		list_for_each(d, &ctx->devices, link) {
@@ -2265,7 +2645,7 @@ mainloop(struct record_context *ctx)
 	}
 	close(ctx->epoll_fd);
 
-	return 0;
+	return ctx->write_error != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
 }
 
 static bool
@@ -2313,6 +2693,7 @@ init_device(struct record_context *ctx, const char *path, bool grab)
 	if (libevdev_get_num_slots(d->evdev) > 0)
 		d->touch.is_touch_device = true;
 
+	d->index = ctx->ndevices;
 	list_append(&ctx->devices, &d->link);
 	if (!ctx->first_device)
 		ctx->first_device = d;
@@ -2376,10 +2757,528 @@ init_libinput(struct record_context *ctx)
 	return true;
 }
 
+/* Upper limit for the device index when converting, anything above this
+ * is assumed to be a corrupt file */
+#define RECORD_BIN_MAX_DEVICES 1024
+
+struct convert_device {
+	FILE *fp;
+	char *text;
+	size_t text_len;
+	struct libevdev *evdev;	/* previous values for the deltas */
+	struct touch_state touch;
+};
+
+static void
+convert_device_init(struct convert_device *d)
+{
+	d->fp = open_memstream(&d->text, &d->text_len);
+	assert(d->fp);
+}
+
+static void
+convert_device_finish(struct convert_device *d, FILE *out)
+{
+	if (!d->fp)
+		return;
+
+	fclose(d->fp);
+	fwrite(d->text, 1, d->text_len, out);
+	free(d->text);
+	libevdev_free(d->evdev);
+}
+
+static struct libevdev *
+convert_abs_state(const struct record_bin_abs *abs, size_t nabs)
+{
+	struct libevdev *evdev = libevdev_new();
+	int current_slot = -1;
+
+	assert(evdev);
+
+	for (size_t i = 0; i < nabs; i++) {
+		struct input_absinfo absinfo = {
+			.minimum = abs[i].minimum,
+			.maximum = abs[i].maximum,
+			.value = abs[i].value,
+		};
+
+		if (abs[i].slot != RECORD_BIN_NO_SLOT ||
+		    abs[i].code >= ABS_CNT)
+			continue;
+
+		libevdev_enable_event_code(evdev,
+					   EV_ABS,
+					   abs[i].code,
+					   &absinfo);
+		if (abs[i].code == ABS_MT_SLOT)
+			current_slot = abs[i].value;
+	}
+
+	for (size_t i = 0; i < nabs; i++) {
+		if (abs[i].slot == RECORD_BIN_NO_SLOT ||
+		    abs[i].code >= ABS_CNT)
+			continue;
+
+		libevdev_set_slot_value(evdev,
+					abs[i].slot,
+					abs[i].code,
+					abs[i].value);
+	}
+
+	if (current_slot >= 0)
+		libevdev_set_event_value(evdev, EV_ABS, ABS_MT_SLOT, current_slot);
+
+	return evdev;
+}
+
+static void
+convert_frame(struct convert_device *d,
+	      const struct record_bin_event *events,
+	      size_t nevents)
+{
+	if (!d->evdev)
+		d->evdev = libevdev_new();
+
+	iprintf(d->fp, I_EVENTTYPE, "- evdev:\n");
+	for (size_t i = 0; i < nevents; i++) {
+		struct input_event e = {
+			.type = events[i].type,
+			.code = events[i].code,
+			.value = events[i].value,
+		};
+
+		input_event_set_time(&e, events[i].time);
+		print_evdev_event_data(d->fp,
+				       d->evdev,
+				       &e,
+				       events[i].flags & RECORD_BIN_EVENT_OBFUSCATED);
+		touch_state_update(&d->touch, d->evdev, &e);
+	}
+	touch_state_print(&d->touch, d->fp);
+}
+
+static int
+convert_binary_to_yaml(FILE *in, FILE *out)
+{
+	struct record_bin_header header;
+	struct convert_device text = {0};
+	struct convert_device **devices = NULL;
+	size_t ndevices = 0;
+	void *payload = NULL;
+	size_t payload_sz = 0;
+	int rc = EXIT_FAILURE;
+
+	if (fread(&header, sizeof(header), 1, in) != 1 ||
+	    memcmp(header.magic, RECORD_BIN_MAGIC, sizeof(header.magic)) != 0) {
+		fprintf(stderr, "Not a binary libinput recording\n");
+		return EXIT_FAILURE;
+	}
+
+	if (header.version != RECORD_BIN_VERSION) {
+		fprintf(stderr,
+			"Unsupported binary format version %u\n",
+			header.version);
+		return EXIT_FAILURE;
+	}
+
+	/* The YAML format needs each device's events in one block, so
+	 * collect everything per device and write it out at the end */
+	convert_device_init(&text);
+
+	while (true) {
+		struct record_bin_chunk chunk;
+		struct convert_device *d;
+		size_t n;
+
+		n = fread(&chunk, 1, sizeof(chunk), in);
+		if (n == 0)
+			break;
+
+		if (n == sizeof(chunk) &&
+		    chunk.length > RECORD_BIN_MAX_CHUNK_SIZE) {
+			fprintf(stderr, "Invalid chunk size %u\n", chunk.length);
+			goto out;
+		}
+
+		if (n == sizeof(chunk) && chunk.length > payload_sz) {
+			payload_sz = chunk.length;
+			payload = realloc(payload, payload_sz);
+			assert(payload);
+		}
+
+		/* A recording that wasn't shut down cleanly ends in a
+		 * partial chunk, convert what we have */
+		if (n != sizeof(chunk) ||
+		    fread(payload, 1, chunk.length, in) != chunk.length) {
+			fprintf(stderr,
+				"Warning: recording is truncated, ignoring the last chunk\n");
+			break;
+		}
+
+		if (chunk.device == RECORD_BIN_NO_DEVICE) {
+			d = &text;
+		} else if (chunk.device < RECORD_BIN_MAX_DEVICES) {
+			if (chunk.device >= ndevices) {
+				size_t new_size = chunk.device + 1;
+
+				/* The memstreams point into the struct,
+				 * so these can't move */
+				devices = realloc(devices,
+						  new_size * sizeof(*devices));
+				assert(devices);
+				for (size_t i = ndevices; i < new_size; i++) {
+					devices[i] = zalloc(sizeof(*devices[i]));
+					convert_device_init(devices[i]);
+				}
+				ndevices = new_size;
+			}
+			d = devices[chunk.device];
+		} else {
+			fprintf(stderr, "Invalid device index %u\n", chunk.device);
+			goto out;
+		}
+
+		switch (chunk.type) {
+		case CHUNK_TEXT:
+			fwrite(payload, 1, chunk.length, d->fp);
+			break;
+		case CHUNK_ABS_STATE:
+			libevdev_free(d->evdev);
+			d->evdev = convert_abs_state(payload,
+						     chunk.length/sizeof(struct record_bin_abs));
+			d->touch.is_touch_device =
+				libevdev_get_num_slots(d->evdev) > 0;
+			break;
+		case CHUNK_EVDEV_FRAME:
+			convert_frame(d,
+				      payload,
+				      chunk.length/sizeof(struct record_bin_event));
+			break;
+		default:
+			/* Newer chunk types are skipped, incompatible
+			 * changes bump the version */
+			break;
+		}
+	}
+
+	rc = EXIT_SUCCESS;
+out:
+	convert_device_finish(&text, out);
+	for (size_t i = 0; i < ndevices; i++) {
+		convert_device_finish(devices[i], out);
+		free(devices[i]);
+	}
+	free(devices);
+	free(payload);
+
+	return rc;
+}
+
+enum convert_section {
+	SECTION_HEADER,
+	SECTION_DESCRIPTION,
+	SECTION_EVENTS,
+};
+
+struct convert_yaml {
+	enum convert_section section;
+	unsigned int lineno;
+
+	/* Re-uses the recording code, dev.index is the current device */
+	struct record_context ctx;
+	struct record_device dev;
+	bool in_frame;
+
+	/* Current device description, to restore the initial axis state */
+	bool in_absinfo;
+	unsigned int desc_type;
+	unsigned int desc_code;
+	int values[ABS_CNT];
+	struct record_bin_abs *abs;
+	size_t nabs;
+	size_t abs_sz;
+};
+
+static void
+convert_yaml_end_frame(struct convert_yaml *y)
+{
+	if (!y->in_frame)
+		return;
+
+	binary_write_frame(&y->dev);
+	y->in_frame = false;
+}
+
+static void
+convert_yaml_flush_text(struct convert_yaml *y)
+{
+	binary_flush_text(&y->dev,
+			  y->section == SECTION_HEADER ?
+				RECORD_BIN_NO_DEVICE : y->dev.index);
+}
+
+static void
+convert_yaml_description(struct convert_yaml *y, const char *line)
+{
+	unsigned int code, type;
+	int minimum, maximum, fuzz, flat, res, value;
+
+	if (streq(line, "absinfo:\n")) {
+		y->in_absinfo = true;
+		return;
+	}
+
+	if (y->in_absinfo) {
+		if (sscanf(line,
+			   "%u: [%d, %d, %d, %d, %d]",
+			   &code, &minimum, &maximum,
+			   &fuzz, &flat, &res) == 6 &&
+		    code < ABS_CNT) {
+			if (y->nabs >= y->abs_sz)
+				resize(y->abs, y->abs_sz);
+			y->abs[y->nabs++] = (struct record_bin_abs) {
+				.code = code,
+				.slot = RECORD_BIN_NO_SLOT,
+				.minimum = minimum,
+				.maximum = maximum,
+				.value = y->values[code],
+			};
+			return;
+		}
+		y->in_absinfo = false;
+	}
+
+	/* The human-readable description has the axis values */
+	if (sscanf(line, "# Event type %u", &type) == 1) {
+		y->desc_type = type;
+	} else if (sscanf(line, "# Event code %u", &code) == 1) {
+		y->desc_code = code;
+	} else if (sscanf(line, "# Value %d", &value) == 1) {
+		if (y->desc_type == EV_ABS && y->desc_code < ABS_CNT)
+			y->values[y->desc_code] = value;
+	}
+}
+
+static bool
+convert_yaml_event(struct convert_yaml *y, const char *line)
+{
+	struct record_device *d = &y->dev;
+	uint64_t sec;
+	unsigned int usec;
+	int type, code, value;
+
+	if (sscanf(line,
+		   "- [%" SCNu64 ", %u, %d, %d, %d]",
+		   &sec, &usec, &type, &code, &value) != 5)
+		return false;
+
+	if (d->binary.nevents >= d->binary.sz)
+		resize(d->binary.events, d->binary.sz);
+
+	d->binary.events[d->binary.nevents++] = (struct record_bin_event) {
+		.time = s2us(sec) + usec,
+		.type = type,
+		.flags = strstr(line, "(obfuscated)") ?
+				RECORD_BIN_EVENT_OBFUSCATED : 0,
+		.code = code,
+		.value = value,
+	};
+
+	return true;
+}
+
+static bool
+convert_yaml_line(struct convert_yaml *y, const char *line)
+{
+	const char *stripped = &line[strspn(line, " ")];
+
+	if (strstartswith(stripped, "- node:")) {
+		convert_yaml_end_frame(y);
+		convert_yaml_flush_text(y);
+
+		if (y->section != SECTION_HEADER)
+			y->dev.index++;
+		y->section = SECTION_DESCRIPTION;
+		y->in_absinfo = false;
+		y->desc_type = 0;
+		y->desc_code = 0;
+		memset(y->values, 0, sizeof(y->values));
+		y->nabs = 0;
+	}
+
+	switch (y->section) {
+	case SECTION_HEADER:
+		break;
+	case SECTION_DESCRIPTION:
+		if (streq(stripped, "events:\n")) {
+			fputs(line, y->dev.fp);
+			convert_yaml_flush_text(y);
+			binary_write_chunk(&y->ctx,
+					   CHUNK_ABS_STATE,
+					   y->dev.index,
+					   y->abs,
+					   y->nabs * sizeof(*y->abs));
+			y->section = SECTION_EVENTS;
+			return true;
+		}
+		convert_yaml_description(y, stripped);
+		break;
+	case SECTION_EVENTS:
+		if (streq(stripped, "- evdev:\n")) {
+			convert_yaml_end_frame(y);
+			y->in_frame = true;
+			return true;
+		}
+
+		if (y->in_frame && strstartswith(stripped, "- [")) {
+			if (!convert_yaml_event(y, stripped)) {
+				fprintf(stderr,
+					"Invalid event on line %u\n",
+					y->lineno);
+				return false;
+			}
+			return true;
+		}
+
+		/* generated during conversion to YAML */
+		if (strstartswith(stripped, "# Touch device in neutral state"))
+			return true;
+
+		convert_yaml_end_frame(y);
+		break;
+	}
+
+	fputs(line, y->dev.fp);
+
+	return true;
+}
+
+static int
+convert_yaml_to_binary(FILE *in, FILE *out)
+{
+	struct convert_yaml y = {
+		.section = SECTION_HEADER,
+		.ctx = {
+			.out = out,
+		},
+	};
+	char *line = NULL;
+	size_t sz = 0;
+	int rc = EXIT_FAILURE;
+
+	y.dev.ctx = &y.ctx;
+	binary_open_text(&y.dev);
+	binary_write_header(&y.ctx);
+
+	while (getline(&line, &sz, in) != -1) {
+		y.lineno++;
+		if (!convert_yaml_line(&y, line))
+			goto out;
+		if (y.ctx.write_error != 0)
+			break;
+	}
+
+	convert_yaml_end_frame(&y);
+	convert_yaml_flush_text(&y);
+	binary_flush(&y.ctx);
+	if (y.ctx.write_error != 0) {
+		fprintf(stderr,
+			"Failed to write the recording (%s)\n",
+			strerror(y.ctx.write_error));
+		goto out;
+	}
+	rc = EXIT_SUCCESS;
+out:
+	binary_close_text(&y.dev);
+	free(y.dev.binary.events);
+	free(y.abs);
+	free(line);
+
+	return rc;
+}
+
+static void
+usage_convert(void)
+{
+	printf("Usage: %s convert [--help] input-file [output-file]\n"
+	       "Converts a recording from the binary format to YAML and vice versa.\n"
+	       "The input format is detected automatically, the output is written\n"
+	       "to stdout if no output file is given.\n",
+	       program_invocation_short_name);
+}
+
+static int
+record_convert(int argc, char **argv)
+{
+	const char *input, *output = NULL;
+	char magic[sizeof(RECORD_BIN_MAGIC) - 1];
+	bool is_binary;
+	FILE *in, *out;
+	int rc;
+
+	if (argc > 1 &&
+	    (streq(argv[1], "--help") || streq(argv[1], "-h"))) {
+		usage_convert();
+		return EXIT_SUCCESS;
+	}
+
+	if (argc < 2 || argc > 3) {
+		usage_convert();
+		return EXIT_INVALID_USAGE;
+	}
+
+	input = argv[1];
+	if (argc > 2)
+		output = argv[2];
+
+	in = fopen(input, "rb");
+	if (!in) {
+		fprintf(stderr, "Failed to open '%s' (%m)\n", input);
+		return EXIT_FAILURE;
+	}
+
+	is_binary = fread(magic, sizeof(magic), 1, in) == 1 &&
+		    memcmp(magic, RECORD_BIN_MAGIC, sizeof(magic)) == 0;
+	rewind(in);
+
+	if (output) {
+		out = fopen(output, "wb");
+		if (!out) {
+			fprintf(stderr, "Failed to open '%s' (%m)\n", output);
+			fclose(in);
+			return EXIT_FAILURE;
+		}
+	} else if (!is_binary && isatty(STDOUT_FILENO)) {
+		fprintf(stderr,
+			"Refusing to write a binary recording to a terminal\n");
+		fclose(in);
+		return EXIT_INVALID_USAGE;
+	} else {
+		out = stdout;
+	}
+
+	setvbuf(out, NULL, _IOFBF, 1024 * 1024);
+
+	if (is_binary)
+		rc = convert_binary_to_yaml(in, out);
+	else
+		rc = convert_yaml_to_binary(in, out);
+
+	fclose(in);
+	if (out != stdout)
+		fclose(out);
+	else
+		fflush(out);
+
+	return rc;
+}
+
 static void
 usage(void)
 {
-	printf("Usage: %s [--help] [--all] [--autorestart] [--output-file filename] [/dev/input/event0] [...]\n"
+	printf("Usage: %s [--help] [--all] [--autorestart] [--format yaml|binary] [--output-file filename] [/dev/input/event0] [...]\n"
+	       "       %s convert input-file [output-file]\n"
 	       "Common use-cases:\n"
 	       "\n"
 	       " sudo %s -o recording.yml\n"
@@ -2393,11 +3292,18 @@ usage(void)
 	       " sudo %s -o recording.yml /dev/input/event3 /dev/input/event4\n"
 	       "    Records the two devices into the same recordings file.\n"
 	       "\n"
+	       " sudo %s --format=binary -o recording.bin\n"
+	       "    Records in the compact binary format, use\n"
+	       "    %s convert recording.bin recording.yml to convert it to YAML.\n"
+	       "\n"
 	       "For more information, see the %s(1) man page\n",
 	       program_invocation_short_name,
 	       program_invocation_short_name,
 	       program_invocation_short_name,
 	       program_invocation_short_name,
+	       program_invocation_short_name,
+	       program_invocation_short_name,
+	       program_invocation_short_name,
 	       program_invocation_short_name);
 }
 
@@ -2494,6 +3400,7 @@ enum options {
 	OPT_ALL,
 	OPT_LIBINPUT,
 	OPT_GRAB,
+	OPT_FORMAT,
 };
 
 int
@@ -2502,6 +3409,7 @@ main(int argc, char **argv)
 	struct record_context ctx = {
 		.timeout = -1,
 		.show_keycodes = false,
+		.format = FORMAT_YAML,
 	};
 	struct option opts[] = {
 		{ "autorestart", required_argument, 0, OPT_AUTORESTART },
@@ -2512,6 +3420,7 @@ main(int argc, char **argv)
 		{ "help", no_argument, 0, OPT_HELP },
 		{ "with-libinput", no_argument, 0, OPT_LIBINPUT },
 		{ "grab", no_argument, 0, OPT_GRAB },
+		{ "format", required_argument, 0, OPT_FORMAT },
 		{ 0, 0, 0, 0 },
 	};
 	struct record_device *d;
@@ -2521,6 +3430,9 @@ main(int argc, char **argv)
 	int rc = EXIT_FAILURE;
 	char **paths = NULL;
 
+	if (argc > 1 && streq(argv[1], "convert"))
+		return record_convert(argc - 1, &argv[1]);
+
 	list_init(&ctx.devices);
 	list_init(&ctx.sources);
 
@@ -2565,6 +3477,17 @@ main(int argc, char **argv)
 		case OPT_GRAB:
 			grab = true;
 			break;
+		case OPT_FORMAT:
+			if (streq(optarg, "yaml")) {
+				ctx.format = FORMAT_YAML;
+			} else if (streq(optarg, "binary")) {
+				ctx.format = FORMAT_BINARY;
+			} else {
+				usage();
+				rc = EXIT_INVALID_USAGE;
+				goto out;
+			}
+			break;
 		default:
 			usage();
 			rc = EXIT_INVALID_USAGE;
@@ -2606,6 +3529,15 @@ main(int argc, char **argv)
 
 	ctx.output_file.name = safe_strdup(output_arg);
 
+	if (output_arg == NULL &&
+	    ctx.format == FORMAT_BINARY &&
+	    isatty(STDOUT_FILENO)) {
+		fprintf(stderr,
+			"Refusing to write a binary recording to a terminal\n");
+		rc = EXIT_INVALID_USAGE;
+		goto out;
+	}
+
 	if (output_arg == NULL && (all || ndevices > 1)) {
 		fprintf(stderr,
 			"Recording multiple devices requires an output file\n");
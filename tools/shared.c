@@ -722,6 +722,7 @@ tools_list_device_quirks(struct quirks_context *ctx,
 			case QUIRK_ATTR_TRACKPOINT_INTEGRATION:
 			case QUIRK_ATTR_TPKBCOMBO_LAYOUT:
 			case QUIRK_ATTR_MSC_TIMESTAMP:
+			case QUIRK_ATTR_TABLET_SMOOTHING:
 				quirks_get_string(quirks, q, &s);
 				snprintf(buf, sizeof(buf), "%s=%s", name, s);
 				callback(userdata, buf);
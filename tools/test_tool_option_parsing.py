@@ -360,6 +360,103 @@ def test_libinput_record_autorestart(libinput_record, recording):
     libinput_record.run_command_success(["-o", recording, "--autorestart=2"])
 
 
+def test_libinput_record_format(libinput_record, recording):
+    libinput_record.run_command_success(["--format=yaml", "-o", recording])
+    libinput_record.run_command_success(["--format=binary", "-o", recording])
+    libinput_record.run_command_invalid(["--format=foo", "-o", recording])
+
+
+def test_libinput_record_convert_invalid(libinput_record, recording):
+    libinput_record.run_command_invalid(["convert"])
+    libinput_record.run_command_invalid(
+        ["convert", recording, recording, recording]
+    )
+
+
+RECORDING = """# libinput record
+version: 1
+ndevices: 1
+libinput:
+  version: "1.17.0"
+  git: "unknown"
+system:
+  kernel: "5.10.0"
+  dmi: "unknown"
+devices:
+- node: /dev/input/event5
+  evdev:
+    # Name: Test Touchpad
+    # Event type 3 (EV_ABS)
+    #   Event code 0 (ABS_X)
+    #       Value        100
+    name: "Test Touchpad"
+    id: [29, 1739, 0, 0]
+    codes:
+      0: [0] # EV_SYN
+      1: [30] # EV_KEY
+      3: [0, 47, 53, 57] # EV_ABS
+    absinfo:
+      0: [0, 4000, 0, 0, 40]
+      47: [0, 1, 0, 0, 0]
+      53: [0, 4000, 0, 0, 40]
+      57: [0, 65535, 0, 0, 0]
+    properties: [0]
+  events:
+  # Current time is 10:00:00
+  - evdev:
+    - [  0,      0,   3,  57,      12] # EV_ABS / ABS_MT_TRACKING_ID       12
+    - [  0,      0,   3,  53,     200] # EV_ABS / ABS_MT_POSITION_X      200 (+200)
+    - [  0,      0,   3,   0,     200] # EV_ABS / ABS_X                  200 (+100)
+    - [  0,      0,   0,   0,       0] # ------------ SYN_REPORT (0) ---------- +0ms
+  - evdev:
+    - [  0,  12000,   3,  57,      -1] # EV_ABS / ABS_MT_TRACKING_ID       -1
+    - [  0,  12000,   0,   0,       0] # ------------ SYN_REPORT (0) ---------- +12ms
+    libinput:
+    - {time: 0.012, type: POINTER_MOTION, delta: [  1.00,  0.00], unaccel: [  1.00,  0.00]}
+  - evdev:
+    - [  1,     30,   1,  30,       1] # EV_KEY / KEY_A                    1 (obfuscated)
+    - [  1,     30,   0,   0,       0] # ------------ SYN_REPORT (0) ---------- +988ms
+"""
+
+
+def test_libinput_record_convert(libinput_record, tmp_path):
+    yaml = pytest.importorskip("yaml")
+
+    original = tmp_path / "original.yml"
+    original.write_text(RECORDING)
+    binary = tmp_path / "recording.bin"
+    converted = tmp_path / "converted.yml"
+    binary2 = tmp_path / "recording2.bin"
+
+    # YAML to binary and back must keep all data, converting the result
+    # again must produce the identical binary file
+    conversions = [(original, binary), (binary, converted), (converted, binary2)]
+    for src, dst in conversions:
+        rc, stdout, stderr = libinput_record.run_command(
+            ["convert", str(src), str(dst)]
+        )
+        assert rc == 0, (stdout, stderr)
+
+    assert binary.read_bytes() == binary2.read_bytes()
+    assert yaml.safe_load(original.read_text()) == yaml.safe_load(
+        converted.read_text()
+    )
+
+
+def test_libinput_record_convert_short_write(libinput_record, tmp_path):
+    if not os.path.exists("/dev/full"):
+        pytest.skip("/dev/full not available")
+
+    original = tmp_path / "original.yml"
+    original.write_text(RECORDING)
+
+    rc, stdout, stderr = libinput_record.run_command(
+        ["convert", str(original), "/dev/full"]
+    )
+    assert rc == 1, (stdout, stderr)
+    assert "Failed to write" in stderr
+
+
 def main():
     args = ["-m", "pytest"]
     try: